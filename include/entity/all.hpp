@@ -18,12 +18,27 @@
 #include <entity/entity.hpp>
 #include <entity/entity_index.hpp>
 #include <entity/entity_pool.hpp>
+#include <entity/memory_usage.hpp>
+#include <entity/profile.hpp>
+#include <entity/registry.hpp>
+#include <entity/sharded_world.hpp>
+#include <entity/shrink_policy.hpp>
+#include <entity/world.hpp>
+#include <entity/component/adaptive_pool.hpp>
+#include <entity/component/component_events.hpp>
+#include <entity/component/cow_pool.hpp>
 #include <entity/component/creation_queue.hpp>
 #include <entity/component/destruction_queue.hpp>
 #include <entity/component/dense_pool.hpp>
+#include <entity/component/hashed_pool.hpp>
+#include <entity/component/hierarchy_pool.hpp>
 #include <entity/component/saturated_pool.hpp>
+#include <entity/component/shared_value_pool.hpp>
 #include <entity/component/sparse_pool.hpp>
+#include <entity/component/spatial_grid.hpp>
+#include <entity/component/tag_pool.hpp>
 #include <entity/iterator/zip_iterator.hpp>
 #include <entity/range/combine.hpp>
+#include <entity/range/fuse.hpp>
 
 #endif // ENTITY_ALL_H_INCLUDED_
\ No newline at end of file
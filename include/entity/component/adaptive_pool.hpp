@@ -0,0 +1,1033 @@
+// ****************************************************************************
+// entity/component/adaptive_pool.h
+//
+// Represents a component pool that picks its own layout at runtime.  While
+// few entities have the component it is stored as a sparse set, like
+// sparse_pool, and once occupancy grows it is stored indexed by entity with
+// an occupancy bitset, like dense_pool.  Components migrate between the
+// two a step at a time so no single call pays for the whole move.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_COMPONENT_ADAPTIVEPOOL_H_INCLUDED_
+#define ENTITY_COMPONENT_ADAPTIVEPOOL_H_INCLUDED_
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/signals2.hpp>
+#include <boost/signals2/connection.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
+#include "entity/component/optional.hpp"
+#include "entity/entity.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
+#include "entity/support/bit_ops.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace component
+{
+	template<typename ComponentPool>
+	class creation_queue;
+	template<typename ComponentPool>
+	class destruction_queue;
+
+	/// \brief Hysteresis thresholds for switching adaptive_pool layouts.
+	///
+	/// A sparse pool starts migrating to the dense layout once the fraction
+	/// of entities with the component reaches dense_occupancy, and a dense
+	/// pool migrates back once it falls to sparse_occupancy.  The gap
+	/// between the two keeps a pool hovering around one threshold from
+	/// migrating back and forth.  Each create and destroy during a
+	/// migration moves migrate_per_operation components along with it; the
+	/// rest is left to adapt_step or a shrink_scheduler.
+	///
+	class adaptive_policy
+	{
+	public:
+
+		explicit adaptive_policy(
+			double dense_occupancy = 0.5,
+			double sparse_occupancy = 0.125,
+			std::size_t migrate_per_operation = 2)
+			: dense_occupancy_(dense_occupancy)
+			, sparse_occupancy_(std::min(sparse_occupancy, dense_occupancy))
+			, migrate_per_operation_(migrate_per_operation)
+		{}
+
+		std::size_t migrate_per_operation() const
+		{
+			return migrate_per_operation_;
+		}
+
+		double dense_occupancy() const
+		{
+			return dense_occupancy_;
+		}
+
+		double sparse_occupancy() const
+		{
+			return sparse_occupancy_;
+		}
+
+	private:
+
+		double dense_occupancy_;
+		double sparse_occupancy_;
+		std::size_t migrate_per_operation_;
+	};
+
+	enum class adaptive_layout
+	{
+		sparse,
+		dense,
+		migrating_to_dense,
+		migrating_to_sparse,
+	};
+
+	template<typename T, typename Allocator = std::allocator<T>>
+	class adaptive_pool
+	{
+		typedef std::uint64_t word_type;
+		static std::size_t const bits_per_word = 64;
+
+		struct element_t
+		{
+			alignas(T) char mem_[sizeof(T)];
+		};
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<entity_index_t> index_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<T> component_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<element_t> element_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<word_type> word_allocator_type;
+
+		typedef std::vector<entity_index_t, index_allocator_type> index_table_t;
+		typedef std::vector<T, component_allocator_type> component_table_t;
+		typedef std::vector<element_t, element_allocator_type> element_table_t;
+		typedef std::vector<word_type, word_allocator_type> word_table_t;
+
+		// Visits the sparse components first, then the dense ones,
+		// skipping whole words of the bitset without components.
+		template<typename ValueType>
+		struct iterator_impl
+			  : boost::iterator_facade<
+			    iterator_impl<ValueType>
+			  , ValueType&
+			  , boost::forward_traversal_tag
+		  	>
+		{
+			iterator_impl()
+			{}
+
+			entity get_entity() const
+			{
+				if(index_ < parent_->components_.size())
+					return make_entity(parent_->owners_[index_]);
+
+				return make_entity(static_cast<entity_index_t>(
+					word_ * bits_per_word + support::count_trailing_zeros(bits_)
+				));
+			}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class adaptive_pool;
+
+			typedef typename std::conditional<
+				std::is_const<ValueType>::value,
+				adaptive_pool const,
+				adaptive_pool
+			>::type parent_type;
+
+			iterator_impl(parent_type* parent, bool at_begin)
+				: parent_(parent)
+				, index_(at_begin ? 0 : parent->components_.size())
+				, word_(at_begin ? 0 : parent->bits_.size())
+				, bits_(at_begin && !parent->bits_.empty() ? parent->bits_[0] : 0)
+			{
+				if(index_ == parent_->components_.size())
+					skip_empty_words();
+			}
+
+			void skip_empty_words()
+			{
+				std::size_t const count = parent_->bits_.size();
+				while(bits_ == 0 && word_ < count)
+				{
+					++word_;
+					bits_ = word_ < count ? parent_->bits_[word_] : 0;
+				}
+			}
+
+			void increment()
+			{
+				if(index_ < parent_->components_.size())
+				{
+					if(++index_ == parent_->components_.size())
+						skip_empty_words();
+					return;
+				}
+
+				bits_ &= bits_ - 1;
+				skip_empty_words();
+			}
+
+			bool equal(iterator_impl const& other) const
+			{
+				return index_ == other.index_
+					&& word_ == other.word_
+					&& bits_ == other.bits_;
+			}
+
+			ValueType& dereference() const
+			{
+				if(index_ < parent_->components_.size())
+					return parent_->components_[index_];
+
+				return *parent_->get_dense(static_cast<entity_index_t>(
+					word_ * bits_per_word + support::count_trailing_zeros(bits_)
+				));
+			}
+
+			parent_type* parent_;
+			std::size_t index_;
+			std::size_t word_;
+			word_type bits_;
+		};
+
+		template<typename ValueType>
+		struct optional_iterator_impl
+			  : boost::iterator_facade<
+			    optional_iterator_impl<ValueType>
+			  , optional<ValueType>
+			  , boost::forward_traversal_tag
+			  , optional<ValueType>
+		  	>
+		{
+			optional_iterator_impl()
+			{}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class adaptive_pool;
+
+			typedef typename std::conditional<
+				std::is_const<ValueType>::value,
+				adaptive_pool const,
+				adaptive_pool
+			>::type parent_type;
+
+			optional_iterator_impl(parent_type* parent, entity_index_t idx)
+				: parent_(parent)
+				, index_(idx)
+			{}
+
+			void increment()
+			{
+				++index_;
+			}
+
+			bool equal(optional_iterator_impl const& other) const
+			{
+				return index_ == other.index_;
+			}
+
+			optional<ValueType> dereference() const
+			{
+				return parent_->get(make_entity(index_));
+			}
+
+			parent_type* parent_;
+			entity_index_t index_;
+		};
+
+	public:
+
+		typedef T type;
+		typedef T value_type;
+		typedef Allocator allocator_type;
+		typedef optional<T> optional_type;
+		typedef optional<T const> const_optional_type;
+		typedef iterator_impl<T> iterator;
+		typedef iterator_impl<T const> const_iterator;
+		typedef optional_iterator_impl<T> optional_iterator;
+		typedef optional_iterator_impl<T const> const_optional_iterator;
+
+		// --------------------------------------------------------------------
+		//
+		template<typename... Args>
+		adaptive_pool(entity_pool& owner_pool, Args&&... args)
+			: adaptive_pool(
+				std::allocator_arg,
+				Allocator(),
+				owner_pool,
+				std::forward<Args>(args)...)
+		{}
+
+		template<typename... Args>
+		adaptive_pool(
+			std::allocator_arg_t,
+			Allocator const& alloc,
+			entity_pool& owner_pool,
+			Args&&... args)
+			: sparse_table_(index_allocator_type(alloc))
+			, components_(component_allocator_type(alloc))
+			, owners_(index_allocator_type(alloc))
+			, dense_(element_allocator_type(alloc))
+			, bits_(word_allocator_type(alloc))
+			, layout_(adaptive_layout::sparse)
+			, entity_count_(0)
+			, dense_count_(0)
+			, cursor_(0)
+		{
+			// Create default values for existing entities.
+			std::for_each(
+				owner_pool.begin(),
+				owner_pool.end(),
+				[this](entity e)
+				{
+					handle_create_entity(e);
+				}
+			);
+
+			std::for_each(
+				owner_pool.begin(),
+				owner_pool.end(),
+				[&args..., this](entity e)
+				{
+					create(e, std::forward<Args>(args)...);
+				}
+			);
+
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					[this](entity e)
+					{
+						handle_create_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_destroy_handler =
+				owner_pool.signals().on_entity_destroy.connect(
+					[this](entity e)
+					{
+						handle_destroy_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_swap_handler =
+				owner_pool.signals().on_entity_swap.connect(
+					[this](entity a, entity b)
+					{
+						handle_swap_entity(a, b);
+					}
+				)
+			;
+		}
+
+		~adaptive_pool()
+		{
+			destroy_dense_components();
+		}
+
+		template<typename... Args>
+		void auto_create_components(entity_pool& owner_pool, Args... args)
+		{
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					std::function<void(entity)>(
+						[this, args...](entity e)
+						{
+							handle_create_entity(e);
+							create(e, args...);
+						}
+					)
+				)
+			;
+		}
+
+		template<typename... Args>
+		T* create(entity e, Args&&... args)
+		{
+			if(creates_dense())
+			{
+				new(dense_[e.index()].mem_) T(std::forward<Args>(args)...);
+				bits_[word_of(e.index())] |= bit_of(e.index());
+				++dense_count_;
+			}
+			else
+			{
+				sparse_table_[e.index()] = static_cast<entity_index_t>(components_.size());
+				components_.emplace_back(std::forward<Args>(args)...);
+				owners_.emplace_back(e.index());
+			}
+
+			update_layout();
+
+			// Migrating may move the new component, so look it up again.
+			migrate_some();
+			return std::addressof(*get(e));
+		}
+
+		void destroy(entity e)
+		{
+			if(in_dense(e.index()))
+			{
+				get_dense(e.index())->~T();
+				bits_[word_of(e.index())] &= ~bit_of(e.index());
+				--dense_count_;
+			}
+			else
+			{
+				destroy_sparse(e.index());
+			}
+
+			update_layout();
+			migrate_some();
+		}
+
+		optional<T> get(entity e)
+		{
+			if(in_dense(e.index()))
+				return *get_dense(e.index());
+
+			if(in_sparse(e.index()))
+				return components_[sparse_table_[e.index()]];
+
+			return boost::none;
+		}
+
+		optional<const T> get(entity e) const
+		{
+			if(in_dense(e.index()))
+				return *get_dense(e.index());
+
+			if(in_sparse(e.index()))
+				return components_[sparse_table_[e.index()]];
+
+			return boost::none;
+		}
+
+		iterator begin()
+		{
+			return iterator(this, true);
+		}
+
+		iterator end()
+		{
+			return iterator(this, false);
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this, true);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(this, false);
+		}
+
+		optional_iterator optional_begin()
+		{
+			return optional_iterator(this, 0);
+		}
+
+		optional_iterator optional_end()
+		{
+			return optional_iterator(this, entity_count_);
+		}
+
+		const_optional_iterator optional_begin() const
+		{
+			return const_optional_iterator(this, 0);
+		}
+
+		const_optional_iterator optional_end() const
+		{
+			return const_optional_iterator(this, entity_count_);
+		}
+
+		std::size_t size() const
+		{
+			return components_.size() + dense_count_;
+		}
+
+		adaptive_layout layout() const
+		{
+			return layout_;
+		}
+
+		void set_policy(adaptive_policy const& policy)
+		{
+			policy_ = policy;
+			update_layout();
+		}
+
+		adaptive_policy const& policy() const
+		{
+			return policy_;
+		}
+
+		// Moves at most budget bytes worth of components towards the
+		// layout being migrated to.  Returns the number of bytes spent.
+		std::size_t adapt_step(std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("adaptive_pool::adapt_step");
+			std::size_t spent = 0;
+			if(layout_ == adaptive_layout::migrating_to_dense)
+			{
+				while(!components_.empty() && spent + sizeof(T) <= budget)
+				{
+					move_to_dense();
+					spent += sizeof(T);
+				}
+
+				if(components_.empty())
+					finish_migration(adaptive_layout::dense);
+			}
+			else if(layout_ == adaptive_layout::migrating_to_sparse)
+			{
+				while(dense_count_ && spent + sizeof(T) <= budget)
+				{
+					move_to_sparse();
+					spent += sizeof(T);
+				}
+
+				if(!dense_count_)
+					finish_migration(adaptive_layout::sparse);
+			}
+
+			return spent;
+		}
+
+		// Completes any migration in progress.
+		void adapt()
+		{
+			adapt_step(std::numeric_limits<std::size_t>::max());
+		}
+
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("adaptive_pool::reserve");
+			if(creates_dense())
+			{
+				dense_.reserve(count);
+				bits_.reserve(words_for(count));
+			}
+			else
+			{
+				components_.reserve(count);
+				owners_.reserve(count);
+			}
+		}
+
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("adaptive_pool::shrink_to_fit");
+			sparse_table_.shrink_to_fit();
+			components_.shrink_to_fit();
+			owners_.shrink_to_fit();
+			dense_.shrink_to_fit();
+			bits_.shrink_to_fit();
+		}
+
+		// Completes any migration and shrinks.
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("adaptive_pool::compact");
+			adapt();
+			shrink_to_fit();
+		}
+
+		// Spends the budget on migration first, then on shrinking storage
+		// according to policy, so a shrink_scheduler also drives layout
+		// changes in the background.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("adaptive_pool::shrink_step");
+			std::size_t spent = adapt_step(budget);
+			spent += policy.shrink(components_, budget - spent);
+			spent += policy.shrink(owners_, budget - spent);
+			spent += policy.shrink(sparse_table_, budget - spent);
+			spent += policy.shrink(dense_, budget - spent);
+			spent += policy.shrink(bits_, budget - spent);
+			return spent;
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = size();
+			usage.slot_count = components_.size() + dense_.size();
+			usage.live_bytes = size() * sizeof(T);
+			usage.reserved_bytes =
+				(components_.capacity() + dense_.capacity()) * sizeof(T)
+			;
+			usage.index_bytes =
+				(sparse_table_.capacity() + owners_.capacity()) * sizeof(entity_index_t) +
+				bits_.capacity() * sizeof(word_type)
+			;
+			return usage;
+		}
+
+		allocator_type get_allocator() const
+		{
+			return allocator_type(components_.get_allocator());
+		}
+
+	private:
+
+		static entity_index_t no_component_flag()
+		{
+			return std::numeric_limits<entity_index_t>::max();
+		}
+
+		static std::size_t words_for(std::size_t entity_count)
+		{
+			return (entity_count + bits_per_word - 1) / bits_per_word;
+		}
+
+		static std::size_t word_of(entity_index_t idx)
+		{
+			return idx / bits_per_word;
+		}
+
+		static word_type bit_of(entity_index_t idx)
+		{
+			return word_type(1) << (idx % bits_per_word);
+		}
+
+		// Which tables exist depends on the layout; both do while migrating.
+		bool has_sparse_tables() const
+		{
+			return layout_ != adaptive_layout::dense;
+		}
+
+		bool has_dense_tables() const
+		{
+			return layout_ != adaptive_layout::sparse;
+		}
+
+		bool creates_dense() const
+		{
+			return layout_ == adaptive_layout::dense
+				|| layout_ == adaptive_layout::migrating_to_dense;
+		}
+
+		bool in_dense(entity_index_t idx) const
+		{
+			return has_dense_tables() && (bits_[word_of(idx)] & bit_of(idx)) != 0;
+		}
+
+		bool in_sparse(entity_index_t idx) const
+		{
+			return has_sparse_tables() && sparse_table_[idx] != no_component_flag();
+		}
+
+		T* get_dense(entity_index_t idx)
+		{
+			return reinterpret_cast<T*>(dense_[idx].mem_);
+		}
+
+		T const* get_dense(entity_index_t idx) const
+		{
+			return reinterpret_cast<T const*>(dense_[idx].mem_);
+		}
+
+		void destroy_sparse(entity_index_t idx)
+		{
+			using std::swap;
+			entity_index_t const slot = sparse_table_[idx];
+			swap(components_[slot], components_.back());
+			components_.pop_back();
+			owners_[slot] = owners_.back();
+			owners_.pop_back();
+			sparse_table_[idx] = no_component_flag();
+
+			if(slot < owners_.size())
+				sparse_table_[owners_[slot]] = slot;
+		}
+
+		bool loaded_tables_match(std::uint32_t layout, std::size_t entity_count) const
+		{
+			if(layout > static_cast<std::uint32_t>(adaptive_layout::migrating_to_sparse) ||
+				entity_count_ != entity_count ||
+				owners_.size() != components_.size())
+			{
+				return false;
+			}
+
+			for(entity_index_t owner : owners_)
+			{
+				if(owner >= entity_count)
+					return false;
+			}
+
+			if(layout != static_cast<std::uint32_t>(adaptive_layout::dense))
+			{
+				if(sparse_table_.size() != entity_count)
+					return false;
+
+				for(entity_index_t slot : sparse_table_)
+				{
+					if(slot != no_component_flag() && slot >= components_.size())
+						return false;
+				}
+			}
+
+			if(layout != static_cast<std::uint32_t>(adaptive_layout::sparse))
+			{
+				if(dense_.size() != entity_count || bits_.size() != words_for(entity_count))
+					return false;
+
+				if(entity_count % bits_per_word != 0 &&
+					bits_.back() >> (entity_count % bits_per_word) != 0)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		void destroy_dense_components()
+		{
+			for(std::size_t w = 0; w < bits_.size(); ++w)
+			{
+				for(word_type bits = bits_[w]; bits; bits &= bits - 1)
+				{
+					get_dense(static_cast<entity_index_t>(
+						w * bits_per_word + support::count_trailing_zeros(bits)
+					))->~T();
+				}
+
+				bits_[w] = 0;
+			}
+
+			dense_count_ = 0;
+		}
+
+		// Starts, reverses or abandons a migration when occupancy crosses
+		// one of the policy's thresholds.
+		void update_layout()
+		{
+			double const occupancy = entity_count_
+				? double(size()) / double(entity_count_)
+				: 0.0
+			;
+
+			bool const want_dense = occupancy >= policy_.dense_occupancy();
+			bool const want_sparse = occupancy <= policy_.sparse_occupancy();
+			switch(layout_)
+			{
+			case adaptive_layout::sparse:
+				if(want_dense)
+				{
+					dense_.resize(entity_count_);
+					bits_.assign(words_for(entity_count_), 0);
+					layout_ = adaptive_layout::migrating_to_dense;
+				}
+				break;
+			case adaptive_layout::dense:
+				if(want_sparse)
+				{
+					sparse_table_.assign(entity_count_, no_component_flag());
+					cursor_ = 0;
+					layout_ = adaptive_layout::migrating_to_sparse;
+				}
+				break;
+			case adaptive_layout::migrating_to_dense:
+				if(want_sparse)
+				{
+					cursor_ = 0;
+					layout_ = adaptive_layout::migrating_to_sparse;
+				}
+				break;
+			case adaptive_layout::migrating_to_sparse:
+				if(want_dense)
+					layout_ = adaptive_layout::migrating_to_dense;
+				break;
+			}
+		}
+
+		void migrate_some()
+		{
+			if(layout_ == adaptive_layout::migrating_to_dense ||
+			   layout_ == adaptive_layout::migrating_to_sparse)
+			{
+				adapt_step(policy_.migrate_per_operation() * sizeof(T));
+			}
+		}
+
+		void finish_migration(adaptive_layout layout)
+		{
+			layout_ = layout;
+			if(layout == adaptive_layout::dense)
+			{
+				index_table_t().swap(sparse_table_);
+				component_table_t().swap(components_);
+				index_table_t().swap(owners_);
+			}
+			else
+			{
+				element_table_t().swap(dense_);
+				word_table_t().swap(bits_);
+			}
+		}
+
+		// Moves the last sparse component into its dense slot.
+		void move_to_dense()
+		{
+			entity_index_t const idx = owners_.back();
+			new(dense_[idx].mem_) T(std::move(components_.back()));
+			bits_[word_of(idx)] |= bit_of(idx);
+			++dense_count_;
+
+			components_.pop_back();
+			owners_.pop_back();
+			sparse_table_[idx] = no_component_flag();
+		}
+
+		// Moves the next dense component found from the cursor into the
+		// sparse set.  Swaps can move components behind the cursor, so it
+		// wraps around until the dense part is empty.
+		void move_to_sparse()
+		{
+			if(cursor_ >= bits_.size())
+				cursor_ = 0;
+
+			while(bits_[cursor_] == 0)
+			{
+				if(++cursor_ == bits_.size())
+					cursor_ = 0;
+			}
+
+			entity_index_t const idx = static_cast<entity_index_t>(
+				cursor_ * bits_per_word + support::count_trailing_zeros(bits_[cursor_])
+			);
+
+			T* p = get_dense(idx);
+			sparse_table_[idx] = static_cast<entity_index_t>(components_.size());
+			components_.push_back(std::move(*p));
+			owners_.push_back(idx);
+			p->~T();
+			bits_[cursor_] &= ~bit_of(idx);
+			--dense_count_;
+		}
+
+		// No copying
+		adaptive_pool(adaptive_pool const&);
+		adaptive_pool operator=(adaptive_pool);
+
+		friend class creation_queue<adaptive_pool>;
+		friend class destruction_queue<adaptive_pool>;
+		friend struct serialization::access;
+		friend struct lifecycle_access;
+
+		struct slot_list
+		{
+			boost::signals2::scoped_connection entity_create_handler;
+			boost::signals2::scoped_connection entity_destroy_handler;
+			boost::signals2::scoped_connection entity_swap_handler;
+		};
+
+		// --------------------------------------------------------------------
+		// Serialization interface.  Both layouts are written as they are,
+		// so a pool loads mid-migration if it was saved mid-migration.
+		template<typename Writer>
+		void save(Writer& writer) const
+		{
+			writer.write_value(std::uint32_t(layout_));
+			writer.write_table(sparse_table_);
+			writer.write_table(components_);
+			writer.write_table(owners_);
+			writer.write_table(dense_);
+			writer.write_table(bits_);
+			writer.write_value(std::uint64_t(entity_count_));
+		}
+
+		template<typename Reader>
+		void load(Reader& reader)
+		{
+			destroy_dense_components();
+
+			std::uint32_t layout = 0;
+			reader.read_value(layout);
+			reader.read_table(sparse_table_);
+			reader.read_table(components_);
+			reader.read_table(owners_);
+			reader.read_table(dense_);
+			reader.read_table(bits_);
+
+			std::uint64_t entity_count = 0;
+			reader.read_value(entity_count);
+			entity_count_ = static_cast<entity_index_t>(entity_count);
+
+			// Checked before anything walks the bits, including our own
+			// destructor if the check throws.
+			if(!loaded_tables_match(layout, reader.entity_count()))
+			{
+				bits_.clear();
+				reader.check(false);
+			}
+
+			layout_ = static_cast<adaptive_layout>(layout);
+
+			dense_count_ = 0;
+			for(word_type w : bits_)
+			{
+				dense_count_ += support::popcount(w);
+			}
+
+			cursor_ = 0;
+		}
+
+		// --------------------------------------------------------------------
+		// Queue interface.
+		template<typename Iter>
+		void create_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				create(current->first.lock().get(), std::move(current->second));
+				++current;
+			}
+		}
+
+		template<typename Iter>
+		void destroy_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				destroy(current->lock().get());
+				++current;
+			}
+		}
+
+		// --------------------------------------------------------------------
+		// Slot Handlers.
+		void handle_create_entity(entity e)
+		{
+			entity_count_ = std::max(entity_count_, e.index() + 1);
+			if(has_sparse_tables() && sparse_table_.size() < entity_count_)
+				sparse_table_.resize(entity_count_, no_component_flag());
+
+			if(has_dense_tables() && dense_.size() < entity_count_)
+			{
+				dense_.resize(entity_count_);
+				bits_.resize(words_for(entity_count_), 0);
+			}
+
+			update_layout();
+		}
+
+		void handle_destroy_entity(entity e)
+		{
+			if(in_dense(e.index()) || in_sparse(e.index()))
+			{
+				destroy(e);
+			}
+
+			// The entity pool always destroys its last entity.
+			entity_count_ = e.index();
+			if(has_sparse_tables())
+				sparse_table_.resize(entity_count_);
+
+			if(has_dense_tables())
+			{
+				dense_.resize(entity_count_);
+				bits_.resize(words_for(entity_count_));
+			}
+
+			update_layout();
+		}
+
+		void handle_swap_entity(entity a, entity b)
+		{
+			using std::swap;
+
+			entity_index_t const ia = a.index();
+			entity_index_t const ib = b.index();
+			if(has_dense_tables())
+			{
+				bool const dense_a = in_dense(ia);
+				bool const dense_b = in_dense(ib);
+				if(dense_a && dense_b)
+				{
+					swap(*get_dense(ia), *get_dense(ib));
+				}
+				else if(dense_a != dense_b)
+				{
+					entity_index_t const from = dense_a ? ia : ib;
+					entity_index_t const to = dense_a ? ib : ia;
+					new(dense_[to].mem_) T(std::move(*get_dense(from)));
+					get_dense(from)->~T();
+					bits_[word_of(from)] &= ~bit_of(from);
+					bits_[word_of(to)] |= bit_of(to);
+				}
+			}
+
+			if(has_sparse_tables())
+			{
+				// Swap the indices instead of the components; either may
+				// have no component at all.
+				entity_index_t const slot_a = sparse_table_[ia];
+				entity_index_t const slot_b = sparse_table_[ib];
+				swap(sparse_table_[ia], sparse_table_[ib]);
+				if(slot_a != no_component_flag())
+					owners_[slot_a] = ib;
+				if(slot_b != no_component_flag())
+					owners_[slot_b] = ia;
+			}
+		}
+
+		index_table_t sparse_table_;
+		component_table_t components_;
+		index_table_t owners_;
+		element_table_t dense_;
+		word_table_t bits_;
+		adaptive_layout layout_;
+		adaptive_policy policy_;
+		entity_index_t entity_count_;
+		std::size_t dense_count_;
+		std::size_t cursor_;
+		slot_list slots_;
+	};
+} } // namespace entity { namespace component
+
+#endif // ENTITY_COMPONENT_ADAPTIVEPOOL_H_INCLUDED_
@@ -0,0 +1,321 @@
+// ****************************************************************************
+// entity/component/component_events.hpp
+//
+// Reports components added to and removed from a pool, so indexes, queries
+// and caches can follow the pool without polling it.
+//
+// Creates and destroys routed through component_events are noted as they
+// happen and dispatched together at flush(): each listener is called once
+// per flush with the span of entities that gained a component and once
+// with the span that lost one.  An entity touched several times between
+// flushes is reported once, by its net change, so a component created and
+// destroyed again inside one batch isn't reported at all.
+//
+// Entities destroyed before the flush are dropped from the batch; their
+// components go with them, which listeners hear about through the
+// entity_pool's own signals.  Changes still pending when component_events
+// is destroyed are dropped too: the pool and listeners may already be
+// gone by then, so flushing first is up to the owner.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_COMPONENT_COMPONENTEVENTS_H_INCLUDED_
+#define ENTITY_COMPONENT_COMPONENTEVENTS_H_INCLUDED_
+
+#include <boost/range/iterator_range_core.hpp>
+#include <boost/signals2.hpp>
+#include <boost/signals2/connection.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/entity.hpp"
+#include "entity/entity_index.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/profile.hpp"
+#include "entity/type_traits/component_pool.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace component
+{
+	enum class event_dispatch
+	{
+		// Listeners are called at flush() with everything since the last.
+		batched,
+
+		// Listeners are called from create and destroy with a single
+		// entity.  For debugging and low rate pools.
+		immediate
+	};
+
+	template<typename ComponentPool>
+	class component_events
+	{
+	private:
+
+		struct pending_t
+		{
+			entity_index_t entity;
+			bool was_present;
+		};
+
+		typedef typename std::allocator_traits<
+			typename ComponentPool::allocator_type
+		>::template rebind_alloc<pending_t> pending_allocator_type;
+
+		typedef typename std::allocator_traits<
+			typename ComponentPool::allocator_type
+		>::template rebind_alloc<entity_index_t> slot_allocator_type;
+
+		typedef typename std::allocator_traits<
+			typename ComponentPool::allocator_type
+		>::template rebind_alloc<entity> entity_allocator_type;
+
+	public:
+
+		static_assert(
+			!type_traits::is_saturated_pool<ComponentPool>::value,
+			"Saturated pools hold a component for every entity, so never add or remove one."
+		);
+
+		typedef boost::iterator_range<entity const*> entity_range;
+
+		struct signal_list
+		{
+			boost::signals2::signal<void(entity_range)> on_component_added;
+			boost::signals2::signal<void(entity_range)> on_component_removed;
+		};
+
+		// --------------------------------------------------------------------
+		//
+		component_events(
+			entity_pool& owner_pool,
+			ComponentPool& pool,
+			event_dispatch dispatch = event_dispatch::batched)
+			: pool_(pool)
+			, dispatch_(dispatch)
+			, flushing_(false)
+			, slots_(owner_pool.size(), 0, slot_allocator_type(pool.get_allocator()))
+			, pending_(pending_allocator_type(pool.get_allocator()))
+			, added_(entity_allocator_type(pool.get_allocator()))
+			, removed_(entity_allocator_type(pool.get_allocator()))
+		{
+			handlers_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					[this](entity e)
+					{
+						handle_create_entity(e);
+					}
+				)
+			;
+
+			handlers_.entity_destroy_handler =
+				owner_pool.signals().on_entity_destroy.connect(
+					[this](entity e)
+					{
+						handle_destroy_entity(e);
+					}
+				)
+			;
+
+			handlers_.entity_swap_handler =
+				owner_pool.signals().on_entity_swap.connect(
+					[this](entity a, entity b)
+					{
+						handle_swap_entity(a, b);
+					}
+				)
+			;
+		}
+
+		template<typename... Args>
+		auto create(entity e, Args&&... args)
+			-> decltype(std::declval<ComponentPool&>().create(e, std::forward<Args>(args)...))
+		{
+			touch(e);
+			auto ret_val = pool_.create(e, std::forward<Args>(args)...);
+			if(dispatch_ == event_dispatch::immediate)
+				flush();
+			return ret_val;
+		}
+
+		void destroy(entity e)
+		{
+			touch(e);
+			pool_.destroy(e);
+			if(dispatch_ == event_dispatch::immediate)
+				flush();
+		}
+
+		// Marks e as possibly changed by something that went to the pool
+		// directly, such as a creation_queue flush.
+		void touch(entity e)
+		{
+			entity_index_t& slot = slots_[e.index()];
+			if(slot)
+				return;
+
+			pending_t p = { e.index(), static_cast<bool>(pool_.get(e)) };
+			pending_.push_back(p);
+			slot = pending_.size();
+		}
+
+		// Calls the listeners with the net changes since the last flush, in
+		// entity order.  Listeners may touch the pool again; those changes
+		// go into the next batch.
+		void flush()
+		{
+			if(pending_.empty() || flushing_)
+				return;
+
+			ENTITY_PROFILE_ZONE("component_events::flush");
+			flush_guard guard(flushing_);
+			added_.clear();
+			removed_.clear();
+			for(auto&& p : pending_)
+			{
+				entity const e = make_entity(p.entity);
+				slots_[p.entity] = 0;
+				bool const present = static_cast<bool>(pool_.get(e));
+				if(present && !p.was_present)
+					added_.push_back(e);
+				else if(!present && p.was_present)
+					removed_.push_back(e);
+			}
+
+			pending_.clear();
+			std::sort(added_.begin(), added_.end());
+			std::sort(removed_.begin(), removed_.end());
+
+			if(!removed_.empty())
+			{
+				signals_.on_component_removed(
+					entity_range(removed_.data(), removed_.data() + removed_.size())
+				);
+			}
+
+			if(!added_.empty())
+			{
+				signals_.on_component_added(
+					entity_range(added_.data(), added_.data() + added_.size())
+				);
+			}
+		}
+
+		// Forgets the pending changes without reporting them.
+		void clear()
+		{
+			for(auto&& p : pending_)
+				slots_[p.entity] = 0;
+			pending_.clear();
+		}
+
+		// Number of entities touched since the last flush.
+		std::size_t pending() const
+		{
+			return pending_.size();
+		}
+
+		signal_list& signals()
+		{
+			return signals_;
+		}
+
+		ComponentPool& pool()
+		{
+			return pool_;
+		}
+
+	private:
+
+		// No copying
+		component_events(component_events const&);
+		component_events operator=(component_events);
+
+		struct slot_list
+		{
+			boost::signals2::scoped_connection entity_create_handler;
+			boost::signals2::scoped_connection entity_destroy_handler;
+			boost::signals2::scoped_connection entity_swap_handler;
+		};
+
+		// Keeps listeners that change the pool, and so land back in
+		// flush() when dispatch is immediate, from overwriting the spans
+		// they're reading.
+		struct flush_guard
+		{
+			explicit flush_guard(bool& flushing)
+				: flushing_(flushing)
+			{
+				flushing_ = true;
+			}
+
+			~flush_guard()
+			{
+				flushing_ = false;
+			}
+
+			bool& flushing_;
+		};
+
+		// --------------------------------------------------------------------
+		// Slot Handlers
+		void handle_create_entity(entity e)
+		{
+			slots_.insert(slots_.begin() + e.index(), 0);
+		}
+
+		void handle_destroy_entity(entity e)
+		{
+			// Swap-remove from the batch, pointing the moved entry's slot
+			// at its new position.
+			entity_index_t const slot = slots_[e.index()];
+			if(slot)
+			{
+				if(slot != pending_.size())
+				{
+					pending_[slot - 1] = pending_.back();
+					slots_[pending_[slot - 1].entity] = slot;
+				}
+
+				pending_.pop_back();
+			}
+
+			slots_.erase(slots_.begin() + e.index());
+		}
+
+		void handle_swap_entity(entity a, entity b)
+		{
+			using std::swap;
+			swap(slots_[a.index()], slots_[b.index()]);
+			if(slots_[a.index()])
+				pending_[slots_[a.index()] - 1].entity = a.index();
+			if(slots_[b.index()])
+				pending_[slots_[b.index()] - 1].entity = b.index();
+		}
+
+		ComponentPool& pool_;
+		event_dispatch dispatch_;
+		bool flushing_;
+
+		// One past each entity's position in pending_, or zero.
+		std::vector<entity_index_t, slot_allocator_type> slots_;
+		std::vector<pending_t, pending_allocator_type> pending_;
+		std::vector<entity, entity_allocator_type> added_;
+		std::vector<entity, entity_allocator_type> removed_;
+		signal_list signals_;
+		slot_list handlers_;
+	};
+} } // namespace entity { namespace component
+
+#endif // ENTITY_COMPONENT_COMPONENTEVENTS_H_INCLUDED_
@@ -0,0 +1,1075 @@
+// ****************************************************************************
+// entity/component/cow_pool.h
+//
+// Represents a component pool that can hand out immutable snapshots of
+// itself to other threads.
+//
+// Components are stored a slot per entity, as in dense_pool, but split
+// into fixed size pages.  A snapshot copies the page table, so taking one
+// is O(pages), and a write to a page shared with a snapshot copies that
+// page first.  Pages a snapshot may still be reading are retired with
+// the epoch they were replaced in and freed once every snapshot from an
+// earlier epoch has been released.
+//
+// Only the thread that owns the pool and its entity_pool may modify it or
+// take snapshots.  Snapshots can be read and released from any thread.
+// Snapshots of several pools taken back to back on the owning thread
+// form a consistent view of the world.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_COMPONENT_COWPOOL_H_INCLUDED_
+#define ENTITY_COMPONENT_COWPOOL_H_INCLUDED_
+
+#include <boost/assert.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/signals2.hpp>
+#include <boost/signals2/connection.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
+#include "entity/component/optional.hpp"
+#include "entity/entity.hpp"
+#include "entity/entity_index.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
+
+namespace boost {
+namespace iterators {
+struct forward_traversal_tag;
+}  // namespace iterators
+}  // namespace boost
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace component
+{
+	template<typename ComponentPool>
+	class creation_queue;
+	template<typename ComponentPool>
+	class destruction_queue;
+
+	namespace detail
+	{
+		// Pages hold around 1KB of components, in multiples of 64 so
+		// presence fits whole words.  Small pages keep the copies made by
+		// scattered writes small; snapshots only pay a pointer per page.
+		template<typename T>
+		struct cow_page_size
+		{
+			static std::size_t const value =
+				1024 / sizeof(T) > 64 ? (1024 / sizeof(T)) & ~std::size_t(63) : 64;
+		};
+
+		template<typename T>
+		struct cow_page
+		{
+			static std::size_t const size = cow_page_size<T>::value;
+			static std::size_t const words = size / 64;
+
+			std::uint64_t epoch;
+			std::uint64_t present[words];
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[size];
+
+			bool has(std::size_t i) const
+			{
+				return (present[i / 64] >> (i % 64)) & 1;
+			}
+
+			void set(std::size_t i, bool has)
+			{
+				std::uint64_t const bit = std::uint64_t(1) << (i % 64);
+				if(has)
+					present[i / 64] |= bit;
+				else
+					present[i / 64] &= ~bit;
+			}
+
+			T* at(std::size_t i)
+			{
+				return reinterpret_cast<T*>(&slots[i]);
+			}
+
+			T const* at(std::size_t i) const
+			{
+				return reinterpret_cast<T const*>(&slots[i]);
+			}
+		};
+
+		// --------------------------------------------------------------------
+		// Page storage shared by a cow_pool and its snapshots, so pages
+		// outlive the pool while snapshots still read them.  The mutex
+		// guards the pinned epochs; the page lists belong to the owning
+		// thread until the pool is destroyed, after which the last
+		// snapshot to go frees them under the mutex.
+		template<typename T, typename Allocator>
+		class cow_page_store
+		{
+		public:
+
+			typedef cow_page<T> page;
+			typedef typename std::allocator_traits<
+				Allocator
+			>::template rebind_alloc<page> page_allocator_type;
+
+			explicit cow_page_store(Allocator const& alloc)
+				: alloc_(alloc)
+				, pinned_count_(0)
+				, orphaned_(false)
+			{}
+
+			~cow_page_store()
+			{
+				for(auto&& r : retired_)
+					free_page(r.second);
+
+				release_spares();
+			}
+
+			// Reuses a reclaimed page where possible, so steady state
+			// copying doesn't go back to the allocator.
+			page* allocate(std::uint64_t epoch)
+			{
+				page* p;
+				if(spares_.empty())
+				{
+					p = std::allocator_traits<page_allocator_type>::allocate(alloc_, 1);
+				}
+				else
+				{
+					p = spares_.back();
+					spares_.pop_back();
+				}
+
+				p->epoch = epoch;
+				std::fill(p->present, p->present + page::words, std::uint64_t(0));
+				return p;
+			}
+
+			page* copy(page const& src, std::uint64_t epoch)
+			{
+				page* p = allocate(epoch);
+				copy_components(src, *p, std::is_trivially_copyable<T>());
+				return p;
+			}
+
+			// Frees p straight away if no snapshot can see it, otherwise
+			// keeps it until the snapshots older than epoch are gone.
+			void release(page* p, std::uint64_t epoch)
+			{
+				if(pinned_count_.load(std::memory_order_acquire) == 0)
+				{
+					free_page(p);
+					return;
+				}
+
+				retired_.push_back(std::make_pair(epoch, p));
+			}
+
+			bool is_pinned() const
+			{
+				return pinned_count_.load(std::memory_order_acquire) != 0;
+			}
+
+			void pin(std::uint64_t epoch)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				pinned_.push_back(epoch);
+				pinned_count_.store(pinned_.size(), std::memory_order_release);
+			}
+
+			void unpin(std::uint64_t epoch)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				pinned_.erase(std::find(pinned_.begin(), pinned_.end(), epoch));
+				pinned_count_.store(pinned_.size(), std::memory_order_release);
+
+				// Normally the owning thread reclaims, keeping component
+				// destructors on it, unless the pool is already gone.
+				if(orphaned_)
+					reclaim_locked();
+			}
+
+			void reclaim()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				reclaim_locked();
+			}
+
+			void orphan()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				orphaned_ = true;
+				reclaim_locked();
+			}
+
+			std::size_t retired_count() const
+			{
+				return retired_.size();
+			}
+
+			std::size_t spare_count() const
+			{
+				return spares_.size();
+			}
+
+			void release_spares()
+			{
+				for(auto&& p : spares_)
+					std::allocator_traits<page_allocator_type>::deallocate(alloc_, p, 1);
+
+				spares_.clear();
+			}
+
+			page_allocator_type const& get_allocator() const
+			{
+				return alloc_;
+			}
+
+		private:
+
+			// No copying
+			cow_page_store(cow_page_store const&);
+			cow_page_store operator=(cow_page_store const&);
+
+			void copy_components(page const& src, page& dst, std::true_type)
+			{
+				std::memcpy(dst.present, src.present, sizeof(src.present));
+				std::memcpy(dst.slots, src.slots, sizeof(src.slots));
+			}
+
+			void copy_components(page const& src, page& dst, std::false_type)
+			{
+				try
+				{
+					for(std::size_t i = 0; i < page::size; ++i)
+					{
+						if(src.has(i))
+						{
+							new(dst.at(i)) T(*src.at(i));
+							dst.set(i, true);
+						}
+					}
+				}
+				catch(...)
+				{
+					free_page(&dst);
+					throw;
+				}
+			}
+
+			void destroy_components(page& p)
+			{
+				for(std::size_t i = 0; i < page::size; ++i)
+				{
+					if(p.has(i))
+						p.at(i)->~T();
+				}
+			}
+
+			void free_page(page* p)
+			{
+				destroy_components(*p);
+				spares_.push_back(p);
+			}
+
+			// A page retired in epoch R is only visible to snapshots taken
+			// before R.
+			void reclaim_locked()
+			{
+				std::uint64_t const oldest = pinned_.empty()
+					? std::numeric_limits<std::uint64_t>::max()
+					: *std::min_element(pinned_.begin(), pinned_.end())
+				;
+
+				auto keep = std::partition(
+					retired_.begin(),
+					retired_.end(),
+					[oldest](std::pair<std::uint64_t, page*> const& r)
+					{
+						return r.first > oldest;
+					}
+				);
+
+				for(auto r = keep; r != retired_.end(); ++r)
+					free_page(r->second);
+
+				retired_.erase(keep, retired_.end());
+			}
+
+			page_allocator_type alloc_;
+			std::mutex mutex_;
+			std::vector<std::uint64_t> pinned_;
+			std::atomic<std::size_t> pinned_count_;
+			std::vector<std::pair<std::uint64_t, page*>> retired_;
+			std::vector<page*> spares_;
+			bool orphaned_;
+		};
+	}
+
+	template<typename T, typename Allocator>
+	class cow_pool;
+
+	// ------------------------------------------------------------------------
+	// An immutable view of a cow_pool, as returned by cow_pool::snapshot().
+	// Has the const interface of a pool, so works with zip_iterator and
+	// range::combine.
+	template<typename T, typename Allocator = std::allocator<T>>
+	class cow_snapshot
+	{
+	private:
+
+		typedef detail::cow_page_store<T, Allocator> store_type;
+		typedef typename store_type::page page;
+
+		struct iterator_impl
+			: boost::iterator_facade<
+			  iterator_impl
+			, T const&
+			, boost::forward_traversal_tag
+			>
+		{
+			iterator_impl()
+			{}
+
+			entity get_entity() const
+			{
+				return make_entity(entity_index_);
+			}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class cow_snapshot;
+
+			iterator_impl(cow_snapshot const* parent, entity_index_t start)
+				: parent_(parent)
+				, entity_index_(start)
+			{
+				skip_absent();
+			}
+
+			void skip_absent()
+			{
+				while(entity_index_ < parent_->slot_count_ && !parent_->has(entity_index_))
+					++entity_index_;
+			}
+
+			void increment()
+			{
+				++entity_index_;
+				skip_absent();
+			}
+
+			bool equal(iterator_impl const& other) const
+			{
+				return entity_index_ == other.entity_index_;
+			}
+
+			T const& dereference() const
+			{
+				return *parent_->at(entity_index_);
+			}
+
+			cow_snapshot const* parent_;
+			entity_index_t entity_index_;
+		};
+
+		struct optional_iterator_impl
+			: boost::iterator_facade<
+			  optional_iterator_impl
+			, optional<T const>
+			, boost::forward_traversal_tag
+			, optional<T const>
+			>
+		{
+			optional_iterator_impl()
+			{}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class cow_snapshot;
+
+			optional_iterator_impl(cow_snapshot const* parent, entity_index_t start)
+				: parent_(parent)
+				, entity_index_(start)
+			{}
+
+			void increment()
+			{
+				++entity_index_;
+			}
+
+			bool equal(optional_iterator_impl const& other) const
+			{
+				return entity_index_ == other.entity_index_;
+			}
+
+			optional<T const> dereference() const
+			{
+				return parent_->get(make_entity(entity_index_));
+			}
+
+			cow_snapshot const* parent_;
+			entity_index_t entity_index_;
+		};
+
+	public:
+
+		typedef T type;
+		typedef T value_type;
+		typedef optional<T const> optional_type;
+		typedef optional<T const> const_optional_type;
+		typedef iterator_impl iterator;
+		typedef iterator_impl const_iterator;
+		typedef optional_iterator_impl optional_iterator;
+		typedef optional_iterator_impl const_optional_iterator;
+
+		~cow_snapshot()
+		{
+			store_->unpin(epoch_);
+		}
+
+		optional<T const> get(entity e) const
+		{
+			if(e.index() >= slot_count_ || !has(e.index()))
+				return boost::none;
+
+			return *at(e.index());
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this, 0);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(this, static_cast<entity_index_t>(slot_count_));
+		}
+
+		const_optional_iterator optional_begin() const
+		{
+			return const_optional_iterator(this, 0);
+		}
+
+		const_optional_iterator optional_end() const
+		{
+			return const_optional_iterator(this, static_cast<entity_index_t>(slot_count_));
+		}
+
+		// Number of components.
+		std::size_t size() const
+		{
+			return used_count_;
+		}
+
+		// Number of entities in the world when the snapshot was taken.
+		std::size_t entity_count() const
+		{
+			return slot_count_;
+		}
+
+		std::uint64_t epoch() const
+		{
+			return epoch_;
+		}
+
+	private:
+
+		// No copying
+		cow_snapshot(cow_snapshot const&);
+		cow_snapshot operator=(cow_snapshot const&);
+
+		friend class cow_pool<T, Allocator>;
+
+		template<typename PageTable>
+		cow_snapshot(
+			std::shared_ptr<store_type> store,
+			std::uint64_t epoch,
+			PageTable const& pages,
+			std::size_t slot_count,
+			std::size_t used_count)
+			: store_(std::move(store))
+			, epoch_(epoch)
+			, pages_(pages.begin(), pages.end())
+			, slot_count_(slot_count)
+			, used_count_(used_count)
+		{
+			store_->pin(epoch_);
+		}
+
+		bool has(entity_index_t idx) const
+		{
+			return pages_[idx / page::size]->has(idx % page::size);
+		}
+
+		T const* at(entity_index_t idx) const
+		{
+			return pages_[idx / page::size]->at(idx % page::size);
+		}
+
+		std::shared_ptr<store_type> store_;
+		std::uint64_t epoch_;
+		std::vector<page const*> pages_;
+		std::size_t slot_count_;
+		std::size_t used_count_;
+	};
+
+	// ------------------------------------------------------------------------
+	//
+	template<typename T, typename Allocator = std::allocator<T>>
+	class cow_pool
+	{
+	private:
+
+		typedef detail::cow_page_store<T, Allocator> store_type;
+		typedef typename store_type::page page;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<page*> page_table_allocator_type;
+
+		typedef std::vector<page*, page_table_allocator_type> page_table_t;
+
+		template<typename ValueType>
+		struct iterator_impl
+			: boost::iterator_facade<
+			  iterator_impl<ValueType>
+			, ValueType&
+			, boost::forward_traversal_tag
+			>
+		{
+			iterator_impl()
+			{}
+
+			entity get_entity() const
+			{
+				return make_entity(entity_index_);
+			}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class cow_pool;
+
+			typedef typename std::conditional<
+				std::is_const<ValueType>::value,
+				cow_pool const,
+				cow_pool
+			>::type parent_type;
+
+			iterator_impl(parent_type* parent, entity_index_t start)
+				: parent_(parent)
+				, entity_index_(start)
+			{
+				skip_absent();
+			}
+
+			void skip_absent()
+			{
+				while(entity_index_ < parent_->slot_count_ && !parent_->has(entity_index_))
+					++entity_index_;
+			}
+
+			void increment()
+			{
+				++entity_index_;
+				skip_absent();
+			}
+
+			bool equal(iterator_impl const& other) const
+			{
+				return entity_index_ == other.entity_index_;
+			}
+
+			// Writable iterators copy shared pages as they reach them.
+			ValueType& dereference() const
+			{
+				return *parent_->get_component(entity_index_);
+			}
+
+			parent_type* parent_;
+			entity_index_t entity_index_;
+		};
+
+		template<typename ValueType>
+		struct optional_iterator_impl
+			: boost::iterator_facade<
+			  optional_iterator_impl<ValueType>
+			, optional<ValueType>
+			, boost::forward_traversal_tag
+			, optional<ValueType>
+			>
+		{
+			optional_iterator_impl()
+			{}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class cow_pool;
+
+			typedef typename std::conditional<
+				std::is_const<ValueType>::value,
+				cow_pool const,
+				cow_pool
+			>::type parent_type;
+
+			optional_iterator_impl(parent_type* parent, entity_index_t start)
+				: parent_(parent)
+				, entity_index_(start)
+			{}
+
+			void increment()
+			{
+				++entity_index_;
+			}
+
+			bool equal(optional_iterator_impl const& other) const
+			{
+				return entity_index_ == other.entity_index_;
+			}
+
+			optional<ValueType> dereference() const
+			{
+				return parent_->get(make_entity(entity_index_));
+			}
+
+			parent_type* parent_;
+			entity_index_t entity_index_;
+		};
+
+	public:
+
+		typedef T type;
+		typedef T value_type;
+		typedef Allocator allocator_type;
+		typedef optional<T> optional_type;
+		typedef optional<T const> const_optional_type;
+		typedef iterator_impl<T> iterator;
+		typedef iterator_impl<T const> const_iterator;
+		typedef optional_iterator_impl<T> optional_iterator;
+		typedef optional_iterator_impl<T const> const_optional_iterator;
+		typedef cow_snapshot<T, Allocator> snapshot_type;
+
+		static std::size_t const page_size = page::size;
+
+		// --------------------------------------------------------------------
+		//
+		template<typename... Args>
+		cow_pool(entity_pool& owner_pool, Args const&... args)
+			: cow_pool(std::allocator_arg, Allocator(), owner_pool, args...)
+		{}
+
+		template<typename... Args>
+		cow_pool(
+			std::allocator_arg_t,
+			Allocator const& alloc,
+			entity_pool& owner_pool,
+			Args const&... args)
+			: store_(std::allocate_shared<store_type>(alloc, alloc))
+			, pages_(page_table_allocator_type(alloc))
+			, slot_count_(0)
+			, used_count_(0)
+			, epoch_(1)
+		{
+			for(std::size_t i = 0; i < owner_pool.size(); ++i)
+			{
+				create_entity_slot();
+			}
+
+			// Create default values for existing entities.
+			std::for_each(
+				owner_pool.begin(),
+				owner_pool.end(),
+				[&args..., this](entity e)
+				{
+					create(e, args...);
+				}
+			);
+
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					[this](entity e)
+					{
+						handle_create_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_destroy_handler =
+				owner_pool.signals().on_entity_destroy.connect(
+					[this](entity e)
+					{
+						handle_destroy_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_swap_handler =
+				owner_pool.signals().on_entity_swap.connect(
+					[this](entity a, entity b)
+					{
+						handle_swap_entity(a, b);
+					}
+				)
+			;
+		}
+
+		~cow_pool()
+		{
+			for(auto&& p : pages_)
+			{
+				store_->release(p, std::numeric_limits<std::uint64_t>::max());
+			}
+
+			store_->orphan();
+		}
+
+		template<typename... Args>
+		void auto_create_components(entity_pool& owner_pool, Args... args)
+		{
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					std::function<void(entity)>(
+						[this, args...](entity e)
+						{
+							create_entity_slot();
+							create(e, args...);
+						}
+					)
+				)
+			;
+		}
+
+		template<typename... Args>
+		T* create(entity e, Args&&... args)
+		{
+			page* p = writable_page(e.index());
+			std::size_t const i = e.index() % page_size;
+			BOOST_ASSERT(!p->has(i) && "Trying to create an existing component.");
+			T* ret_val = new(p->at(i)) T(std::forward<Args>(args)...);
+			p->set(i, true);
+			++used_count_;
+			return ret_val;
+		}
+
+		void destroy(entity e)
+		{
+			page* p = writable_page(e.index());
+			std::size_t const i = e.index() % page_size;
+			BOOST_ASSERT(p->has(i) && "Trying to destroy un-allocated component.");
+			p->at(i)->~T();
+			p->set(i, false);
+			--used_count_;
+		}
+
+		optional<T> get(entity e)
+		{
+			if(!has(e.index()))
+				return boost::none;
+
+			return *get_component(e.index());
+		}
+
+		optional<T const> get(entity e) const
+		{
+			if(!has(e.index()))
+				return boost::none;
+
+			return *get_component(e.index());
+		}
+
+		// Returns an immutable view of the pool as it is now.  Costs a copy
+		// of the page table; the pages themselves are shared until the
+		// pool next writes to them.
+		std::shared_ptr<snapshot_type const> snapshot()
+		{
+			ENTITY_PROFILE_ZONE("cow_pool::snapshot");
+			store_->reclaim();
+			std::shared_ptr<snapshot_type const> s(
+				new snapshot_type(store_, epoch_, pages_, slot_count_, used_count_)
+			);
+
+			++epoch_;
+			return s;
+		}
+
+		// Frees the pages only released snapshots were using.  Also done
+		// by every call to snapshot().
+		void reclaim()
+		{
+			ENTITY_PROFILE_ZONE("cow_pool::reclaim");
+			store_->reclaim();
+		}
+
+		iterator begin()
+		{
+			return iterator(this, 0);
+		}
+
+		iterator end()
+		{
+			return iterator(this, static_cast<entity_index_t>(slot_count_));
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this, 0);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(this, static_cast<entity_index_t>(slot_count_));
+		}
+
+		optional_iterator optional_begin()
+		{
+			return optional_iterator(this, 0);
+		}
+
+		optional_iterator optional_end()
+		{
+			return optional_iterator(this, static_cast<entity_index_t>(slot_count_));
+		}
+
+		const_optional_iterator optional_begin() const
+		{
+			return const_optional_iterator(this, 0);
+		}
+
+		const_optional_iterator optional_end() const
+		{
+			return const_optional_iterator(this, static_cast<entity_index_t>(slot_count_));
+		}
+
+		std::size_t size() const
+		{
+			return used_count_;
+		}
+
+		// Reserves the page table for count entities.  Pages themselves
+		// are allocated as entities arrive.
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("cow_pool::reserve");
+			pages_.reserve((count + page_size - 1) / page_size);
+		}
+
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("cow_pool::shrink_to_fit");
+			pages_.shrink_to_fit();
+		}
+
+		// Also returns reclaimed pages kept for reuse to the allocator.
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("cow_pool::compact");
+			shrink_to_fit();
+			store_->reclaim();
+			store_->release_spares();
+		}
+
+		// Shrinks at most budget bytes worth of storage according to
+		// policy.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("cow_pool::shrink_step");
+			return policy.shrink(pages_, budget);
+		}
+
+		// Counts the pages owned by the pool and those kept for reuse;
+		// retired pages still held for snapshots are reported by
+		// retired_page_count().
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = used_count_;
+			usage.slot_count = pages_.size() * page_size;
+			usage.live_bytes = used_count_ * sizeof(T);
+			usage.reserved_bytes = (pages_.size() + store_->spare_count()) * sizeof(page);
+			usage.index_bytes = pages_.capacity() * sizeof(page*);
+			return usage;
+		}
+
+		std::size_t retired_page_count() const
+		{
+			return store_->retired_count();
+		}
+
+		allocator_type get_allocator() const
+		{
+			return allocator_type(pages_.get_allocator());
+		}
+
+	private:
+
+		// No copying
+		cow_pool(cow_pool const&);
+		cow_pool operator=(cow_pool);
+
+		friend class creation_queue<cow_pool>;
+		friend class destruction_queue<cow_pool>;
+		friend struct serialization::access;
+		friend struct lifecycle_access;
+
+		struct slot_list
+		{
+			boost::signals2::scoped_connection entity_create_handler;
+			boost::signals2::scoped_connection entity_destroy_handler;
+			boost::signals2::scoped_connection entity_swap_handler;
+		};
+
+		bool has(entity_index_t idx) const
+		{
+			return pages_[idx / page_size]->has(idx % page_size);
+		}
+
+		// Pages from an earlier epoch may be shared with a snapshot, so
+		// are copied before the first write in this epoch.  With no
+		// snapshot alive they are just adopted into the current epoch.
+		page* writable_page(entity_index_t idx)
+		{
+			page*& p = pages_[idx / page_size];
+			if(p->epoch != epoch_)
+			{
+				if(store_->is_pinned())
+				{
+					page* copy = store_->copy(*p, epoch_);
+					store_->release(p, epoch_);
+					p = copy;
+				}
+				else
+				{
+					p->epoch = epoch_;
+				}
+			}
+
+			return p;
+		}
+
+		T* get_component(entity_index_t idx)
+		{
+			return writable_page(idx)->at(idx % page_size);
+		}
+
+		T const* get_component(entity_index_t idx) const
+		{
+			return pages_[idx / page_size]->at(idx % page_size);
+		}
+
+		void create_entity_slot()
+		{
+			if(slot_count_ == pages_.size() * page_size)
+				pages_.push_back(store_->allocate(epoch_));
+
+			++slot_count_;
+		}
+
+		void free_entity_slot()
+		{
+			--slot_count_;
+			if(slot_count_ == (pages_.size() - 1) * page_size)
+			{
+				store_->release(pages_.back(), epoch_);
+				pages_.pop_back();
+			}
+		}
+
+		// --------------------------------------------------------------------
+		// Queue interface.
+		template<typename Iter>
+		void create_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				create(current->first.lock().get(), std::move(current->second));
+				++current;
+			}
+		}
+
+		template<typename Iter>
+		void destroy_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				destroy(current->lock().get());
+				++current;
+			}
+		}
+
+		// --------------------------------------------------------------------
+		// Slot Handlers
+		void handle_create_entity(entity)
+		{
+			create_entity_slot();
+		}
+
+		void handle_destroy_entity(entity e)
+		{
+			if(has(e.index()))
+			{
+				destroy(e);
+			}
+
+			free_entity_slot();
+		}
+
+		void handle_swap_entity(entity a, entity b)
+		{
+			using std::swap;
+
+			auto c_a = get(a);
+			auto c_b = get(b);
+
+			if(c_a && c_b)
+			{
+				swap(*c_a, *c_b);
+			}
+			else if(c_a)
+			{
+				create(b, std::move(*c_a));
+				destroy(a);
+			}
+			else if(c_b)
+			{
+				create(a, std::move(*c_b));
+				destroy(b);
+			}
+		}
+
+		std::shared_ptr<store_type>		store_;
+		page_table_t					pages_;
+		std::size_t						slot_count_;
+		std::size_t						used_count_;
+		std::uint64_t					epoch_;
+		slot_list						slots_;
+	};
+} } // namespace entity { namespace component
+
+#endif // ENTITY_COMPONENT_COWPOOL_H_INCLUDED_
@@ -17,7 +17,9 @@
 
 #include "entity/config.hpp" // IWYU pragma: keep
 #include "entity/entity.hpp"
+#include "entity/profile.hpp"
 #include <algorithm>
+#include <memory>
 #include <vector>
 #include <utility>
 
@@ -31,9 +33,16 @@ namespace entity { namespace component
 	public:
 
 		typedef typename ComponentPool::type type;
+		typedef std::pair<weak_entity, type> value_type;
+
+		// The queue allocates from the same place as its pool.
+		typedef typename std::allocator_traits<
+			typename ComponentPool::allocator_type
+		>::template rebind_alloc<value_type> allocator_type;
 
 		creation_queue(ComponentPool& p)
-			: pool_(p)
+			: created_(allocator_type(p.get_allocator()))
+			, pool_(p)
 		{}
 
 		~creation_queue()
@@ -49,6 +58,7 @@ namespace entity { namespace component
 	
 		void flush()
 		{
+			ENTITY_PROFILE_ZONE("creation_queue::flush");
 			std::sort(created_.begin(), created_.end());
 			pool_.create_range(created_.begin(), created_.end());
 			clear();
@@ -65,7 +75,7 @@ namespace entity { namespace component
 		creation_queue(creation_queue const&);
 		creation_queue operator=(creation_queue);
 
-		std::vector<std::pair<weak_entity, type>> created_;
+		std::vector<value_type, allocator_type> created_;
 		ComponentPool& pool_;
 	};
 } } // namespace entity { namespace component
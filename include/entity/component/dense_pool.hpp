@@ -25,16 +25,24 @@
 #include <boost/signals2/connection.hpp>
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <new>
+#include <type_traits>
 #include <vector>
 
 #include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
 #include "entity/component/optional.hpp"
 #include "entity/entity.hpp"
 #include "entity/entity_index.hpp"
 #include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
 
 namespace boost {
 namespace iterators {
@@ -51,7 +59,7 @@ namespace entity { namespace component
 	template<typename ComponentPool>
 	class destruction_queue;
 
-	template<typename T>
+	template<typename T, typename Allocator = std::allocator<T>>
 	class dense_pool
 	{
 	private:
@@ -61,6 +69,17 @@ namespace entity { namespace component
 			char mem_[sizeof(T)];
 		};
 
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<element_t> element_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<char> available_allocator_type;
+
+		typedef std::vector<element_t, element_allocator_type> component_table_t;
+		typedef std::vector<char, available_allocator_type> available_table_t;
+
 		template<typename ValueType>
 		struct iterator_impl
 			: boost::iterator_facade<
@@ -82,8 +101,6 @@ namespace entity { namespace component
 			friend class boost::iterator_core_access;
 			friend class dense_pool;
 
-			typedef typename std::vector<char>::iterator parent_iterator;
-
 			iterator_impl(dense_pool* parent, entity_index_t start)
 				: parent_(parent)
 				, entity_index_(start)
@@ -102,7 +119,11 @@ namespace entity { namespace component
 				auto available_iterator = parent_->available_.begin() + entity_index_;
 				auto end_iterator = parent_->available_.end();
 				if(available_iterator != end_iterator)
+				{
+					++available_iterator;
 					++entity_index_;
+				}
+
 				while(available_iterator != end_iterator && *available_iterator)
 				{
 					++available_iterator;
@@ -141,8 +162,6 @@ namespace entity { namespace component
 			friend class boost::iterator_core_access;
 			friend class dense_pool;
 
-			typedef typename std::vector<char>::iterator parent_iterator;
-
 			optional_iterator_impl(dense_pool* parent, entity_index_t start)
 				: parent_(parent)
 				, entity_index_(start)
@@ -181,6 +200,7 @@ namespace entity { namespace component
 
 		typedef T type;
 		typedef T value_type;
+		typedef Allocator allocator_type;
 		typedef optional<T> optional_type;
 		typedef optional<T const> const_optional_type;
 		typedef iterator_impl<T> iterator;
@@ -192,7 +212,18 @@ namespace entity { namespace component
 		//
 		template<typename... Args>	
 		dense_pool(entity_pool& owner_pool, Args const&... args)
-			: used_count_(0)
+			: dense_pool(std::allocator_arg, Allocator(), owner_pool, args...)
+		{}
+
+		template<typename... Args>
+		dense_pool(
+			std::allocator_arg_t,
+			Allocator const& alloc,
+			entity_pool& owner_pool,
+			Args const&... args)
+			: components_(element_allocator_type(alloc))
+			, available_(available_allocator_type(alloc))
+			, used_count_(0)
 		{
 			components_.resize(owner_pool.size());
 			available_.resize(owner_pool.size(), true);
@@ -336,14 +367,66 @@ namespace entity { namespace component
 			return used_count_;
 		}
 
+		// Reserves space for count entities so the pool can grow to that
+		// size without reallocating.
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("dense_pool::reserve");
+			components_.reserve(count);
+			available_.reserve(count);
+		}
+
+		// Dense pools keep a slot per entity, so this can only release
+		// capacity left over from entities that have been destroyed.
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("dense_pool::shrink_to_fit");
+			components_.shrink_to_fit();
+			available_.shrink_to_fit();
+		}
+
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("dense_pool::compact");
+			shrink_to_fit();
+		}
+
+		// Shrinks at most budget bytes worth of storage according to
+		// policy.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("dense_pool::shrink_step");
+			std::size_t spent = policy.shrink(components_, budget);
+			spent += policy.shrink(available_, budget - spent);
+			return spent;
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = used_count_;
+			usage.slot_count = components_.size();
+			usage.live_bytes = used_count_ * sizeof(T);
+			usage.reserved_bytes = components_.capacity() * sizeof(element_t);
+			usage.index_bytes = available_.capacity() * sizeof(char);
+			return usage;
+		}
+
+		allocator_type get_allocator() const
+		{
+			return allocator_type(components_.get_allocator());
+		}
+
 	private:
 
 		// No copying
 		dense_pool(dense_pool const&);
 		dense_pool operator=(dense_pool);
 
-		friend class creation_queue<dense_pool<T>>;
-		friend class destruction_queue<dense_pool<T>>;
+		friend class creation_queue<dense_pool>;
+		friend class destruction_queue<dense_pool>;
+		friend struct serialization::access;
+		friend struct lifecycle_access;
 
 		struct slot_list
 		{
@@ -384,6 +467,39 @@ namespace entity { namespace component
 			components_.erase(components_.begin() + e.index());
 		}
 
+		// --------------------------------------------------------------------
+		// Serialization interface.
+		template<typename Writer>
+		void save(Writer& writer) const
+		{
+			static_assert(
+				std::is_trivially_copyable<T>::value,
+				"Only pools of trivially copyable components can be saved."
+			);
+
+			writer.write_table(components_);
+			writer.write_table(available_);
+			writer.write_value(static_cast<std::uint64_t>(used_count_));
+		}
+
+		template<typename Reader>
+		void load(Reader& reader)
+		{
+			std::uint64_t used_count = 0;
+			reader.read_table(components_);
+			reader.read_table(available_);
+			reader.read_value(used_count);
+			used_count_ = static_cast<std::size_t>(used_count);
+
+			reader.check(
+				components_.size() == reader.entity_count() &&
+				available_.size() == reader.entity_count() &&
+				used_count_ == static_cast<std::size_t>(
+					std::count(available_.begin(), available_.end(), 0)
+				)
+			);
+		}
+
 		// --------------------------------------------------------------------
 		// Queue interface.
 		template<typename Iter>
@@ -446,8 +562,8 @@ namespace entity { namespace component
 			}
 		}
 
-		std::vector<element_t>			components_;
-		std::vector<char>				available_;
+		component_table_t				components_;
+		available_table_t				available_;
 		std::size_t						used_count_;
 		slot_list						slots_;
 	};
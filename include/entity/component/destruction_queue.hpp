@@ -16,10 +16,12 @@
 
 #include <algorithm>
 #include <functional>
+#include <memory>
 #include <vector>
 
 #include "entity/config.hpp" // IWYU pragma: keep
 #include "entity/entity.hpp"
+#include "entity/profile.hpp"
 
 // ----------------------------------------------------------------------------
 //
@@ -32,8 +34,14 @@ namespace entity { namespace component
 
 		typedef typename ComponentPool::type type;
 
+		// The queue allocates from the same place as its pool.
+		typedef typename std::allocator_traits<
+			typename ComponentPool::allocator_type
+		>::template rebind_alloc<weak_entity> allocator_type;
+
 		destruction_queue(ComponentPool& p)
-			: pool_(p)
+			: destroyed_(allocator_type(p.get_allocator()))
+			, pool_(p)
 		{}
 
 		~destruction_queue()
@@ -48,6 +56,7 @@ namespace entity { namespace component
 
 		void flush()
 		{
+			ENTITY_PROFILE_ZONE("destruction_queue::flush");
 			std::sort(destroyed_.begin(), destroyed_.end(), std::greater<weak_entity>());
 			pool_.destroy_range(destroyed_.begin(), destroyed_.end());
 			clear();
@@ -64,7 +73,7 @@ namespace entity { namespace component
 		destruction_queue(destruction_queue const&);
 		destruction_queue operator=(destruction_queue);
 
-		std::vector<weak_entity> destroyed_;
+		std::vector<weak_entity, allocator_type> destroyed_;
 		ComponentPool& pool_;
 	};
 } } // namespace entity { namespace component {
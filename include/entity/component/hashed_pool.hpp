@@ -0,0 +1,683 @@
+// ****************************************************************************
+// entity/component/hashed_pool.h
+//
+// Represents a component pool where only a handful of entities out of a
+// very large world have the component.  Unlike sparse_pool it keeps no
+// per entity table; entities are found through an open addressing hash
+// table, so memory is proportional to the number of components.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_COMPONENT_HASHEDPOOL_H_INCLUDED_
+#define ENTITY_COMPONENT_HASHEDPOOL_H_INCLUDED_
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/signals2.hpp>
+#include <boost/signals2/connection.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
+#include "entity/component/optional.hpp"
+#include "entity/entity.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace component
+{
+	template<typename ComponentPool>
+	class creation_queue;
+	template<typename ComponentPool>
+	class destruction_queue;
+
+	template<typename T, typename Allocator = std::allocator<T>>
+	class hashed_pool
+	{
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<entity_index_t> index_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<T> component_allocator_type;
+
+		typedef std::vector<entity_index_t, index_allocator_type> index_table_t;
+		typedef std::vector<T, component_allocator_type> component_table_t;
+
+		template<typename ValueType>
+		struct iterator_impl
+			  : boost::iterator_facade<
+			    iterator_impl<ValueType>
+			  , ValueType&
+			  , boost::forward_traversal_tag
+		  	>
+		{
+			iterator_impl()
+			{}
+
+			entity get_entity() const
+			{
+				return make_entity(*entity_iterator_);
+			}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class hashed_pool;
+
+			typedef typename std::conditional<
+				std::is_const<ValueType>::value,
+				typename hashed_pool::component_table_t::const_iterator,
+				typename hashed_pool::component_table_t::iterator
+			>::type parent_iterator;
+
+			typedef typename hashed_pool::index_table_t::const_iterator entity_iterator;
+
+			iterator_impl(parent_iterator table_iter, entity_iterator entity_iter)
+				: iterator_(std::move(table_iter))
+				, entity_iterator_(std::move(entity_iter))
+			{}
+
+			void increment()
+			{
+				++iterator_;
+				++entity_iterator_;
+			}
+
+			bool equal(iterator_impl const& other) const
+			{
+				return iterator_ == other.iterator_;
+			}
+
+			ValueType& dereference() const
+			{
+				return *iterator_;
+			}
+
+			parent_iterator iterator_;
+			entity_iterator entity_iterator_;
+		};
+
+		// Walks every entity index, looking each one up.  Prefer begin()
+		// and end() when the entity isn't needed.
+		template<typename ValueType>
+		struct optional_iterator_impl
+			  : boost::iterator_facade<
+			    optional_iterator_impl<ValueType>
+			  , optional<ValueType>
+			  , boost::forward_traversal_tag
+			  , optional<ValueType>
+		  	>
+		{
+			optional_iterator_impl()
+			{}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class hashed_pool;
+
+			typedef typename std::conditional<
+				std::is_const<ValueType>::value,
+				hashed_pool const,
+				hashed_pool
+			>::type parent_type;
+
+			optional_iterator_impl(parent_type* parent, entity_index_t idx)
+				: parent_(parent)
+				, index_(idx)
+			{}
+
+			void increment()
+			{
+				++index_;
+			}
+
+			bool equal(optional_iterator_impl const& other) const
+			{
+				return index_ == other.index_;
+			}
+
+			optional<ValueType> dereference() const
+			{
+				return parent_->get(make_entity(index_));
+			}
+
+			parent_type* parent_;
+			entity_index_t index_;
+		};
+
+	public:
+
+		typedef T type;
+		typedef T value_type;
+		typedef Allocator allocator_type;
+		typedef optional<T> optional_type;
+		typedef optional<T const> const_optional_type;
+		typedef iterator_impl<T> iterator;
+		typedef iterator_impl<T const> const_iterator;
+		typedef optional_iterator_impl<T> optional_iterator;
+		typedef optional_iterator_impl<T const> const_optional_iterator;
+
+		// --------------------------------------------------------------------
+		//
+		template<typename... Args>
+		hashed_pool(entity_pool& owner_pool, Args&&... args)
+			: hashed_pool(
+				std::allocator_arg,
+				Allocator(),
+				owner_pool,
+				std::forward<Args>(args)...)
+		{}
+
+		template<typename... Args>
+		hashed_pool(
+			std::allocator_arg_t,
+			Allocator const& alloc,
+			entity_pool& owner_pool,
+			Args&&... args)
+			: keys_(index_allocator_type(alloc))
+			, components_(component_allocator_type(alloc))
+			, bucket_keys_(index_allocator_type(alloc))
+			, bucket_values_(index_allocator_type(alloc))
+			, bucket_shift_(64)
+			, entity_count_(0)
+		{
+			// Create default values for existing entities.
+			std::for_each(
+				owner_pool.begin(),
+				owner_pool.end(),
+				[this](entity e)
+				{
+					handle_create_entity(e);
+				}
+			);
+
+			std::for_each(
+				owner_pool.begin(),
+				owner_pool.end(),
+				[&args..., this](entity e)
+				{
+					create(e, std::forward<Args>(args)...);
+				}
+			);
+
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					[this](entity e)
+					{
+						handle_create_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_destroy_handler =
+				owner_pool.signals().on_entity_destroy.connect(
+					[this](entity e)
+					{
+						handle_destroy_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_swap_handler =
+				owner_pool.signals().on_entity_swap.connect(
+					[this](entity a, entity b)
+					{
+						handle_swap_entity(a, b);
+					}
+				)
+			;
+		}
+
+		template<typename... Args>
+		void auto_create_components(entity_pool& owner_pool, Args... args)
+		{
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					std::function<void(entity)>(
+						[this, args...](entity e)
+						{
+							handle_create_entity(e);
+							create(e, args...);
+						}
+					)
+				)
+			;
+		}
+
+		template<typename... Args>
+		T* create(entity e, Args&&... args)
+		{
+			insert_bucket(e.index(), components_.size());
+			components_.emplace_back(std::forward<Args>(args)...);
+			keys_.emplace_back(e.index());
+			return std::addressof(components_.back());
+		}
+
+		void destroy(entity e)
+		{
+			std::size_t const bucket = find_bucket(e.index());
+			entity_index_t const idx = bucket_values_[bucket];
+			erase_bucket(bucket);
+
+			using std::swap;
+			swap(components_[idx], components_.back());
+			components_.pop_back();
+			keys_[idx] = keys_.back();
+			keys_.pop_back();
+
+			// Point the moved component's entity at its new home.
+			if(idx < keys_.size())
+				bucket_values_[find_bucket(keys_[idx])] = idx;
+		}
+
+		optional<T> get(entity e)
+		{
+			std::size_t const bucket = find_bucket(e.index());
+			if(bucket != no_bucket())
+				return components_[bucket_values_[bucket]];
+			return boost::none;
+		}
+
+		optional<const T> get(entity e) const
+		{
+			std::size_t const bucket = find_bucket(e.index());
+			if(bucket != no_bucket())
+				return components_[bucket_values_[bucket]];
+			return boost::none;
+		}
+
+		iterator begin()
+		{
+			return iterator(components_.begin(), keys_.begin());
+		}
+
+		iterator end()
+		{
+			return iterator(components_.end(), keys_.end());
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(components_.begin(), keys_.begin());
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(components_.end(), keys_.end());
+		}
+
+		optional_iterator optional_begin()
+		{
+			return optional_iterator(this, 0);
+		}
+
+		optional_iterator optional_end()
+		{
+			return optional_iterator(this, entity_count_);
+		}
+
+		const_optional_iterator optional_begin() const
+		{
+			return const_optional_iterator(this, 0);
+		}
+
+		const_optional_iterator optional_end() const
+		{
+			return const_optional_iterator(this, entity_count_);
+		}
+
+		// The entity owning each component, in the same order as begin()
+		// and end().
+		index_table_t const& entities() const
+		{
+			return keys_;
+		}
+
+		std::size_t size()
+		{
+			return components_.size();
+		}
+
+		std::size_t bucket_count() const
+		{
+			return bucket_keys_.size();
+		}
+
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("hashed_pool::reserve");
+			keys_.reserve(count);
+			components_.reserve(count);
+			if(buckets_for(count) > bucket_keys_.size())
+				rehash(buckets_for(count));
+		}
+
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("hashed_pool::shrink_to_fit");
+			keys_.shrink_to_fit();
+			components_.shrink_to_fit();
+			rehash(buckets_for(components_.size()));
+		}
+
+		// Shrinks and also re-sorts the components into entity order.
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("hashed_pool::compact");
+			index_table_t order(keys_.size(), keys_.get_allocator());
+			for(std::size_t i = 0; i < order.size(); ++i)
+			{
+				order[i] = static_cast<entity_index_t>(i);
+			}
+
+			std::sort(order.begin(), order.end(),
+				[this](entity_index_t a, entity_index_t b)
+				{
+					return keys_[a] < keys_[b];
+				}
+			);
+
+			component_table_t components(components_.get_allocator());
+			index_table_t keys(keys_.get_allocator());
+			components.reserve(components_.size());
+			keys.reserve(keys_.size());
+			for(entity_index_t idx : order)
+			{
+				components.push_back(std::move(components_[idx]));
+				keys.push_back(keys_[idx]);
+			}
+
+			components_.swap(components);
+			keys_.swap(keys);
+			rehash(buckets_for(components_.size()));
+		}
+
+		// Shrinks at most budget bytes worth of storage according to
+		// policy.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("hashed_pool::shrink_step");
+			std::size_t spent = policy.shrink(components_, budget);
+			spent += policy.shrink(keys_, budget - spent);
+
+			std::size_t const target = buckets_for(components_.size());
+			std::size_t const cost = 2 * bucket_keys_.size() * sizeof(entity_index_t);
+			if(target < bucket_keys_.size() && cost <= budget - spent &&
+				policy.should_shrink(target, bucket_keys_.size(), 2 * sizeof(entity_index_t)))
+			{
+				rehash(target);
+				spent += cost;
+			}
+
+			return spent;
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = components_.size();
+			usage.slot_count = components_.size();
+			usage.live_bytes = components_.size() * sizeof(T);
+			usage.reserved_bytes = components_.capacity() * sizeof(T);
+			usage.index_bytes = (
+				keys_.capacity() +
+				bucket_keys_.capacity() +
+				bucket_values_.capacity()
+			) * sizeof(entity_index_t);
+			return usage;
+		}
+
+		allocator_type get_allocator() const
+		{
+			return allocator_type(components_.get_allocator());
+		}
+
+	private:
+
+		static entity_index_t no_component_flag()
+		{
+			return std::numeric_limits<entity_index_t>::max();
+		}
+
+		static std::size_t no_bucket()
+		{
+			return std::numeric_limits<std::size_t>::max();
+		}
+
+		// Smallest power of two bucket count keeping the load at or
+		// under three quarters.
+		static std::size_t buckets_for(std::size_t count)
+		{
+			std::size_t buckets = 8;
+			while(buckets * 3 < count * 4)
+				buckets *= 2;
+			return buckets;
+		}
+
+		// Fibonacci hashing; consecutive entity indices spread out across
+		// the table rather than clustering.
+		std::size_t ideal_bucket(entity_index_t key) const
+		{
+			return static_cast<std::size_t>(
+				(std::uint64_t(key) * 0x9E3779B97F4A7C15ull) >> bucket_shift_
+			);
+		}
+
+		std::size_t find_bucket(entity_index_t key) const
+		{
+			if(bucket_keys_.empty())
+				return no_bucket();
+
+			std::size_t const mask = bucket_keys_.size() - 1;
+			for(std::size_t b = ideal_bucket(key); ; b = (b + 1) & mask)
+			{
+				if(bucket_keys_[b] == key)
+					return b;
+				if(bucket_keys_[b] == no_component_flag())
+					return no_bucket();
+			}
+		}
+
+		void insert_bucket(entity_index_t key, std::size_t value)
+		{
+			if((components_.size() + 1) * 4 > bucket_keys_.size() * 3)
+				rehash(buckets_for(components_.size() + 1));
+
+			place(key, static_cast<entity_index_t>(value));
+		}
+
+		void place(entity_index_t key, entity_index_t value)
+		{
+			std::size_t const mask = bucket_keys_.size() - 1;
+			std::size_t b = ideal_bucket(key);
+			while(bucket_keys_[b] != no_component_flag())
+				b = (b + 1) & mask;
+
+			bucket_keys_[b] = key;
+			bucket_values_[b] = value;
+		}
+
+		// Backward shift deletion, so lookups never have to step over
+		// tombstones.
+		void erase_bucket(std::size_t hole)
+		{
+			std::size_t const mask = bucket_keys_.size() - 1;
+			for(std::size_t next = (hole + 1) & mask;
+				bucket_keys_[next] != no_component_flag();
+				next = (next + 1) & mask)
+			{
+				std::size_t const ideal = ideal_bucket(bucket_keys_[next]);
+				if(((next - ideal) & mask) >= ((next - hole) & mask))
+				{
+					bucket_keys_[hole] = bucket_keys_[next];
+					bucket_values_[hole] = bucket_values_[next];
+					hole = next;
+				}
+			}
+
+			bucket_keys_[hole] = no_component_flag();
+		}
+
+		void rehash(std::size_t buckets)
+		{
+			index_table_t bucket_keys(buckets, no_component_flag(), bucket_keys_.get_allocator());
+			index_table_t bucket_values(buckets, 0, bucket_values_.get_allocator());
+			bucket_keys_.swap(bucket_keys);
+			bucket_values_.swap(bucket_values);
+
+			bucket_shift_ = 64;
+			for(std::size_t b = buckets; b > 1; b >>= 1)
+				--bucket_shift_;
+
+			for(std::size_t i = 0; i < keys_.size(); ++i)
+			{
+				place(keys_[i], static_cast<entity_index_t>(i));
+			}
+		}
+
+		// No copying
+		hashed_pool(hashed_pool const&);
+		hashed_pool operator=(hashed_pool);
+
+		friend class creation_queue<hashed_pool>;
+		friend class destruction_queue<hashed_pool>;
+		friend struct serialization::access;
+		friend struct lifecycle_access;
+
+		struct slot_list
+		{
+			boost::signals2::scoped_connection entity_create_handler;
+			boost::signals2::scoped_connection entity_destroy_handler;
+			boost::signals2::scoped_connection entity_swap_handler;
+		};
+
+		// --------------------------------------------------------------------
+		// Serialization interface.  The hash table is rebuilt on load.
+		template<typename Writer>
+		void save(Writer& writer) const
+		{
+			writer.write_table(keys_);
+			writer.write_table(components_);
+			writer.write_value(std::uint64_t(entity_count_));
+		}
+
+		template<typename Reader>
+		void load(Reader& reader)
+		{
+			reader.read_table(keys_);
+			reader.read_table(components_);
+			std::uint64_t entity_count = 0;
+			reader.read_value(entity_count);
+			entity_count_ = static_cast<entity_index_t>(entity_count);
+
+			reader.check(
+				keys_.size() == components_.size() &&
+				entity_count == reader.entity_count()
+			);
+			reader.check_indices(keys_, entity_count_);
+
+			rehash(buckets_for(keys_.size()));
+		}
+
+		// --------------------------------------------------------------------
+		// Queue interface.
+		template<typename Iter>
+		void create_range(Iter current, Iter last)
+		{
+			reserve(components_.size() + std::distance(current, last));
+			while(current != last)
+			{
+				create(current->first.lock().get(), std::move(current->second));
+				++current;
+			}
+		}
+
+		template<typename Iter>
+		void destroy_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				destroy(current->lock().get());
+				++current;
+			}
+		}
+
+		// --------------------------------------------------------------------
+		// Slot Handlers.
+		void handle_create_entity(entity e)
+		{
+			entity_count_ = std::max(entity_count_, e.index() + 1);
+		}
+
+		void handle_destroy_entity(entity e)
+		{
+			if(find_bucket(e.index()) != no_bucket())
+			{
+				destroy(e);
+			}
+
+			// The entity pool always destroys its last entity.
+			entity_count_ = e.index();
+		}
+
+		void handle_swap_entity(entity a, entity b)
+		{
+			using std::swap;
+
+			std::size_t const bucket_a = find_bucket(a.index());
+			std::size_t const bucket_b = find_bucket(b.index());
+			if(bucket_a != no_bucket() && bucket_b != no_bucket())
+			{
+				swap(bucket_values_[bucket_a], bucket_values_[bucket_b]);
+				keys_[bucket_values_[bucket_a]] = a.index();
+				keys_[bucket_values_[bucket_b]] = b.index();
+			}
+			else if(bucket_a != no_bucket())
+			{
+				move_key(bucket_a, b.index());
+			}
+			else if(bucket_b != no_bucket())
+			{
+				move_key(bucket_b, a.index());
+			}
+		}
+
+		void move_key(std::size_t bucket, entity_index_t key)
+		{
+			entity_index_t const idx = bucket_values_[bucket];
+			erase_bucket(bucket);
+			place(key, idx);
+			keys_[idx] = key;
+		}
+
+		index_table_t keys_;
+		component_table_t components_;
+		index_table_t bucket_keys_;
+		index_table_t bucket_values_;
+		unsigned bucket_shift_;
+		entity_index_t entity_count_;
+		slot_list slots_;
+	};
+} } // namespace entity { namespace component
+
+#endif // ENTITY_COMPONENT_HASHEDPOOL_H_INCLUDED_
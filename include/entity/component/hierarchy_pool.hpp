@@ -0,0 +1,754 @@
+// ****************************************************************************
+// entity/component/hierarchy_pool.h
+//
+// Represents a component pool whose entities form a forest, such as a
+// scene graph.  Components are packed in depth first order so every
+// subtree is a contiguous span and parents always come before their
+// children; propagating transforms is a single forward pass.
+//
+// The price is paid on insertion: a child lands at the end of its parent's
+// subtree and every node after it moves.  Trees created depth first only
+// ever append, but building a tree of N nodes in any other order, breadth
+// first for example, is O(N^2).
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_COMPONENT_HIERARCHYPOOL_H_INCLUDED_
+#define ENTITY_COMPONENT_HIERARCHYPOOL_H_INCLUDED_
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/optional.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <boost/signals2.hpp>
+#include <boost/signals2/connection.hpp>
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
+#include "entity/component/optional.hpp"
+#include "entity/entity.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace component
+{
+	template<typename ComponentPool>
+	class creation_queue;
+	template<typename ComponentPool>
+	class destruction_queue;
+
+	template<typename T, typename Allocator = std::allocator<T>>
+	class hierarchy_pool
+	{
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<entity_index_t> index_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<T> component_allocator_type;
+
+		typedef std::vector<entity_index_t, index_allocator_type> index_table_t;
+		typedef std::vector<T, component_allocator_type> component_table_t;
+
+		template<typename ValueType>
+		struct iterator_impl
+			  : boost::iterator_facade<
+			    iterator_impl<ValueType>
+			  , ValueType&
+			  , boost::random_access_traversal_tag
+		  	>
+		{
+			iterator_impl()
+			{}
+
+			entity get_entity() const
+			{
+				return make_entity(*entity_iterator_);
+			}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class hierarchy_pool;
+
+			typedef typename std::conditional<
+				std::is_const<ValueType>::value,
+				typename hierarchy_pool::component_table_t::const_iterator,
+				typename hierarchy_pool::component_table_t::iterator
+			>::type parent_iterator;
+
+			typedef typename hierarchy_pool::index_table_t::const_iterator entity_iterator;
+
+			iterator_impl(parent_iterator table_iter, entity_iterator entity_iter)
+				: iterator_(std::move(table_iter))
+				, entity_iterator_(std::move(entity_iter))
+			{}
+
+			void increment()
+			{
+				++iterator_;
+				++entity_iterator_;
+			}
+
+			void decrement()
+			{
+				--iterator_;
+				--entity_iterator_;
+			}
+
+			void advance(std::ptrdiff_t n)
+			{
+				iterator_ += n;
+				entity_iterator_ += n;
+			}
+
+			std::ptrdiff_t distance_to(iterator_impl const& other) const
+			{
+				return other.iterator_ - iterator_;
+			}
+
+			bool equal(iterator_impl const& other) const
+			{
+				return iterator_ == other.iterator_;
+			}
+
+			ValueType& dereference() const
+			{
+				return *iterator_;
+			}
+
+			parent_iterator iterator_;
+			entity_iterator entity_iterator_;
+		};
+
+		template<typename ValueType>
+		struct optional_iterator_impl
+			  : boost::iterator_facade<
+			    optional_iterator_impl<ValueType>
+			  , optional<ValueType>
+			  , boost::forward_traversal_tag
+			  , optional<ValueType>
+		  	>
+		{
+			optional_iterator_impl()
+			{}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class hierarchy_pool;
+
+			typedef typename std::conditional<
+				std::is_const<ValueType>::value,
+				hierarchy_pool const,
+				hierarchy_pool
+			>::type parent_type;
+
+			optional_iterator_impl(parent_type* parent, entity_index_t idx)
+				: parent_(parent)
+				, index_(idx)
+			{}
+
+			void increment()
+			{
+				++index_;
+			}
+
+			bool equal(optional_iterator_impl const& other) const
+			{
+				return index_ == other.index_;
+			}
+
+			optional<ValueType> dereference() const
+			{
+				return parent_->get(make_entity(index_));
+			}
+
+			parent_type* parent_;
+			entity_index_t index_;
+		};
+
+	public:
+
+		typedef T type;
+		typedef T value_type;
+		typedef Allocator allocator_type;
+		typedef optional<T> optional_type;
+		typedef optional<T const> const_optional_type;
+
+		// Iterates in depth first order; parents before children.
+		typedef iterator_impl<T> iterator;
+		typedef iterator_impl<T const> const_iterator;
+		typedef optional_iterator_impl<T> optional_iterator;
+		typedef optional_iterator_impl<T const> const_optional_iterator;
+
+		// Position of the parent of a root.
+		static entity_index_t no_parent()
+		{
+			return std::numeric_limits<entity_index_t>::max();
+		}
+
+		// --------------------------------------------------------------------
+		//
+		template<typename... Args>
+		hierarchy_pool(entity_pool& owner_pool, Args&&... args)
+			: hierarchy_pool(
+				std::allocator_arg,
+				Allocator(),
+				owner_pool,
+				std::forward<Args>(args)...)
+		{}
+
+		template<typename... Args>
+		hierarchy_pool(
+			std::allocator_arg_t,
+			Allocator const& alloc,
+			entity_pool& owner_pool,
+			Args&&... args)
+			: components_(component_allocator_type(alloc))
+			, entities_(index_allocator_type(alloc))
+			, parents_(index_allocator_type(alloc))
+			, subtree_sizes_(index_allocator_type(alloc))
+			, positions_(index_allocator_type(alloc))
+			, parent_positions_(index_allocator_type(alloc))
+			, dirty_from_(0)
+		{
+			positions_.resize(owner_pool.size(), no_parent());
+
+			// Create default values for existing entities, as roots.
+			std::for_each(
+				owner_pool.begin(),
+				owner_pool.end(),
+				[&args..., this](entity e)
+				{
+					create(e, std::forward<Args>(args)...);
+				}
+			);
+
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					[this](entity e)
+					{
+						handle_create_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_destroy_handler =
+				owner_pool.signals().on_entity_destroy.connect(
+					[this](entity e)
+					{
+						handle_destroy_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_swap_handler =
+				owner_pool.signals().on_entity_swap.connect(
+					[this](entity a, entity b)
+					{
+						handle_swap_entity(a, b);
+					}
+				)
+			;
+		}
+
+		template<typename... Args>
+		void auto_create_components(entity_pool& owner_pool, Args... args)
+		{
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					std::function<void(entity)>(
+						[this, args...](entity e)
+						{
+							handle_create_entity(e);
+							create(e, args...);
+						}
+					)
+				)
+			;
+		}
+
+		// Creates e as a new root, after every existing node.
+		template<typename... Args>
+		T* create(entity e, Args&&... args)
+		{
+			std::size_t const pos = components_.size();
+			components_.emplace_back(std::forward<Args>(args)...);
+			entities_.push_back(e.index());
+			parents_.push_back(no_parent());
+			subtree_sizes_.push_back(1);
+			positions_[e.index()] = static_cast<entity_index_t>(pos);
+			return std::addressof(components_.back());
+		}
+
+		// Creates e as the last child of parent, which must have a
+		// component.  Nodes after the parent's subtree shift along by one,
+		// so this is O(N) unless the parent's subtree ends the pool, as it
+		// always does when creating depth first.
+		template<typename... Args>
+		T* create_child(entity e, entity parent, Args&&... args)
+		{
+			std::size_t const parent_pos = positions_[parent.index()];
+			std::size_t const pos = parent_pos + subtree_sizes_[parent_pos];
+			components_.emplace(components_.begin() + pos, std::forward<Args>(args)...);
+			entities_.insert(entities_.begin() + pos, e.index());
+			parents_.insert(parents_.begin() + pos, parent.index());
+			subtree_sizes_.insert(subtree_sizes_.begin() + pos, 1);
+			update_positions(pos, components_.size());
+			resize_ancestors(parent.index(), 1);
+			return std::addressof(components_[pos]);
+		}
+
+		// Removes e's component.  Its children, and their subtrees, are
+		// given to e's parent, or become roots.
+		void destroy(entity e)
+		{
+			std::size_t const pos = positions_[e.index()];
+			entity_index_t const parent = parents_[pos];
+			std::size_t const last = pos + subtree_sizes_[pos];
+			for(std::size_t child = pos + 1; child < last; child += subtree_sizes_[child])
+			{
+				parents_[child] = parent;
+			}
+
+			resize_ancestors(parent, -1);
+			components_.erase(components_.begin() + pos);
+			entities_.erase(entities_.begin() + pos);
+			parents_.erase(parents_.begin() + pos);
+			subtree_sizes_.erase(subtree_sizes_.begin() + pos);
+			positions_[e.index()] = no_parent();
+			update_positions(pos, components_.size());
+		}
+
+		// Moves e and its subtree to be the last child of parent.  Only the
+		// nodes between the old and new positions move, so the cost is
+		// proportional to the subtree plus that distance.
+		void set_parent(entity e, entity parent)
+		{
+			std::size_t const pos = positions_[e.index()];
+			std::size_t const parent_pos = positions_[parent.index()];
+			if(parent_pos >= pos && parent_pos < pos + subtree_sizes_[pos])
+				BOOST_THROW_EXCEPTION(std::invalid_argument("Can't parent an entity to its own subtree."));
+
+			move_subtree(e, parent.index(), parent_pos + subtree_sizes_[parent_pos]);
+		}
+
+		// Moves e and its subtree to be the last root.
+		void clear_parent(entity e)
+		{
+			move_subtree(e, no_parent(), components_.size());
+		}
+
+		optional<T> get(entity e)
+		{
+			if(has_component(e))
+				return components_[positions_[e.index()]];
+			return boost::none;
+		}
+
+		optional<const T> get(entity e) const
+		{
+			if(has_component(e))
+				return components_[positions_[e.index()]];
+			return boost::none;
+		}
+
+		boost::optional<entity> parent(entity e) const
+		{
+			entity_index_t const p = parents_[positions_[e.index()]];
+			if(p != no_parent())
+				return make_entity(p);
+			return boost::none;
+		}
+
+		// e's component followed by those of all its descendants.
+		boost::iterator_range<iterator> subtree(entity e)
+		{
+			std::size_t const pos = positions_[e.index()];
+			return boost::make_iterator_range(
+				iterator(components_.begin() + pos, entities_.begin() + pos),
+				iterator(
+					components_.begin() + pos + subtree_sizes_[pos],
+					entities_.begin() + pos + subtree_sizes_[pos]
+				)
+			);
+		}
+
+		boost::iterator_range<const_iterator> subtree(entity e) const
+		{
+			std::size_t const pos = positions_[e.index()];
+			return boost::make_iterator_range(
+				const_iterator(components_.begin() + pos, entities_.begin() + pos),
+				const_iterator(
+					components_.begin() + pos + subtree_sizes_[pos],
+					entities_.begin() + pos + subtree_sizes_[pos]
+				)
+			);
+		}
+
+		iterator begin()
+		{
+			return iterator(components_.begin(), entities_.begin());
+		}
+
+		iterator end()
+		{
+			return iterator(components_.end(), entities_.end());
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(components_.begin(), entities_.begin());
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(components_.end(), entities_.end());
+		}
+
+		optional_iterator optional_begin()
+		{
+			return optional_iterator(this, 0);
+		}
+
+		optional_iterator optional_end()
+		{
+			return optional_iterator(this, static_cast<entity_index_t>(positions_.size()));
+		}
+
+		const_optional_iterator optional_begin() const
+		{
+			return const_optional_iterator(this, 0);
+		}
+
+		const_optional_iterator optional_end() const
+		{
+			return const_optional_iterator(this, static_cast<entity_index_t>(positions_.size()));
+		}
+
+		// --------------------------------------------------------------------
+		// Positional interface, for passes over the packed order.
+
+		// Index of e's component in iteration order.
+		std::size_t position(entity e) const
+		{
+			return positions_[e.index()];
+		}
+
+		// The position of each node's parent, or no_parent() for roots,
+		// in iteration order.  Entries before the first position changed
+		// since the last call are kept, so calling this once per frame
+		// costs a pass over the nodes that moved and those after them.
+		index_table_t const& parent_positions()
+		{
+			parent_positions_.resize(components_.size());
+			for(std::size_t i = dirty_from_; i < parents_.size(); ++i)
+			{
+				entity_index_t const p = parents_[i];
+				parent_positions_[i] = p != no_parent() ? positions_[p] : no_parent();
+			}
+
+			dirty_from_ = parents_.size();
+			return parent_positions_;
+		}
+
+		// The entity owning each component, in iteration order.
+		index_table_t const& entities() const
+		{
+			return entities_;
+		}
+
+		// The number of nodes in each node's subtree, itself included.
+		index_table_t const& subtree_sizes() const
+		{
+			return subtree_sizes_;
+		}
+
+		std::size_t size() const
+		{
+			return components_.size();
+		}
+
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("hierarchy_pool::reserve");
+			components_.reserve(count);
+			entities_.reserve(count);
+			parents_.reserve(count);
+			subtree_sizes_.reserve(count);
+		}
+
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("hierarchy_pool::shrink_to_fit");
+			components_.shrink_to_fit();
+			entities_.shrink_to_fit();
+			parents_.shrink_to_fit();
+			subtree_sizes_.shrink_to_fit();
+			positions_.shrink_to_fit();
+			parent_positions_.shrink_to_fit();
+		}
+
+		// The packed order is always compact.
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("hierarchy_pool::compact");
+			shrink_to_fit();
+		}
+
+		// Shrinks at most budget bytes worth of storage according to
+		// policy.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("hierarchy_pool::shrink_step");
+			std::size_t spent = policy.shrink(components_, budget);
+			spent += policy.shrink(entities_, budget - spent);
+			spent += policy.shrink(parents_, budget - spent);
+			spent += policy.shrink(subtree_sizes_, budget - spent);
+			spent += policy.shrink(positions_, budget - spent);
+			spent += policy.shrink(parent_positions_, budget - spent);
+			return spent;
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = components_.size();
+			usage.slot_count = components_.size();
+			usage.live_bytes = components_.size() * sizeof(T);
+			usage.reserved_bytes = components_.capacity() * sizeof(T);
+			usage.index_bytes = (
+				entities_.capacity() +
+				parents_.capacity() +
+				subtree_sizes_.capacity() +
+				positions_.capacity() +
+				parent_positions_.capacity()
+			) * sizeof(entity_index_t);
+			return usage;
+		}
+
+		allocator_type get_allocator() const
+		{
+			return allocator_type(components_.get_allocator());
+		}
+
+	private:
+
+		bool has_component(entity e) const
+		{
+			return positions_[e.index()] != no_parent();
+		}
+
+		void update_positions(std::size_t first, std::size_t last)
+		{
+			for(std::size_t i = first; i < last; ++i)
+			{
+				positions_[entities_[i]] = static_cast<entity_index_t>(i);
+			}
+
+			dirty_from_ = std::min(dirty_from_, first);
+		}
+
+		void resize_ancestors(entity_index_t parent, std::ptrdiff_t delta)
+		{
+			while(parent != no_parent())
+			{
+				std::size_t const pos = positions_[parent];
+				subtree_sizes_[pos] = static_cast<entity_index_t>(subtree_sizes_[pos] + delta);
+				parent = parents_[pos];
+			}
+		}
+
+		template<typename Vector>
+		static void rotate(Vector& v, std::size_t first, std::size_t middle, std::size_t last)
+		{
+			std::rotate(v.begin() + first, v.begin() + middle, v.begin() + last);
+		}
+
+		// Moves e's subtree so it starts at target, measured before the
+		// move, and hangs from parent.
+		void move_subtree(entity e, entity_index_t parent, std::size_t target)
+		{
+			std::size_t const pos = positions_[e.index()];
+			std::size_t const count = subtree_sizes_[pos];
+			resize_ancestors(parents_[pos], -std::ptrdiff_t(count));
+
+			std::size_t first, middle, last, moved_to;
+			if(target > pos)
+			{
+				first = pos;
+				middle = pos + count;
+				last = target;
+				moved_to = target - count;
+			}
+			else
+			{
+				first = target;
+				middle = pos;
+				last = pos + count;
+				moved_to = target;
+			}
+
+			rotate(components_, first, middle, last);
+			rotate(entities_, first, middle, last);
+			rotate(parents_, first, middle, last);
+			rotate(subtree_sizes_, first, middle, last);
+			update_positions(first, last);
+
+			parents_[moved_to] = parent;
+			resize_ancestors(parent, std::ptrdiff_t(count));
+		}
+
+		// No copying
+		hierarchy_pool(hierarchy_pool const&);
+		hierarchy_pool operator=(hierarchy_pool);
+
+		friend class creation_queue<hierarchy_pool>;
+		friend class destruction_queue<hierarchy_pool>;
+		friend struct serialization::access;
+		friend struct lifecycle_access;
+
+		struct slot_list
+		{
+			boost::signals2::scoped_connection entity_create_handler;
+			boost::signals2::scoped_connection entity_destroy_handler;
+			boost::signals2::scoped_connection entity_swap_handler;
+		};
+
+		// --------------------------------------------------------------------
+		// Serialization interface.
+		template<typename Writer>
+		void save(Writer& writer) const
+		{
+			writer.write_table(components_);
+			writer.write_table(entities_);
+			writer.write_table(parents_);
+			writer.write_table(subtree_sizes_);
+			writer.write_table(positions_);
+		}
+
+		template<typename Reader>
+		void load(Reader& reader)
+		{
+			reader.read_table(components_);
+			reader.read_table(entities_);
+			reader.read_table(parents_);
+			reader.read_table(subtree_sizes_);
+			reader.read_table(positions_);
+
+			std::size_t const count = components_.size();
+			reader.check(
+				entities_.size() == count &&
+				parents_.size() == count &&
+				subtree_sizes_.size() == count &&
+				positions_.size() == reader.entity_count()
+			);
+			reader.check_indices(positions_, count, no_parent());
+			reader.check_indices(entities_, positions_.size());
+			reader.check_indices(parents_, positions_.size(), no_parent());
+			for(std::size_t i = 0; i < count; ++i)
+				reader.check(subtree_sizes_[i] > 0 && subtree_sizes_[i] <= count - i);
+
+			dirty_from_ = 0;
+		}
+
+		// --------------------------------------------------------------------
+		// Queue interface.  Queued components are created as roots.
+		template<typename Iter>
+		void create_range(Iter current, Iter last)
+		{
+			reserve(components_.size() + std::distance(current, last));
+			while(current != last)
+			{
+				create(current->first.lock().get(), std::move(current->second));
+				++current;
+			}
+		}
+
+		template<typename Iter>
+		void destroy_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				destroy(current->lock().get());
+				++current;
+			}
+		}
+
+		// --------------------------------------------------------------------
+		// Slot Handlers.
+		void handle_create_entity(entity e)
+		{
+			if(positions_.size() <= e.index())
+				positions_.resize(e.index()+1, no_parent());
+		}
+
+		void handle_destroy_entity(entity e)
+		{
+			if(has_component(e))
+			{
+				destroy(e);
+			}
+
+			positions_.erase(positions_.begin() + e.index());
+		}
+
+		// Positions don't change, but a and b trade names, including in
+		// the parent links of their children.
+		void handle_swap_entity(entity a, entity b)
+		{
+			using std::swap;
+
+			rename_children(a.index(), b.index());
+			rename_children(b.index(), a.index());
+			swap(positions_[a.index()], positions_[b.index()]);
+		}
+
+		void rename_children(entity_index_t from, entity_index_t to)
+		{
+			std::size_t const pos = positions_[from];
+			if(pos == no_parent())
+				return;
+
+			entities_[pos] = to;
+			std::size_t const last = pos + subtree_sizes_[pos];
+			for(std::size_t child = pos + 1; child < last; child += subtree_sizes_[child])
+			{
+				parents_[child] = to;
+			}
+		}
+
+		component_table_t components_;
+		index_table_t entities_;
+		index_table_t parents_;
+		index_table_t subtree_sizes_;
+		index_table_t positions_;
+		index_table_t parent_positions_;
+		std::size_t dirty_from_;
+		slot_list slots_;
+	};
+} } // namespace entity { namespace component
+
+#endif // ENTITY_COMPONENT_HIERARCHYPOOL_H_INCLUDED_
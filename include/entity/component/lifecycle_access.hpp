@@ -0,0 +1,48 @@
+// ****************************************************************************
+// entity/component/lifecycle_access.hpp
+//
+// Lets a container that manages entities itself, such as world, call the
+// pools' private entity handlers directly instead of through signals.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_COMPONENT_LIFECYCLEACCESS_H_INCLUDED_
+#define ENTITY_COMPONENT_LIFECYCLEACCESS_H_INCLUDED_
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/entity.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace component {
+
+struct lifecycle_access
+{
+	template<typename Pool>
+	static void create_entity(Pool& pool, entity e)
+	{
+		pool.handle_create_entity(e);
+	}
+
+	template<typename Pool>
+	static void destroy_entity(Pool& pool, entity e)
+	{
+		pool.handle_destroy_entity(e);
+	}
+
+	template<typename Pool>
+	static void swap_entities(Pool& pool, entity a, entity b)
+	{
+		pool.handle_swap_entity(a, b);
+	}
+};
+
+} } // namespace entity { namespace component {
+
+#endif // ENTITY_COMPONENT_LIFECYCLEACCESS_H_INCLUDED_
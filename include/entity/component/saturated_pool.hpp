@@ -23,14 +23,20 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <vector>
 
 #include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
 #include "entity/component/required.hpp"
 #include "entity/entity.hpp"
 #include "entity/entity_index.hpp"
 #include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
 
 namespace boost {
 namespace iterators {
@@ -47,11 +53,17 @@ namespace entity { namespace component
 	template<typename ComponentPool>
 	class destruction_queue;
 
-	template<typename T>
+	template<typename T, typename Allocator = std::allocator<T>>
 	class saturated_pool
 	{
 	private:
 
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<T> component_allocator_type;
+
+		typedef std::vector<T, component_allocator_type> component_table_t;
+
 		// For saturated pools, the elements are never 'optional', so the name
 		// optional is incorrect.  However, we want the pools to have
 		// compatible interfaces so we retain the name.
@@ -72,7 +84,7 @@ namespace entity { namespace component
 			friend class boost::iterator_core_access;
 			friend class saturated_pool;
 			
-			typedef typename std::vector<T>::iterator parent_iterator;
+			typedef typename component_table_t::iterator parent_iterator;
 
 			optional_iterator_impl(parent_iterator iter)
 				: iterator_(iter)
@@ -102,8 +114,9 @@ namespace entity { namespace component
 		typedef T value_type;
 		typedef required<T> optional_type;
 		typedef required<T const> const_optional_type;
-		typedef typename std::vector<T>::iterator iterator;
-		typedef typename std::vector<T>::const_iterator const_iterator;
+		typedef Allocator allocator_type;
+		typedef typename component_table_t::iterator iterator;
+		typedef typename component_table_t::const_iterator const_iterator;
 		typedef optional_iterator_impl<T> optional_iterator;
 		typedef optional_iterator_impl<T const> const_optional_iterator;
 
@@ -111,6 +124,16 @@ namespace entity { namespace component
 		//	
 		template<typename... Args>		
 		saturated_pool(entity_pool& owner_pool, Args... args)
+			: saturated_pool(std::allocator_arg, Allocator(), owner_pool, args...)
+		{}
+
+		template<typename... Args>
+		saturated_pool(
+			std::allocator_arg_t,
+			Allocator const& alloc,
+			entity_pool& owner_pool,
+			Args... args)
+			: components_(component_allocator_type(alloc))
 		{
 			std::for_each(
 				owner_pool.begin(),
@@ -222,6 +245,49 @@ namespace entity { namespace component
 			return components_.size();
 		}
 
+		// Reserves space for count entities so the pool can grow to that
+		// size without reallocating.
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("saturated_pool::reserve");
+			components_.reserve(count);
+		}
+
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("saturated_pool::shrink_to_fit");
+			components_.shrink_to_fit();
+		}
+
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("saturated_pool::compact");
+			shrink_to_fit();
+		}
+
+		// Shrinks at most budget bytes worth of storage according to
+		// policy.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("saturated_pool::shrink_step");
+			return policy.shrink(components_, budget);
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = components_.size();
+			usage.slot_count = components_.size();
+			usage.live_bytes = components_.size() * sizeof(T);
+			usage.reserved_bytes = components_.capacity() * sizeof(T);
+			return usage;
+		}
+
+		allocator_type get_allocator() const
+		{
+			return allocator_type(components_.get_allocator());
+		}
+
 	private:
 
 		// No copying.
@@ -242,8 +308,10 @@ namespace entity { namespace component
 			components_.erase(components_.begin() + e.index());
 		}
 
-		friend class creation_queue<saturated_pool<T>>;
-		friend class destruction_queue<saturated_pool<T>>;
+		friend class creation_queue<saturated_pool>;
+		friend class destruction_queue<saturated_pool>;
+		friend struct serialization::access;
+		friend struct lifecycle_access;
 
 		struct slot_list
 		{
@@ -262,6 +330,21 @@ namespace entity { namespace component
 			return &components_[e.index()];
 		}
 
+		// --------------------------------------------------------------------
+		// Serialization interface.
+		template<typename Writer>
+		void save(Writer& writer) const
+		{
+			writer.write_table(components_);
+		}
+
+		template<typename Reader>
+		void load(Reader& reader)
+		{
+			reader.read_table(components_);
+			reader.check(components_.size() == reader.entity_count());
+		}
+
 		// --------------------------------------------------------------------
 		// Queue interface.
 		template<typename Iter>
@@ -286,6 +369,11 @@ namespace entity { namespace component
 
 		// --------------------------------------------------------------------
 		// Slot Handlers.
+		void handle_create_entity(entity e)
+		{
+			create_impl(e);
+		}
+
 		void handle_destroy_entity(entity e)
 		{
 			destroy_impl(e);
@@ -297,7 +385,7 @@ namespace entity { namespace component
 			swap(components_[a.index()], components_[b.index()]);
 		}
 
-		std::vector<type> components_;
+		component_table_t components_;
 		slot_list		  slots_;
 	};
 } } // namespace entity { namespace component
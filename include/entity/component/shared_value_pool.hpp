@@ -0,0 +1,731 @@
+// ****************************************************************************
+// entity/component/shared_value_pool.h
+//
+// Represents a component pool where many entities hold identical values,
+// such as mesh or material references.  Each distinct value is stored
+// once, reference counted, and entities hold a small index into the value
+// table.  Values are deduplicated on insert by hashing them.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_COMPONENT_SHAREDVALUEPOOL_H_INCLUDED_
+#define ENTITY_COMPONENT_SHAREDVALUEPOOL_H_INCLUDED_
+
+#include <boost/functional/hash.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/signals2.hpp>
+#include <boost/signals2/connection.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
+#include "entity/component/optional.hpp"
+#include "entity/entity.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace component
+{
+	template<typename ComponentPool>
+	class creation_queue;
+	template<typename ComponentPool>
+	class destruction_queue;
+
+	template<
+		typename T,
+		typename Hash = boost::hash<T>,
+		typename Pred = std::equal_to<T>,
+		typename Allocator = std::allocator<T>
+	>
+	class shared_value_pool
+	{
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<entity_index_t> index_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<std::size_t> hash_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<T> value_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<entity> entity_allocator_type;
+
+		typedef std::vector<entity_index_t, index_allocator_type> index_table_t;
+		typedef std::vector<std::size_t, hash_allocator_type> hash_table_t;
+		typedef std::vector<T, value_allocator_type> value_table_t;
+		typedef std::vector<entity, entity_allocator_type> entity_table_t;
+
+		// Visits each distinct value once, skipping released slots.
+		struct value_iterator
+			  : boost::iterator_facade<
+			    value_iterator
+			  , T const&
+			  , boost::forward_traversal_tag
+		  	>
+		{
+			value_iterator()
+				: parent_(nullptr)
+				, slot_(0)
+			{}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class shared_value_pool;
+
+			value_iterator(shared_value_pool const* parent, std::size_t slot)
+				: parent_(parent)
+				, slot_(slot)
+			{
+				skip_released();
+			}
+
+			void skip_released()
+			{
+				while(slot_ < parent_->values_.size() && parent_->refcounts_[slot_] == 0)
+					++slot_;
+			}
+
+			void increment()
+			{
+				++slot_;
+				skip_released();
+			}
+
+			bool equal(value_iterator const& other) const
+			{
+				return slot_ == other.slot_;
+			}
+
+			T const& dereference() const
+			{
+				return parent_->values_[slot_];
+			}
+
+			shared_value_pool const* parent_;
+			std::size_t slot_;
+		};
+
+		struct optional_iterator_impl
+			  : boost::iterator_facade<
+			    optional_iterator_impl
+			  , optional<T const>
+			  , boost::forward_traversal_tag
+			  , optional<T const>
+		  	>
+		{
+			optional_iterator_impl()
+			{}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class shared_value_pool;
+
+			optional_iterator_impl(shared_value_pool const* parent, entity_index_t idx)
+				: parent_(parent)
+				, index_(idx)
+			{}
+
+			void increment()
+			{
+				++index_;
+			}
+
+			bool equal(optional_iterator_impl const& other) const
+			{
+				return index_ == other.index_;
+			}
+
+			optional<T const> dereference() const
+			{
+				return parent_->get(make_entity(index_));
+			}
+
+			shared_value_pool const* parent_;
+			entity_index_t index_;
+		};
+
+	public:
+
+		// Shared values are read only through the pool; use create() to
+		// give an entity a different value.
+		typedef T type;
+		typedef T value_type;
+		typedef Allocator allocator_type;
+		typedef optional<T const> optional_type;
+		typedef optional<T const> const_optional_type;
+		typedef value_iterator iterator;
+		typedef value_iterator const_iterator;
+		typedef optional_iterator_impl optional_iterator;
+		typedef optional_iterator_impl const_optional_iterator;
+
+		// --------------------------------------------------------------------
+		//
+		template<typename... Args>
+		shared_value_pool(entity_pool& owner_pool, Args&&... args)
+			: shared_value_pool(
+				std::allocator_arg,
+				Allocator(),
+				owner_pool,
+				std::forward<Args>(args)...)
+		{}
+
+		template<typename... Args>
+		shared_value_pool(
+			std::allocator_arg_t,
+			Allocator const& alloc,
+			entity_pool& owner_pool,
+			Args&&... args)
+			: table_(index_allocator_type(alloc))
+			, values_(value_allocator_type(alloc))
+			, refcounts_(index_allocator_type(alloc))
+			, hashes_(hash_allocator_type(alloc))
+			, free_slots_(index_allocator_type(alloc))
+			, buckets_(index_allocator_type(alloc))
+			, bucket_shift_(64)
+			, count_(0)
+			, unique_count_(0)
+			, group_offsets_(hash_allocator_type(alloc))
+			, group_cursor_(hash_allocator_type(alloc))
+			, group_entities_(entity_allocator_type(alloc))
+		{
+			table_.resize(owner_pool.size(), no_component_flag());
+
+			// Create default values for existing entities.
+			std::for_each(
+				owner_pool.begin(),
+				owner_pool.end(),
+				[&args..., this](entity e)
+				{
+					create(e, std::forward<Args>(args)...);
+				}
+			);
+
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					[this](entity e)
+					{
+						handle_create_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_destroy_handler =
+				owner_pool.signals().on_entity_destroy.connect(
+					[this](entity e)
+					{
+						handle_destroy_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_swap_handler =
+				owner_pool.signals().on_entity_swap.connect(
+					[this](entity a, entity b)
+					{
+						handle_swap_entity(a, b);
+					}
+				)
+			;
+		}
+
+		template<typename... Args>
+		void auto_create_components(entity_pool& owner_pool, Args... args)
+		{
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					std::function<void(entity)>(
+						[this, args...](entity e)
+						{
+							handle_create_entity(e);
+							create(e, args...);
+						}
+					)
+				)
+			;
+		}
+
+		// Gives e the value constructed from args, sharing the storage of
+		// an equal value if one exists.  Replaces any value e already had.
+		template<typename... Args>
+		T const* create(entity e, Args&&... args)
+		{
+			entity_index_t const slot = acquire(T(std::forward<Args>(args)...));
+			entity_index_t& current = table_[e.index()];
+			if(current != no_component_flag())
+				release(current);
+			else
+				++count_;
+
+			current = slot;
+			return std::addressof(values_[slot]);
+		}
+
+		void destroy(entity e)
+		{
+			entity_index_t& current = table_[e.index()];
+			release(current);
+			current = no_component_flag();
+			--count_;
+		}
+
+		optional<T const> get(entity e) const
+		{
+			entity_index_t const slot = table_[e.index()];
+			if(slot != no_component_flag())
+				return values_[slot];
+			return boost::none;
+		}
+
+		// Number of entities sharing e's value, or zero.
+		std::size_t use_count(entity e) const
+		{
+			entity_index_t const slot = table_[e.index()];
+			if(slot != no_component_flag())
+				return refcounts_[slot];
+			return 0;
+		}
+
+		iterator begin() const
+		{
+			return iterator(this, 0);
+		}
+
+		iterator end() const
+		{
+			return iterator(this, values_.size());
+		}
+
+		optional_iterator optional_begin() const
+		{
+			return optional_iterator(this, 0);
+		}
+
+		optional_iterator optional_end() const
+		{
+			return optional_iterator(this, static_cast<entity_index_t>(table_.size()));
+		}
+
+		// Number of entities with a value.
+		std::size_t size() const
+		{
+			return count_;
+		}
+
+		// Number of distinct values, as visited by begin() and end().
+		std::size_t unique_size() const
+		{
+			return unique_count_;
+		}
+
+		// Calls f(value, first, last) once per distinct value, where
+		// [first, last) are the entities holding it in index order.
+		template<typename F>
+		void for_each_group(F f)
+		{
+			group_offsets_.assign(values_.size() + 1, 0);
+			for(std::size_t slot = 0; slot < values_.size(); ++slot)
+			{
+				group_offsets_[slot + 1] = group_offsets_[slot] + refcounts_[slot];
+			}
+
+			group_entities_.resize(count_, make_entity(0));
+			group_cursor_.assign(group_offsets_.begin(), group_offsets_.end() - 1);
+			for(std::size_t i = 0; i < table_.size(); ++i)
+			{
+				entity_index_t const slot = table_[i];
+				if(slot != no_component_flag())
+				{
+					group_entities_[group_cursor_[slot]++] =
+						make_entity(static_cast<entity_index_t>(i));
+				}
+			}
+
+			entity const* entities = group_entities_.data();
+			for(std::size_t slot = 0; slot < values_.size(); ++slot)
+			{
+				if(refcounts_[slot])
+				{
+					f(
+						static_cast<T const&>(values_[slot]),
+						entities + group_offsets_[slot],
+						entities + group_offsets_[slot + 1]
+					);
+				}
+			}
+		}
+
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("shared_value_pool::reserve");
+			table_.reserve(count);
+		}
+
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("shared_value_pool::shrink_to_fit");
+			table_.shrink_to_fit();
+			values_.shrink_to_fit();
+			refcounts_.shrink_to_fit();
+			hashes_.shrink_to_fit();
+			free_slots_.shrink_to_fit();
+			group_offsets_ = hash_table_t(group_offsets_.get_allocator());
+			group_cursor_ = hash_table_t(group_cursor_.get_allocator());
+			group_entities_ = entity_table_t(group_entities_.get_allocator());
+			rehash(buckets_for(unique_count_));
+		}
+
+		// Shrinks and also removes released values from the table,
+		// renumbering the values entities refer to.
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("shared_value_pool::compact");
+			index_table_t remap(values_.size(), no_component_flag(), table_.get_allocator());
+			entity_index_t next = 0;
+			for(std::size_t slot = 0; slot < values_.size(); ++slot)
+			{
+				if(refcounts_[slot])
+				{
+					if(next != slot)
+					{
+						values_[next] = std::move(values_[slot]);
+						refcounts_[next] = refcounts_[slot];
+						hashes_[next] = hashes_[slot];
+					}
+
+					remap[slot] = next++;
+				}
+			}
+
+			values_.erase(values_.begin() + next, values_.end());
+			refcounts_.resize(next);
+			hashes_.resize(next);
+			free_slots_.clear();
+			for(entity_index_t& slot : table_)
+			{
+				if(slot != no_component_flag())
+					slot = remap[slot];
+			}
+
+			shrink_to_fit();
+		}
+
+		// Shrinks at most budget bytes worth of storage according to
+		// policy.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("shared_value_pool::shrink_step");
+			std::size_t spent = policy.shrink(table_, budget);
+			spent += policy.shrink(values_, budget - spent);
+			spent += policy.shrink(refcounts_, budget - spent);
+			spent += policy.shrink(hashes_, budget - spent);
+			return spent;
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = count_;
+			usage.slot_count = values_.size();
+			usage.live_bytes = unique_count_ * sizeof(T);
+			usage.reserved_bytes = values_.capacity() * sizeof(T);
+			usage.index_bytes =
+				(table_.capacity() + refcounts_.capacity() +
+				 free_slots_.capacity() + buckets_.capacity()) * sizeof(entity_index_t) +
+				hashes_.capacity() * sizeof(std::size_t)
+			;
+			return usage;
+		}
+
+		allocator_type get_allocator() const
+		{
+			return allocator_type(values_.get_allocator());
+		}
+
+	private:
+
+		static entity_index_t no_component_flag()
+		{
+			return std::numeric_limits<entity_index_t>::max();
+		}
+
+		static std::size_t buckets_for(std::size_t count)
+		{
+			std::size_t buckets = 8;
+			while(buckets * 3 < count * 4)
+				buckets *= 2;
+			return buckets;
+		}
+
+		std::size_t ideal_bucket(std::size_t hash) const
+		{
+			return static_cast<std::size_t>(
+				(std::uint64_t(hash) * 0x9E3779B97F4A7C15ull) >> bucket_shift_
+			);
+		}
+
+		// Finds the slot holding value, refcounted or not, using the
+		// open addressing bucket table.
+		entity_index_t find_slot(T const& value, std::size_t hash) const
+		{
+			if(buckets_.empty())
+				return no_component_flag();
+
+			std::size_t const mask = buckets_.size() - 1;
+			for(std::size_t b = ideal_bucket(hash); ; b = (b + 1) & mask)
+			{
+				entity_index_t const slot = buckets_[b];
+				if(slot == no_component_flag())
+					return no_component_flag();
+				if(hashes_[slot] == hash && pred_(values_[slot], value))
+					return slot;
+			}
+		}
+
+		entity_index_t acquire(T&& value)
+		{
+			std::size_t const hash = hash_(value);
+			entity_index_t slot = find_slot(value, hash);
+			if(slot != no_component_flag())
+			{
+				++refcounts_[slot];
+				return slot;
+			}
+
+			if((unique_count_ + 1) * 4 > buckets_.size() * 3)
+				rehash(buckets_for(unique_count_ + 1));
+
+			if(free_slots_.empty())
+			{
+				slot = static_cast<entity_index_t>(values_.size());
+				values_.push_back(std::move(value));
+				refcounts_.push_back(1);
+				hashes_.push_back(hash);
+			}
+			else
+			{
+				slot = free_slots_.back();
+				free_slots_.pop_back();
+				values_[slot] = std::move(value);
+				refcounts_[slot] = 1;
+				hashes_[slot] = hash;
+			}
+
+			place(slot);
+			++unique_count_;
+			return slot;
+		}
+
+		// Released values stay in place until the slot is reused or the
+		// pool is compacted.
+		void release(entity_index_t slot)
+		{
+			if(--refcounts_[slot])
+				return;
+
+			std::size_t const mask = buckets_.size() - 1;
+			std::size_t b = ideal_bucket(hashes_[slot]);
+			while(buckets_[b] != slot)
+				b = (b + 1) & mask;
+
+			erase_bucket(b);
+			free_slots_.push_back(slot);
+			--unique_count_;
+		}
+
+		void place(entity_index_t slot)
+		{
+			std::size_t const mask = buckets_.size() - 1;
+			std::size_t b = ideal_bucket(hashes_[slot]);
+			while(buckets_[b] != no_component_flag())
+				b = (b + 1) & mask;
+
+			buckets_[b] = slot;
+		}
+
+		// Backward shift deletion, so lookups never have to step over
+		// tombstones.
+		void erase_bucket(std::size_t hole)
+		{
+			std::size_t const mask = buckets_.size() - 1;
+			for(std::size_t next = (hole + 1) & mask;
+				buckets_[next] != no_component_flag();
+				next = (next + 1) & mask)
+			{
+				std::size_t const ideal = ideal_bucket(hashes_[buckets_[next]]);
+				if(((next - ideal) & mask) >= ((next - hole) & mask))
+				{
+					buckets_[hole] = buckets_[next];
+					hole = next;
+				}
+			}
+
+			buckets_[hole] = no_component_flag();
+		}
+
+		void rehash(std::size_t buckets)
+		{
+			index_table_t fresh(buckets, no_component_flag(), buckets_.get_allocator());
+			buckets_.swap(fresh);
+
+			bucket_shift_ = 64;
+			for(std::size_t b = buckets; b > 1; b >>= 1)
+				--bucket_shift_;
+
+			for(std::size_t slot = 0; slot < values_.size(); ++slot)
+			{
+				if(refcounts_[slot])
+					place(static_cast<entity_index_t>(slot));
+			}
+		}
+
+		// No copying
+		shared_value_pool(shared_value_pool const&);
+		shared_value_pool operator=(shared_value_pool);
+
+		friend class creation_queue<shared_value_pool>;
+		friend class destruction_queue<shared_value_pool>;
+		friend struct serialization::access;
+		friend struct lifecycle_access;
+
+		struct slot_list
+		{
+			boost::signals2::scoped_connection entity_create_handler;
+			boost::signals2::scoped_connection entity_destroy_handler;
+			boost::signals2::scoped_connection entity_swap_handler;
+		};
+
+		// --------------------------------------------------------------------
+		// Serialization interface.  Hashes aren't portable, so they and
+		// the bucket table are rebuilt on load.
+		template<typename Writer>
+		void save(Writer& writer) const
+		{
+			writer.write_table(table_);
+			writer.write_table(values_);
+			writer.write_table(refcounts_);
+		}
+
+		template<typename Reader>
+		void load(Reader& reader)
+		{
+			reader.read_table(table_);
+			reader.read_table(values_);
+			reader.read_table(refcounts_);
+
+			reader.check(
+				table_.size() == reader.entity_count() &&
+				refcounts_.size() == values_.size()
+			);
+			reader.check_indices(table_, values_.size(), no_component_flag());
+
+			hashes_.resize(values_.size());
+			free_slots_.clear();
+			count_ = 0;
+			unique_count_ = 0;
+			for(std::size_t slot = 0; slot < values_.size(); ++slot)
+			{
+				hashes_[slot] = hash_(values_[slot]);
+				if(refcounts_[slot])
+				{
+					count_ += refcounts_[slot];
+					++unique_count_;
+				}
+				else
+				{
+					free_slots_.push_back(static_cast<entity_index_t>(slot));
+				}
+			}
+
+			rehash(buckets_for(unique_count_));
+		}
+
+		// --------------------------------------------------------------------
+		// Queue interface.
+		template<typename Iter>
+		void create_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				create(current->first.lock().get(), std::move(current->second));
+				++current;
+			}
+		}
+
+		template<typename Iter>
+		void destroy_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				destroy(current->lock().get());
+				++current;
+			}
+		}
+
+		// --------------------------------------------------------------------
+		// Slot Handlers.
+		void handle_create_entity(entity e)
+		{
+			if(table_.size() <= e.index())
+				table_.resize(e.index()+1, no_component_flag());
+		}
+
+		void handle_destroy_entity(entity e)
+		{
+			if(table_[e.index()] != no_component_flag())
+			{
+				destroy(e);
+			}
+
+			table_.erase(table_.begin() + e.index());
+		}
+
+		void handle_swap_entity(entity a, entity b)
+		{
+			using std::swap;
+			swap(table_[a.index()], table_[b.index()]);
+		}
+
+		index_table_t table_;
+		value_table_t values_;
+		index_table_t refcounts_;
+		hash_table_t hashes_;
+		index_table_t free_slots_;
+		index_table_t buckets_;
+		unsigned bucket_shift_;
+		std::size_t count_;
+		std::size_t unique_count_;
+		Hash hash_;
+		Pred pred_;
+		hash_table_t group_offsets_;
+		hash_table_t group_cursor_;
+		entity_table_t group_entities_;
+		slot_list slots_;
+	};
+} } // namespace entity { namespace component
+
+#endif // ENTITY_COMPONENT_SHAREDVALUEPOOL_H_INCLUDED_
@@ -26,14 +26,20 @@
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <memory>
 #include <mutex>
 #include <utility>
 #include <vector>
 
 #include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
 #include "entity/component/optional.hpp"
 #include "entity/entity.hpp"
 #include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
 #include "entity/support/mutable_pair.hpp"
 
 namespace boost {
@@ -51,11 +57,19 @@ namespace entity { namespace component
 	template<typename ComponentPool>
 	class destruction_queue;
 
-	template<typename T>
+	template<typename T, typename Allocator = std::allocator<T>>
 	class sparse_pool
 	{
-		typedef std::vector<entity_index_t> index_table_t;
-		typedef std::vector<T> component_table_t;
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<entity_index_t> index_allocator_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<T> component_allocator_type;
+
+		typedef std::vector<entity_index_t, index_allocator_type> index_table_t;
+		typedef std::vector<T, component_allocator_type> component_table_t;
 
 		template<typename ValueType>
 		struct iterator_impl
@@ -68,20 +82,29 @@ namespace entity { namespace component
 			iterator_impl()
 			{}
 
+			entity get_entity() const
+			{
+				return make_entity(*entity_iterator_);
+			}
+
 		private:
 
 			friend class boost::iterator_core_access;
 			friend class sparse_pool;
 			
-			typedef typename sparse_pool<T>::component_table_t::iterator parent_iterator;
+			typedef typename sparse_pool::component_table_t::iterator parent_iterator;
+
+			typedef typename sparse_pool::index_table_t::const_iterator entity_iterator;
 
-			explicit iterator_impl(parent_iterator table_iter)
+			iterator_impl(parent_iterator table_iter, entity_iterator entity_iter)
 				: iterator_(std::move(table_iter))
+				, entity_iterator_(std::move(entity_iter))
 			{}
 
 			void increment()
 			{
 				++iterator_;
+				++entity_iterator_;
 			}
 
 			bool equal(iterator_impl const& other) const
@@ -95,6 +118,7 @@ namespace entity { namespace component
 			}
 
 			parent_iterator iterator_;
+			entity_iterator entity_iterator_;
 		};
 
 		template<typename ValueType>
@@ -114,8 +138,8 @@ namespace entity { namespace component
 			friend class boost::iterator_core_access;
 			friend class sparse_pool;
 			
-			typedef typename sparse_pool<T>::index_table_t::iterator parent_iterator;
-			typedef typename sparse_pool<T>::component_table_t component_table_t;
+			typedef typename sparse_pool::index_table_t::iterator parent_iterator;
+			typedef typename sparse_pool::component_table_t component_table_t;
 
 			optional_iterator_impl(
 				parent_iterator table_iter, 
@@ -136,7 +160,7 @@ namespace entity { namespace component
 
 			optional<ValueType> dereference() const
 			{
-				if(*iterator_ != sparse_pool<T>::no_component_flag())
+				if(*iterator_ != sparse_pool::no_component_flag())
 					return (*components_)[*iterator_];
 				else
 					return boost::none;
@@ -150,6 +174,7 @@ namespace entity { namespace component
 
 		typedef T type;
 		typedef T value_type;
+		typedef Allocator allocator_type;
 		typedef optional<T> optional_type;
 		typedef optional<T const> const_optional_type;
 		typedef iterator_impl<T> iterator;
@@ -161,6 +186,22 @@ namespace entity { namespace component
 		//
 		template<typename... Args>
 		sparse_pool(entity_pool& owner_pool, Args&&... args)
+			: sparse_pool(
+				std::allocator_arg,
+				Allocator(),
+				owner_pool,
+				std::forward<Args>(args)...)
+		{}
+
+		template<typename... Args>
+		sparse_pool(
+			std::allocator_arg_t,
+			Allocator const& alloc,
+			entity_pool& owner_pool,
+			Args&&... args)
+			: table_(index_allocator_type(alloc))
+			, reverse_table_(index_allocator_type(alloc))
+			, components_(component_allocator_type(alloc))
 		{
 			// Create default values for existing entities.
 			std::for_each(
@@ -243,6 +284,10 @@ namespace entity { namespace component
 			components_.pop_back();
 			reverse_table_[idx] = reverse_table_.back();
 			reverse_table_.pop_back();
+
+			// Point the moved component's entity at its new home.
+			if(idx < reverse_table_.size())
+				table_[reverse_table_[idx]] = idx;
 		}
 
 		optional<T> get(entity e)
@@ -263,22 +308,22 @@ namespace entity { namespace component
 
 		iterator begin()
 		{
-			return iterator(components_.begin());
+			return iterator(components_.begin(), reverse_table_.begin());
 		}
 
 		iterator end()
 		{
-			return iterator(components_.end());
+			return iterator(components_.end(), reverse_table_.end());
 		}
 
 		const_iterator begin() const
 		{
-			return const_iterator(components_.begin());
+			return const_iterator(components_.begin(), reverse_table_.begin());
 		}
 
 		const_iterator end() const
 		{
-			return const_iterator(components_.end());
+			return const_iterator(components_.end(), reverse_table_.end());
 		}
 
 		optional_iterator optional_begin()
@@ -306,6 +351,80 @@ namespace entity { namespace component
 			return components_.size();
 		}
 
+		// Reserves space for count entities, each with a component, so the
+		// pool can grow to that size without reallocating.  With a lazily
+		// committed allocator the unused part costs only address space.
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("sparse_pool::reserve");
+			table_.reserve(count);
+			reverse_table_.reserve(count);
+			components_.reserve(count);
+		}
+
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("sparse_pool::shrink_to_fit");
+			table_.shrink_to_fit();
+			reverse_table_.shrink_to_fit();
+			components_.shrink_to_fit();
+		}
+
+		// Shrinks and also re-sorts the components into entity order,
+		// restoring linear access after heavy churn.
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("sparse_pool::compact");
+			component_table_t components(components_.get_allocator());
+			index_table_t reverse_table(reverse_table_.get_allocator());
+			components.reserve(components_.size());
+			reverse_table.reserve(components_.size());
+
+			for(entity_index_t e = 0; e < table_.size(); ++e)
+			{
+				entity_index_t& idx = table_[e];
+				if(idx != no_component_flag())
+				{
+					components.push_back(std::move(components_[idx]));
+					reverse_table.push_back(e);
+					idx = components.size() - 1;
+				}
+			}
+
+			components_.swap(components);
+			reverse_table_.swap(reverse_table);
+			table_.shrink_to_fit();
+		}
+
+		// Shrinks at most budget bytes worth of storage according to
+		// policy.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("sparse_pool::shrink_step");
+			std::size_t spent = policy.shrink(components_, budget);
+			spent += policy.shrink(reverse_table_, budget - spent);
+			spent += policy.shrink(table_, budget - spent);
+			return spent;
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = components_.size();
+			usage.slot_count = table_.size();
+			usage.live_bytes = components_.size() * sizeof(T);
+			usage.reserved_bytes = components_.capacity() * sizeof(T);
+			usage.index_bytes = 
+				(table_.capacity() + reverse_table_.capacity()) * sizeof(entity_index_t)
+			;
+			return usage;
+		}
+
+		allocator_type get_allocator() const
+		{
+			return allocator_type(components_.get_allocator());
+		}
+
 	private:
 
 		static entity_index_t no_component_flag()
@@ -323,8 +442,10 @@ namespace entity { namespace component
 		sparse_pool(sparse_pool const&);
 		sparse_pool operator=(sparse_pool);
 
-		friend class creation_queue<sparse_pool<T>>;
-		friend class destruction_queue<sparse_pool<T>>;
+		friend class creation_queue<sparse_pool>;
+		friend class destruction_queue<sparse_pool>;
+		friend struct serialization::access;
+		friend struct lifecycle_access;
 
 		struct slot_list
 		{
@@ -333,6 +454,31 @@ namespace entity { namespace component
 			boost::signals2::scoped_connection entity_swap_handler;
 		};
 
+		// --------------------------------------------------------------------
+		// Serialization interface.
+		template<typename Writer>
+		void save(Writer& writer) const
+		{
+			writer.write_table(table_);
+			writer.write_table(reverse_table_);
+			writer.write_table(components_);
+		}
+
+		template<typename Reader>
+		void load(Reader& reader)
+		{
+			reader.read_table(table_);
+			reader.read_table(reverse_table_);
+			reader.read_table(components_);
+
+			reader.check(
+				table_.size() == reader.entity_count() &&
+				reverse_table_.size() == components_.size()
+			);
+			reader.check_indices(table_, components_.size(), no_component_flag());
+			reader.check_indices(reverse_table_, table_.size());
+		}
+
 		// --------------------------------------------------------------------
 		// Queue interface.
 		template<typename Iter>
@@ -348,11 +494,12 @@ namespace entity { namespace component
 			);
 
 			auto current_index = initial_count;
+			reverse_table_.reserve(components_.size());
 			for(auto i = first; i != last; ++i)
 			{
 				auto entity = i->first.lock();
 				auto entity_idx = entity.get().index();
-				reverse_table_[current_index] = entity_idx;
+				reverse_table_.push_back(entity_idx);
 				table_[entity_idx] = current_index++;
 			}
 		}
@@ -382,21 +529,28 @@ namespace entity { namespace component
 			{
 				destroy(e);
 			}
+
+			table_.erase(table_.begin() + e.index());
 		}
 
 		void handle_swap_entity(entity a, entity b)
 		{
 			using std::swap;
 
-			// Could also just swap the indices here.
+			// Swap the indices instead of the components; either may
+			// have no component at all.
 			auto idx_a = table_[a.index()];
 			auto idx_b = table_[b.index()];
-			swap(components_[idx_a], components_[idx_b]);
+			swap(table_[a.index()], table_[b.index()]);
+			if(idx_a != no_component_flag())
+				reverse_table_[idx_a] = b.index();
+			if(idx_b != no_component_flag())
+				reverse_table_[idx_b] = a.index();
 		}
 
 		index_table_t table_;
 		index_table_t reverse_table_;
-		std::vector<T> components_;
+		component_table_t components_;
 		slot_list slots_;
 	};
 } } // namespace entity { namespace component 
@@ -0,0 +1,499 @@
+// ****************************************************************************
+// entity/component/spatial_grid.h
+//
+// Incremental spatial index over a pool of positions.
+//
+// Entities are bucketed by the grid cell their position falls in, with
+// cells hashed into a fixed number of buckets so the world needs no
+// bounds.  Each bucket entry keeps a copy of the position, so queries
+// filter candidates without touching the position pool.
+//
+// Component pools don't announce writes, so the grid is told which
+// entities moved through mark_moved() and re-buckets only those in
+// update(), or re-reads every position in refresh().  Entity creation,
+// destruction and swaps are followed through the entity pool signals.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_COMPONENT_SPATIALGRID_H_INCLUDED_
+#define ENTITY_COMPONENT_SPATIALGRID_H_INCLUDED_
+
+#include <boost/range/iterator_range_core.hpp>
+#include <boost/signals2.hpp>
+#include <boost/signals2/connection.hpp>
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/entity.hpp"
+#include "entity/entity_index.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/support/bit_ops.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace component
+{
+	// Reads coordinates from anything indexable as p[0], p[1], p[2].
+	struct subscript_coordinates
+	{
+		template<typename Position>
+		float operator()(Position const& p, int axis) const
+		{
+			return static_cast<float>(p[axis]);
+		}
+	};
+
+	template<typename PositionPool, typename Coordinates = subscript_coordinates>
+	class spatial_grid
+	{
+	public:
+
+		typedef PositionPool pool_type;
+		typedef typename PositionPool::value_type position_type;
+		typedef std::vector<entity> result_type;
+		typedef boost::iterator_range<
+			typename result_type::const_iterator
+		> result_range;
+
+		// --------------------------------------------------------------------
+		// cell_size should be around the typical query radius.  The
+		// bucket count is rounded up to a power of two.
+		spatial_grid(
+			entity_pool& owner_pool,
+			PositionPool& positions,
+			float cell_size,
+			std::size_t bucket_count = 1 << 16,
+			Coordinates coordinates = Coordinates())
+			: positions_(positions)
+			, coordinates_(coordinates)
+			, cell_size_(cell_size)
+			, inv_cell_size_(1.f / cell_size)
+			, indexed_count_(0)
+		{
+			if(!(cell_size > 0.f))
+			{
+				BOOST_THROW_EXCEPTION(
+					std::invalid_argument("Grid cell size must be positive.")
+				);
+			}
+
+			std::size_t buckets = 1;
+			while(buckets < bucket_count)
+				buckets <<= 1;
+
+			buckets_.resize(buckets);
+			bucket_mask_ = buckets - 1;
+
+			for(std::size_t i = 0; i < owner_pool.size(); ++i)
+			{
+				handle_create_entity(make_entity(static_cast<entity_index_t>(i)));
+			}
+
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					[this](entity e)
+					{
+						handle_create_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_destroy_handler =
+				owner_pool.signals().on_entity_destroy.connect(
+					[this](entity e)
+					{
+						handle_destroy_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_swap_handler =
+				owner_pool.signals().on_entity_swap.connect(
+					[this](entity a, entity b)
+					{
+						handle_swap_entity(a, b);
+					}
+				)
+			;
+
+			update();
+		}
+
+		// Flags e to be re-read on the next update().  New entities are
+		// flagged automatically.
+		void mark_moved(entity e)
+		{
+			moved_[e.index() / 64] |= std::uint64_t(1) << (e.index() % 64);
+		}
+
+		// Re-buckets the entities flagged since the last update, and
+		// drops those that no longer have a position.
+		void update()
+		{
+			ENTITY_PROFILE_ZONE("spatial_grid::update");
+			for(std::size_t w = 0; w < moved_.size(); ++w)
+			{
+				std::uint64_t word = moved_[w];
+				moved_[w] = 0;
+				while(word)
+				{
+					std::size_t const bit = support::count_trailing_zeros(word);
+					word &= word - 1;
+					place(w * 64 + bit);
+				}
+			}
+		}
+
+		// Re-reads every position.  Useful when most entities move each
+		// frame, as it skips the bookkeeping of marking them.
+		void refresh()
+		{
+			ENTITY_PROFILE_ZONE("spatial_grid::refresh");
+			std::fill(moved_.begin(), moved_.end(), std::uint64_t(0));
+			for(std::size_t i = 0; i < records_.size(); ++i)
+			{
+				place(i);
+			}
+		}
+
+		// Appends the entities inside the box [lo, hi] to out and returns
+		// the appended range, which can be passed to range::combine.
+		// Entities are reported as of the last update() or refresh().
+		result_range query_box(position_type const& lo, position_type const& hi, result_type& out) const
+		{
+			ENTITY_PROFILE_ZONE("spatial_grid::query_box");
+			float box[6];
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				box[axis] = coordinates_(lo, axis);
+				box[axis + 3] = coordinates_(hi, axis);
+			}
+
+			std::size_t const first = out.size();
+			for_each_bucket(box, [&box, &out](entry const& en)
+			{
+				for(int axis = 0; axis < 3; ++axis)
+				{
+					if(en.position[axis] < box[axis] || en.position[axis] > box[axis + 3])
+						return;
+				}
+
+				out.push_back(make_entity(en.entity));
+			});
+
+			return boost::make_iterator_range(out.cbegin() + first, out.cend());
+		}
+
+		// As query_box, for the entities within radius of center.
+		result_range query_radius(position_type const& center, float radius, result_type& out) const
+		{
+			ENTITY_PROFILE_ZONE("spatial_grid::query_radius");
+			float c[3];
+			float box[6];
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				c[axis] = coordinates_(center, axis);
+				box[axis] = c[axis] - radius;
+				box[axis + 3] = c[axis] + radius;
+			}
+
+			float const radius_sq = radius * radius;
+			std::size_t const first = out.size();
+			for_each_bucket(box, [&c, radius_sq, &out](entry const& en)
+			{
+				float dist_sq = 0.f;
+				for(int axis = 0; axis < 3; ++axis)
+				{
+					float const d = en.position[axis] - c[axis];
+					dist_sq += d * d;
+				}
+
+				if(dist_sq <= radius_sq)
+					out.push_back(make_entity(en.entity));
+			});
+
+			return boost::make_iterator_range(out.cbegin() + first, out.cend());
+		}
+
+		// Number of entities currently in the grid.
+		std::size_t size() const
+		{
+			return indexed_count_;
+		}
+
+		bool contains(entity e) const
+		{
+			return records_[e.index()].bucket != not_indexed();
+		}
+
+		float cell_size() const
+		{
+			return cell_size_;
+		}
+
+		std::size_t bucket_count() const
+		{
+			return buckets_.size();
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = indexed_count_;
+			usage.slot_count = records_.size();
+			usage.live_bytes = indexed_count_ * sizeof(entry);
+			for(auto&& bucket : buckets_)
+			{
+				usage.reserved_bytes += bucket.capacity() * sizeof(entry);
+			}
+
+			usage.index_bytes =
+				buckets_.capacity() * sizeof(bucket_t) +
+				records_.capacity() * sizeof(record) +
+				moved_.capacity() * sizeof(std::uint64_t)
+			;
+			return usage;
+		}
+
+	private:
+
+		// No copying
+		spatial_grid(spatial_grid const&);
+		spatial_grid operator=(spatial_grid const&);
+
+		struct entry
+		{
+			entity_index_t entity;
+			float position[3];
+		};
+
+		struct record
+		{
+			std::uint32_t bucket;
+			std::uint32_t slot;
+		};
+
+		typedef std::vector<entry> bucket_t;
+
+		static std::uint32_t not_indexed()
+		{
+			return std::numeric_limits<std::uint32_t>::max();
+		}
+
+		static std::int32_t cell_coordinate(float v, float inv_cell_size)
+		{
+			float const c = std::floor(v * inv_cell_size);
+			float const limit = float(std::numeric_limits<std::int32_t>::max() / 2);
+			return static_cast<std::int32_t>(std::max(-limit, std::min(c, limit)));
+		}
+
+		std::size_t bucket_of(std::int32_t x, std::int32_t y, std::int32_t z) const
+		{
+			std::uint32_t const h =
+				(static_cast<std::uint32_t>(x) * 73856093u) ^
+				(static_cast<std::uint32_t>(y) * 19349663u) ^
+				(static_cast<std::uint32_t>(z) * 83492791u)
+			;
+			return h & bucket_mask_;
+		}
+
+		// Calls f for every entry in the buckets the box overlaps.  Distinct
+		// cells can share a bucket, so buckets are gathered and deduplicated
+		// before they are visited.
+		template<typename F>
+		void for_each_bucket(float const (&box)[6], F f) const
+		{
+			std::int32_t lo[3];
+			std::int32_t hi[3];
+			std::uint64_t cells = 1;
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				lo[axis] = cell_coordinate(box[axis], inv_cell_size_);
+				hi[axis] = cell_coordinate(box[axis + 3], inv_cell_size_);
+				if(hi[axis] < lo[axis])
+					return;
+
+				cells *= std::uint64_t(std::int64_t(hi[axis]) - lo[axis] + 1);
+				cells = std::min<std::uint64_t>(cells, buckets_.size());
+			}
+
+			if(cells >= buckets_.size())
+			{
+				for(auto&& bucket : buckets_)
+				{
+					std::for_each(bucket.begin(), bucket.end(), f);
+				}
+
+				return;
+			}
+
+			// Queries around the cell size touch a few dozen buckets, which
+			// fit on the stack; queries stay const and safe to run in
+			// parallel.
+			std::size_t local[64];
+			std::vector<std::size_t> heap;
+			std::size_t* first = local;
+			if(cells > 64)
+			{
+				heap.resize(static_cast<std::size_t>(cells));
+				first = heap.data();
+			}
+
+			std::size_t* last = first;
+			for(std::int32_t z = lo[2]; z <= hi[2]; ++z)
+			{
+				for(std::int32_t y = lo[1]; y <= hi[1]; ++y)
+				{
+					for(std::int32_t x = lo[0]; x <= hi[0]; ++x)
+					{
+						*last++ = bucket_of(x, y, z);
+					}
+				}
+			}
+
+			std::sort(first, last);
+			last = std::unique(first, last);
+			for(; first != last; ++first)
+			{
+				bucket_t const& bucket = buckets_[*first];
+				std::for_each(bucket.begin(), bucket.end(), f);
+			}
+		}
+
+		void place(std::size_t idx)
+		{
+			auto p = positions_.get(make_entity(static_cast<entity_index_t>(idx)));
+			if(!p)
+			{
+				remove(idx);
+				return;
+			}
+
+			float pos[3];
+			for(int axis = 0; axis < 3; ++axis)
+				pos[axis] = coordinates_(*p, axis);
+
+			std::uint32_t const b = static_cast<std::uint32_t>(bucket_of(
+				cell_coordinate(pos[0], inv_cell_size_),
+				cell_coordinate(pos[1], inv_cell_size_),
+				cell_coordinate(pos[2], inv_cell_size_)
+			));
+
+			record& r = records_[idx];
+			if(r.bucket != b)
+			{
+				remove(idx);
+				r.bucket = b;
+				r.slot = static_cast<std::uint32_t>(buckets_[b].size());
+				entry en;
+				en.entity = static_cast<entity_index_t>(idx);
+				buckets_[b].push_back(en);
+				++indexed_count_;
+			}
+
+			entry& en = buckets_[b][r.slot];
+			std::copy(pos, pos + 3, en.position);
+		}
+
+		void remove(std::size_t idx)
+		{
+			record& r = records_[idx];
+			if(r.bucket == not_indexed())
+				return;
+
+			bucket_t& bucket = buckets_[r.bucket];
+			if(r.slot + 1 != bucket.size())
+			{
+				bucket[r.slot] = bucket.back();
+				records_[bucket[r.slot].entity].slot = r.slot;
+			}
+
+			bucket.pop_back();
+			r.bucket = not_indexed();
+			--indexed_count_;
+		}
+
+		bool is_moved(std::size_t idx) const
+		{
+			return (moved_[idx / 64] >> (idx % 64)) & 1;
+		}
+
+		void set_moved(std::size_t idx, bool moved)
+		{
+			std::uint64_t const bit = std::uint64_t(1) << (idx % 64);
+			if(moved)
+				moved_[idx / 64] |= bit;
+			else
+				moved_[idx / 64] &= ~bit;
+		}
+
+		void handle_create_entity(entity e)
+		{
+			record r;
+			r.bucket = not_indexed();
+			r.slot = 0;
+			records_.push_back(r);
+			if(moved_.size() * 64 < records_.size())
+				moved_.push_back(0);
+
+			mark_moved(e);
+		}
+
+		void handle_destroy_entity(entity e)
+		{
+			remove(e.index());
+			set_moved(e.index(), false);
+			records_.pop_back();
+		}
+
+		void handle_swap_entity(entity a, entity b)
+		{
+			std::size_t const ia = a.index();
+			std::size_t const ib = b.index();
+			std::swap(records_[ia], records_[ib]);
+			if(records_[ia].bucket != not_indexed())
+				buckets_[records_[ia].bucket][records_[ia].slot].entity = a.index();
+			if(records_[ib].bucket != not_indexed())
+				buckets_[records_[ib].bucket][records_[ib].slot].entity = b.index();
+
+			bool const moved_a = is_moved(ia);
+			set_moved(ia, is_moved(ib));
+			set_moved(ib, moved_a);
+		}
+
+		struct slot_list
+		{
+			boost::signals2::scoped_connection entity_create_handler;
+			boost::signals2::scoped_connection entity_destroy_handler;
+			boost::signals2::scoped_connection entity_swap_handler;
+		};
+
+		PositionPool& positions_;
+		Coordinates coordinates_;
+		float cell_size_;
+		float inv_cell_size_;
+		std::size_t bucket_mask_;
+		std::vector<bucket_t> buckets_;
+		std::vector<record> records_;
+		std::vector<std::uint64_t> moved_;
+		std::size_t indexed_count_;
+		slot_list slots_;
+	};
+} } // namespace entity { namespace component
+
+#endif // ENTITY_COMPONENT_SPATIALGRID_H_INCLUDED_
@@ -0,0 +1,601 @@
+// ****************************************************************************
+// entity/component/tag_pool.h
+//
+// Represents a pool of marker components that carry no data, such as
+// "frozen" or "needs_update".  Stores nothing but one bit per entity, so
+// dozens of tags cost less per entity than a single float component.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_COMPONENT_TAGPOOL_H_INCLUDED_
+#define ENTITY_COMPONENT_TAGPOOL_H_INCLUDED_
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/signals2.hpp>
+#include <boost/signals2/connection.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
+#include "entity/component/optional.hpp"
+#include "entity/entity.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
+#include "entity/support/bit_ops.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace component
+{
+	template<typename ComponentPool>
+	class creation_queue;
+	template<typename ComponentPool>
+	class destruction_queue;
+
+	template<typename Tag, typename Allocator = std::allocator<Tag>>
+	class tag_pool
+	{
+		typedef std::uint64_t word_type;
+		static std::size_t const bits_per_word = 64;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<word_type> word_allocator_type;
+
+		typedef std::vector<word_type, word_allocator_type> word_table_t;
+
+		// Visits tagged entities, skipping whole words without tags.
+		struct entity_iterator
+			  : boost::iterator_facade<
+			    entity_iterator
+			  , entity
+			  , boost::forward_traversal_tag
+			  , entity
+		  	>
+		{
+			entity_iterator()
+				: words_(nullptr)
+				, word_count_(0)
+				, word_(0)
+				, bits_(0)
+			{}
+
+			entity get_entity() const
+			{
+				return dereference();
+			}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class tag_pool;
+
+			entity_iterator(
+				word_type const* words,
+				std::size_t word_count,
+				std::size_t word)
+				: words_(words)
+				, word_count_(word_count)
+				, word_(word)
+				, bits_(word < word_count ? words[word] : 0)
+			{
+				skip_empty_words();
+			}
+
+			void skip_empty_words()
+			{
+				while(bits_ == 0 && word_ < word_count_)
+				{
+					++word_;
+					bits_ = word_ < word_count_ ? words_[word_] : 0;
+				}
+			}
+
+			void increment()
+			{
+				bits_ &= bits_ - 1;
+				skip_empty_words();
+			}
+
+			bool equal(entity_iterator const& other) const
+			{
+				return word_ == other.word_ && bits_ == other.bits_;
+			}
+
+			entity dereference() const
+			{
+				return make_entity(static_cast<entity_index_t>(
+					word_ * bits_per_word + support::count_trailing_zeros(bits_)
+				));
+			}
+
+			word_type const* words_;
+			std::size_t word_count_;
+			std::size_t word_;
+			word_type bits_;
+		};
+
+		template<typename ValueType>
+		struct optional_iterator_impl
+			  : boost::iterator_facade<
+			    optional_iterator_impl<ValueType>
+			  , optional<ValueType>
+			  , boost::forward_traversal_tag
+			  , optional<ValueType>
+		  	>
+		{
+			optional_iterator_impl()
+			{}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class tag_pool;
+
+			typedef typename std::conditional<
+				std::is_const<ValueType>::value,
+				tag_pool const,
+				tag_pool
+			>::type parent_type;
+
+			optional_iterator_impl(parent_type* parent, entity_index_t idx)
+				: parent_(parent)
+				, index_(idx)
+			{}
+
+			void increment()
+			{
+				++index_;
+			}
+
+			bool equal(optional_iterator_impl const& other) const
+			{
+				return index_ == other.index_;
+			}
+
+			optional<ValueType> dereference() const
+			{
+				return parent_->get(make_entity(index_));
+			}
+
+			parent_type* parent_;
+			entity_index_t index_;
+		};
+
+	public:
+
+		typedef Tag type;
+		typedef Tag value_type;
+		typedef Allocator allocator_type;
+		typedef optional<Tag> optional_type;
+		typedef optional<Tag const> const_optional_type;
+
+		// Tags have no data, so iterating the pool visits the tagged
+		// entities instead of components.
+		typedef entity_iterator iterator;
+		typedef entity_iterator const_iterator;
+		typedef optional_iterator_impl<Tag> optional_iterator;
+		typedef optional_iterator_impl<Tag const> const_optional_iterator;
+
+		// --------------------------------------------------------------------
+		//
+		template<typename... Args>
+		tag_pool(entity_pool& owner_pool, Args&&... args)
+			: tag_pool(
+				std::allocator_arg,
+				Allocator(),
+				owner_pool,
+				std::forward<Args>(args)...)
+		{}
+
+		template<typename... Args>
+		tag_pool(
+			std::allocator_arg_t,
+			Allocator const& alloc,
+			entity_pool& owner_pool,
+			Args&&...)
+			: words_(word_allocator_type(alloc))
+			, entity_count_(0)
+		{
+			// Tag existing entities, as other pools create default values.
+			std::for_each(
+				owner_pool.begin(),
+				owner_pool.end(),
+				[this](entity e)
+				{
+					handle_create_entity(e);
+					create(e);
+				}
+			);
+
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					[this](entity e)
+					{
+						handle_create_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_destroy_handler =
+				owner_pool.signals().on_entity_destroy.connect(
+					[this](entity e)
+					{
+						handle_destroy_entity(e);
+					}
+				)
+			;
+
+			slots_.entity_swap_handler =
+				owner_pool.signals().on_entity_swap.connect(
+					[this](entity a, entity b)
+					{
+						handle_swap_entity(a, b);
+					}
+				)
+			;
+		}
+
+		template<typename... Args>
+		void auto_create_components(entity_pool& owner_pool, Args...)
+		{
+			slots_.entity_create_handler =
+				owner_pool.signals().on_entity_create.connect(
+					std::function<void(entity)>(
+						[this](entity e)
+						{
+							handle_create_entity(e);
+							create(e);
+						}
+					)
+				)
+			;
+		}
+
+		// Arguments are accepted for compatibility with the other pools
+		// but a tag has no value to construct.
+		template<typename... Args>
+		Tag* create(entity e, Args&&...)
+		{
+			words_[word_of(e)] |= bit_of(e);
+			return std::addressof(tag_);
+		}
+
+		void destroy(entity e)
+		{
+			words_[word_of(e)] &= ~bit_of(e);
+		}
+
+		optional<Tag> get(entity e)
+		{
+			if(test(e))
+				return tag_;
+			return boost::none;
+		}
+
+		optional<const Tag> get(entity e) const
+		{
+			if(test(e))
+				return tag_;
+			return boost::none;
+		}
+
+		bool test(entity e) const
+		{
+			return (words_[word_of(e)] & bit_of(e)) != 0;
+		}
+
+		iterator begin() const
+		{
+			return iterator(words_.data(), words_.size(), 0);
+		}
+
+		iterator end() const
+		{
+			return iterator(words_.data(), words_.size(), words_.size());
+		}
+
+		optional_iterator optional_begin()
+		{
+			return optional_iterator(this, 0);
+		}
+
+		optional_iterator optional_end()
+		{
+			return optional_iterator(this, entity_count_);
+		}
+
+		const_optional_iterator optional_begin() const
+		{
+			return const_optional_iterator(this, 0);
+		}
+
+		const_optional_iterator optional_end() const
+		{
+			return const_optional_iterator(this, entity_count_);
+		}
+
+		// Number of tagged entities.
+		std::size_t size() const
+		{
+			std::size_t count = 0;
+			for(word_type w : words_)
+			{
+				count += support::popcount(w);
+			}
+
+			return count;
+		}
+
+		bool empty() const
+		{
+			return std::none_of(
+				words_.begin(),
+				words_.end(),
+				[](word_type w) { return w != 0; }
+			);
+		}
+
+		// --------------------------------------------------------------------
+		// Set operations against another tag pool on the same entity pool.
+		// Written as plain loops over whole words so the compiler can
+		// vectorise them.
+		template<typename OtherTag, typename OtherAllocator>
+		tag_pool& operator|=(tag_pool<OtherTag, OtherAllocator> const& other)
+		{
+			word_type* a = words_.data();
+			word_type const* b = other.words().data();
+			std::size_t const count = common_size(other);
+			for(std::size_t i = 0; i < count; ++i)
+				a[i] |= b[i];
+			return *this;
+		}
+
+		template<typename OtherTag, typename OtherAllocator>
+		tag_pool& operator&=(tag_pool<OtherTag, OtherAllocator> const& other)
+		{
+			word_type* a = words_.data();
+			word_type const* b = other.words().data();
+			std::size_t const count = common_size(other);
+			for(std::size_t i = 0; i < count; ++i)
+				a[i] &= b[i];
+			std::fill(words_.begin() + count, words_.end(), 0);
+			return *this;
+		}
+
+		template<typename OtherTag, typename OtherAllocator>
+		tag_pool& operator-=(tag_pool<OtherTag, OtherAllocator> const& other)
+		{
+			word_type* a = words_.data();
+			word_type const* b = other.words().data();
+			std::size_t const count = common_size(other);
+			for(std::size_t i = 0; i < count; ++i)
+				a[i] &= ~b[i];
+			return *this;
+		}
+
+		template<typename OtherTag, typename OtherAllocator>
+		tag_pool& operator^=(tag_pool<OtherTag, OtherAllocator> const& other)
+		{
+			word_type* a = words_.data();
+			word_type const* b = other.words().data();
+			std::size_t const count = common_size(other);
+			for(std::size_t i = 0; i < count; ++i)
+				a[i] ^= b[i];
+			return *this;
+		}
+
+		// Number of entities carrying both tags, without modifying either.
+		template<typename OtherTag, typename OtherAllocator>
+		std::size_t intersection_size(tag_pool<OtherTag, OtherAllocator> const& other) const
+		{
+			word_type const* a = words_.data();
+			word_type const* b = other.words().data();
+			std::size_t const count = common_size(other);
+			std::size_t result = 0;
+			for(std::size_t i = 0; i < count; ++i)
+				result += support::popcount(a[i] & b[i]);
+			return result;
+		}
+
+		template<typename OtherTag, typename OtherAllocator>
+		bool intersects(tag_pool<OtherTag, OtherAllocator> const& other) const
+		{
+			word_type const* a = words_.data();
+			word_type const* b = other.words().data();
+			std::size_t const count = common_size(other);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				if(a[i] & b[i])
+					return true;
+			}
+
+			return false;
+		}
+
+		// The raw bitset, one bit per entity index.
+		word_table_t const& words() const
+		{
+			return words_;
+		}
+
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("tag_pool::reserve");
+			words_.reserve(words_for(count));
+		}
+
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("tag_pool::shrink_to_fit");
+			words_.shrink_to_fit();
+		}
+
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("tag_pool::compact");
+			shrink_to_fit();
+		}
+
+		// Shrinks at most budget bytes worth of storage according to
+		// policy.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("tag_pool::shrink_step");
+			return policy.shrink(words_, budget);
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = size();
+			usage.slot_count = entity_count_;
+			usage.live_bytes = words_.size() * sizeof(word_type);
+			usage.reserved_bytes = words_.capacity() * sizeof(word_type);
+			usage.index_bytes = 0;
+			return usage;
+		}
+
+		allocator_type get_allocator() const
+		{
+			return allocator_type(words_.get_allocator());
+		}
+
+	private:
+
+		static std::size_t words_for(std::size_t entity_count)
+		{
+			return (entity_count + bits_per_word - 1) / bits_per_word;
+		}
+
+		static std::size_t word_of(entity e)
+		{
+			return e.index() / bits_per_word;
+		}
+
+		static word_type bit_of(entity e)
+		{
+			return word_type(1) << (e.index() % bits_per_word);
+		}
+
+		template<typename OtherTag, typename OtherAllocator>
+		std::size_t common_size(tag_pool<OtherTag, OtherAllocator> const& other) const
+		{
+			return std::min(words_.size(), other.words().size());
+		}
+
+		// No copying
+		tag_pool(tag_pool const&);
+		tag_pool operator=(tag_pool);
+
+		friend class creation_queue<tag_pool>;
+		friend class destruction_queue<tag_pool>;
+		friend struct serialization::access;
+		friend struct lifecycle_access;
+
+		struct slot_list
+		{
+			boost::signals2::scoped_connection entity_create_handler;
+			boost::signals2::scoped_connection entity_destroy_handler;
+			boost::signals2::scoped_connection entity_swap_handler;
+		};
+
+		// --------------------------------------------------------------------
+		// Serialization interface.
+		template<typename Writer>
+		void save(Writer& writer) const
+		{
+			writer.write_table(words_);
+			writer.write_value(std::uint64_t(entity_count_));
+		}
+
+		template<typename Reader>
+		void load(Reader& reader)
+		{
+			reader.read_table(words_);
+			std::uint64_t entity_count = 0;
+			reader.read_value(entity_count);
+			entity_count_ = static_cast<entity_index_t>(entity_count);
+
+			// Bits past the last entity would show up in iteration.
+			reader.check(
+				entity_count == reader.entity_count() &&
+				words_.size() == words_for(entity_count_) &&
+				(entity_count_ % bits_per_word == 0 ||
+					words_.back() >> (entity_count_ % bits_per_word) == 0)
+			);
+		}
+
+		// --------------------------------------------------------------------
+		// Queue interface.
+		template<typename Iter>
+		void create_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				create(current->first.lock().get());
+				++current;
+			}
+		}
+
+		template<typename Iter>
+		void destroy_range(Iter current, Iter last)
+		{
+			while(current != last)
+			{
+				destroy(current->lock().get());
+				++current;
+			}
+		}
+
+		// --------------------------------------------------------------------
+		// Slot Handlers.
+		void handle_create_entity(entity e)
+		{
+			entity_count_ = std::max(entity_count_, e.index() + 1);
+			if(words_.size() < words_for(entity_count_))
+				words_.resize(words_for(entity_count_), 0);
+		}
+
+		void handle_destroy_entity(entity e)
+		{
+			// The entity pool always destroys its last entity, so the
+			// word it leaves behind may be empty.
+			destroy(e);
+			entity_count_ = e.index();
+			words_.resize(words_for(entity_count_));
+		}
+
+		void handle_swap_entity(entity a, entity b)
+		{
+			bool const a_set = test(a);
+			bool const b_set = test(b);
+			if(a_set != b_set)
+			{
+				words_[word_of(a)] ^= bit_of(a);
+				words_[word_of(b)] ^= bit_of(b);
+			}
+		}
+
+		word_table_t words_;
+		entity_index_t entity_count_;
+		Tag tag_;
+		slot_list slots_;
+	};
+} } // namespace entity { namespace component
+
+#endif // ENTITY_COMPONENT_TAGPOOL_H_INCLUDED_
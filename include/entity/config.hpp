@@ -1,16 +1,25 @@
-#ifndef ENTITY_CONFIG_H
-#define ENTITY_CONFIG_H
-
-#include <boost/config.hpp>
-#include <boost/config/warning_disable.hpp>
-
-namespace entity {
-
-const int VersionMajor = 1;
-const int VersionMinor = 0;
-const int VersionPatch = 0;
-char const* const VersionString = "1.0.0";
-
-}
-
-#endif // ENTITY_CONFIG_H
+#ifndef ENTITY_CONFIG_H
+#define ENTITY_CONFIG_H
+
+#include <boost/config.hpp>
+#include <boost/config/warning_disable.hpp>
+
+// Profiling zones (entity/profile.hpp).  This is a build-wide setting: the
+// library's inline functions open zones, so every translation unit linked
+// into a program must see the same value or those functions get different
+// definitions.  Set it on the compiler command line, or with the CMake
+// option of the same name, never with a #define ahead of an include.
+#ifndef ENTITY_ENABLE_PROFILING
+#  define ENTITY_ENABLE_PROFILING 0
+#endif
+
+namespace entity {
+
+const int VersionMajor = 1;
+const int VersionMinor = 0;
+const int VersionPatch = 0;
+char const* const VersionString = "1.0.0";
+
+}
+
+#endif // ENTITY_CONFIG_H
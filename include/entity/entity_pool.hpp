@@ -15,20 +15,31 @@
 
 #include <boost/function.hpp>
 #include <boost/iterator/iterator_facade.hpp>
+#include <boost/range/iterator_range_core.hpp>
 #include <boost/core/no_exceptions_support.hpp>
-#include <boost/pool/pool.hpp>
+#include <boost/throw_exception.hpp>
 #include <boost/signals2.hpp>
 #include <boost/signals2/optional_last_value.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <new>
+#include <stdexcept>
 #include <type_traits>
 #include <vector>
 
 #include "entity/config.hpp" // IWYU pragma: keep
 #include "entity/entity.hpp"
 #include "entity/entity_index.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/shrink_policy.hpp"
+#include "entity/support/any_allocator.hpp"
+#include "entity/support/bit_ops.hpp"
+#include "entity/support/node_pool.hpp"
 
 // ----------------------------------------------------------------------------
 //
@@ -71,10 +82,81 @@ namespace entity
 			entity_index_t iterator_;
 		};
 
+		// Walks the set bits of the enabled words, skipping whole words
+		// of disabled entities at a time.
+		struct enabled_iterator_impl
+			  : boost::iterator_facade<
+			    enabled_iterator_impl
+			  , entity
+			  , boost::forward_traversal_tag
+			  , entity
+		  	>
+		{
+			enabled_iterator_impl()
+				: words_(nullptr)
+				, iterator_(0)
+				, size_(0)
+			{}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class entity_pool;
+
+			enabled_iterator_impl(std::uint64_t const* words, entity_index_t idx, std::size_t size)
+				: words_(words)
+				, iterator_(idx)
+				, size_(size)
+			{
+				skip_disabled();
+			}
+
+			void increment()
+			{
+				++iterator_;
+				skip_disabled();
+			}
+
+			bool equal(enabled_iterator_impl const& other) const
+			{
+				return iterator_ == other.iterator_;
+			}
+
+			entity dereference() const
+			{
+				return make_entity(iterator_);
+			}
+
+			void skip_disabled()
+			{
+				while(iterator_ < size_)
+				{
+					std::uint64_t const bits = words_[iterator_ / 64] >> (iterator_ % 64);
+					if(bits)
+					{
+						iterator_ += support::count_trailing_zeros(bits);
+						break;
+					}
+
+					iterator_ = (iterator_ / 64 + 1) * 64;
+				}
+
+				if(iterator_ > size_)
+					iterator_ = size_;
+			}
+
+			std::uint64_t const* words_;
+			entity_index_t iterator_;
+			std::size_t size_;
+		};
+
 	public:
 
 		typedef iterator_impl iterator;
 		typedef iterator_impl const_iterator;
+		typedef enabled_iterator_impl enabled_iterator;
+		typedef boost::iterator_range<enabled_iterator> enabled_range;
+		typedef support::any_allocator<entity_index_t> allocator_type;
 
 		struct signal_list
 		{
@@ -85,6 +167,18 @@ namespace entity
 
 		entity_pool()
 			: entity_pool_(16)
+			, disabled_count_(0)
+		{}
+
+		// Routes the index storage and bookkeeping through alloc.  Any
+		// standard allocator works, including arena, monotonic or
+		// polymorphic allocators.
+		template<typename Allocator>
+		entity_pool(std::allocator_arg_t, Allocator const& alloc)
+			: entity_pool_(16, allocator_type(std::allocator_arg, alloc))
+			, entities_(entity_pool_.get_allocator())
+			, enabled_(entity_pool_.get_allocator())
+			, disabled_count_(0)
 		{}
 
 		~entity_pool()
@@ -97,15 +191,18 @@ namespace entity
 
 		entity create()
 		{
+			ENTITY_PROFILE_ZONE("entity_pool::create");
 			entity_index_t* new_idx = new(entity_pool_.malloc()) entity_index_t(entities_.size());
 			entity ret_val = make_entity(*new_idx);
 			entities_.push_back(new_idx);
+			push_enabled();
 			signals().on_entity_create(ret_val);
 			return ret_val;
 		}	
 
 		unique_entity create_unique()
 		{
+			ENTITY_PROFILE_ZONE("entity_pool::create_unique");
 			entity_index_t* new_idx_ptr = nullptr;
 			void* new_index_mem = nullptr;
 			bool pop_on_catch = false;
@@ -116,6 +213,7 @@ namespace entity
 
 				entity ent_val = make_entity(*new_idx_ptr);
 				entities_.push_back(new_idx_ptr);
+				push_enabled();
 
 				// Ensure we leave the container in a good state if shared_ptr throws.
 				pop_on_catch = true;
@@ -131,7 +229,10 @@ namespace entity
 			BOOST_CATCH(...)
 			{
 				if(pop_on_catch)
+				{
 					entities_.pop_back();
+					pop_enabled();
+				}
 				if(new_idx_ptr)
 					new_idx_ptr->~entity_index_t();
 				if(new_index_mem)
@@ -156,11 +257,136 @@ namespace entity
 			return entities_.size();
 		}
 
+		// --------------------------------------------------------------------
+		// Disabled entities keep their index and components but are skipped
+		// by enabled(), for parking pooled objects without the destroy and
+		// swap cascade.  New entities start enabled.  Only ranges driven by
+		// enabled() are filtered; ranges over pools alone, such as
+		// combine_optional(pools...) or a pool's own iterators, still visit
+		// disabled entities' components.
+		void disable(entity e)
+		{
+			std::uint64_t& word = enabled_[e.index() / 64];
+			std::uint64_t const bit = std::uint64_t(1) << (e.index() % 64);
+			if(word & bit)
+			{
+				word &= ~bit;
+				++disabled_count_;
+			}
+		}
+
+		void enable(entity e)
+		{
+			std::uint64_t& word = enabled_[e.index() / 64];
+			std::uint64_t const bit = std::uint64_t(1) << (e.index() % 64);
+			if(!(word & bit))
+			{
+				word |= bit;
+				--disabled_count_;
+			}
+		}
+
+		bool is_enabled(entity e) const
+		{
+			return (enabled_[e.index() / 64] >> (e.index() % 64)) & 1;
+		}
+
+		std::size_t enabled_count() const
+		{
+			return entities_.size() - disabled_count_;
+		}
+
+		enabled_iterator enabled_begin() const
+		{
+			return enabled_iterator(enabled_.data(), 0, size());
+		}
+
+		enabled_iterator enabled_end() const
+		{
+			return enabled_iterator(enabled_.data(), static_cast<entity_index_t>(size()), size());
+		}
+
+		// Invalidated by creating or destroying entities.
+		enabled_range enabled() const
+		{
+			return enabled_range(enabled_begin(), enabled_end());
+		}
+
+		// The enabled bits, 64 entities to a word, for views that filter
+		// with them directly.  Invalidated as enabled() is.
+		std::uint64_t const* enabled_words() const
+		{
+			return enabled_.data();
+		}
+
 		bool empty() const
 		{
 			return entities_.empty();
 		}
 
+		// Also reserves the nodes handles are allocated from, so creating
+		// up to count entities doesn't allocate.
+		void reserve(std::size_t count)
+		{
+			ENTITY_PROFILE_ZONE("entity_pool::reserve");
+			entities_.reserve(count);
+			enabled_.reserve(words_for(count));
+			entity_pool_.reserve(count);
+		}
+
+		void shrink_to_fit()
+		{
+			ENTITY_PROFILE_ZONE("entity_pool::shrink_to_fit");
+			entities_.shrink_to_fit();
+			enabled_.shrink_to_fit();
+		}
+
+		// Also returns index storage left over from destroyed entities.
+		// Walks every free index so is O(peak entity count).
+		void compact()
+		{
+			ENTITY_PROFILE_ZONE("entity_pool::compact");
+			shrink_to_fit();
+			entity_pool_.release_free_blocks();
+		}
+
+		// Shrinks at most budget bytes worth of storage according to
+		// policy.  Returns the number of bytes spent.
+		std::size_t shrink_step(shrink_policy const& policy, std::size_t budget)
+		{
+			ENTITY_PROFILE_ZONE("entity_pool::shrink_step");
+			std::size_t spent = policy.shrink(entities_, budget);
+			std::size_t const index_cost =
+				entity_pool_.capacity() * entity_pool_.node_size();
+
+			if(index_cost <= budget - spent &&
+				policy.should_shrink(
+					entities_.size(),
+					entity_pool_.capacity(),
+					entity_pool_.node_size()))
+			{
+				entity_pool_.release_free_blocks();
+				spent += index_cost;
+			}
+
+			return spent;
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			usage.live_count = entities_.size();
+			usage.slot_count = entity_pool_.capacity();
+			usage.live_bytes = entities_.size() * entity_pool_.node_size();
+			usage.reserved_bytes = entity_pool_.capacity() * entity_pool_.node_size();
+			usage.index_bytes =
+				entities_.capacity() * sizeof(entity_index_t*) +
+				enabled_.capacity() * sizeof(std::uint64_t) +
+				entity_pool_.overhead_bytes()
+			;
+			return usage;
+		}
+
 		iterator begin() const
 		{
 			return iterator_impl(0);
@@ -176,11 +402,54 @@ namespace entity
 			return signals_;
 		}
 
+		allocator_type get_allocator() const
+		{
+			return entity_pool_.get_allocator();
+		}
+
 	private:
 
 		entity_pool(entity_pool const&);
 		entity_pool operator=(entity_pool);
 
+		friend struct serialization::access;
+
+		// --------------------------------------------------------------------
+		// Serialization interface.
+		template<typename Writer>
+		void save(Writer& writer) const
+		{
+			writer.write_value(static_cast<std::uint64_t>(entities_.size()));
+		}
+
+		template<typename Reader>
+		void load(Reader& reader)
+		{
+			std::uint64_t count = 0;
+			reader.read_value(count);
+			restore(static_cast<std::size_t>(count));
+		}
+
+		// Recreates count entities without signalling anyone; the
+		// component pools are restored separately.  Enabled state isn't
+		// saved, so every restored entity is enabled.
+		void restore(std::size_t count)
+		{
+			if(!entities_.empty())
+			{
+				BOOST_THROW_EXCEPTION(
+					std::logic_error("Can only restore into an empty entity_pool.")
+				);
+			}
+
+			entities_.reserve(count);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				entities_.push_back(new(entity_pool_.malloc()) entity_index_t(i));
+				push_enabled();
+			}
+		}
+
 		struct entity_deleter
 		{
 			entity_deleter(entity_pool& owner_pool)
@@ -200,11 +469,18 @@ namespace entity
 			using std::swap;
 			swap(entities_[a], entities_[b]);
 			swap(*entities_[a], *entities_[b]);
+			if(is_enabled(make_entity(a)) != is_enabled(make_entity(b)))
+			{
+				enabled_[a / 64] ^= std::uint64_t(1) << (a % 64);
+				enabled_[b / 64] ^= std::uint64_t(1) << (b % 64);
+			}
+
 			signals().on_entity_swap(make_entity(a), make_entity(b));
 		}
 
 		void destroy_impl(entity_index_t e)
 		{
+			ENTITY_PROFILE_ZONE("entity_pool::destroy");
 			// Avoid swapping if this is at the end.
 			if((e + 1) < entities_.size())
 			{
@@ -220,6 +496,7 @@ namespace entity
 				void* idx_mem = idx;
 				idx = nullptr;
 				entity_pool_.free(idx_mem);
+				pop_enabled();
 			}
 			BOOST_CATCH(...)
 			{
@@ -230,8 +507,42 @@ namespace entity
 			BOOST_CATCH_END
 		}
 
-		boost::pool<> entity_pool_;
-		std::vector<entity_index_t*> entities_;
+		static std::size_t words_for(std::size_t count)
+		{
+			return (count + 63) / 64;
+		}
+
+		// Called after the entity list grows or shrinks by one.
+		void push_enabled()
+		{
+			std::size_t const idx = entities_.size() - 1;
+			if(enabled_.size() < words_for(entities_.size()))
+				enabled_.push_back(0);
+			enabled_[idx / 64] |= std::uint64_t(1) << (idx % 64);
+		}
+
+		void pop_enabled()
+		{
+			std::size_t const idx = entities_.size();
+			std::uint64_t const bit = std::uint64_t(1) << (idx % 64);
+			if(!(enabled_[idx / 64] & bit))
+				--disabled_count_;
+			enabled_[idx / 64] &= ~bit;
+			enabled_.resize(words_for(entities_.size()));
+		}
+
+		typedef std::allocator_traits<
+			allocator_type
+		>::rebind_alloc<entity_index_t*> index_list_allocator_type;
+
+		typedef std::allocator_traits<
+			allocator_type
+		>::rebind_alloc<std::uint64_t> enabled_list_allocator_type;
+
+		support::node_pool<entity_index_t, allocator_type> entity_pool_;
+		std::vector<entity_index_t*, index_list_allocator_type> entities_;
+		std::vector<std::uint64_t, enabled_list_allocator_type> enabled_;
+		std::size_t disabled_count_;
 		signal_list signals_;
 	};
 }
@@ -0,0 +1,105 @@
+// ****************************************************************************
+// entity/memory_usage.hpp
+//
+// Describes how much memory an entity or component pool is using, and
+// how much of it is doing useful work.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_MEMORYUSAGE_H_INCLUDED_
+#define ENTITY_MEMORYUSAGE_H_INCLUDED_
+
+#include <cstddef>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+
+// ----------------------------------------------------------------------------
+//
+namespace entity
+{
+	/// \brief Snapshot of a pool's memory, as returned by memory_stats().
+	/// Usage from several pools can be summed to give a world total.
+	///
+	struct memory_usage
+	{
+		memory_usage()
+			: live_count(0)
+			, slot_count(0)
+			, live_bytes(0)
+			, reserved_bytes(0)
+			, index_bytes(0)
+		{}
+
+		// Number of live components, or entities.
+		std::size_t live_count;
+
+		// Number of component slots that exist, live or not.
+		std::size_t slot_count;
+
+		// Bytes holding live components.
+		std::size_t live_bytes;
+
+		// Bytes allocated for component storage, including free
+		// slots and unused capacity.
+		std::size_t reserved_bytes;
+
+		// Bytes allocated for bookkeeping; index tables, free
+		// flags, etc.
+		std::size_t index_bytes;
+
+		std::size_t total_bytes() const
+		{
+			return reserved_bytes + index_bytes;
+		}
+
+		// Fraction of the slots holding live components.
+		double occupancy() const
+		{
+			return slot_count ? double(live_count) / double(slot_count) : 1.0;
+		}
+
+		// Fraction of the component storage not holding live components.
+		double fragmentation() const
+		{
+			return reserved_bytes ? 1.0 - (double(live_bytes) / double(reserved_bytes)) : 0.0;
+		}
+
+		memory_usage& operator+=(memory_usage const& rhs)
+		{
+			live_count += rhs.live_count;
+			slot_count += rhs.slot_count;
+			live_bytes += rhs.live_bytes;
+			reserved_bytes += rhs.reserved_bytes;
+			index_bytes += rhs.index_bytes;
+			return *this;
+		}
+	};
+
+	inline memory_usage operator+(memory_usage lhs, memory_usage const& rhs)
+	{
+		lhs += rhs;
+		return lhs;
+	}
+
+	// ------------------------------------------------------------------------
+	// Sums the memory_stats() of any number of pools, for example the
+	// entity_pool and every component pool that make up a world.
+	inline memory_usage total_memory_usage()
+	{
+		return memory_usage();
+	}
+
+	template<typename Pool, typename... Pools>
+	memory_usage total_memory_usage(Pool const& pool, Pools const&... pools)
+	{
+		return pool.memory_stats() + total_memory_usage(pools...);
+	}
+}
+
+#endif // ENTITY_MEMORYUSAGE_H_INCLUDED_
@@ -0,0 +1,311 @@
+// ****************************************************************************
+// entity/profile.hpp
+//
+// Lightweight scoped profiling zones recorded into per-thread ring
+// buffers and exported in the Chrome trace_event JSON format, which
+// chrome://tracing and Perfetto open directly.
+//
+// Zones are compiled out entirely unless ENTITY_ENABLE_PROFILING is
+// defined to a non zero value, so the library's own zones cost nothing
+// in normal builds.  The setting must be the same across the whole
+// program; see entity/config.hpp.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_PROFILE_H_INCLUDED_
+#define ENTITY_PROFILE_H_INCLUDED_
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/throw_exception.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+
+// Opens a zone that lasts until the end of the enclosing scope.  name
+// must be a string literal or otherwise outlive the profiler.
+#if ENTITY_ENABLE_PROFILING
+#  define ENTITY_PROFILE_ZONE(name) \
+	::entity::profile::zone BOOST_PP_CAT(entity_profile_zone_, __LINE__)(name)
+#else
+#  define ENTITY_PROFILE_ZONE(name) ((void)0)
+#endif
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace profile {
+
+// ----------------------------------------------------------------------------
+//
+struct event
+{
+	char const* name;
+	std::uint64_t begin;
+	std::uint64_t end;
+};
+
+// Nanoseconds on the steady clock.
+inline std::uint64_t now()
+{
+	return static_cast<std::uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()
+		).count()
+	);
+}
+
+// ----------------------------------------------------------------------------
+// Fixed size ring of the most recent events on one thread.  Only the
+// owning thread records; readers should run while the thread is idle,
+// between frames for example.
+class thread_buffer
+{
+public:
+
+	thread_buffer(std::uint32_t thread_id, std::size_t capacity)
+		: events_(capacity ? capacity : 1)
+		, written_(0)
+		, thread_id_(thread_id)
+	{}
+
+	void record(event const& e)
+	{
+		std::uint64_t const w = written_.load(std::memory_order_relaxed);
+		events_[w % events_.size()] = e;
+		written_.store(w + 1, std::memory_order_release);
+	}
+
+	void clear()
+	{
+		written_.store(0, std::memory_order_release);
+	}
+
+	// Events currently held, at most the capacity.
+	std::size_t size() const
+	{
+		std::uint64_t const w = written_.load(std::memory_order_acquire);
+		return static_cast<std::size_t>(
+			w < events_.size() ? w : events_.size()
+		);
+	}
+
+	// Events lost to wrap around since the last clear.
+	std::uint64_t dropped() const
+	{
+		std::uint64_t const w = written_.load(std::memory_order_acquire);
+		return w > events_.size() ? w - events_.size() : 0;
+	}
+
+	std::uint32_t thread_id() const
+	{
+		return thread_id_;
+	}
+
+	// Visits the held events from oldest to newest.
+	template<typename F>
+	void for_each(F f) const
+	{
+		std::uint64_t const w = written_.load(std::memory_order_acquire);
+		std::uint64_t const first = w - size();
+		for(std::uint64_t i = first; i < w; ++i)
+		{
+			f(events_[i % events_.size()]);
+		}
+	}
+
+private:
+
+	// No copying.
+	thread_buffer(thread_buffer const&);
+	thread_buffer operator=(thread_buffer);
+
+	std::vector<event> events_;
+	std::atomic<std::uint64_t> written_;
+	std::uint32_t thread_id_;
+};
+
+// ----------------------------------------------------------------------------
+// Owns the buffers of every thread that has recorded a zone.  Buffers
+// outlive their threads so a trace can be exported after workers exit.
+class profiler
+{
+public:
+
+	static std::size_t const default_capacity = 1 << 16;
+
+	static profiler& instance()
+	{
+		static profiler p;
+		return p;
+	}
+
+	// The calling thread's buffer, created on first use.
+	static thread_buffer& local()
+	{
+		static thread_local std::shared_ptr<thread_buffer> buffer =
+			instance().register_thread();
+		return *buffer;
+	}
+
+	// Capacity, in events, of buffers created from now on.
+	void set_capacity(std::size_t capacity)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		capacity_ = capacity;
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for(auto&& b : buffers_)
+		{
+			b->clear();
+		}
+	}
+
+	std::size_t size() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::size_t count = 0;
+		for(auto&& b : buffers_)
+		{
+			count += b->size();
+		}
+
+		return count;
+	}
+
+	// Writes every held event as a complete ("X") trace event.
+	// Timestamps are in microseconds relative to the profiler's creation.
+	void write_chrome_trace(std::ostream& out) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::ios::fmtflags const flags = out.flags();
+		out.setf(std::ios::fixed);
+		std::streamsize const precision = out.precision(3);
+
+		out << "{\"traceEvents\":[";
+		bool first = true;
+		for(auto&& b : buffers_)
+		{
+			b->for_each(
+				[&](event const& e)
+				{
+					out << (first ? "\n" : ",\n");
+					first = false;
+					out << "{\"name\":\"";
+					write_escaped(out, e.name);
+					out << "\",\"cat\":\"entity\",\"ph\":\"X\",\"pid\":1"
+						<< ",\"tid\":" << b->thread_id()
+						<< ",\"ts\":" << to_micros(e.begin - epoch_)
+						<< ",\"dur\":" << to_micros(e.end - e.begin)
+						<< "}";
+				}
+			);
+		}
+
+		out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+		out.precision(precision);
+		out.flags(flags);
+	}
+
+	void save_chrome_trace(char const* path) const
+	{
+		std::ofstream out(path, std::ios::trunc);
+		if(!out)
+			BOOST_THROW_EXCEPTION(std::runtime_error("Failed to open trace for writing."));
+
+		write_chrome_trace(out);
+	}
+
+private:
+
+	profiler()
+		: epoch_(now())
+		, capacity_(default_capacity)
+	{}
+
+	// No copying.
+	profiler(profiler const&);
+	profiler operator=(profiler);
+
+	std::shared_ptr<thread_buffer> register_thread()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		buffers_.push_back(
+			std::make_shared<thread_buffer>(
+				static_cast<std::uint32_t>(buffers_.size() + 1),
+				capacity_
+			)
+		);
+
+		return buffers_.back();
+	}
+
+	static double to_micros(std::uint64_t ns)
+	{
+		return double(ns) / 1000.0;
+	}
+
+	static void write_escaped(std::ostream& out, char const* s)
+	{
+		for(; *s; ++s)
+		{
+			if(*s == '"' || *s == '\\')
+				out << '\\';
+			out << *s;
+		}
+	}
+
+	std::uint64_t epoch_;
+	std::size_t capacity_;
+	std::vector<std::shared_ptr<thread_buffer>> buffers_;
+	mutable std::mutex mutex_;
+};
+
+// ----------------------------------------------------------------------------
+// Records the time between construction and destruction.
+class zone
+{
+public:
+
+	explicit zone(char const* name)
+		: buffer_(profiler::local())
+		, name_(name)
+		, begin_(now())
+	{}
+
+	~zone()
+	{
+		event const e = { name_, begin_, now() };
+		buffer_.record(e);
+	}
+
+private:
+
+	// No copying.
+	zone(zone const&);
+	zone operator=(zone);
+
+	thread_buffer& buffer_;
+	char const* name_;
+	std::uint64_t begin_;
+};
+
+} } // namespace entity { namespace profile {
+
+#endif // ENTITY_PROFILE_H_INCLUDED_
@@ -0,0 +1,133 @@
+// ****************************************************************************
+// entity/range/fuse.hpp
+//
+// Runs several systems in one pass over the entities.
+//
+// Each system is described by a stage: a functor plus the pools it reads
+// and writes.  fuse(stages...) walks the entities once and runs every
+// stage on each entity in turn, so a pipeline like jerk, accelerate, move
+// brings each component in from memory once per frame instead of once per
+// system that uses it, and lookups the stages share stay in cache.
+//
+// Stages are called with what combine() or make_optional_range() would
+// yield for the same pools: a tuple of optionals, or the bare optional
+// for a single pool.  Fusing is only equivalent to running the systems
+// one after another when each stage touches just the entity it was
+// called for.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_RANGE_FUSE_H_INCLUDED_
+#define ENTITY_RANGE_FUSE_H_INCLUDED_
+
+#include "entity/config.hpp"  // IWYU pragma: keep
+
+#include <cstddef>
+#include <initializer_list>
+#include <tuple>
+#include <utility>
+
+#include "entity/component/detail/get_helper.hpp"
+#include "entity/entity.hpp"
+#include "entity/profile.hpp"
+#include "entity/support/index_sequence.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace range {
+
+// ----------------------------------------------------------------------------
+//
+template<typename F, typename... ComponentPools>
+class pipeline_stage
+{
+public:
+
+	static_assert(sizeof...(ComponentPools) > 0, "A stage needs at least one pool.");
+
+	pipeline_stage(F f, ComponentPools&... pools)
+		: f_(std::move(f))
+		, getters_(component::detail::make_get_helper(pools)...)
+	{}
+
+	void operator()(entity e)
+	{
+		call(e, support::make_index_sequence<sizeof...(ComponentPools)>());
+	}
+
+private:
+
+	template<std::size_t Index>
+	void call(entity e, support::index_sequence<Index>)
+	{
+		f_(std::get<Index>(getters_).get(e));
+	}
+
+	template<std::size_t... Indices>
+	void call(entity e, support::index_sequence<Indices...>)
+	{
+		f_(std::make_tuple(std::get<Indices>(getters_).get(e)...));
+	}
+
+	F f_;
+	std::tuple<component::detail::get_helper<ComponentPools>...> getters_;
+};
+
+template<typename F, typename... ComponentPools>
+pipeline_stage<F, ComponentPools...> stage(F f, ComponentPools&... pools)
+{
+	return pipeline_stage<F, ComponentPools...>(std::move(f), pools...);
+}
+
+// ----------------------------------------------------------------------------
+//
+template<typename... Stages>
+class fused
+{
+public:
+
+	explicit fused(Stages... stages)
+		: stages_(std::move(stages)...)
+	{}
+
+	void operator()(entity e)
+	{
+		run_stages(e, support::make_index_sequence<sizeof...(Stages)>());
+	}
+
+	template<typename EntityRange>
+	void for_each(EntityRange&& entities)
+	{
+		ENTITY_PROFILE_ZONE("fused::for_each");
+		for(entity e : entities)
+			(*this)(e);
+	}
+
+private:
+
+	template<std::size_t... Indices>
+	void run_stages(entity e, support::index_sequence<Indices...>)
+	{
+		(void)std::initializer_list<int>{
+			(std::get<Indices>(stages_)(e), 0)...
+		};
+	}
+
+	std::tuple<Stages...> stages_;
+};
+
+template<typename... Stages>
+fused<Stages...> fuse(Stages... stages)
+{
+	return fused<Stages...>(std::move(stages)...);
+}
+
+} } // namespace entity { namespace range {
+
+#endif // ENTITY_RANGE_FUSE_H_INCLUDED_
@@ -0,0 +1,564 @@
+// ****************************************************************************
+// entity/registry.hpp
+//
+// Runtime access to component pools for tools and scripting.
+//
+// A component_registry gives each registered pool a dense numeric id and
+// a name, and reaches its components through a per type table of
+// functions, so code that only knows an id can create, copy, move,
+// destroy, serialize and query components.  Queries take a mask of ids
+// and visit the entities holding all of them.
+//
+// The pools are not owned and stay fully typed; pool<Pool>() and view()
+// hand back the pools themselves, so typed code keeps the specialized
+// iterators.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_REGISTRY_H_INCLUDED_
+#define ENTITY_REGISTRY_H_INCLUDED_
+
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/entity.hpp"
+#include "entity/entity_index.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/support/bit_ops.hpp"
+#include "entity/type_traits/component_pool.hpp"
+#include "entity/world.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity
+{
+	typedef std::uint32_t component_id;
+	static component_id const invalid_component_id = ~component_id(0);
+	static std::size_t const max_component_types = 64;
+	typedef std::bitset<max_component_types> component_mask;
+
+	struct component_info
+	{
+		std::string name;
+		std::size_t size;
+		std::size_t alignment;
+
+		// Trivially copyable components can be saved and loaded.
+		bool serializable;
+	};
+
+	namespace detail
+	{
+		// --------------------------------------------------------------------
+		// A process wide number per type, to find a pool's id without a
+		// search.
+		inline std::size_t next_registry_type_index()
+		{
+			static std::atomic<std::size_t> next(0);
+			return next++;
+		}
+
+		template<typename T>
+		std::size_t registry_type_index()
+		{
+			static std::size_t const index = next_registry_type_index();
+			return index;
+		}
+
+		// --------------------------------------------------------------------
+		//
+		struct erased_pool_ops
+		{
+			void* (*get)(void* pool, entity e);
+			void* (*create)(void* pool, entity e);
+			void* (*create_copy)(void* pool, entity e, void const* value);
+			void* (*create_move)(void* pool, entity e, void* value);
+			void (*destroy)(void* pool, entity e);
+			void (*save)(void* pool, entity e, std::vector<std::uint8_t>& out);
+			void (*load)(void* pool, entity e, std::uint8_t const* data);
+			void (*clear_missing)(void* pool, std::uint64_t* words);
+			memory_usage (*memory_stats)(void const* pool);
+		};
+
+		template<typename Pool>
+		struct erased_pool
+		{
+			typedef typename Pool::type type;
+			typedef type_traits::is_saturated_pool<Pool> saturated;
+
+			static void* get(void* pool, entity e)
+			{
+				auto c = static_cast<Pool*>(pool)->get(e);
+				return c ? &*c : nullptr;
+			}
+
+			// Saturated pools always hold a component, so giving an entity
+			// a value assigns it.  Other pools assign if the component
+			// exists and create it otherwise.
+			template<typename Value>
+			static void* put(void* pool, entity e, Value&& value)
+			{
+				Pool& p = *static_cast<Pool*>(pool);
+				auto c = p.get(e);
+				if(c)
+				{
+					*c = std::forward<Value>(value);
+					return &*c;
+				}
+
+				return p.create(e, std::forward<Value>(value));
+			}
+
+			static void* create(void* pool, entity e)
+			{
+				if(void* c = get(pool, e))
+					return c;
+
+				return static_cast<Pool*>(pool)->create(e);
+			}
+
+			static void* create_copy(void* pool, entity e, void const* value)
+			{
+				return put(pool, e, *static_cast<type const*>(value));
+			}
+
+			static void* create_move(void* pool, entity e, void* value)
+			{
+				return put(pool, e, std::move(*static_cast<type*>(value)));
+			}
+
+			static void destroy(void* pool, entity e)
+			{
+				if(!saturated::value && get(pool, e))
+					static_cast<Pool*>(pool)->destroy(e);
+			}
+
+			static void save(void* pool, entity e, std::vector<std::uint8_t>& out)
+			{
+				std::uint8_t const* c = static_cast<std::uint8_t const*>(get(pool, e));
+				out.insert(out.end(), c, c + sizeof(type));
+			}
+
+			static void load(void* pool, entity e, std::uint8_t const* data)
+			{
+				type value;
+				std::memcpy(&value, data, sizeof(type));
+				put(pool, e, value);
+			}
+
+			typedef void (*save_type)(void*, entity, std::vector<std::uint8_t>&);
+			typedef void (*load_type)(void*, entity, std::uint8_t const*);
+
+			static save_type save_function(std::true_type)
+			{
+				return &save;
+			}
+
+			static save_type save_function(std::false_type)
+			{
+				return nullptr;
+			}
+
+			static load_type load_function(std::true_type)
+			{
+				return &load;
+			}
+
+			static load_type load_function(std::false_type)
+			{
+				return nullptr;
+			}
+
+			static void clear_missing(void* pool, std::uint64_t* words)
+			{
+				clear_missing(*static_cast<Pool*>(pool), words, saturated());
+			}
+
+			static void clear_missing(Pool&, std::uint64_t*, std::true_type)
+			{}
+
+			static void clear_missing(Pool& pool, std::uint64_t* words, std::false_type)
+			{
+				std::size_t idx = 0;
+				for(auto i = pool.optional_begin(), e = pool.optional_end(); i != e; ++i, ++idx)
+				{
+					if(!*i)
+						words[idx / 64] &= ~(std::uint64_t(1) << (idx % 64));
+				}
+			}
+
+			static memory_usage memory_stats(void const* pool)
+			{
+				return static_cast<Pool const*>(pool)->memory_stats();
+			}
+
+			static erased_pool_ops const* ops()
+			{
+				static erased_pool_ops const table = {
+					&get,
+					&create,
+					&create_copy,
+					&create_move,
+					&destroy,
+					save_function(std::is_trivially_copyable<type>()),
+					load_function(std::is_trivially_copyable<type>()),
+					&clear_missing,
+					&memory_stats
+				};
+
+				return &table;
+			}
+		};
+	}
+
+	// ------------------------------------------------------------------------
+	//
+	class component_registry
+	{
+	public:
+
+		explicit component_registry(entity_pool& entities)
+			: entities_(entities)
+		{}
+
+		// Registers pool under name and returns its id.  Ids are handed out
+		// in order from zero.
+		template<typename Pool>
+		component_id add_pool(Pool& pool, std::string name)
+		{
+			static_assert(
+				std::is_default_constructible<typename Pool::type>::value,
+				"Registered components must be default constructible."
+			);
+
+			if(entries_.size() == max_component_types)
+			{
+				BOOST_THROW_EXCEPTION(
+					std::length_error("Too many component types registered.")
+				);
+			}
+
+			if(id_of<Pool>() != invalid_component_id)
+			{
+				BOOST_THROW_EXCEPTION(
+					std::invalid_argument("Pool type is already registered.")
+				);
+			}
+
+			if(names_.count(name))
+			{
+				BOOST_THROW_EXCEPTION(
+					std::invalid_argument("Component name is already registered.")
+				);
+			}
+
+			component_id const id = static_cast<component_id>(entries_.size());
+			std::size_t const type_index = detail::registry_type_index<Pool>();
+			if(type_ids_.size() <= type_index)
+				type_ids_.resize(type_index + 1, invalid_component_id);
+
+			type_ids_[type_index] = id;
+			names_[name] = id;
+
+			entry e;
+			e.pool = &pool;
+			e.ops = detail::erased_pool<Pool>::ops();
+			e.info.name = std::move(name);
+			e.info.size = sizeof(typename Pool::type);
+			e.info.alignment = alignof(typename Pool::type);
+			e.info.serializable = e.ops->save != nullptr;
+			entries_.push_back(std::move(e));
+			return id;
+		}
+
+		template<typename Pool>
+		component_id id_of() const
+		{
+			std::size_t const type_index = detail::registry_type_index<Pool>();
+			return type_index < type_ids_.size()
+				? type_ids_[type_index]
+				: invalid_component_id
+			;
+		}
+
+		component_id find(std::string const& name) const
+		{
+			auto i = names_.find(name);
+			return i != names_.end() ? i->second : invalid_component_id;
+		}
+
+		std::size_t size() const
+		{
+			return entries_.size();
+		}
+
+		component_info const& info(component_id id) const
+		{
+			return checked_entry(id).info;
+		}
+
+		// ----------------------------------------------------------------
+		// Typed access.
+		template<typename Pool>
+		Pool& pool()
+		{
+			component_id const id = id_of<Pool>();
+			if(id == invalid_component_id)
+			{
+				BOOST_THROW_EXCEPTION(
+					std::out_of_range("Pool type is not registered.")
+				);
+			}
+
+			return *static_cast<Pool*>(entries_[id].pool);
+		}
+
+		template<typename... Pools>
+		::entity::view<Pools...> view()
+		{
+			return ::entity::view<Pools...>(
+				entities_.size(),
+				entities_.enabled_count() == entities_.size()
+					? nullptr
+					: entities_.enabled_words(),
+				pool<typename std::remove_const<Pools>::type>()...
+			);
+		}
+
+		// ----------------------------------------------------------------
+		// Access by id.  Component pointers point to the component's type
+		// as given by info(id).
+		bool has(component_id id, entity e) const
+		{
+			return get(id, e) != nullptr;
+		}
+
+		void* get(component_id id, entity e) const
+		{
+			entry const& c = checked_entry(id);
+			check_entity(e);
+			return c.ops->get(c.pool, e);
+		}
+
+		// Default constructs the component if e doesn't have one and
+		// returns it.
+		void* create(component_id id, entity e)
+		{
+			entry const& c = checked_entry(id);
+			check_entity(e);
+			return c.ops->create(c.pool, e);
+		}
+
+		// Copies or moves value into e's component, creating it if needed.
+		void* create_copy(component_id id, entity e, void const* value)
+		{
+			entry const& c = checked_entry(id);
+			check_entity(e);
+			return c.ops->create_copy(c.pool, e, value);
+		}
+
+		void* create_move(component_id id, entity e, void* value)
+		{
+			entry const& c = checked_entry(id);
+			check_entity(e);
+			return c.ops->create_move(c.pool, e, value);
+		}
+
+		// Does nothing if e has no component, or the pool is saturated.
+		void destroy(component_id id, entity e)
+		{
+			entry const& c = checked_entry(id);
+			check_entity(e);
+			c.ops->destroy(c.pool, e);
+		}
+
+		// Copies the component from one entity to another; returns false
+		// if from has none.
+		bool copy(component_id id, entity from, entity to)
+		{
+			void const* value = get(id, from);
+			if(!value)
+				return false;
+
+			if(from != to)
+				create_copy(id, to, value);
+			return true;
+		}
+
+		// Appends the raw bytes of e's component to out.  Returns false if
+		// e has none.
+		bool save(component_id id, entity e, std::vector<std::uint8_t>& out) const
+		{
+			entry const& c = checked_entry(id);
+			check_entity(e);
+			check_serializable(c);
+			if(!c.ops->get(c.pool, e))
+				return false;
+
+			c.ops->save(c.pool, e, out);
+			return true;
+		}
+
+		// Reads info(id).size bytes written by save into e's component and
+		// advances first past them.
+		void load(component_id id, entity e, std::uint8_t const*& first, std::uint8_t const* last)
+		{
+			entry const& c = checked_entry(id);
+			check_entity(e);
+			check_serializable(c);
+			if(std::size_t(last - first) < c.info.size)
+			{
+				BOOST_THROW_EXCEPTION(
+					std::runtime_error("Component data is truncated.")
+				);
+			}
+
+			c.ops->load(c.pool, e, first);
+			first += c.info.size;
+		}
+
+		component_mask mask_of(entity e) const
+		{
+			component_mask mask;
+			for(std::size_t id = 0; id < entries_.size(); ++id)
+			{
+				if(has(static_cast<component_id>(id), e))
+					mask.set(id);
+			}
+
+			return mask;
+		}
+
+		template<typename... Pools>
+		component_mask mask() const
+		{
+			component_mask result;
+			component_id const ids[] = { id_of<Pools>()... };
+			for(component_id id : ids)
+				result.set(checked_id(id));
+			return result;
+		}
+
+		// Calls f(entity) for every entity holding all of the components
+		// in mask, in index order.  f must not create or destroy entities.
+		template<typename F>
+		void for_each(component_mask const& mask, F f) const
+		{
+			ENTITY_PROFILE_ZONE("component_registry::for_each");
+			std::size_t const count = entities_.size();
+			std::size_t const word_count = (count + 63) / 64;
+			std::vector<std::uint64_t> words(word_count, ~std::uint64_t(0));
+			if(count % 64)
+				words.back() = (std::uint64_t(1) << (count % 64)) - 1;
+
+			for(std::size_t id = 0; id < max_component_types; ++id)
+			{
+				if(mask.test(id))
+				{
+					entry const& c = checked_entry(static_cast<component_id>(id));
+					c.ops->clear_missing(c.pool, words.data());
+				}
+			}
+
+			for(std::size_t w = 0; w < word_count; ++w)
+			{
+				for(std::uint64_t bits = words[w]; bits; bits &= bits - 1)
+				{
+					f(make_entity(static_cast<entity_index_t>(
+						w * 64 + support::count_trailing_zeros(bits)
+					)));
+				}
+			}
+		}
+
+		std::size_t count(component_mask const& mask) const
+		{
+			std::size_t n = 0;
+			for_each(mask, [&n](entity) { ++n; });
+			return n;
+		}
+
+		memory_usage memory_stats(component_id id) const
+		{
+			entry const& c = checked_entry(id);
+			return c.ops->memory_stats(c.pool);
+		}
+
+	private:
+
+		// No copying
+		component_registry(component_registry const&);
+		component_registry operator=(component_registry const&);
+
+		struct entry
+		{
+			void* pool;
+			detail::erased_pool_ops const* ops;
+			component_info info;
+		};
+
+		component_id checked_id(component_id id) const
+		{
+			if(id >= entries_.size())
+			{
+				BOOST_THROW_EXCEPTION(
+					std::out_of_range("Component id is not registered.")
+				);
+			}
+
+			return id;
+		}
+
+		entry const& checked_entry(component_id id) const
+		{
+			return entries_[checked_id(id)];
+		}
+
+		void check_entity(entity e) const
+		{
+			if(e.index() >= entities_.size())
+			{
+				BOOST_THROW_EXCEPTION(
+					std::out_of_range("Entity is not in the pool.")
+				);
+			}
+		}
+
+		static void check_serializable(entry const& c)
+		{
+			if(!c.info.serializable)
+			{
+				BOOST_THROW_EXCEPTION(
+					std::runtime_error("Component type can't be serialized.")
+				);
+			}
+		}
+
+		entity_pool& entities_;
+		std::vector<entry> entries_;
+		std::vector<component_id> type_ids_;
+		std::unordered_map<std::string, component_id> names_;
+	};
+}
+
+#endif // ENTITY_REGISTRY_H_INCLUDED_
@@ -0,0 +1,41 @@
+// ****************************************************************************
+// entity/serialization/access.hpp
+//
+// Lets the serialization code reach the private save/load hooks of the
+// pools, in the style of boost::serialization::access.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SERIALIZATION_ACCESS_H_INCLUDED_
+#define ENTITY_SERIALIZATION_ACCESS_H_INCLUDED_
+
+#include "entity/config.hpp" // IWYU pragma: keep
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace serialization {
+
+struct access
+{
+	template<typename Pool, typename Writer>
+	static void save(Pool const& pool, Writer& writer)
+	{
+		pool.save(writer);
+	}
+
+	template<typename Pool, typename Reader>
+	static void load(Pool& pool, Reader& reader)
+	{
+		pool.load(reader);
+	}
+};
+
+} } // namespace entity { namespace serialization {
+
+#endif // ENTITY_SERIALIZATION_ACCESS_H_INCLUDED_
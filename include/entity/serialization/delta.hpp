@@ -0,0 +1,373 @@
+// ****************************************************************************
+// entity/serialization/delta.hpp
+//
+// Delta encoding of component pools for replication.
+//
+// A pool is compared against a baseline copy of its previous state and
+// only the entities that changed are written.  Components are treated as
+// a sequence of 32 bit words; each changed entity writes a bitmask of the
+// words that differ followed by the zigzag/varint encoded difference of
+// each such word, so small changes to integers and to floats of the same
+// sign encode to a byte or two.
+//
+// The decoder applies a delta in place to any pool holding the baseline
+// state, so sender and receiver only need to agree on the baseline.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SERIALIZATION_DELTA_H_INCLUDED_
+#define ENTITY_SERIALIZATION_DELTA_H_INCLUDED_
+
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/entity.hpp"
+#include "entity/entity_index.hpp"
+#include "entity/profile.hpp"
+#include "entity/type_traits/component_pool.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace serialization {
+
+namespace detail
+{
+	// ------------------------------------------------------------------------
+	//
+	enum delta_record_kind
+	{
+		delta_modified = 0,
+		delta_added    = 1,
+		delta_removed  = 2,
+		delta_end      = 3,
+	};
+
+	inline void write_varint(std::vector<std::uint8_t>& out, std::uint64_t v)
+	{
+		while(v >= 0x80)
+		{
+			out.push_back(static_cast<std::uint8_t>(v | 0x80));
+			v >>= 7;
+		}
+
+		out.push_back(static_cast<std::uint8_t>(v));
+	}
+
+	inline std::uint64_t read_varint(std::uint8_t const*& p, std::uint8_t const* last)
+	{
+		std::uint64_t v = 0;
+		for(int shift = 0; shift < 64; shift += 7)
+		{
+			if(p == last)
+				break;
+
+			std::uint8_t const b = *p++;
+			v |= std::uint64_t(b & 0x7f) << shift;
+			if(!(b & 0x80))
+				return v;
+		}
+
+		BOOST_THROW_EXCEPTION(std::runtime_error("Malformed delta stream."));
+	}
+
+	inline std::uint32_t zigzag(std::int32_t v)
+	{
+		return (static_cast<std::uint32_t>(v) << 1) ^ static_cast<std::uint32_t>(v >> 31);
+	}
+
+	inline std::int32_t unzigzag(std::uint32_t v)
+	{
+		return static_cast<std::int32_t>(v >> 1) ^ -static_cast<std::int32_t>(v & 1);
+	}
+
+	// ------------------------------------------------------------------------
+	// Views a component as a run of 32 bit words, the last one zero
+	// padded if the component size isn't a multiple of four.
+	template<typename T>
+	struct component_words
+	{
+		static_assert(
+			std::is_trivially_copyable<T>::value,
+			"Delta encoding requires trivially copyable components."
+		);
+
+		static std::size_t const count = (sizeof(T) + 3) / 4;
+
+		static_assert(
+			count <= 64,
+			"Delta encoding supports components of up to 256 bytes."
+		);
+
+		static void load(T const& value, std::uint32_t* words)
+		{
+			words[count - 1] = 0;
+			std::memcpy(words, &value, sizeof(T));
+		}
+
+		static void store(std::uint32_t const* words, T& value)
+		{
+			std::memcpy(&value, words, sizeof(T));
+		}
+	};
+}
+
+// ----------------------------------------------------------------------------
+// The last state a receiver is known to have, one entry per entity.
+template<typename T>
+class delta_baseline
+{
+public:
+
+	typedef detail::component_words<T> words_type;
+
+	delta_baseline()
+	{}
+
+	template<typename ComponentPool>
+	explicit delta_baseline(ComponentPool& pool)
+	{
+		capture(pool);
+	}
+
+	template<typename ComponentPool>
+	void capture(ComponentPool& pool)
+	{
+		ENTITY_PROFILE_ZONE("delta_baseline::capture");
+		present_.clear();
+		words_.clear();
+
+		std::uint32_t w[words_type::count];
+		for(auto i = pool.optional_begin(), e = pool.optional_end(); i != e; ++i)
+		{
+			auto c = *i;
+			present_.push_back(c ? 1 : 0);
+			if(c)
+				words_type::load(*c, w);
+			else
+				std::fill(w, w + words_type::count, 0);
+
+			words_.insert(words_.end(), w, w + words_type::count);
+		}
+	}
+
+	std::size_t size() const
+	{
+		return present_.size();
+	}
+
+	bool has(entity_index_t idx) const
+	{
+		return idx < present_.size() && present_[idx];
+	}
+
+	std::uint32_t const* words(entity_index_t idx) const
+	{
+		return &words_[idx * words_type::count];
+	}
+
+private:
+
+	std::vector<char> present_;
+	std::vector<std::uint32_t> words_;
+};
+
+namespace detail
+{
+	template<typename T>
+	void write_words(
+		std::vector<std::uint8_t>& out,
+		std::uint32_t const* from,
+		std::uint32_t const* to)
+	{
+		std::uint64_t mask = 0;
+		for(std::size_t w = 0; w < component_words<T>::count; ++w)
+		{
+			if(from[w] != to[w])
+				mask |= std::uint64_t(1) << w;
+		}
+
+		write_varint(out, mask);
+		for(std::size_t w = 0; w < component_words<T>::count; ++w)
+		{
+			if(mask & (std::uint64_t(1) << w))
+			{
+				write_varint(out, zigzag(static_cast<std::int32_t>(to[w] - from[w])));
+			}
+		}
+	}
+
+	template<typename T>
+	void read_words(
+		std::uint8_t const*& p,
+		std::uint8_t const* last,
+		std::uint32_t* words)
+	{
+		std::uint64_t const mask = read_varint(p, last);
+		for(std::size_t w = 0; w < component_words<T>::count; ++w)
+		{
+			if(mask & (std::uint64_t(1) << w))
+			{
+				std::uint64_t const diff = read_varint(p, last);
+				words[w] += static_cast<std::uint32_t>(
+					unzigzag(static_cast<std::uint32_t>(diff))
+				);
+			}
+		}
+	}
+
+	inline void write_record_header(
+		std::vector<std::uint8_t>& out,
+		entity_index_t& next,
+		entity_index_t idx,
+		delta_record_kind kind)
+	{
+		write_varint(out, (std::uint64_t(idx - next) << 2) | kind);
+		next = idx + 1;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Appends the difference between pool and baseline to out.  Returns the
+// number of entities written.  The baseline is not modified; capture the
+// pool into it once the receiver has acknowledged the delta.
+template<typename ComponentPool>
+std::size_t encode_delta(
+	ComponentPool& pool,
+	delta_baseline<typename ComponentPool::type> const& baseline,
+	std::vector<std::uint8_t>& out)
+{
+	ENTITY_PROFILE_ZONE("encode_delta");
+	typedef typename ComponentPool::type type;
+	typedef detail::component_words<type> words_type;
+
+	std::uint32_t const zero[words_type::count] = {};
+	std::uint32_t current[words_type::count];
+	std::size_t written = 0;
+	entity_index_t next = 0;
+	entity_index_t idx = 0;
+
+	for(auto i = pool.optional_begin(), e = pool.optional_end(); i != e; ++i, ++idx)
+	{
+		auto c = *i;
+		bool const had = baseline.has(idx);
+		if(c)
+		{
+			words_type::load(*c, current);
+			std::uint32_t const* previous = had ? baseline.words(idx) : zero;
+			if(had && std::equal(current, current + words_type::count, previous))
+				continue;
+
+			detail::write_record_header(
+				out, next, idx, had ? detail::delta_modified : detail::delta_added);
+			detail::write_words<type>(out, previous, current);
+			++written;
+		}
+		else if(had)
+		{
+			detail::write_record_header(out, next, idx, detail::delta_removed);
+			++written;
+		}
+	}
+
+	for(; idx < baseline.size(); ++idx)
+	{
+		if(baseline.has(idx))
+		{
+			detail::write_record_header(out, next, idx, detail::delta_removed);
+			++written;
+		}
+	}
+
+	detail::write_varint(out, detail::delta_end);
+	return written;
+}
+
+// ----------------------------------------------------------------------------
+// Applies a delta produced by encode_delta to a pool holding the baseline
+// state.  Returns a pointer past the consumed bytes.  Throws
+// std::runtime_error on a malformed delta or one that names entities or
+// components the pool does not match, having applied the records before
+// the bad one.
+template<typename ComponentPool>
+std::uint8_t const* apply_delta(
+	ComponentPool& pool,
+	std::uint8_t const* first,
+	std::uint8_t const* last)
+{
+	ENTITY_PROFILE_ZONE("apply_delta");
+	typedef typename ComponentPool::type type;
+	typedef detail::component_words<type> words_type;
+
+	// Saturated pools hold every component, so a full state delta adds
+	// over them; for anything else an add over a component is foreign.
+	bool const adds_replace = type_traits::is_saturated_pool<ComponentPool>::value;
+	std::uint64_t const entity_count = static_cast<std::uint64_t>(
+		std::distance(pool.optional_begin(), pool.optional_end())
+	);
+
+	std::uint32_t words[words_type::count];
+	std::uint64_t next = 0;
+	for(;;)
+	{
+		std::uint64_t const header = detail::read_varint(first, last);
+		detail::delta_record_kind const kind =
+			static_cast<detail::delta_record_kind>(header & 3);
+
+		if(kind == detail::delta_end)
+			break;
+
+		std::uint64_t const idx = next + (header >> 2);
+		if(idx >= entity_count)
+			BOOST_THROW_EXCEPTION(std::runtime_error("Delta does not match baseline."));
+
+		entity const e = make_entity(static_cast<entity_index_t>(idx));
+		next = idx + 1;
+
+		if(kind == detail::delta_removed)
+		{
+			if(pool.get(e))
+				pool.destroy(e);
+		}
+		else if(kind == detail::delta_added)
+		{
+			if(!adds_replace && pool.get(e))
+				BOOST_THROW_EXCEPTION(std::runtime_error("Delta does not match baseline."));
+
+			std::fill(words, words + words_type::count, 0);
+			detail::read_words<type>(first, last, words);
+			type value;
+			words_type::store(words, value);
+			*pool.create(e, value) = value;
+		}
+		else
+		{
+			auto c = pool.get(e);
+			if(!c)
+				BOOST_THROW_EXCEPTION(std::runtime_error("Delta does not match baseline."));
+
+			words_type::load(*c, words);
+			detail::read_words<type>(first, last, words);
+			words_type::store(words, *c);
+		}
+	}
+
+	return first;
+}
+
+} } // namespace entity { namespace serialization {
+
+#endif // ENTITY_SERIALIZATION_DELTA_H_INCLUDED_
@@ -0,0 +1,305 @@
+// ****************************************************************************
+// entity/serialization/history.hpp
+//
+// Rollback history for a component pool.
+//
+// Each commit() compares the pool with the state of the previous commit
+// and records an undo delta holding only the components that changed, in
+// the same format as encode_delta.  The deltas live in a ring buffer of
+// the last N frames, so restoring a frame costs time proportional to the
+// changes made since, not to the size of the pool.
+//
+// Pools do not track writes, so the history keeps its own copy of every
+// component as of the last commit, as much memory again as the pool's
+// components, and commit() and discard() read the whole pool and the
+// whole copy to find what changed.  Only rollback is proportional to the
+// changes; a commit is a full pass over both every frame.
+//
+// History is kept per entity index.  Entities are not part of it, so the
+// entity pool must hold the same entities when rolling back, as it does
+// with deterministic resimulation.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SERIALIZATION_HISTORY_H_INCLUDED_
+#define ENTITY_SERIALIZATION_HISTORY_H_INCLUDED_
+
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/entity.hpp"
+#include "entity/entity_index.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/delta.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace serialization {
+
+template<typename ComponentPool>
+class pool_history
+{
+public:
+
+	typedef ComponentPool pool_type;
+	typedef typename ComponentPool::type type;
+
+	pool_history(ComponentPool& pool, std::size_t frame_count)
+		: pool_(pool)
+		, frames_(frame_count)
+		, oldest_(0)
+		, count_(0)
+	{
+		record_undo(scratch_, true);
+	}
+
+	// Records the changes since the last commit as a new frame, dropping
+	// the oldest frame once the history is full.  Returns the number of
+	// entities that changed.
+	std::size_t commit()
+	{
+		ENTITY_PROFILE_ZONE("pool_history::commit");
+		if(frames_.empty())
+		{
+			scratch_.clear();
+			return record_undo(scratch_, true);
+		}
+
+		std::vector<std::uint8_t>* frame;
+		if(count_ == frames_.size())
+		{
+			frame = &frames_[oldest_];
+			oldest_ = (oldest_ + 1) % frames_.size();
+		}
+		else
+		{
+			frame = &frames_[(oldest_ + count_) % frames_.size()];
+			++count_;
+		}
+
+		frame->clear();
+		return record_undo(*frame, true);
+	}
+
+	// Reverts the changes made since the last commit.
+	void discard()
+	{
+		ENTITY_PROFILE_ZONE("pool_history::discard");
+		scratch_.clear();
+		if(record_undo(scratch_, false))
+			apply_delta(pool_, scratch_.data(), scratch_.data() + scratch_.size());
+	}
+
+	// Restores the pool to its state frames commits before the last one
+	// and forgets the frames in between, ready to resimulate them.
+	// rollback(0) is the same as discard().
+	void rollback(std::size_t frames)
+	{
+		ENTITY_PROFILE_ZONE("pool_history::rollback");
+		if(frames > count_)
+		{
+			BOOST_THROW_EXCEPTION(
+				std::out_of_range("Rollback exceeds the recorded history.")
+			);
+		}
+
+		discard();
+		for(; frames > 0; --frames, --count_)
+		{
+			std::vector<std::uint8_t> const& frame =
+				frames_[(oldest_ + count_ - 1) % frames_.size()];
+
+			std::uint8_t const* first = frame.data();
+			std::uint8_t const* last = first + frame.size();
+			apply_delta(pool_, first, last);
+			apply_to_baseline(first, last);
+		}
+	}
+
+	// Forgets every recorded frame, keeping the current state.
+	void clear()
+	{
+		count_ = 0;
+		oldest_ = 0;
+	}
+
+	// Number of commits that can be rolled back.
+	std::size_t frames() const
+	{
+		return count_;
+	}
+
+	std::size_t capacity() const
+	{
+		return frames_.size();
+	}
+
+	memory_usage memory_stats() const
+	{
+		memory_usage usage;
+		usage.live_count = count_;
+		usage.slot_count = frames_.size();
+		for(std::size_t i = 0; i < count_; ++i)
+		{
+			usage.live_bytes += frames_[(oldest_ + i) % frames_.size()].size();
+		}
+
+		for(auto&& frame : frames_)
+		{
+			usage.reserved_bytes += frame.capacity();
+		}
+
+		usage.index_bytes =
+			frames_.capacity() * sizeof(frames_[0]) +
+			scratch_.capacity() +
+			present_.capacity() +
+			words_.capacity() * sizeof(std::uint32_t)
+		;
+		return usage;
+	}
+
+private:
+
+	// No copying
+	pool_history(pool_history const&);
+	pool_history operator=(pool_history const&);
+
+	typedef detail::component_words<type> words_type;
+
+	// Writes the delta taking the pool back to the baseline to out and,
+	// if rebase is set, brings the baseline up to the pool.  Returns the
+	// number of entities that differ.
+	std::size_t record_undo(std::vector<std::uint8_t>& out, bool rebase)
+	{
+		std::uint32_t const zero[words_type::count] = {};
+		std::uint32_t current[words_type::count];
+		std::size_t changed = 0;
+		entity_index_t next = 0;
+		entity_index_t idx = 0;
+
+		for(auto i = pool_.optional_begin(), e = pool_.optional_end(); i != e; ++i, ++idx)
+		{
+			auto c = *i;
+			bool const had = idx < present_.size() && present_[idx];
+			if(c)
+			{
+				words_type::load(*c, current);
+				std::uint32_t* previous = had ? baseline_words(idx) : nullptr;
+				if(had && std::equal(current, current + words_type::count, previous))
+					continue;
+
+				if(had)
+				{
+					detail::write_record_header(out, next, idx, detail::delta_modified);
+					detail::write_words<type>(out, current, previous);
+				}
+				else
+				{
+					detail::write_record_header(out, next, idx, detail::delta_removed);
+				}
+
+				if(rebase)
+				{
+					grow_baseline(idx);
+					std::copy(current, current + words_type::count, baseline_words(idx));
+					present_[idx] = 1;
+				}
+			}
+			else if(had)
+			{
+				detail::write_record_header(out, next, idx, detail::delta_added);
+				detail::write_words<type>(out, zero, baseline_words(idx));
+				if(rebase)
+					present_[idx] = 0;
+			}
+			else
+			{
+				continue;
+			}
+
+			++changed;
+		}
+
+		// Components of entities that no longer exist can't be restored.
+		if(rebase && idx < present_.size())
+		{
+			present_.resize(idx);
+			words_.resize(idx * words_type::count);
+		}
+
+		detail::write_varint(out, detail::delta_end);
+		return changed;
+	}
+
+	void apply_to_baseline(std::uint8_t const* first, std::uint8_t const* last)
+	{
+		entity_index_t next = 0;
+		for(;;)
+		{
+			std::uint64_t const header = detail::read_varint(first, last);
+			detail::delta_record_kind const kind =
+				static_cast<detail::delta_record_kind>(header & 3);
+
+			if(kind == detail::delta_end)
+				break;
+
+			entity_index_t const idx = next + static_cast<entity_index_t>(header >> 2);
+			next = idx + 1;
+			grow_baseline(idx);
+
+			if(kind == detail::delta_removed)
+			{
+				present_[idx] = 0;
+			}
+			else
+			{
+				std::uint32_t* words = baseline_words(idx);
+				if(kind == detail::delta_added)
+				{
+					std::fill(words, words + words_type::count, 0);
+					present_[idx] = 1;
+				}
+
+				detail::read_words<type>(first, last, words);
+			}
+		}
+	}
+
+	void grow_baseline(entity_index_t idx)
+	{
+		if(idx >= present_.size())
+		{
+			present_.resize(idx + 1, 0);
+			words_.resize((idx + 1) * words_type::count, 0);
+		}
+	}
+
+	std::uint32_t* baseline_words(entity_index_t idx)
+	{
+		return &words_[idx * words_type::count];
+	}
+
+	ComponentPool& pool_;
+	std::vector<std::vector<std::uint8_t>> frames_;
+	std::size_t oldest_;
+	std::size_t count_;
+	std::vector<std::uint8_t> scratch_;
+	std::vector<char> present_;
+	std::vector<std::uint32_t> words_;
+};
+
+} } // namespace entity { namespace serialization {
+
+#endif // ENTITY_SERIALIZATION_HISTORY_H_INCLUDED_
@@ -0,0 +1,345 @@
+// ****************************************************************************
+// entity/serialization/snapshot.hpp
+//
+// Binary snapshots of an entity_pool and its component pools.
+//
+// Each pool table is written as one aligned section of a single file, so
+// loading is a memory map plus one bulk copy per table; no parsing and no
+// per-entity creation or signals.  Only pools of trivially copyable
+// components can be snapshotted.
+//
+// Loading checks every section against the file and every pool's tables
+// against the restored entity count, and throws std::runtime_error on a
+// truncated, foreign or mismatched file.  After a throw the entity_pool
+// and pools are left part loaded and should be discarded.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SERIALIZATION_SNAPSHOT_H_INCLUDED_
+#define ENTITY_SERIALIZATION_SNAPSHOT_H_INCLUDED_
+
+#include <boost/throw_exception.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/entity_pool.hpp"
+#include "entity/profile.hpp"
+#include "entity/serialization/access.hpp"
+#include "entity/support/mapped_file.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace serialization {
+
+namespace detail
+{
+	static char const snapshot_magic[8] = {'E', 'N', 'T', 'S', 'N', 'A', 'P', '\0'};
+	static std::uint32_t const snapshot_version = 1;
+	static std::size_t const section_alignment = 64;
+
+	struct file_header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t section_count;
+	};
+
+	struct section_header
+	{
+		std::uint64_t offset;
+		std::uint64_t count;
+		std::uint64_t element_size;
+	};
+
+	inline std::size_t align_section(std::size_t offset)
+	{
+		return (offset + section_alignment - 1) & ~(section_alignment - 1);
+	}
+
+	inline void snapshot_error(char const* what)
+	{
+		BOOST_THROW_EXCEPTION(std::runtime_error(what));
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Collects the tables of each pool and writes them out in one go.
+// Tables are referenced, not copied, so the pools must not change until
+// write() returns.
+class snapshot_writer
+{
+public:
+
+	template<typename Vector>
+	void write_table(Vector const& table)
+	{
+		typedef typename Vector::value_type value_type;
+		static_assert(
+			std::is_trivially_copyable<value_type>::value,
+			"Snapshots require trivially copyable tables."
+		);
+
+		section s = { table.data(), table.size(), sizeof(value_type), 0 };
+		sections_.push_back(s);
+	}
+
+	template<typename T>
+	void write_value(T const& value)
+	{
+		static_assert(
+			std::is_trivially_copyable<T>::value,
+			"Snapshots require trivially copyable values."
+		);
+
+		values_.emplace_back(
+			reinterpret_cast<char const*>(&value),
+			reinterpret_cast<char const*>(&value) + sizeof(T)
+		);
+
+		section s = { nullptr, 1, sizeof(T), values_.size() - 1 };
+		sections_.push_back(s);
+	}
+
+	void write(char const* path) const
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		if(!out)
+			detail::snapshot_error("Failed to open snapshot for writing.");
+
+		detail::file_header header;
+		std::memcpy(header.magic, detail::snapshot_magic, sizeof(header.magic));
+		header.version = detail::snapshot_version;
+		header.section_count = static_cast<std::uint32_t>(sections_.size());
+
+		std::vector<detail::section_header> table;
+		std::size_t offset = detail::align_section(
+			sizeof(header) + sections_.size() * sizeof(detail::section_header)
+		);
+
+		for(auto&& s : sections_)
+		{
+			detail::section_header h = { offset, s.count, s.element_size };
+			table.push_back(h);
+			offset = detail::align_section(offset + s.count * s.element_size);
+		}
+
+		out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		out.write(
+			reinterpret_cast<char const*>(table.data()),
+			table.size() * sizeof(detail::section_header)
+		);
+
+		for(std::size_t i = 0; i < sections_.size(); ++i)
+		{
+			pad_to(out, static_cast<std::size_t>(table[i].offset));
+			section const& s = sections_[i];
+			char const* data = s.data
+				? static_cast<char const*>(s.data)
+				: values_[s.value_index].data()
+			;
+
+			out.write(data, s.count * s.element_size);
+		}
+
+		if(!out)
+			detail::snapshot_error("Failed to write snapshot.");
+	}
+
+private:
+
+	struct section
+	{
+		void const* data;
+		std::size_t count;
+		std::size_t element_size;
+		std::size_t value_index;
+	};
+
+	static void pad_to(std::ofstream& out, std::size_t offset)
+	{
+		static char const zeros[detail::section_alignment] = {};
+		std::size_t const current = static_cast<std::size_t>(out.tellp());
+		out.write(zeros, offset - current);
+	}
+
+	std::vector<section> sections_;
+	std::vector<std::vector<char>> values_;
+};
+
+// ----------------------------------------------------------------------------
+// Maps a snapshot and hands its sections back to the pools in the order
+// they were written.
+class snapshot_reader
+{
+public:
+
+	explicit snapshot_reader(char const* path)
+		: file_(path)
+		, next_section_(0)
+		, entity_count_(0)
+	{
+		if(file_.size() < sizeof(detail::file_header))
+			detail::snapshot_error("Snapshot is truncated.");
+
+		std::memcpy(&header_, file_.data(), sizeof(header_));
+		if(std::memcmp(header_.magic, detail::snapshot_magic, sizeof(header_.magic)) != 0)
+			detail::snapshot_error("File is not a snapshot.");
+
+		if(header_.version != detail::snapshot_version)
+			detail::snapshot_error("Unsupported snapshot version.");
+
+		std::size_t const table_end =
+			sizeof(header_) + header_.section_count * sizeof(detail::section_header);
+		if(file_.size() < table_end)
+			detail::snapshot_error("Snapshot is truncated.");
+
+		sections_ = reinterpret_cast<detail::section_header const*>(
+			file_.data() + sizeof(header_)
+		);
+
+		// Written so no product can overflow on a hostile header.
+		for(std::uint32_t i = 0; i < header_.section_count; ++i)
+		{
+			detail::section_header const& s = sections_[i];
+			if(s.element_size == 0 ||
+				s.offset > file_.size() ||
+				s.count > (file_.size() - s.offset) / s.element_size)
+			{
+				detail::snapshot_error("Snapshot is truncated.");
+			}
+		}
+	}
+
+	template<typename Vector>
+	void read_table(Vector& table)
+	{
+		typedef typename Vector::value_type value_type;
+		value_type const* first = next_section<value_type>();
+		table.assign(first, first + sections_[next_section_ - 1].count);
+	}
+
+	template<typename T>
+	void read_value(T& value)
+	{
+		T const* first = next_section<T>();
+		if(sections_[next_section_ - 1].count != 1)
+			detail::snapshot_error("Snapshot section does not match pool type.");
+
+		std::memcpy(&value, first, sizeof(T));
+	}
+
+	// Entities restored so far; pools check their tables against this.
+	std::size_t entity_count() const
+	{
+		return entity_count_;
+	}
+
+	void set_entity_count(std::size_t count)
+	{
+		entity_count_ = count;
+	}
+
+	// Called by pools with the result of checking what they loaded.
+	void check(bool consistent) const
+	{
+		if(!consistent)
+			detail::snapshot_error("Snapshot does not match its entities.");
+	}
+
+	// Checks every element of table is below bound, or is none.
+	template<typename Vector>
+	void check_indices(
+		Vector const& table,
+		std::size_t bound,
+		typename Vector::value_type none) const
+	{
+		for(auto&& idx : table)
+			check(idx == none || static_cast<std::size_t>(idx) < bound);
+	}
+
+	template<typename Vector>
+	void check_indices(Vector const& table, std::size_t bound) const
+	{
+		for(auto&& idx : table)
+			check(static_cast<std::size_t>(idx) < bound);
+	}
+
+	// True once every section has been consumed.
+	bool done() const
+	{
+		return next_section_ == header_.section_count;
+	}
+
+private:
+
+	template<typename T>
+	T const* next_section()
+	{
+		if(next_section_ >= header_.section_count)
+			detail::snapshot_error("Snapshot has fewer sections than pools.");
+
+		detail::section_header const& s = sections_[next_section_++];
+		if(s.element_size != sizeof(T) || s.offset % alignof(T) != 0)
+			detail::snapshot_error("Snapshot section does not match pool type.");
+
+		return reinterpret_cast<T const*>(file_.data() + s.offset);
+	}
+
+	support::mapped_file file_;
+	detail::file_header header_;
+	detail::section_header const* sections_;
+	std::uint32_t next_section_;
+	std::size_t entity_count_;
+};
+
+// ----------------------------------------------------------------------------
+// Saves entities and pools, in order, to path.
+template<typename... ComponentPools>
+void save_snapshot(
+	char const* path,
+	entity_pool const& entities,
+	ComponentPools const&... pools)
+{
+	ENTITY_PROFILE_ZONE("save_snapshot");
+	snapshot_writer writer;
+	access::save(entities, writer);
+	int expand[] = { 0, (access::save(pools, writer), 0)... };
+	(void)expand;
+	writer.write(path);
+}
+
+// ----------------------------------------------------------------------------
+// Loads a snapshot written by save_snapshot with the same pool types in
+// the same order.  entities must be empty; the pools are replaced
+// wholesale without firing any signals.
+template<typename... ComponentPools>
+void load_snapshot(
+	char const* path,
+	entity_pool& entities,
+	ComponentPools&... pools)
+{
+	ENTITY_PROFILE_ZONE("load_snapshot");
+	snapshot_reader reader(path);
+	access::load(entities, reader);
+	reader.set_entity_count(entities.size());
+	int expand[] = { 0, (access::load(pools, reader), 0)... };
+	(void)expand;
+	if(!reader.done())
+		detail::snapshot_error("Snapshot has more sections than pools.");
+}
+
+} } // namespace entity { namespace serialization {
+
+#endif // ENTITY_SERIALIZATION_SNAPSHOT_H_INCLUDED_
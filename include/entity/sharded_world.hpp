@@ -0,0 +1,526 @@
+// ****************************************************************************
+// entity/sharded_world.hpp
+//
+// A world split into shards, each an independent entity_pool with its own
+// set of component pools, so shards can be simulated on separate threads.
+//
+// Entities are named across shards by a global_entity, which stays valid
+// while the entity migrates.  Migrations are queued on the entity's
+// current shard and carried out together, components and all, at sync().
+// Global ids are reused once destroyed, but each reuse bumps the id's
+// generation, so old handles and queued migrations of a destroyed entity
+// never reach its successor.
+//
+// Shards share nothing, so each can be updated by its own thread.  While
+// they are, a shard's thread may modify components, look up the global
+// ids of its own entities and queue migrations for them; creating and
+// destroying entities, and sync(), go through the world on the
+// coordinating thread.  Each shard keeps its own copy of its entities'
+// global ids and generations for this, so a shard's thread never reads
+// the world's tables while the coordinating thread grows them.
+//
+// Entities created directly on a shard's entity_pool are local to that
+// shard: they have no global_entity and can't migrate.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SHARDEDWORLD_H_INCLUDED_
+#define ENTITY_SHARDEDWORLD_H_INCLUDED_
+
+#include <boost/operators.hpp>
+#include <boost/signals2.hpp>
+#include <boost/signals2/connection.hpp>
+#include <boost/throw_exception.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/entity.hpp"
+#include "entity/entity_index.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/profile.hpp"
+#include "entity/support/index_sequence.hpp"
+#include "entity/type_traits/component_pool.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity
+{
+	// ------------------------------------------------------------------------
+	//
+	class global_entity : boost::totally_ordered<global_entity>
+	{
+	public:
+
+		std::size_t index() const BOOST_NOEXCEPT
+		{
+			return idx_;
+		}
+
+		std::uint32_t generation() const BOOST_NOEXCEPT
+		{
+			return generation_;
+		}
+
+		bool operator==(global_entity const& rhs) const BOOST_NOEXCEPT
+		{
+			return index() == rhs.index() && generation() == rhs.generation();
+		}
+
+		bool operator<(global_entity const& rhs) const BOOST_NOEXCEPT
+		{
+			return index() < rhs.index() ||
+				(index() == rhs.index() && generation() < rhs.generation());
+		}
+
+	private:
+
+		friend global_entity make_global_entity(std::size_t, std::uint32_t) BOOST_NOEXCEPT;
+
+		global_entity(std::size_t idx, std::uint32_t generation) BOOST_NOEXCEPT
+			: idx_(idx)
+			, generation_(generation)
+		{}
+
+		std::size_t idx_;
+		std::uint32_t generation_;
+	};
+
+	inline std::size_t hash_value(global_entity const& e) BOOST_NOEXCEPT
+	{
+		return e.index() ^ (std::size_t(e.generation()) << 24);
+	}
+
+	inline global_entity make_global_entity(std::size_t idx, std::uint32_t generation = 0) BOOST_NOEXCEPT
+	{
+		return global_entity(idx, generation);
+	}
+
+	// ------------------------------------------------------------------------
+	// Where a global_entity currently lives.
+	struct shard_location
+	{
+		shard_location(std::size_t s, entity e)
+			: shard(s)
+			, local(e)
+		{}
+
+		std::size_t shard;
+		entity local;
+	};
+
+	namespace detail
+	{
+		inline void check_shard(std::size_t index, std::size_t shard_count)
+		{
+			if(index >= shard_count)
+			{
+				BOOST_THROW_EXCEPTION(
+					std::out_of_range("Shard index out of range.")
+				);
+			}
+		}
+
+		// Saturated pools always hold a component, so migrating assigns.
+		template<typename Pool>
+		void migrate_component(Pool& from, entity a, Pool& to, entity b, std::true_type)
+		{
+			*to.get(b) = std::move(*from.get(a));
+		}
+
+		// Otherwise any component made by auto_create_components on the
+		// destination is replaced.
+		template<typename Pool>
+		void migrate_component(Pool& from, entity a, Pool& to, entity b, std::false_type)
+		{
+			auto c = from.get(a);
+			if(!c)
+				return;
+
+			if(to.get(b))
+				to.destroy(b);
+
+			to.create(b, std::move(*c));
+		}
+	}
+
+	// ------------------------------------------------------------------------
+	//
+	template<typename... Pools>
+	class sharded_world
+	{
+	public:
+
+		class shard
+		{
+		public:
+
+			entity_pool& entities()
+			{
+				return entities_;
+			}
+
+			template<typename Pool>
+			Pool& pool()
+			{
+				return std::get<Pool>(pools_);
+			}
+
+			template<std::size_t Index>
+			typename std::tuple_element<Index, std::tuple<Pools...>>::type& pool()
+			{
+				return std::get<Index>(pools_);
+			}
+
+			std::size_t index() const
+			{
+				return index_;
+			}
+
+			global_entity global(entity e) const
+			{
+				global_entity const g = globals_[e.index()];
+				if(g.index() == invalid_index())
+				{
+					BOOST_THROW_EXCEPTION(
+						std::invalid_argument("Entity is local to its shard.")
+					);
+				}
+
+				return g;
+			}
+
+			// Queues e to move to another shard at the next sync().  Safe to
+			// call from the thread updating this shard.
+			void migrate(entity e, std::size_t to)
+			{
+				detail::check_shard(to, shard_count_);
+				outbox_.push_back(std::make_pair(global(e), to));
+			}
+
+		private:
+
+			friend class sharded_world;
+
+			// No copying
+			shard(shard const&);
+			shard operator=(shard const&);
+
+			template<typename Pool>
+			static entity_pool& owner(entity_pool& entities)
+			{
+				return entities;
+			}
+
+			shard(sharded_world& world, std::size_t index, std::size_t shard_count)
+				: pools_(owner<Pools>(entities_)...)
+				, world_(world)
+				, index_(index)
+				, shard_count_(shard_count)
+			{
+				slots_.entity_create_handler =
+					entities_.signals().on_entity_create.connect(
+						[this](entity)
+						{
+							globals_.push_back(make_global_entity(invalid_index()));
+						}
+					)
+				;
+
+				slots_.entity_destroy_handler =
+					entities_.signals().on_entity_destroy.connect(
+						[this](entity)
+						{
+							std::size_t const id = globals_.back().index();
+							globals_.pop_back();
+							if(id != invalid_index())
+								world_.release(id);
+						}
+					)
+				;
+
+				slots_.entity_swap_handler =
+					entities_.signals().on_entity_swap.connect(
+						[this](entity a, entity b)
+						{
+							std::swap(globals_[a.index()], globals_[b.index()]);
+							relocate(a);
+							relocate(b);
+						}
+					)
+				;
+			}
+
+			void relocate(entity e)
+			{
+				std::size_t const id = globals_[e.index()].index();
+				if(id != invalid_index())
+					world_.locations_[id].local = e.index();
+			}
+
+			struct slot_list
+			{
+				boost::signals2::scoped_connection entity_create_handler;
+				boost::signals2::scoped_connection entity_destroy_handler;
+				boost::signals2::scoped_connection entity_swap_handler;
+			};
+
+			entity_pool entities_;
+			std::tuple<Pools...> pools_;
+			sharded_world& world_;
+			std::size_t index_;
+			std::size_t shard_count_;
+			std::vector<global_entity> globals_;
+			std::vector<std::pair<global_entity, std::size_t>> outbox_;
+			slot_list slots_;
+		};
+
+		// --------------------------------------------------------------------
+		//
+		explicit sharded_world(std::size_t shard_count)
+			: size_(0)
+		{
+			if(shard_count == 0)
+			{
+				BOOST_THROW_EXCEPTION(
+					std::invalid_argument("A sharded_world needs at least one shard.")
+				);
+			}
+
+			shards_.reserve(shard_count);
+			for(std::size_t i = 0; i < shard_count; ++i)
+			{
+				shards_.emplace_back(new shard(*this, i, shard_count));
+			}
+		}
+
+		global_entity create(std::size_t shard_index)
+		{
+			shard& s = get_shard(shard_index);
+			entity const e = s.entities_.create();
+
+			std::size_t id;
+			if(free_ids_.empty())
+			{
+				id = locations_.size();
+				locations_.push_back(location_record());
+			}
+			else
+			{
+				id = free_ids_.back();
+				free_ids_.pop_back();
+			}
+
+			global_entity const g = make_global_entity(id, locations_[id].generation);
+			locations_[id].shard = shard_index;
+			locations_[id].local = e.index();
+			s.globals_[e.index()] = g;
+			++size_;
+			return g;
+		}
+
+		// Pending migrations of g are dropped at the next sync(), even if
+		// its id has been reused by then.
+		void destroy(global_entity g)
+		{
+			shard_location const where = locate(g);
+			shards_[where.shard]->entities_.destroy(where.local);
+		}
+
+		bool contains(global_entity g) const
+		{
+			return g.index() < locations_.size() &&
+				locations_[g.index()].shard != invalid_index() &&
+				locations_[g.index()].generation == g.generation();
+		}
+
+		shard_location locate(global_entity g) const
+		{
+			if(!contains(g))
+			{
+				BOOST_THROW_EXCEPTION(
+					std::out_of_range("Entity is not in the world.")
+				);
+			}
+
+			location_record const& r = locations_[g.index()];
+			return shard_location(r.shard, make_entity(r.local));
+		}
+
+		template<typename Pool>
+		typename type_traits::optional_type_of_pool<Pool>::type get(global_entity g)
+		{
+			shard_location const where = locate(g);
+			return shards_[where.shard]->template pool<Pool>().get(where.local);
+		}
+
+		// Queues g to move to shard to at the next sync().
+		void migrate(global_entity g, std::size_t to)
+		{
+			detail::check_shard(to, shards_.size());
+			shards_[locate(g).shard]->outbox_.push_back(std::make_pair(g, to));
+		}
+
+		// Carries out the queued migrations, creating each entity in its
+		// new shard, moving every component across and destroying the
+		// original.  Returns the number of entities moved.
+		std::size_t sync()
+		{
+			ENTITY_PROFILE_ZONE("sharded_world::sync");
+			std::size_t moved = 0;
+			for(auto&& s : shards_)
+			{
+				for(auto&& m : s->outbox_)
+				{
+					if(!contains(m.first))
+						continue;
+
+					location_record& r = locations_[m.first.index()];
+					if(r.shard == m.second)
+						continue;
+
+					shard& from = *shards_[r.shard];
+					shard& to = *shards_[m.second];
+					entity const a = make_entity(r.local);
+					entity const b = to.entities_.create();
+					move_components(
+						from, a, to, b,
+						support::make_index_sequence<sizeof...(Pools)>()
+					);
+
+					// Hand the id over before destroying the original so the
+					// destroy doesn't release it.
+					to.globals_[b.index()] = m.first;
+					from.globals_[a.index()] = make_global_entity(invalid_index());
+					from.entities_.destroy(a);
+					r.shard = m.second;
+					r.local = b.index();
+					++moved;
+				}
+
+				s->outbox_.clear();
+			}
+
+			return moved;
+		}
+
+		shard& get_shard(std::size_t index)
+		{
+			detail::check_shard(index, shards_.size());
+			return *shards_[index];
+		}
+
+		std::size_t shard_count() const
+		{
+			return shards_.size();
+		}
+
+		// Number of entities across all shards.
+		std::size_t size() const
+		{
+			return size_;
+		}
+
+		template<typename F>
+		void for_each_shard(F f)
+		{
+			for(auto&& s : shards_)
+				f(*s);
+		}
+
+		// Calls f(global_entity, component) for every component in Pool,
+		// shard by shard, for systems that need the whole world.  Entities
+		// local to a shard, and entities disabled in their shard's
+		// entity_pool, are skipped.
+		template<typename Pool, typename F>
+		void for_each(F f)
+		{
+			for(auto&& s : shards_)
+			{
+				Pool& pool = s->template pool<Pool>();
+				std::size_t idx = 0;
+				for(auto i = pool.optional_begin(), e = pool.optional_end(); i != e; ++i, ++idx)
+				{
+					auto c = *i;
+					global_entity const g = s->globals_[idx];
+					if(c && g.index() != invalid_index() &&
+						s->entities_.is_enabled(make_entity(static_cast<entity_index_t>(idx))))
+					{
+						f(g, *c);
+					}
+				}
+			}
+		}
+
+	private:
+
+		// No copying
+		sharded_world(sharded_world const&);
+		sharded_world operator=(sharded_world const&);
+
+		struct location_record
+		{
+			location_record()
+				: shard(invalid_index())
+				, local(0)
+				, generation(0)
+			{}
+
+			std::size_t shard;
+			entity_index_t local;
+			std::uint32_t generation;
+		};
+
+		// Called as a global entity's local entity is destroyed, wherever
+		// the destroy came from.
+		void release(std::size_t id)
+		{
+			location_record& r = locations_[id];
+			r.shard = invalid_index();
+			++r.generation;
+			free_ids_.push_back(id);
+			--size_;
+		}
+
+		static std::size_t invalid_index()
+		{
+			return std::numeric_limits<std::size_t>::max();
+		}
+
+		template<std::size_t... Indices>
+		static void move_components(
+			shard& from, entity a,
+			shard& to, entity b,
+			support::index_sequence<Indices...>)
+		{
+			(void)std::initializer_list<int>{
+				(detail::migrate_component(
+					std::get<Indices>(from.pools_), a,
+					std::get<Indices>(to.pools_), b,
+					type_traits::is_saturated_pool<Pools>()
+				), 0)...
+			};
+		}
+
+		std::vector<std::unique_ptr<shard>> shards_;
+		std::vector<location_record> locations_;
+		std::vector<std::size_t> free_ids_;
+		std::size_t size_;
+	};
+}
+
+#endif // ENTITY_SHARDEDWORLD_H_INCLUDED_
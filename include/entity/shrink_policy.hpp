@@ -0,0 +1,186 @@
+// ****************************************************************************
+// entity/shrink_policy.hpp
+//
+// Controls when and how pools hand memory back after their population
+// drops, and a scheduler that shares a per frame budget between pools.
+//
+// Each table is reallocated in one go, never copied piecewise, so only
+// tables whose live contents fit in a step's budget are shrunk by steps.
+// A table larger than that is left alone by shrink_step and the
+// scheduler however empty it gets; reclaim it with the pool's
+// shrink_to_fit() or compact() at a point that can afford the copy.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SHRINKPOLICY_H_INCLUDED_
+#define ENTITY_SHRINKPOLICY_H_INCLUDED_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/profile.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity
+{
+	/// \brief Hysteresis thresholds for shrinking pool tables.
+	///
+	/// A table is shrunk once the unused fraction of its capacity reaches
+	/// high_water, and is shrunk to a capacity that leaves low_water of it
+	/// free, so a small regrowth doesn't immediately reallocate again.
+	/// Each shrink_step spends at most its budget of bytes on copying live
+	/// elements, so a table is only shrunk once its live contents fit
+	/// within a single step.  Larger tables need shrink_to_fit().
+	///
+	class shrink_policy
+	{
+	public:
+
+		explicit shrink_policy(
+			double high_water = 0.75,
+			double low_water = 0.25,
+			std::size_t bytes_per_step = 256 * 1024,
+			std::size_t min_reclaim_bytes = 4 * 1024)
+			: high_water_(high_water)
+			, low_water_(std::min(low_water, high_water))
+			, bytes_per_step_(bytes_per_step)
+			, min_reclaim_bytes_(min_reclaim_bytes)
+		{}
+
+		std::size_t bytes_per_step() const
+		{
+			return bytes_per_step_;
+		}
+
+		// Returns true if storage with the given size and capacity, in
+		// elements, has enough slack to be worth shrinking.
+		bool should_shrink(
+			std::size_t size,
+			std::size_t capacity,
+			std::size_t element_size) const
+		{
+			std::size_t const unused = capacity - size;
+			return unused * element_size >= min_reclaim_bytes_
+				&& double(unused) >= high_water_ * double(capacity);
+		}
+
+		template<typename Vector>
+		bool should_shrink(Vector const& table) const
+		{
+			return should_shrink(
+				table.size(),
+				table.capacity(),
+				sizeof(typename Vector::value_type)
+			);
+		}
+
+		// Shrinks table if the policy says so and the copy fits in budget.
+		// Returns the number of bytes spent, or zero if nothing was done.
+		template<typename Vector>
+		std::size_t shrink(Vector& table, std::size_t budget) const
+		{
+			if(!should_shrink(table))
+				return 0;
+
+			std::size_t const cost =
+				std::max<std::size_t>(table.size(), 1) *
+				sizeof(typename Vector::value_type)
+			;
+
+			if(cost > budget)
+				return 0;
+
+			std::size_t const size = table.size();
+			reallocate(table, size + std::size_t(double(size) * low_water_ / (1.0 - low_water_)));
+			return cost;
+		}
+
+		// Moves table into a new allocation of exactly capacity elements.
+		template<typename Vector>
+		static void reallocate(Vector& table, std::size_t capacity)
+		{
+			Vector replacement(table.get_allocator());
+			replacement.reserve(std::max(capacity, table.size()));
+			std::move(table.begin(), table.end(), std::back_inserter(replacement));
+			table.swap(replacement);
+		}
+
+	private:
+
+		double high_water_;
+		double low_water_;
+		std::size_t bytes_per_step_;
+		std::size_t min_reclaim_bytes_;
+	};
+
+	/// \brief Applies a shrink_policy to a set of pools a step at a time.
+	/// Call update() once per frame; each call spends at most the policy's
+	/// per step budget and resumes from where the last call stopped.  The
+	/// work spread across frames is whole tables, one pool after another;
+	/// see the note at the top of the file about tables over budget.
+	///
+	class shrink_scheduler
+	{
+	public:
+
+		explicit shrink_scheduler(shrink_policy policy = shrink_policy())
+			: policy_(policy)
+			, next_(0)
+		{}
+
+		template<typename Pool>
+		void add(Pool& pool)
+		{
+			pools_.push_back(
+				[&pool](shrink_policy const& policy, std::size_t budget)
+				{
+					return pool.shrink_step(policy, budget);
+				}
+			);
+		}
+
+		void clear()
+		{
+			pools_.clear();
+			next_ = 0;
+		}
+
+		// Returns the number of bytes spent this step.
+		std::size_t update()
+		{
+			ENTITY_PROFILE_ZONE("shrink_scheduler::update");
+			std::size_t const budget = policy_.bytes_per_step();
+			std::size_t const first = next_;
+			std::size_t spent = 0;
+			for(std::size_t i = 0; i < pools_.size() && spent < budget; ++i)
+			{
+				std::size_t const pool_idx = (first + i) % pools_.size();
+				spent += pools_[pool_idx](policy_, budget - spent);
+				next_ = (pool_idx + 1) % pools_.size();
+			}
+
+			return spent;
+		}
+
+	private:
+
+		shrink_policy policy_;
+		std::vector<
+			std::function<std::size_t(shrink_policy const&, std::size_t)>
+		> pools_;
+		std::size_t next_;
+	};
+}
+
+#endif // ENTITY_SHRINKPOLICY_H_INCLUDED_
@@ -0,0 +1,163 @@
+// ****************************************************************************
+// entity/support/any_allocator.hpp
+//
+// A type erased allocator so that non-template owners, such as entity_pool,
+// can accept arbitrary user allocators (arenas, monotonic buffers,
+// std::pmr::polymorphic_allocator) without changing their own type.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SUPPORT_ANYALLOCATOR_H_INCLUDED_
+#define ENTITY_SUPPORT_ANYALLOCATOR_H_INCLUDED_
+
+#include <boost/config.hpp>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace support {
+
+namespace detail
+{
+	// ------------------------------------------------------------------------
+	//
+	struct any_allocator_resource
+	{
+		virtual ~any_allocator_resource()
+		{}
+
+		virtual void* allocate(std::size_t bytes) = 0;
+		virtual void deallocate(void* p, std::size_t bytes) = 0;
+	};
+
+	// ------------------------------------------------------------------------
+	// Allocates in units of max_align_t so any value type placed in the
+	// memory is suitably aligned.
+	template<typename Allocator>
+	class any_allocator_resource_impl : public any_allocator_resource
+	{
+	public:
+
+		typedef typename std::aligned_storage<
+			sizeof(std::max_align_t),
+			alignof(std::max_align_t)
+		>::type unit_type;
+
+		typedef typename std::allocator_traits<
+			Allocator
+		>::template rebind_alloc<unit_type> allocator_type;
+
+		typedef std::allocator_traits<allocator_type> traits_type;
+
+		explicit any_allocator_resource_impl(Allocator const& alloc)
+			: allocator_(alloc)
+		{}
+
+		void* allocate(std::size_t bytes) override
+		{
+			return std::addressof(*traits_type::allocate(allocator_, num_units(bytes)));
+		}
+
+		void deallocate(void* p, std::size_t bytes) override
+		{
+			traits_type::deallocate(
+				allocator_,
+				static_cast<unit_type*>(p),
+				num_units(bytes)
+			);
+		}
+
+	private:
+
+		static std::size_t num_units(std::size_t bytes)
+		{
+			return (bytes + sizeof(unit_type) - 1) / sizeof(unit_type);
+		}
+
+		allocator_type allocator_;
+	};
+}
+
+// ----------------------------------------------------------------------------
+//
+template<typename T>
+class any_allocator
+{
+public:
+
+	typedef T value_type;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef any_allocator<U> other;
+	};
+
+	// Default constructed allocators go straight to the global heap and
+	// carry no extra state.
+	any_allocator() BOOST_NOEXCEPT
+	{}
+
+	template<typename Allocator>
+	any_allocator(std::allocator_arg_t, Allocator const& alloc)
+		: resource_(
+			std::allocate_shared<
+				detail::any_allocator_resource_impl<Allocator>
+			>(alloc, alloc))
+	{}
+
+	template<typename U>
+	any_allocator(any_allocator<U> const& other) BOOST_NOEXCEPT
+		: resource_(other.resource_)
+	{}
+
+	T* allocate(std::size_t n)
+	{
+		if(!resource_)
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+
+		return static_cast<T*>(resource_->allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, std::size_t n)
+	{
+		if(!resource_)
+			::operator delete(p);
+		else
+			resource_->deallocate(p, n * sizeof(T));
+	}
+
+	template<typename U>
+	bool operator==(any_allocator<U> const& rhs) const BOOST_NOEXCEPT
+	{
+		return resource_ == rhs.resource_;
+	}
+
+	template<typename U>
+	bool operator!=(any_allocator<U> const& rhs) const BOOST_NOEXCEPT
+	{
+		return !(*this == rhs);
+	}
+
+private:
+
+	template<typename U>
+	friend class any_allocator;
+
+	std::shared_ptr<detail::any_allocator_resource> resource_;
+};
+
+} } // namespace entity { namespace support {
+
+#endif // ENTITY_SUPPORT_ANYALLOCATOR_H_INCLUDED_
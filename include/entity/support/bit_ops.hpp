@@ -0,0 +1,61 @@
+// ****************************************************************************
+// entity/support/bit_ops.hpp
+//
+// Portable popcount and count trailing zeros for 64 bit words, using the
+// compiler intrinsics where they're available.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SUPPORT_BITOPS_H_INCLUDED_
+#define ENTITY_SUPPORT_BITOPS_H_INCLUDED_
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#  include <intrin.h>
+#  pragma intrinsic(_BitScanForward64)
+#endif
+
+namespace entity { namespace support {
+
+// ------------------------------------------------------------------------
+//
+inline std::size_t popcount(std::uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<std::size_t>(__builtin_popcountll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return static_cast<std::size_t>(__popcnt64(word));
+#else
+	word = word - ((word >> 1) & 0x5555555555555555ull);
+	word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return static_cast<std::size_t>((word * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// ------------------------------------------------------------------------
+// Index of the lowest set bit.  word must not be zero.
+inline std::size_t count_trailing_zeros(std::uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<std::size_t>(__builtin_ctzll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long idx;
+	_BitScanForward64(&idx, word);
+	return static_cast<std::size_t>(idx);
+#else
+	return popcount((word & (~word + 1)) - 1);
+#endif
+}
+
+} } // namespace entity { namespace support {
+
+#endif // ENTITY_SUPPORT_BITOPS_H_INCLUDED_
@@ -0,0 +1,217 @@
+// ****************************************************************************
+// entity/support/mapped_allocator.hpp
+//
+// An allocator that takes large blocks directly from the virtual memory
+// system instead of the heap.  Blocks are aligned and advised for
+// transparent huge pages and physical memory is committed lazily on first
+// touch unless prefaulting is requested.
+//
+// Combined with the pools' reserve() this gives storage that can be
+// reserved once for the largest expected world and then grow in place,
+// without copying, while only the touched pages cost physical memory.
+//
+// On Windows the whole block is committed when it's mapped: it counts
+// against the system commit limit straight away, though physical pages
+// still arrive on first touch.  Committing on demand there would need a
+// fault handler, so reserve() sizes count in full against the limit.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SUPPORT_MAPPEDALLOCATOR_H_INCLUDED_
+#define ENTITY_SUPPORT_MAPPEDALLOCATOR_H_INCLUDED_
+
+#include <boost/config.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#if defined(BOOST_WINDOWS)
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+#include "entity/config.hpp" // IWYU pragma: keep
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace support {
+
+// ----------------------------------------------------------------------------
+//
+struct mapping_flags
+{
+	enum type
+	{
+		none       = 0,
+		// Align and advise mappings for transparent huge pages.
+		huge_pages = 1 << 0,
+		// Commit all pages at allocation time so first touch
+		// doesn't fault in the middle of a frame.
+		prefault   = 1 << 1,
+	};
+};
+
+namespace detail
+{
+	// ------------------------------------------------------------------------
+	//
+	static std::size_t const huge_page_size = 2 * 1024 * 1024;
+
+	inline std::size_t mapping_size(std::size_t bytes, unsigned flags)
+	{
+		std::size_t const granularity = (flags & mapping_flags::huge_pages)
+			? huge_page_size
+			: 64 * 1024
+		;
+
+		return (bytes + granularity - 1) & ~(granularity - 1);
+	}
+
+	inline void* map_memory(std::size_t size, unsigned flags)
+	{
+#if defined(BOOST_WINDOWS)
+		// Committed up front; see the note at the top of the file.
+		void* p = ::VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if(!p)
+			throw std::bad_alloc();
+#else
+		int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#  if defined(MAP_NORESERVE)
+		map_flags |= MAP_NORESERVE;
+#  endif
+#  if defined(MAP_POPULATE)
+		if(flags & mapping_flags::prefault)
+			map_flags |= MAP_POPULATE;
+#  endif
+
+		// Over-map so the block can be aligned to a huge page boundary,
+		// then hand the slack back.
+		std::size_t const slack = (flags & mapping_flags::huge_pages) ? huge_page_size : 0;
+		void* raw = ::mmap(nullptr, size + slack, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+		if(raw == MAP_FAILED)
+			throw std::bad_alloc();
+
+		std::uintptr_t const begin = reinterpret_cast<std::uintptr_t>(raw);
+		std::uintptr_t const aligned = slack
+			? (begin + slack - 1) & ~(std::uintptr_t(slack) - 1)
+			: begin
+		;
+
+		if(aligned != begin)
+			::munmap(raw, aligned - begin);
+		if(slack != aligned - begin)
+			::munmap(reinterpret_cast<void*>(aligned + size), slack - (aligned - begin));
+
+		void* p = reinterpret_cast<void*>(aligned);
+
+#  if defined(MADV_HUGEPAGE)
+		if(flags & mapping_flags::huge_pages)
+			::madvise(p, size, MADV_HUGEPAGE);
+#  endif
+#endif
+
+#if !defined(MAP_POPULATE)
+		if(flags & mapping_flags::prefault)
+		{
+			for(std::size_t i = 0; i < size; i += 4096)
+				static_cast<volatile char*>(p)[i] = 0;
+		}
+#endif
+		return p;
+	}
+
+	inline void unmap_memory(void* p, std::size_t size)
+	{
+#if defined(BOOST_WINDOWS)
+		(void)size;
+		::VirtualFree(p, 0, MEM_RELEASE);
+#else
+		::munmap(p, size);
+#endif
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Allocations below min_mapping_bytes go to the regular heap; mapping
+// small tables wastes address space and makes every small vector growth
+// a system call.
+template<typename T>
+class mapped_allocator
+{
+public:
+
+	typedef T value_type;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef mapped_allocator<U> other;
+	};
+
+	static std::size_t const min_mapping_bytes = 256 * 1024;
+
+	explicit mapped_allocator(unsigned flags = mapping_flags::huge_pages) BOOST_NOEXCEPT
+		: flags_(flags)
+	{}
+
+	template<typename U>
+	mapped_allocator(mapped_allocator<U> const& other) BOOST_NOEXCEPT
+		: flags_(other.flags())
+	{}
+
+	T* allocate(std::size_t n)
+	{
+		std::size_t const bytes = n * sizeof(T);
+		if(bytes < min_mapping_bytes)
+			return static_cast<T*>(::operator new(bytes));
+
+		return static_cast<T*>(
+			detail::map_memory(detail::mapping_size(bytes, flags_), flags_)
+		);
+	}
+
+	void deallocate(T* p, std::size_t n)
+	{
+		std::size_t const bytes = n * sizeof(T);
+		if(bytes < min_mapping_bytes)
+			::operator delete(p);
+		else
+			detail::unmap_memory(p, detail::mapping_size(bytes, flags_));
+	}
+
+	unsigned flags() const BOOST_NOEXCEPT
+	{
+		return flags_;
+	}
+
+	template<typename U>
+	bool operator==(mapped_allocator<U> const& rhs) const BOOST_NOEXCEPT
+	{
+		return flags_ == rhs.flags();
+	}
+
+	template<typename U>
+	bool operator!=(mapped_allocator<U> const& rhs) const BOOST_NOEXCEPT
+	{
+		return !(*this == rhs);
+	}
+
+private:
+
+	unsigned flags_;
+};
+
+} } // namespace entity { namespace support {
+
+#endif // ENTITY_SUPPORT_MAPPEDALLOCATOR_H_INCLUDED_
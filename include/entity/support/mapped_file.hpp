@@ -0,0 +1,138 @@
+// ****************************************************************************
+// entity/support/mapped_file.hpp
+//
+// Maps a whole file read-only into memory.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SUPPORT_MAPPEDFILE_H_INCLUDED_
+#define ENTITY_SUPPORT_MAPPEDFILE_H_INCLUDED_
+
+#include <boost/config.hpp>
+#include <boost/throw_exception.hpp>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#if defined(BOOST_WINDOWS)
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include "entity/config.hpp" // IWYU pragma: keep
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace support {
+
+class mapped_file
+{
+public:
+
+	explicit mapped_file(char const* path)
+		: data_(nullptr)
+		, size_(0)
+	{
+#if defined(BOOST_WINDOWS)
+		HANDLE file = ::CreateFileA(
+			path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if(file == INVALID_HANDLE_VALUE)
+			fail(path);
+
+		LARGE_INTEGER size;
+		::GetFileSizeEx(file, &size);
+		size_ = static_cast<std::size_t>(size.QuadPart);
+
+		HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		::CloseHandle(file);
+		if(!mapping)
+			fail(path);
+
+		data_ = static_cast<char const*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		::CloseHandle(mapping);
+		if(!data_)
+			fail(path);
+#else
+		int fd = ::open(path, O_RDONLY);
+		if(fd < 0)
+			fail(path);
+
+		struct stat info;
+		if(::fstat(fd, &info) != 0)
+		{
+			::close(fd);
+			fail(path);
+		}
+
+		size_ = static_cast<std::size_t>(info.st_size);
+		if(size_)
+		{
+			void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(p == MAP_FAILED)
+			{
+				::close(fd);
+				fail(path);
+			}
+
+			data_ = static_cast<char const*>(p);
+		}
+
+		::close(fd);
+#endif
+	}
+
+	~mapped_file()
+	{
+		if(!data_)
+			return;
+#if defined(BOOST_WINDOWS)
+		::UnmapViewOfFile(data_);
+#else
+		::munmap(const_cast<char*>(data_), size_);
+#endif
+	}
+
+	char const* data() const
+	{
+		return data_;
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+private:
+
+	// No copying.
+	mapped_file(mapped_file const&);
+	mapped_file operator=(mapped_file);
+
+	static void fail(char const* path)
+	{
+		BOOST_THROW_EXCEPTION(
+			std::runtime_error(std::string("Failed to map file ") + path)
+		);
+	}
+
+	char const* data_;
+	std::size_t size_;
+};
+
+} } // namespace entity { namespace support {
+
+#endif // ENTITY_SUPPORT_MAPPEDFILE_H_INCLUDED_
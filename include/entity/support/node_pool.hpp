@@ -0,0 +1,243 @@
+// ****************************************************************************
+// entity/support/node_pool.hpp
+//
+// A simple segregated storage pool of fixed size nodes, similar to
+// boost::pool<> but drawing its blocks from a standard allocator.
+// Node addresses are stable for the lifetime of the node.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SUPPORT_NODEPOOL_H_INCLUDED_
+#define ENTITY_SUPPORT_NODEPOOL_H_INCLUDED_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/profile.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace support {
+
+template<typename T, typename Allocator = std::allocator<T>>
+class node_pool
+{
+	union node
+	{
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type value_;
+		node* next_;
+	};
+
+	typedef typename std::allocator_traits<
+		Allocator
+	>::template rebind_alloc<node> node_allocator_type;
+
+	typedef std::allocator_traits<node_allocator_type> node_traits;
+
+	typedef std::pair<node*, std::size_t> block_type;
+
+	typedef typename std::allocator_traits<
+		Allocator
+	>::template rebind_alloc<block_type> block_allocator_type;
+
+	typedef typename std::allocator_traits<
+		Allocator
+	>::template rebind_alloc<std::size_t> count_allocator_type;
+
+public:
+
+	typedef Allocator allocator_type;
+
+	explicit node_pool(std::size_t first_block_size, Allocator const& alloc = Allocator())
+		: allocator_(alloc)
+		, blocks_(block_allocator_type(alloc))
+		, free_list_(nullptr)
+		, first_block_size_(first_block_size ? first_block_size : 1)
+		, next_block_size_(first_block_size_)
+		, capacity_(0)
+	{}
+
+	~node_pool()
+	{
+		release_memory();
+	}
+
+	// Returns uninitialised storage for one T.
+	void* malloc()
+	{
+		if(!free_list_)
+			add_block();
+
+		node* n = free_list_;
+		free_list_ = n->next_;
+		return n;
+	}
+
+	void free(void* p)
+	{
+		node* n = static_cast<node*>(p);
+		n->next_ = free_list_;
+		free_list_ = n;
+	}
+
+	// Frees every block.  Any outstanding nodes become invalid.
+	void release_memory()
+	{
+		for(auto&& b : blocks_)
+		{
+			node_traits::deallocate(allocator_, b.first, b.second);
+		}
+
+		blocks_.clear();
+		free_list_ = nullptr;
+		capacity_ = 0;
+	}
+
+	// Frees every block that has no nodes in use.  This walks the whole
+	// free list so is O(capacity), but never moves a live node.
+	// Returns the number of nodes released.
+	std::size_t release_free_blocks()
+	{
+		std::sort(blocks_.begin(), blocks_.end(), 
+			[](block_type const& a, block_type const& b)
+			{
+				return std::less<node*>()(a.first, b.first);
+			}
+		);
+
+		std::vector<std::size_t, count_allocator_type> free_counts(
+			blocks_.size(), 0, count_allocator_type(allocator_)
+		);
+		for(node* n = free_list_; n; n = n->next_)
+		{
+			++free_counts[find_block(n)];
+		}
+
+		node* old_free_list = free_list_;
+		free_list_ = nullptr;
+		for(node* n = old_free_list; n;)
+		{
+			node* next = n->next_;
+			std::size_t const b = find_block(n);
+			if(free_counts[b] != blocks_[b].second)
+			{
+				n->next_ = free_list_;
+				free_list_ = n;
+			}
+			n = next;
+		}
+
+		std::size_t released = 0;
+		std::size_t kept = 0;
+		for(std::size_t i = 0; i < blocks_.size(); ++i)
+		{
+			if(free_counts[i] == blocks_[i].second)
+			{
+				node_traits::deallocate(allocator_, blocks_[i].first, blocks_[i].second);
+				released += blocks_[i].second;
+			}
+			else
+			{
+				blocks_[kept++] = blocks_[i];
+			}
+		}
+
+		blocks_.resize(kept);
+		capacity_ -= released;
+		next_block_size_ = std::max(first_block_size_, capacity_);
+		return released;
+	}
+
+	// Makes room for count nodes in all, used or free, in one block, so
+	// the next count - capacity() mallocs don't allocate.
+	void reserve(std::size_t count)
+	{
+		if(count > capacity_)
+			add_block(count - capacity_);
+	}
+
+	// Number of nodes held across all blocks, used or free.
+	std::size_t capacity() const
+	{
+		return capacity_;
+	}
+
+	// Bytes used by the list of blocks itself.
+	std::size_t overhead_bytes() const
+	{
+		return blocks_.capacity() * sizeof(block_type);
+	}
+
+	static std::size_t node_size()
+	{
+		return sizeof(node);
+	}
+
+	allocator_type get_allocator() const
+	{
+		return allocator_type(allocator_);
+	}
+
+private:
+
+	// No copying.
+	node_pool(node_pool const&);
+	node_pool operator=(node_pool);
+
+	// Requires blocks_ to be sorted by address.
+	std::size_t find_block(node* n) const
+	{
+		auto i = std::upper_bound(blocks_.begin(), blocks_.end(), n,
+			[](node* p, block_type const& b)
+			{
+				return std::less<node*>()(p, b.first);
+			}
+		);
+
+		return static_cast<std::size_t>(i - blocks_.begin()) - 1;
+	}
+
+	void add_block()
+	{
+		add_block(next_block_size_);
+		next_block_size_ *= 2;
+	}
+
+	void add_block(std::size_t count)
+	{
+		ENTITY_PROFILE_ZONE("node_pool::add_block");
+		node* block = std::addressof(*node_traits::allocate(allocator_, count));
+		blocks_.emplace_back(block, count);
+
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			block[i].next_ = (i + 1) < count ? &block[i + 1] : free_list_;
+		}
+
+		free_list_ = block;
+		capacity_ += count;
+	}
+
+	node_allocator_type allocator_;
+	std::vector<block_type, block_allocator_type> blocks_;
+	node* free_list_;
+	std::size_t first_block_size_;
+	std::size_t next_block_size_;
+	std::size_t capacity_;
+};
+
+} } // namespace entity { namespace support {
+
+#endif // ENTITY_SUPPORT_NODEPOOL_H_INCLUDED_
@@ -0,0 +1,466 @@
+// ****************************************************************************
+// entity/support/numa.hpp
+//
+// NUMA placement for pool storage and the threads that iterate it.
+//
+// numa_allocator maps blocks like mapped_allocator and binds them in
+// fixed size stripes, round robin across the nodes with memory, so stripe
+// j of every block lives on the (j % node_count)th of numa_nodes().  Node
+// ids need not be contiguous; memoryless and offline nodes are skipped.
+// Binding is done with mbind before the pages are touched, so it holds no
+// matter which thread first writes the memory or copies it in when a pool
+// grows.  If the kernel refuses the binding, as it does in containers
+// whose seccomp profile blocks mbind, allocate throws rather than leave
+// the memory wherever it lands.
+//
+// numa_workers keeps threads pinned to each node's CPUs and splits an
+// index range along the same stripes, so every element is processed by a
+// thread on the node that holds it.
+//
+// Where the platform doesn't expose NUMA there is a single node, nothing
+// is bound and the workers are unpinned.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_SUPPORT_NUMA_H_INCLUDED_
+#define ENTITY_SUPPORT_NUMA_H_INCLUDED_
+
+#include <boost/config.hpp>
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#  include <pthread.h>
+#  include <sched.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/profile.hpp"
+#include "entity/support/mapped_allocator.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity { namespace support {
+
+namespace detail
+{
+	// ------------------------------------------------------------------------
+	// Parses a sysfs cpu or node list such as "0-3,8-11".
+	inline std::vector<int> read_sysfs_list(char const* path)
+	{
+		std::vector<int> result;
+#if defined(__linux__)
+		std::FILE* f = std::fopen(path, "r");
+		if(!f)
+			return result;
+
+		int first;
+		while(std::fscanf(f, "%d", &first) == 1)
+		{
+			int last = first;
+			int c = std::fgetc(f);
+			if(c == '-')
+			{
+				if(std::fscanf(f, "%d", &last) != 1)
+					break;
+				c = std::fgetc(f);
+			}
+
+			for(int i = first; i <= last; ++i)
+				result.push_back(i);
+
+			if(c != ',')
+				break;
+		}
+
+		std::fclose(f);
+#else
+		(void)path;
+#endif
+		return result;
+	}
+
+	// Returns false if the kernel refused the binding.
+	inline bool bind_to_node(void* p, std::size_t size, int node)
+	{
+#if defined(__linux__) && defined(SYS_mbind)
+		// MPOL_PREFERRED falls back to other nodes rather than failing the
+		// fault when the node runs out of memory.
+		int const mpol_preferred = 1;
+		std::size_t const bits = sizeof(unsigned long) * 8;
+		if(node < 0)
+			return false;
+
+		std::vector<unsigned long> mask(std::size_t(node) / bits + 1, 0);
+		mask[std::size_t(node) / bits] = 1ul << (std::size_t(node) % bits);
+		return ::syscall(
+			SYS_mbind, p, size, mpol_preferred, mask.data(), mask.size() * bits + 1, 0
+		) == 0;
+#else
+		(void)p;
+		(void)size;
+		(void)node;
+		return true;
+#endif
+	}
+
+	inline void pin_current_thread(std::vector<int> const& cpus)
+	{
+#if defined(__linux__)
+		if(cpus.empty())
+			return;
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for(int cpu : cpus)
+		{
+			if(cpu < CPU_SETSIZE)
+				CPU_SET(cpu, &set);
+		}
+
+		::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+#else
+		(void)cpus;
+#endif
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Ids of the nodes with memory, in ascending order; { 0 } where the
+// platform doesn't say.
+inline std::vector<int> const& numa_nodes()
+{
+	static std::vector<int> const nodes = []
+	{
+		std::vector<int> result =
+			detail::read_sysfs_list("/sys/devices/system/node/has_memory");
+		if(result.empty())
+			result = detail::read_sysfs_list("/sys/devices/system/node/online");
+		if(result.empty())
+			result.push_back(0);
+		return result;
+	}();
+
+	return nodes;
+}
+
+inline int numa_node_count()
+{
+	return static_cast<int>(numa_nodes().size());
+}
+
+// CPUs belonging to node, empty if unknown.
+inline std::vector<int> numa_node_cpus(int node)
+{
+	char path[64];
+	std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+	return detail::read_sysfs_list(path);
+}
+
+// ----------------------------------------------------------------------------
+// Allocations below min_mapping_bytes go to the regular heap, as with
+// mapped_allocator, and aren't bound.  Stripes should be a multiple of the
+// page size, and of the huge page size when using huge pages.
+template<typename T>
+class numa_allocator
+{
+public:
+
+	typedef T value_type;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef numa_allocator<U> other;
+	};
+
+	static std::size_t const min_mapping_bytes = mapped_allocator<T>::min_mapping_bytes;
+
+	explicit numa_allocator(
+		std::size_t stripe_bytes = detail::huge_page_size,
+		unsigned flags = mapping_flags::huge_pages)
+		: stripe_bytes_(stripe_bytes)
+		, node_count_(numa_node_count())
+		, flags_(flags)
+	{
+		if(stripe_bytes_ == 0 || stripe_bytes_ % 4096 != 0)
+		{
+			BOOST_THROW_EXCEPTION(
+				std::invalid_argument("Stripe size must be a multiple of the page size.")
+			);
+		}
+	}
+
+	template<typename U>
+	numa_allocator(numa_allocator<U> const& other) BOOST_NOEXCEPT
+		: stripe_bytes_(other.stripe_bytes())
+		, node_count_(other.node_count())
+		, flags_(other.flags())
+	{}
+
+	T* allocate(std::size_t n)
+	{
+		std::size_t const bytes = n * sizeof(T);
+		if(bytes < min_mapping_bytes)
+			return static_cast<T*>(::operator new(bytes));
+
+		std::size_t const size = detail::mapping_size(bytes, flags_);
+
+		// Bind before prefaulting so the committed pages land in place.
+		void* p = detail::map_memory(size, flags_ & ~mapping_flags::prefault);
+		if(node_count_ > 1)
+		{
+			char* stripe = static_cast<char*>(p);
+			for(std::size_t offset = 0; offset < size; offset += stripe_bytes_)
+			{
+				bool const bound = detail::bind_to_node(
+					stripe + offset,
+					(std::min)(stripe_bytes_, size - offset),
+					node_of_offset(offset)
+				);
+
+				if(!bound)
+				{
+					detail::unmap_memory(p, size);
+					BOOST_THROW_EXCEPTION(
+						std::runtime_error("Failed to bind memory to its NUMA node.")
+					);
+				}
+			}
+		}
+
+		if(flags_ & mapping_flags::prefault)
+		{
+			for(std::size_t i = 0; i < size; i += 4096)
+				static_cast<volatile char*>(p)[i] = 0;
+		}
+
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T* p, std::size_t n)
+	{
+		std::size_t const bytes = n * sizeof(T);
+		if(bytes < min_mapping_bytes)
+			::operator delete(p);
+		else
+			detail::unmap_memory(p, detail::mapping_size(bytes, flags_));
+	}
+
+	// Id of the node holding the byte at offset from the start of a block.
+	int node_of_offset(std::size_t offset) const BOOST_NOEXCEPT
+	{
+		return numa_nodes()[(offset / stripe_bytes_) % node_count_];
+	}
+
+	std::size_t stripe_bytes() const BOOST_NOEXCEPT
+	{
+		return stripe_bytes_;
+	}
+
+	int node_count() const BOOST_NOEXCEPT
+	{
+		return node_count_;
+	}
+
+	unsigned flags() const BOOST_NOEXCEPT
+	{
+		return flags_;
+	}
+
+	template<typename U>
+	bool operator==(numa_allocator<U> const& rhs) const BOOST_NOEXCEPT
+	{
+		return stripe_bytes_ == rhs.stripe_bytes() &&
+			node_count_ == rhs.node_count() &&
+			flags_ == rhs.flags();
+	}
+
+	template<typename U>
+	bool operator!=(numa_allocator<U> const& rhs) const BOOST_NOEXCEPT
+	{
+		return !(*this == rhs);
+	}
+
+private:
+
+	std::size_t stripe_bytes_;
+	int node_count_;
+	unsigned flags_;
+};
+
+// ----------------------------------------------------------------------------
+// Threads pinned to each node, for iterating storage placed by a
+// numa_allocator.  for_each_range is called from one thread at a time and
+// blocks until every range is done.
+class numa_workers
+{
+public:
+
+	explicit numa_workers(int threads_per_node = 1)
+		: node_count_(numa_node_count())
+		, threads_per_node_((std::max)(threads_per_node, 1))
+		, stripe_bytes_(0)
+		, element_size_(0)
+		, count_(0)
+		, generation_(0)
+		, busy_(0)
+		, stopping_(false)
+	{
+		// Workers count nodes by their position in numa_nodes(), as the
+		// stripes do, and pin to the CPUs of the node with that id.
+		for(int node = 0; node < node_count_; ++node)
+		{
+			std::vector<int> const cpus = numa_node_cpus(numa_nodes()[node]);
+			for(int i = 0; i < threads_per_node_; ++i)
+			{
+				threads_.emplace_back(
+					[this, node, i, cpus]
+					{
+						detail::pin_current_thread(cpus);
+						run(node, i);
+					}
+				);
+			}
+		}
+	}
+
+	~numa_workers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+
+		wake_.notify_all();
+		for(auto&& t : threads_)
+			t.join();
+	}
+
+	// Calls f(first, last) over [0, count) for elements of a block from
+	// alloc, each range on a thread of the node that holds it.
+	template<typename T, typename F>
+	void for_each_range(numa_allocator<T> const& alloc, std::size_t count, F f)
+	{
+		ENTITY_PROFILE_ZONE("numa_workers::for_each_range");
+		if(count == 0)
+			return;
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		stripe_bytes_ = alloc.stripe_bytes();
+		element_size_ = sizeof(T);
+		count_ = count;
+		error_ = nullptr;
+		task_ = std::ref(f);
+		busy_ = threads_.size();
+		++generation_;
+		wake_.notify_all();
+		done_.wait(lock, [this] { return busy_ == 0; });
+		task_ = nullptr;
+
+		if(error_)
+			std::rethrow_exception(error_);
+	}
+
+	int node_count() const
+	{
+		return node_count_;
+	}
+
+	std::size_t thread_count() const
+	{
+		return threads_.size();
+	}
+
+private:
+
+	// No copying
+	numa_workers(numa_workers const&);
+	numa_workers operator=(numa_workers const&);
+
+	void run(int node, int lane)
+	{
+		std::size_t seen = 0;
+		for(;;)
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this, seen] { return stopping_ || generation_ != seen; });
+			if(stopping_)
+				return;
+
+			seen = generation_;
+			std::size_t const stripe_bytes = stripe_bytes_;
+			std::size_t const element_size = element_size_;
+			std::size_t const count = count_;
+			lock.unlock();
+
+			// Stripe j lives on the (j % node_count)th node; the threads on
+			// that node take turns at its stripes.
+			std::exception_ptr error;
+			std::size_t const stride = std::size_t(node_count_) * threads_per_node_;
+			std::size_t const bytes = count * element_size;
+			try
+			{
+				for(std::size_t j = std::size_t(node) + std::size_t(lane) * node_count_;
+					j * stripe_bytes < bytes; j += stride)
+				{
+					std::size_t const first = (j * stripe_bytes + element_size - 1) / element_size;
+					std::size_t const last = (std::min)(
+						((j + 1) * stripe_bytes + element_size - 1) / element_size,
+						count
+					);
+
+					if(first < last)
+						task_(first, last);
+				}
+			}
+			catch(...)
+			{
+				error = std::current_exception();
+			}
+
+			lock.lock();
+			if(error && !error_)
+				error_ = error;
+
+			if(--busy_ == 0)
+				done_.notify_one();
+		}
+	}
+
+	int node_count_;
+	int threads_per_node_;
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	std::function<void(std::size_t, std::size_t)> task_;
+	std::exception_ptr error_;
+	std::size_t stripe_bytes_;
+	std::size_t element_size_;
+	std::size_t count_;
+	std::size_t generation_;
+	std::size_t busy_;
+	bool stopping_;
+};
+
+} } // namespace entity { namespace support {
+
+#endif // ENTITY_SUPPORT_NUMA_H_INCLUDED_
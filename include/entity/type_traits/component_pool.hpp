@@ -12,6 +12,10 @@
 #ifndef ENTITY_TYPETRAITS_COMPONENTPOOL_H_INCLUDED_
 #define ENTITY_TYPETRAITS_COMPONENTPOOL_H_INCLUDED_
 
+#include <type_traits>
+
+#include "entity/component/required.hpp"
+
 namespace entity { namespace type_traits {
 
 template<typename ComponentPool>
@@ -26,6 +30,19 @@ struct optional_type_of_pool<ComponentPool const>
 	typedef typename ComponentPool::const_optional_type type;
 };
 
+// Pools that hold a component for every entity.
+template<typename ComponentPool>
+struct is_saturated_pool
+	: std::is_same<
+		typename ComponentPool::optional_type,
+		component::required<typename ComponentPool::type>
+	>
+{};
+
+template<typename ComponentPool>
+struct is_saturated_pool<ComponentPool const>
+	: is_saturated_pool<ComponentPool>
+{};
 
 } } // namespace entity { namespace type_traits {
 #endif // ENTITY_TYPETRAITS_COMPONENTPOOL_H_INCLUDED_
\ No newline at end of file
@@ -0,0 +1,1075 @@
+// ****************************************************************************
+// entity/world.hpp
+//
+// A set of entities together with a fixed list of component pools, all
+// known at compile time.
+//
+// The world keeps the entities itself and tells each pool about creates,
+// destroys and swaps with direct calls, so there are no signals or
+// function objects between them and the compiler can inline the whole
+// sequence.  The pools are constructed against a private entity_pool that
+// is never used, which keeps their ordinary constructors working.
+//
+// The entities themselves are just a count, not an entity_pool, so a world
+// offers create(), destroy(), size() and iteration and none of the rest of
+// entity_pool: no shared_entity handles, no creation or destruction queues
+// (they hook an entity_pool's signals), no reserve(), compact() or
+// shrink steps for the entity list and no snapshots.  Each pool's own
+// reserve and shrink calls still work through pool<C>().  The world keeps
+// its own enabled bits for enable() and disable(), as entity_pool does.
+//
+// view<A, B const>() iterates the entities holding every listed component.
+// Components are named by their value type or by their pool type.  When a
+// view includes pools that list their own entities, the smallest of them
+// drives the walk through its packed storage and the rest are looked up
+// per entity, so a view over a sparse or hashed pool costs what that pool
+// holds rather than what the world holds.  Views of only saturated pools
+// walk their storage in step and never test for presence.  Views skip
+// disabled entities; begin() and end() still visit every entity.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+#ifndef ENTITY_WORLD_H_INCLUDED_
+#define ENTITY_WORLD_H_INCLUDED_
+
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <initializer_list>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "entity/config.hpp" // IWYU pragma: keep
+#include "entity/component/lifecycle_access.hpp"
+#include "entity/entity.hpp"
+#include "entity/entity_index.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/profile.hpp"
+#include "entity/support/index_sequence.hpp"
+#include "entity/type_traits/component_pool.hpp"
+
+// ----------------------------------------------------------------------------
+//
+namespace entity
+{
+	namespace detail
+	{
+		// Index of the first pool that is, or holds, Component.  Equals
+		// the number of pools if there is none.
+		template<typename Component, typename... Pools>
+		struct pool_index_of
+			: std::integral_constant<std::size_t, 0>
+		{};
+
+		template<typename Component, typename Pool, typename... Rest>
+		struct pool_index_of<Component, Pool, Rest...>
+			: std::integral_constant<
+				std::size_t,
+				std::is_same<Component, Pool>::value ||
+				std::is_same<Component, typename Pool::type>::value
+					? 0
+					: 1 + pool_index_of<Component, Rest...>::value
+			>
+		{};
+
+		// --------------------------------------------------------------------
+		// How a view walks one pool.  A const Pool only makes the
+		// references const; the walk itself uses the mutable iterators.
+		template<
+			typename Pool,
+			bool Saturated = type_traits::is_saturated_pool<Pool>::value>
+		struct view_cursor
+		{
+			typedef typename std::remove_const<Pool>::type pool_type;
+			typedef typename pool_type::optional_iterator iterator;
+
+			typedef typename std::conditional<
+				std::is_const<Pool>::value,
+				typename Pool::type const&,
+				typename Pool::type&
+			>::type reference;
+
+			static iterator begin(pool_type& pool)
+			{
+				return pool.optional_begin();
+			}
+
+			static bool present(iterator const& i)
+			{
+				return static_cast<bool>(*i);
+			}
+
+			static reference get(iterator const& i)
+			{
+				return *(*i);
+			}
+		};
+
+		template<typename Pool>
+		struct view_cursor<Pool, true>
+		{
+			typedef typename std::remove_const<Pool>::type pool_type;
+			typedef typename pool_type::iterator iterator;
+
+			typedef typename std::conditional<
+				std::is_const<Pool>::value,
+				typename Pool::type const&,
+				typename Pool::type&
+			>::type reference;
+
+			static iterator begin(pool_type& pool)
+			{
+				return pool.begin();
+			}
+
+			static BOOST_CONSTEXPR bool present(iterator const&)
+			{
+				return true;
+			}
+
+			static reference get(iterator const& i)
+			{
+				return *i;
+			}
+		};
+
+		// --------------------------------------------------------------------
+		// Pools whose iterators name the entity they're on can drive a view
+		// from their own storage.  Saturated pools could, but gain nothing
+		// over the plain walk.
+		struct no_driver
+		{
+			bool operator==(no_driver const&) const
+			{
+				return true;
+			}
+		};
+
+		template<typename Pool, typename = void>
+		struct view_driver
+		{
+			static BOOST_CONSTEXPR_OR_CONST bool value = false;
+			typedef no_driver iterator;
+
+			template<typename P>
+			static iterator begin(P&)
+			{
+				return iterator();
+			}
+
+			template<typename P>
+			static iterator end(P&)
+			{
+				return iterator();
+			}
+		};
+
+		template<typename Pool>
+		struct view_driver<
+			Pool,
+			decltype((void)std::declval<
+				typename std::remove_const<Pool>::type::iterator const&
+			>().get_entity())
+		>
+		{
+			typedef typename std::remove_const<Pool>::type pool_type;
+			typedef typename pool_type::iterator iterator;
+
+			static BOOST_CONSTEXPR_OR_CONST bool value =
+				!type_traits::is_saturated_pool<pool_type>::value;
+
+			static iterator begin(pool_type& pool)
+			{
+				return pool.begin();
+			}
+
+			static iterator end(pool_type& pool)
+			{
+				return pool.end();
+			}
+		};
+
+		// Whether idx is set in a view's enabled bits, 64 to a word.  Null
+		// bits enable every entity, so views skip the test when nothing is
+		// disabled.
+		inline bool view_enabled(std::uint64_t const* enabled, entity_index_t idx)
+		{
+			return !enabled || ((enabled[idx / 64] >> (idx % 64)) & 1) != 0;
+		}
+
+		template<bool... Values>
+		struct bool_pack;
+
+		template<bool... Values>
+		struct any_of
+			: std::integral_constant<
+				bool,
+				!std::is_same<
+					bool_pack<false, Values...>,
+					bool_pack<Values..., false>
+				>::value
+			>
+		{};
+
+		// ------------------------------------------------------------------------
+		// The entities holding a component in every one of Pools, in index
+		// order, found by walking every pool in step.
+		template<typename... Pools>
+		class walked_view;
+
+		// The entities holding a component in every one of Pools, in the
+		// order of the smallest pool able to drive the walk.
+		template<typename... Pools>
+		class driven_view;
+	}
+
+	// ------------------------------------------------------------------------
+	// Dereferencing a view's iterator gives a tuple of references.
+	template<typename... Pools>
+	using view = typename std::conditional<
+		detail::any_of<detail::view_driver<Pools>::value...>::value,
+		detail::driven_view<Pools...>,
+		detail::walked_view<Pools...>
+	>::type;
+
+	namespace detail
+	{
+	template<typename... Pools>
+	class walked_view
+	{
+	private:
+
+		typedef std::tuple<
+			typename detail::view_cursor<Pools>::iterator...
+		> cursor_tuple;
+
+		typedef std::tuple<
+			typename detail::view_cursor<Pools>::reference...
+		> reference_tuple;
+
+	public:
+
+		class iterator
+			: public boost::iterator_facade<
+			    iterator
+			  , reference_tuple
+			  , boost::forward_traversal_tag
+			  , reference_tuple
+			>
+		{
+		public:
+
+			entity get_entity() const
+			{
+				return make_entity(idx_);
+			}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class walked_view;
+
+			iterator(
+				cursor_tuple cursors,
+				entity_index_t idx,
+				entity_index_t last,
+				std::uint64_t const* enabled)
+				: cursors_(cursors)
+				, idx_(idx)
+				, last_(last)
+				, enabled_(enabled)
+			{
+				skip_missing();
+			}
+
+			void increment()
+			{
+				advance(support::make_index_sequence<sizeof...(Pools)>());
+				++idx_;
+				skip_missing();
+			}
+
+			bool equal(iterator const& other) const
+			{
+				return idx_ == other.idx_;
+			}
+
+			reference_tuple dereference() const
+			{
+				return get(support::make_index_sequence<sizeof...(Pools)>());
+			}
+
+			void skip_missing()
+			{
+				while(idx_ != last_ &&
+					!(detail::view_enabled(enabled_, idx_) &&
+						present(support::make_index_sequence<sizeof...(Pools)>())))
+				{
+					advance(support::make_index_sequence<sizeof...(Pools)>());
+					++idx_;
+				}
+			}
+
+			template<std::size_t... Indices>
+			void advance(support::index_sequence<Indices...>)
+			{
+				(void)std::initializer_list<int>{
+					(++std::get<Indices>(cursors_), 0)...
+				};
+			}
+
+			template<std::size_t... Indices>
+			bool present(support::index_sequence<Indices...>) const
+			{
+				bool all = true;
+				(void)std::initializer_list<int>{
+					(all = all && detail::view_cursor<Pools>::present(
+						std::get<Indices>(cursors_)), 0)...
+				};
+				return all;
+			}
+
+			template<std::size_t... Indices>
+			reference_tuple get(support::index_sequence<Indices...>) const
+			{
+				return reference_tuple(
+					detail::view_cursor<Pools>::get(std::get<Indices>(cursors_))...
+				);
+			}
+
+			cursor_tuple cursors_;
+			entity_index_t idx_;
+			entity_index_t last_;
+			std::uint64_t const* enabled_;
+		};
+
+		walked_view(
+			std::size_t entity_count,
+			std::uint64_t const* enabled,
+			typename detail::view_cursor<Pools>::pool_type&... pools)
+			: cursors_(detail::view_cursor<Pools>::begin(pools)...)
+			, count_(static_cast<entity_index_t>(entity_count))
+			, enabled_(enabled)
+		{}
+
+		iterator begin() const
+		{
+			return iterator(cursors_, 0, count_, enabled_);
+		}
+
+		iterator end() const
+		{
+			return iterator(cursors_, count_, count_, enabled_);
+		}
+
+		// Calls f with a reference to each component of every entity in
+		// the view.
+		template<typename F>
+		void for_each(F f) const
+		{
+			if(BOOST_LIKELY(!enabled_))
+				walk(f, std::false_type());
+			else
+				walk(f, std::true_type());
+		}
+
+	private:
+
+		// Tests the enabled bits only when some entity is disabled.  Both
+		// loops are forced inline; calling the filtered one out of line
+		// lets f's captures escape and slows the unfiltered loop too.
+		template<typename F, bool Filtered>
+		BOOST_FORCEINLINE void walk(F& f, std::integral_constant<bool, Filtered>) const
+		{
+			// The end iterator skips nothing, so borrow its cursor helpers
+			// and walk the cursors from the start.
+			iterator i = end();
+			i.cursors_ = cursors_;
+			for(entity_index_t idx = 0; idx != count_; ++idx, i.advance(support::make_index_sequence<sizeof...(Pools)>()))
+			{
+				if((!Filtered || detail::view_enabled(enabled_, idx)) &&
+					i.present(support::make_index_sequence<sizeof...(Pools)>()))
+				{
+					call(f, i, support::make_index_sequence<sizeof...(Pools)>());
+				}
+			}
+		}
+
+		template<typename F, std::size_t... Indices>
+		static void call(F& f, iterator const& i, support::index_sequence<Indices...>)
+		{
+			f(detail::view_cursor<Pools>::get(std::get<Indices>(i.cursors_))...);
+		}
+
+		cursor_tuple cursors_;
+		entity_index_t count_;
+		std::uint64_t const* enabled_;
+	};
+
+	// ------------------------------------------------------------------------
+	//
+	template<typename... Pools>
+	class driven_view
+	{
+	private:
+
+		typedef std::tuple<
+			typename detail::view_cursor<Pools>::pool_type*...
+		> pool_tuple;
+
+		typedef std::tuple<
+			typename detail::view_driver<Pools>::iterator...
+		> driver_tuple;
+
+		typedef std::tuple<
+			typename std::remove_reference<
+				typename detail::view_cursor<Pools>::reference
+			>::type*...
+		> pointer_tuple;
+
+		typedef std::tuple<
+			typename detail::view_cursor<Pools>::reference...
+		> reference_tuple;
+
+	public:
+
+		class iterator
+			: public boost::iterator_facade<
+			    iterator
+			  , reference_tuple
+			  , boost::forward_traversal_tag
+			  , reference_tuple
+			>
+		{
+		public:
+
+			entity get_entity() const
+			{
+				return entity_;
+			}
+
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class driven_view;
+
+			iterator(driven_view const* parent, driver_tuple drivers)
+				: parent_(parent)
+				, drivers_(drivers)
+				, entity_(make_entity(0))
+			{
+				skip_missing();
+			}
+
+			void increment()
+			{
+				step(support::make_index_sequence<sizeof...(Pools)>());
+				skip_missing();
+			}
+
+			bool equal(iterator const& other) const
+			{
+				return same(other, support::make_index_sequence<sizeof...(Pools)>());
+			}
+
+			reference_tuple dereference() const
+			{
+				return get(support::make_index_sequence<sizeof...(Pools)>());
+			}
+
+			void skip_missing()
+			{
+				while(!at_end(support::make_index_sequence<sizeof...(Pools)>()))
+				{
+					entity_ = driver_entity(support::make_index_sequence<sizeof...(Pools)>());
+					if(detail::view_enabled(parent_->enabled_, entity_.index()) &&
+						look_up(support::make_index_sequence<sizeof...(Pools)>()))
+					{
+						return;
+					}
+
+					step(support::make_index_sequence<sizeof...(Pools)>());
+				}
+			}
+
+			template<std::size_t... Indices>
+			void step(support::index_sequence<Indices...>)
+			{
+				(void)std::initializer_list<int>{
+					(Indices == parent_->driver_ ? (advance(std::get<Indices>(drivers_)), 0) : 0)...
+				};
+			}
+
+			template<std::size_t... Indices>
+			bool at_end(support::index_sequence<Indices...>) const
+			{
+				bool result = false;
+				(void)std::initializer_list<int>{
+					(Indices == parent_->driver_
+						? (result = std::get<Indices>(drivers_) == std::get<Indices>(parent_->ends_), 0)
+						: 0)...
+				};
+				return result;
+			}
+
+			template<std::size_t... Indices>
+			bool same(iterator const& other, support::index_sequence<Indices...>) const
+			{
+				bool result = false;
+				(void)std::initializer_list<int>{
+					(Indices == parent_->driver_
+						? (result = std::get<Indices>(drivers_) == std::get<Indices>(other.drivers_), 0)
+						: 0)...
+				};
+				return result;
+			}
+
+			template<std::size_t... Indices>
+			entity driver_entity(support::index_sequence<Indices...>) const
+			{
+				entity e = make_entity(0);
+				(void)std::initializer_list<int>{
+					(Indices == parent_->driver_
+						? (e = entity_of(std::get<Indices>(drivers_)), 0)
+						: 0)...
+				};
+				return e;
+			}
+
+			template<std::size_t... Indices>
+			bool look_up(support::index_sequence<Indices...> indices)
+			{
+				bool found = false;
+				(void)std::initializer_list<int>{
+					(Indices == parent_->driver_
+						? (found = find_all<Indices>(
+							components_, parent_->pools_,
+							std::get<Indices>(drivers_), entity_, indices), 0)
+						: 0)...
+				};
+				return found;
+			}
+
+			template<std::size_t... Indices>
+			reference_tuple get(support::index_sequence<Indices...>) const
+			{
+				return reference_tuple(*std::get<Indices>(components_)...);
+			}
+
+			driven_view const* parent_;
+			driver_tuple drivers_;
+			pointer_tuple components_;
+			entity entity_;
+		};
+
+		driven_view(
+			std::size_t,
+			std::uint64_t const* enabled,
+			typename detail::view_cursor<Pools>::pool_type&... pools)
+			: pools_(&pools...)
+			, begins_(detail::view_driver<Pools>::begin(pools)...)
+			, ends_(detail::view_driver<Pools>::end(pools)...)
+			, driver_(0)
+			, enabled_(enabled)
+		{
+			std::size_t smallest = (std::numeric_limits<std::size_t>::max)();
+			choose_driver(smallest, support::make_index_sequence<sizeof...(Pools)>());
+		}
+
+		iterator begin() const
+		{
+			return iterator(this, begins_);
+		}
+
+		iterator end() const
+		{
+			return iterator(this, ends_);
+		}
+
+		// Calls f with a reference to each component of every entity in
+		// the view.
+		template<typename F>
+		void for_each(F f) const
+		{
+			ENTITY_PROFILE_ZONE("view::for_each");
+			for_each(f, support::make_index_sequence<sizeof...(Pools)>());
+		}
+
+		// Index of the pool driving the walk.
+		std::size_t driver() const
+		{
+			return driver_;
+		}
+
+	private:
+
+		template<std::size_t... Indices>
+		void choose_driver(std::size_t& smallest, support::index_sequence<Indices...>)
+		{
+			(void)std::initializer_list<int>{
+				(detail::view_driver<Pools>::value &&
+					std::get<Indices>(pools_)->size() < smallest
+						? (smallest = std::get<Indices>(pools_)->size(), driver_ = Indices, 0)
+						: 0)...
+			};
+		}
+
+		// Chooses the loop for the driver, and whether to test the
+		// enabled bits, once rather than per entity as the iterator has
+		// to.  Both loops are forced inline for the reason walked_view's
+		// are.
+		template<typename F, std::size_t... Indices>
+		BOOST_FORCEINLINE void for_each(F& f, support::index_sequence<Indices...> indices) const
+		{
+			if(BOOST_LIKELY(!enabled_))
+			{
+				(void)std::initializer_list<int>{
+					(Indices == driver_ ? (walk<Indices>(f, indices, std::false_type()), 0) : 0)...
+				};
+			}
+			else
+			{
+				(void)std::initializer_list<int>{
+					(Indices == driver_ ? (walk<Indices>(f, indices, std::true_type()), 0) : 0)...
+				};
+			}
+		}
+
+		template<std::size_t Driver, typename F, std::size_t... Indices, bool Filtered>
+		BOOST_FORCEINLINE void walk(
+			F& f,
+			support::index_sequence<Indices...> indices,
+			std::integral_constant<bool, Filtered>) const
+		{
+			pointer_tuple components;
+			for(auto i = std::get<Driver>(begins_), last = std::get<Driver>(ends_); !(i == last); advance(i))
+			{
+				entity const e = entity_of(i);
+				if((!Filtered || detail::view_enabled(enabled_, e.index())) &&
+					find_all<Driver>(components, pools_, i, e, indices))
+				{
+					f(*std::get<Indices>(components)...);
+				}
+			}
+		}
+
+		// Stops at the first pool without a component.
+		template<std::size_t Driver, typename Iterator, std::size_t... Indices>
+		static bool find_all(
+			pointer_tuple& components,
+			pool_tuple const& pools,
+			Iterator const& driver,
+			entity e,
+			support::index_sequence<Indices...>)
+		{
+			bool all = true;
+			(void)std::initializer_list<int>{
+				(all = all && find<Indices>(
+					components, pools, driver, e,
+					std::integral_constant<bool, Indices == Driver>()), 0)...
+			};
+			return all;
+		}
+
+		// The driver's component comes from its iterator, saving a second
+		// trip through the pool's index.
+		template<std::size_t Index, typename Iterator>
+		static bool find(
+			pointer_tuple& components,
+			pool_tuple const& pools,
+			Iterator const& driver,
+			entity e,
+			std::true_type)
+		{
+			typedef typename std::tuple_element<Index, pointer_tuple>::type pointer;
+			std::get<Index>(components) = from_driver<pointer>(driver, *std::get<Index>(pools), e, 0);
+			return std::get<Index>(components) != nullptr;
+		}
+
+		template<std::size_t Index, typename Iterator>
+		static bool find(
+			pointer_tuple& components,
+			pool_tuple const& pools,
+			Iterator const&,
+			entity e,
+			std::false_type)
+		{
+			std::get<Index>(components) = pointer_of(std::get<Index>(pools)->get(e));
+			return std::get<Index>(components) != nullptr;
+		}
+
+		template<typename Iterator>
+		static void advance(Iterator& i)
+		{
+			++i;
+		}
+
+		static void advance(detail::no_driver&)
+		{}
+
+		template<typename Iterator>
+		static entity entity_of(Iterator const& i)
+		{
+			return i.get_entity();
+		}
+
+		static entity entity_of(detail::no_driver const&)
+		{
+			return make_entity(0);
+		}
+
+		template<typename Optional>
+		static auto pointer_of(Optional c) -> decltype(&*c)
+		{
+			return !c ? nullptr : &*c;
+		}
+
+		template<typename Pointer, typename Iterator, typename Pool>
+		static auto from_driver(Iterator const& i, Pool&, entity, int)
+			-> decltype(static_cast<Pointer>(&*i))
+		{
+			return &*i;
+		}
+
+		// Tag pools iterate entities rather than components.
+		template<typename Pointer, typename Iterator, typename Pool>
+		static Pointer from_driver(Iterator const&, Pool& pool, entity e, long)
+		{
+			return pointer_of(pool.get(e));
+		}
+
+		pool_tuple pools_;
+		driver_tuple begins_;
+		driver_tuple ends_;
+		std::size_t driver_;
+		std::uint64_t const* enabled_;
+	};
+	}
+
+	// ------------------------------------------------------------------------
+	//
+	template<typename... Pools>
+	class world
+	{
+	private:
+
+		template<typename Component>
+		struct index_of
+			: detail::pool_index_of<
+				typename std::remove_const<Component>::type,
+				Pools...
+			>
+		{
+			static_assert(
+				index_of::value < sizeof...(Pools),
+				"No pool in the world holds this component."
+			);
+		};
+
+		template<typename Component>
+		struct pool_of
+		{
+			typedef typename std::tuple_element<
+				index_of<Component>::value,
+				std::tuple<Pools...>
+			>::type type;
+		};
+
+		// Keeps the const from view<A const>.
+		template<typename Component>
+		struct view_pool_of
+		{
+			typedef typename std::conditional<
+				std::is_const<Component>::value,
+				typename pool_of<Component>::type const,
+				typename pool_of<Component>::type
+			>::type type;
+		};
+
+		struct iterator_impl
+			  : boost::iterator_facade<
+			    iterator_impl
+			  , entity
+			  , boost::forward_traversal_tag
+			  , entity
+		  	>
+		{
+		private:
+
+			friend class boost::iterator_core_access;
+			friend class world;
+
+			iterator_impl(entity_index_t idx)
+				: iterator_(idx)
+			{}
+
+			void increment()
+			{
+				++iterator_;
+			}
+
+			bool equal(iterator_impl const& other) const
+			{
+				return iterator_ == other.iterator_;
+			}
+
+			entity dereference() const
+			{
+				return make_entity(iterator_);
+			}
+
+			entity_index_t iterator_;
+		};
+
+	public:
+
+		typedef iterator_impl iterator;
+		typedef iterator_impl const_iterator;
+
+		world()
+			: pools_(owner<Pools>(unused_)...)
+			, size_(0)
+			, disabled_count_(0)
+		{}
+
+		~world()
+		{
+			while(size_ > 0)
+			{
+				destroy(make_entity(static_cast<entity_index_t>(size_ - 1)));
+			}
+		}
+
+		entity create()
+		{
+			ENTITY_PROFILE_ZONE("world::create");
+			entity const e = make_entity(static_cast<entity_index_t>(size_));
+			++size_;
+			push_enabled();
+			dispatch_create(e, support::make_index_sequence<sizeof...(Pools)>());
+			return e;
+		}
+
+		// As with entity_pool, the last entity takes the place of the
+		// destroyed one.
+		void destroy(entity e)
+		{
+			ENTITY_PROFILE_ZONE("world::destroy");
+			BOOST_ASSERT(e.index() < size_ && "Trying to destroy an entity that doesn't exist.");
+			entity const last = make_entity(static_cast<entity_index_t>(size_ - 1));
+			if(e != last)
+			{
+				if(is_enabled(e) != is_enabled(last))
+				{
+					enabled_[e.index() / 64] ^= std::uint64_t(1) << (e.index() % 64);
+					enabled_[last.index() / 64] ^= std::uint64_t(1) << (last.index() % 64);
+				}
+
+				dispatch_swap(e, last, support::make_index_sequence<sizeof...(Pools)>());
+			}
+
+			dispatch_destroy(last, support::make_index_sequence<sizeof...(Pools)>());
+			--size_;
+			pop_enabled();
+		}
+
+		// As with entity_pool, disabled entities keep their components and
+		// are skipped by views.
+		void disable(entity e)
+		{
+			std::uint64_t& word = enabled_[e.index() / 64];
+			std::uint64_t const bit = std::uint64_t(1) << (e.index() % 64);
+			if(word & bit)
+			{
+				word &= ~bit;
+				++disabled_count_;
+			}
+		}
+
+		void enable(entity e)
+		{
+			std::uint64_t& word = enabled_[e.index() / 64];
+			std::uint64_t const bit = std::uint64_t(1) << (e.index() % 64);
+			if(!(word & bit))
+			{
+				word |= bit;
+				--disabled_count_;
+			}
+		}
+
+		bool is_enabled(entity e) const
+		{
+			return (enabled_[e.index() / 64] >> (e.index() % 64)) & 1;
+		}
+
+		std::size_t enabled_count() const
+		{
+			return size_ - disabled_count_;
+		}
+
+		std::size_t size() const
+		{
+			return size_;
+		}
+
+		bool empty() const
+		{
+			return size_ == 0;
+		}
+
+		iterator begin() const
+		{
+			return iterator_impl(0);
+		}
+
+		iterator end() const
+		{
+			return iterator_impl(static_cast<entity_index_t>(size_));
+		}
+
+		template<typename Component>
+		typename pool_of<Component>::type& pool()
+		{
+			return std::get<index_of<Component>::value>(pools_);
+		}
+
+		template<typename Component>
+		typename pool_of<Component>::type const& pool() const
+		{
+			return std::get<index_of<Component>::value>(pools_);
+		}
+
+		template<std::size_t Index>
+		typename std::tuple_element<Index, std::tuple<Pools...>>::type& pool()
+		{
+			return std::get<Index>(pools_);
+		}
+
+		template<typename Component, typename... Args>
+		typename pool_of<Component>::type::type* add(entity e, Args&&... args)
+		{
+			return pool<Component>().create(e, std::forward<Args>(args)...);
+		}
+
+		template<typename Component>
+		void remove(entity e)
+		{
+			pool<Component>().destroy(e);
+		}
+
+		template<typename Component>
+		typename type_traits::optional_type_of_pool<
+			typename pool_of<Component>::type
+		>::type get(entity e)
+		{
+			return pool<Component>().get(e);
+		}
+
+		template<typename... Components>
+		::entity::view<typename view_pool_of<Components>::type...> view()
+		{
+			return ::entity::view<typename view_pool_of<Components>::type...>(
+				size_,
+				disabled_count_ ? enabled_.data() : nullptr,
+				std::get<index_of<Components>::value>(pools_)...
+			);
+		}
+
+		memory_usage memory_stats() const
+		{
+			memory_usage usage;
+			sum_memory_stats(usage, support::make_index_sequence<sizeof...(Pools)>());
+			return usage;
+		}
+
+	private:
+
+		// No copying
+		world(world const&);
+		world operator=(world const&);
+
+		template<typename Pool>
+		static entity_pool& owner(entity_pool& entities)
+		{
+			return entities;
+		}
+
+		static std::size_t words_for(std::size_t count)
+		{
+			return (count + 63) / 64;
+		}
+
+		// Called after the entity count grows or shrinks by one.
+		void push_enabled()
+		{
+			std::size_t const idx = size_ - 1;
+			if(enabled_.size() < words_for(size_))
+				enabled_.push_back(0);
+			enabled_[idx / 64] |= std::uint64_t(1) << (idx % 64);
+		}
+
+		void pop_enabled()
+		{
+			std::size_t const idx = size_;
+			std::uint64_t const bit = std::uint64_t(1) << (idx % 64);
+			if(!(enabled_[idx / 64] & bit))
+				--disabled_count_;
+			enabled_[idx / 64] &= ~bit;
+			enabled_.resize(words_for(size_));
+		}
+
+		template<std::size_t... Indices>
+		void dispatch_create(entity e, support::index_sequence<Indices...>)
+		{
+			(void)std::initializer_list<int>{
+				(component::lifecycle_access::create_entity(std::get<Indices>(pools_), e), 0)...
+			};
+		}
+
+		template<std::size_t... Indices>
+		void dispatch_destroy(entity e, support::index_sequence<Indices...>)
+		{
+			(void)std::initializer_list<int>{
+				(component::lifecycle_access::destroy_entity(std::get<Indices>(pools_), e), 0)...
+			};
+		}
+
+		template<std::size_t... Indices>
+		void dispatch_swap(entity a, entity b, support::index_sequence<Indices...>)
+		{
+			(void)std::initializer_list<int>{
+				(component::lifecycle_access::swap_entities(std::get<Indices>(pools_), a, b), 0)...
+			};
+		}
+
+		template<std::size_t... Indices>
+		void sum_memory_stats(memory_usage& usage, support::index_sequence<Indices...>) const
+		{
+			(void)std::initializer_list<int>{
+				(usage += std::get<Indices>(pools_).memory_stats(), 0)...
+			};
+		}
+
+		// Only here to satisfy the pools' constructors; never changes, so
+		// never signals.  None of its features reach the world's entities.
+		entity_pool unused_;
+		std::tuple<Pools...> pools_;
+		std::size_t size_;
+		std::vector<std::uint64_t> enabled_;
+		std::size_t disabled_count_;
+	};
+}
+
+#endif // ENTITY_WORLD_H_INCLUDED_
@@ -0,0 +1,365 @@
+// ****************************************************************************
+// test/allocators.cpp
+//
+// Part of the test harness for entity.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#include "entity/component/creation_queue.hpp"
+#include "entity/component/dense_pool.hpp"
+#include "entity/component/destruction_queue.hpp"
+#include "entity/component/sparse_pool.hpp"
+#include "entity/component/saturated_pool.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/entity.hpp"
+#include "entity/support/mapped_allocator.hpp"
+#include "entity/support/numa.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#define BOOST_TEST_MODULE Allocators
+#include <boost/test/unit_test.hpp>
+
+// ----------------------------------------------------------------------------
+// Minimal bump allocator.  Deallocation is a no-op so the whole arena
+// is released at once when it goes out of scope.
+struct arena
+{
+	explicit arena(std::size_t size)
+		: memory_(new char[size])
+		, size_(size)
+		, used_(0)
+		, live_allocations_(0)
+	{}
+
+	void* allocate(std::size_t bytes, std::size_t align)
+	{
+		std::size_t start = (used_ + align - 1) & ~(align - 1);
+		if(start + bytes > size_)
+			throw std::bad_alloc();
+		used_ = start + bytes;
+		++live_allocations_;
+		return memory_.get() + start;
+	}
+
+	void deallocate(void*)
+	{
+		--live_allocations_;
+	}
+
+	std::unique_ptr<char[]> memory_;
+	std::size_t size_;
+	std::size_t used_;
+	std::ptrdiff_t live_allocations_;
+};
+
+template<typename T>
+struct arena_allocator
+{
+	typedef T value_type;
+
+	explicit arena_allocator(arena& a)
+		: arena_(&a)
+	{}
+
+	template<typename U>
+	arena_allocator(arena_allocator<U> const& other)
+		: arena_(other.arena_)
+	{}
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* p, std::size_t)
+	{
+		arena_->deallocate(p);
+	}
+
+	template<typename U>
+	bool operator==(arena_allocator<U> const& rhs) const
+	{
+		return arena_ == rhs.arena_;
+	}
+
+	template<typename U>
+	bool operator!=(arena_allocator<U> const& rhs) const
+	{
+		return arena_ != rhs.arena_;
+	}
+
+	arena* arena_;
+};
+
+static int const kNumEntities = 64;
+
+// ----------------------------------------------------------------------------
+//
+template<template<typename, typename> class Pool>
+void PoolUsesAllocator()
+{
+	arena world_arena(1024 * 1024);
+	{
+		arena_allocator<float> alloc(world_arena);
+		entity::entity_pool entities(std::allocator_arg, alloc);
+		BOOST_CHECK(world_arena.live_allocations_ > 0);
+
+		Pool<float, arena_allocator<float>> pool(std::allocator_arg, alloc, entities);
+		BOOST_CHECK(pool.get_allocator() == alloc);
+
+		std::size_t const used_before = world_arena.used_;
+		for(int i = 0; i < kNumEntities; ++i)
+		{
+			*pool.create(entities.create(), 1.f) = static_cast<float>(i);
+		}
+
+		BOOST_CHECK(world_arena.used_ > used_before);
+		BOOST_CHECK_EQUAL(pool.size(), kNumEntities);
+
+		float sum = 0;
+		for(auto&& v : pool)
+		{
+			sum += v;
+		}
+
+		BOOST_CHECK_EQUAL(sum, (kNumEntities * (kNumEntities - 1)) / 2);
+	}
+
+	BOOST_CHECK_EQUAL(world_arena.live_allocations_, 0);
+}
+
+BOOST_AUTO_TEST_CASE( entity_pool_allocator )
+{
+	arena world_arena(1024 * 1024);
+	{
+		entity::entity_pool entities(std::allocator_arg, arena_allocator<int>(world_arena));
+		std::vector<entity::shared_entity> handles;
+		for(int i = 0; i < kNumEntities; ++i)
+		{
+			handles.push_back(entities.create_shared());
+		}
+
+		BOOST_CHECK_EQUAL(entities.size(), kNumEntities);
+		BOOST_CHECK(world_arena.used_ > kNumEntities * sizeof(entity::entity_index_t));
+
+		handles.erase(handles.begin(), handles.begin() + kNumEntities / 2);
+		BOOST_CHECK_EQUAL(entities.size(), kNumEntities / 2);
+		for(auto&& h : handles)
+		{
+			BOOST_CHECK(h.get().index() < entities.size());
+		}
+
+		// Once shrunk, compacting again only needs scratch space, which
+		// must come from the arena too.
+		entities.compact();
+		std::size_t const used_before = world_arena.used_;
+		entities.compact();
+		BOOST_CHECK(world_arena.used_ > used_before);
+
+		handles.clear();
+		BOOST_CHECK(entities.empty());
+	}
+
+	BOOST_CHECK_EQUAL(world_arena.live_allocations_, 0);
+}
+
+BOOST_AUTO_TEST_CASE( saturated_pool_allocator )
+{
+	PoolUsesAllocator<entity::component::saturated_pool>();
+}
+
+BOOST_AUTO_TEST_CASE( dense_pool_allocator )
+{
+	PoolUsesAllocator<entity::component::dense_pool>();
+}
+
+BOOST_AUTO_TEST_CASE( sparse_pool_allocator )
+{
+	PoolUsesAllocator<entity::component::sparse_pool>();
+}
+
+BOOST_AUTO_TEST_CASE( queue_allocator )
+{
+	arena world_arena(1024 * 1024);
+	{
+		arena_allocator<float> alloc(world_arena);
+		entity::entity_pool entities(std::allocator_arg, alloc);
+		entity::component::dense_pool<float, arena_allocator<float>> pool(
+			std::allocator_arg, alloc, entities);
+
+		std::vector<entity::shared_entity> handles;
+		for(int i = 0; i < kNumEntities; ++i)
+		{
+			handles.push_back(entities.create_shared());
+		}
+
+		{
+			entity::component::creation_queue<decltype(pool)> creator(pool);
+			for(auto&& h : handles)
+			{
+				creator.push(h, 2.f);
+			}
+
+			BOOST_CHECK(world_arena.live_allocations_ > 0);
+		}
+
+		BOOST_CHECK_EQUAL(pool.size(), kNumEntities);
+
+		{
+			entity::component::destruction_queue<decltype(pool)> destroyer(pool);
+			for(auto&& h : handles)
+			{
+				destroyer.push(h);
+			}
+		}
+
+		BOOST_CHECK_EQUAL(pool.size(), 0);
+	}
+
+	BOOST_CHECK_EQUAL(world_arena.live_allocations_, 0);
+}
+
+BOOST_AUTO_TEST_CASE( entity_pool_reserve_covers_handles )
+{
+	arena world_arena(1024 * 1024);
+	arena_allocator<float> alloc(world_arena);
+	entity::entity_pool entities(std::allocator_arg, alloc);
+	entities.reserve(kNumEntities * 4);
+
+	std::size_t const used_before = world_arena.used_;
+	for(int i = 0; i < kNumEntities * 4; ++i)
+	{
+		entities.create();
+	}
+
+	BOOST_CHECK_EQUAL(world_arena.used_, used_before);
+}
+
+BOOST_AUTO_TEST_CASE( mapped_allocator_grows_in_place )
+{
+	std::size_t const kReserved = 1024 * 1024;
+	entity::support::mapped_allocator<float> alloc(
+		entity::support::mapping_flags::huge_pages);
+
+	entity::entity_pool entities;
+	entities.reserve(kReserved);
+	entity::component::saturated_pool<float, entity::support::mapped_allocator<float>> pool(
+		std::allocator_arg, alloc, entities, 0.f);
+	pool.reserve(kReserved);
+
+	entities.create();
+	float* const first = &*pool.begin();
+	BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(first) % (2 * 1024 * 1024), 0u);
+
+	for(std::size_t i = 1; i < kReserved / 4; ++i)
+	{
+		entities.create();
+	}
+
+	BOOST_CHECK(&*pool.begin() == first);
+	BOOST_CHECK_EQUAL(pool.size(), kReserved / 4);
+}
+
+BOOST_AUTO_TEST_CASE( numa_workers_follow_stripes )
+{
+	std::size_t const kNumEntities = 1024 * 1024;
+	std::size_t const kStripeBytes = 64 * 1024;
+	entity::support::numa_allocator<float> alloc(
+		kStripeBytes, entity::support::mapping_flags::none);
+
+	entity::entity_pool entities;
+	entity::component::saturated_pool<float, entity::support::numa_allocator<float>> pool(
+		std::allocator_arg, alloc, entities, 0.f);
+	for(std::size_t i = 0; i < kNumEntities; ++i)
+	{
+		entities.create();
+	}
+
+	float* const data = &*pool.begin();
+	BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(data) % 4096, 0u);
+
+	entity::support::numa_workers workers(3);
+	BOOST_CHECK_EQUAL(workers.thread_count(), std::size_t(workers.node_count()) * 3);
+
+	std::mutex mutex;
+	std::vector<std::pair<std::size_t, std::size_t>> ranges;
+	workers.for_each_range(alloc, pool.size(),
+		[&](std::size_t first, std::size_t last)
+		{
+			for(std::size_t i = first; i < last; ++i)
+				data[i] += 1.f;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			ranges.push_back(std::make_pair(first, last));
+		}
+	);
+
+	// Every element once, and no range crosses a stripe.
+	for(auto&& f : pool)
+	{
+		BOOST_CHECK_EQUAL(f, 1.f);
+	}
+
+	for(auto&& r : ranges)
+	{
+		BOOST_CHECK_EQUAL(
+			r.first * sizeof(float) / kStripeBytes,
+			(r.second - 1) * sizeof(float) / kStripeBytes
+		);
+	}
+
+	BOOST_CHECK_EQUAL(ranges.size(), kNumEntities * sizeof(float) / kStripeBytes);
+
+	BOOST_CHECK_THROW(
+		workers.for_each_range(alloc, pool.size(),
+			[](std::size_t, std::size_t) { throw std::runtime_error("Failed."); }
+		),
+		std::runtime_error
+	);
+
+	BOOST_CHECK_THROW(
+		entity::support::numa_allocator<float>(1000),
+		std::invalid_argument
+	);
+}
+
+BOOST_AUTO_TEST_CASE( numa_stripes_use_listed_nodes )
+{
+	// Node lists can have gaps, from offline or memoryless nodes.
+	char const* const kListPath = "test.allocators.nodelist";
+	std::FILE* f = std::fopen(kListPath, "w");
+	BOOST_REQUIRE(f);
+	std::fputs("0,2,4-5\n", f);
+	std::fclose(f);
+
+	std::vector<int> const listed = entity::support::detail::read_sysfs_list(kListPath);
+	std::remove(kListPath);
+	BOOST_CHECK((listed == std::vector<int>{ 0, 2, 4, 5 }));
+
+	std::vector<int> const& nodes = entity::support::numa_nodes();
+	BOOST_REQUIRE(!nodes.empty());
+	BOOST_CHECK_EQUAL(entity::support::numa_node_count(), int(nodes.size()));
+
+	std::size_t const kStripeBytes = 64 * 1024;
+	entity::support::numa_allocator<float> alloc(
+		kStripeBytes, entity::support::mapping_flags::none);
+	for(std::size_t j = 0; j < nodes.size() * 2; ++j)
+	{
+		BOOST_CHECK_EQUAL(
+			alloc.node_of_offset(j * kStripeBytes + 1),
+			nodes[j % nodes.size()]
+		);
+	}
+}
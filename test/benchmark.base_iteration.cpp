@@ -12,6 +12,7 @@
 // ****************************************************************************
 
 #include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
 #include <vector>
 #include <algorithm>
 
@@ -57,6 +58,7 @@ static void StructIteration(benchmark::State& st)
 		entities.push_back(p);
 	}
 
+	perf_counters_scope counters(st, num_entities);
 	while(st.KeepRunning())
 	{
 		::for_each(entities.begin(), entities.end(),
@@ -102,6 +104,7 @@ static void ManualComponentIteration(benchmark::State& st)
 		accels.push_back(9.8f);
 	}
 
+	perf_counters_scope counters(st, num_entities);
 	while(st.KeepRunning())
 	{
 		for(std::size_t i = 0, s = accels.size(); i < s; ++i)
@@ -0,0 +1,453 @@
+// ****************************************************************************
+// test/benchmark.churn.cpp
+//
+// Benchmarks entity and component churn: creating and destroying entities
+// while a number of pools listen to the entity pool, either directly or
+// through creation and destruction queues.  Each benchmark iteration is
+// one frame; frame time percentiles are reported alongside the mean cost
+// of a single create or destroy.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//
+#ifdef _DEBUG
+static const int kNumEntities = 1024;
+#else
+static const int kNumEntities = 1024 * 16;
+#endif
+
+static const int kPoolCounts[] = { 1, 4, 16, 32 };
+
+// Churn is in parts per thousand of the population per frame.
+static const int kChurnRates[] = { 1, 10, 100 };
+
+// -----------------------------------------------------------------------------
+// Picks victims with a fixed LCG so every run churns the same entities.
+struct victim_picker
+{
+	victim_picker()
+		: state_(12345)
+	{}
+
+	std::size_t operator()(std::size_t size)
+	{
+		state_ = state_ * 6364136223846793005ull + 1442695040888963407ull;
+		return static_cast<std::size_t>(state_ >> 33) % size;
+	}
+
+	std::uint64_t state_;
+};
+
+// -----------------------------------------------------------------------------
+// A population of entities with pool_count pools of the same type attached.
+template<typename ComponentPool>
+struct churn_world
+{
+	typedef entity::component::creation_queue<ComponentPool> creation_queue;
+	typedef entity::component::destruction_queue<ComponentPool> destruction_queue;
+
+	explicit churn_world(int pool_count)
+	{
+		for(int i = 0; i < pool_count; ++i)
+		{
+			pools.emplace_back(new ComponentPool(entities));
+			creators.emplace_back(new creation_queue(*pools.back()));
+			destroyers.emplace_back(new destruction_queue(*pools.back()));
+		}
+	}
+
+	void add_components(entity::entity e)
+	{
+		for(auto&& p : pools)
+		{
+			*p->create(e, 0.f) = 1.f;
+		}
+	}
+
+	entity::entity_pool entities;
+	std::vector<std::unique_ptr<ComponentPool>> pools;
+	std::vector<std::unique_ptr<creation_queue>> creators;
+	std::vector<std::unique_ptr<destruction_queue>> destroyers;
+	victim_picker pick;
+};
+
+// -----------------------------------------------------------------------------
+// Handle strategies.  Each one owns the population and knows how to grow
+// and shrink it by one entity.
+struct EntityHandles
+{
+	template<typename World>
+	void create(World& w)
+	{
+		w.add_components(w.entities.create());
+	}
+
+	template<typename World>
+	void destroy(World& w)
+	{
+		w.entities.destroy(entity::make_entity(
+			static_cast<entity::entity_index_t>(w.pick(w.entities.size()))
+		));
+	}
+
+	template<typename World>
+	void flush(World&)
+	{}
+};
+
+template<typename Handle>
+struct OwningHandles
+{
+	template<typename World>
+	void create(World& w)
+	{
+		handles.push_back(make(w.entities));
+		w.add_components(handles.back().get());
+	}
+
+	template<typename World>
+	void destroy(World& w)
+	{
+		using std::swap;
+		std::size_t const victim = w.pick(handles.size());
+		swap(handles[victim], handles.back());
+		handles.pop_back();
+	}
+
+	template<typename World>
+	void flush(World&)
+	{}
+
+	static entity::unique_entity make_impl(entity::entity_pool& p, entity::unique_entity*)
+	{
+		return p.create_unique();
+	}
+
+	static entity::shared_entity make_impl(entity::entity_pool& p, entity::shared_entity*)
+	{
+		return p.create_shared();
+	}
+
+	static Handle make(entity::entity_pool& p)
+	{
+		return make_impl(p, static_cast<Handle*>(nullptr));
+	}
+
+	std::vector<Handle> handles;
+};
+
+typedef OwningHandles<entity::unique_entity> UniqueHandles;
+typedef OwningHandles<entity::shared_entity> SharedHandles;
+
+// Shared handles whose components come and go through the queues.
+// Components are destroyed through the destruction queue before the
+// entity is released so both flushes are measured.
+struct QueuedHandles
+{
+	template<typename World>
+	void create(World& w)
+	{
+		handles.push_back(w.entities.create_shared());
+		for(auto&& q : w.creators)
+		{
+			q->push(handles.back(), 1.f);
+		}
+	}
+
+	template<typename World>
+	void destroy(World& w)
+	{
+		std::size_t const victim = w.pick(handles.size());
+		for(auto&& q : w.destroyers)
+		{
+			q->push(handles[victim]);
+		}
+
+		doomed.push_back(handles[victim]);
+		std::swap(handles[victim], handles.back());
+		handles.pop_back();
+	}
+
+	template<typename World>
+	void flush(World& w)
+	{
+		for(auto&& q : w.destroyers)
+			q->flush();
+
+		doomed.clear();
+
+		for(auto&& q : w.creators)
+			q->flush();
+	}
+
+	std::vector<entity::shared_entity> handles;
+	std::vector<entity::shared_entity> doomed;
+};
+
+// Object pooling: destroyed entities are disabled and parked, and creates
+// re-enable a parked entity before making a new one.  Nothing is ever
+// destroyed, so entity handles stay put.
+struct PooledHandles
+{
+	template<typename World>
+	void create(World& w)
+	{
+		if(parked.empty())
+		{
+			active.push_back(w.entities.create());
+			w.add_components(active.back());
+			return;
+		}
+
+		entity::entity const e = parked.back();
+		parked.pop_back();
+		w.entities.enable(e);
+		for(auto&& p : w.pools)
+		{
+			*p->get(e) = 1.f;
+		}
+
+		active.push_back(e);
+	}
+
+	template<typename World>
+	void destroy(World& w)
+	{
+		using std::swap;
+		std::size_t const victim = w.pick(active.size());
+		w.entities.disable(active[victim]);
+		parked.push_back(active[victim]);
+		swap(active[victim], active.back());
+		active.pop_back();
+	}
+
+	template<typename World>
+	void flush(World&)
+	{}
+
+	std::vector<entity::entity> active;
+	std::vector<entity::entity> parked;
+};
+
+// -----------------------------------------------------------------------------
+// Fills the world, then runs frames that destroy and create churn entities
+// each.  The frame clock is taken manually so percentiles can be reported.
+template<typename ComponentPool, typename Handles>
+static void Churn(benchmark::State& st)
+{
+	int const pool_count = static_cast<int>(st.range(0));
+	int const churn = std::max(1, kNumEntities * static_cast<int>(st.range(1)) / 1000);
+
+	churn_world<ComponentPool> world(pool_count);
+	Handles handles;
+	for(int i = 0; i < kNumEntities; ++i)
+	{
+		handles.create(world);
+	}
+
+	handles.flush(world);
+
+	typedef std::chrono::high_resolution_clock clock;
+	std::vector<double> frames;
+	perf_counters_scope counters(st, churn * 2);
+	while(st.KeepRunning())
+	{
+		clock::time_point const start = clock::now();
+
+		for(int i = 0; i < churn; ++i)
+		{
+			handles.destroy(world);
+		}
+
+		for(int i = 0; i < churn; ++i)
+		{
+			handles.create(world);
+		}
+
+		handles.flush(world);
+
+		frames.push_back(
+			std::chrono::duration<double, std::micro>(clock::now() - start).count()
+		);
+	}
+
+	benchmark::DoNotOptimize(world.entities.size());
+
+	double total = 0;
+	for(double f : frames)
+		total += f;
+
+	std::sort(frames.begin(), frames.end());
+	auto percentile = [&frames](double p)
+	{
+		std::size_t idx = static_cast<std::size_t>(p * frames.size());
+		return frames[std::min(idx, frames.size() - 1)];
+	};
+
+	std::int64_t const ops = std::int64_t(st.iterations()) * churn * 2;
+	st.SetItemsProcessed(ops);
+	st.counters["ns_per_op"] = total * 1000.0 / double(ops);
+	st.counters["p50_us"] = percentile(0.5);
+	st.counters["p99_us"] = percentile(0.99);
+	st.counters["p999_us"] = percentile(0.999);
+}
+
+// The same frames for four pools owned by a world, which calls the pools
+// directly instead of through the entity pool's signals.  Compare with
+// the EntityHandles rows for four pools.
+template<typename ComponentPool>
+static void ChurnWorld(benchmark::State& st)
+{
+	int const churn = std::max(1, kNumEntities * static_cast<int>(st.range(0)) / 1000);
+
+	typedef entity::world<
+		ComponentPool, ComponentPool, ComponentPool, ComponentPool
+	> world_type;
+
+	world_type world;
+	victim_picker pick;
+	auto create = [&world]
+	{
+		auto e = world.create();
+		*world.template pool<0>().create(e, 0.f) = 1.f;
+		*world.template pool<1>().create(e, 0.f) = 1.f;
+		*world.template pool<2>().create(e, 0.f) = 1.f;
+		*world.template pool<3>().create(e, 0.f) = 1.f;
+	};
+
+	for(int i = 0; i < kNumEntities; ++i)
+	{
+		create();
+	}
+
+	perf_counters_scope counters(st, churn * 2);
+	while(st.KeepRunning())
+	{
+		for(int i = 0; i < churn; ++i)
+		{
+			world.destroy(entity::make_entity(
+				static_cast<entity::entity_index_t>(pick(world.size()))
+			));
+		}
+
+		for(int i = 0; i < churn; ++i)
+		{
+			create();
+		}
+	}
+
+	benchmark::DoNotOptimize(world.size());
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * churn * 2);
+}
+
+// A view over a saturated pool and one of ComponentPool holding a
+// component for range(0) parts per thousand of the entities.  Non
+// saturated pools drive the view from their own entities, so the cost
+// should follow the second pool's size rather than the world's.
+template<typename ComponentPool>
+static void ViewWorld(benchmark::State& st)
+{
+	int const every = std::max(1, 1000 / static_cast<int>(st.range(0)));
+
+	typedef entity::world<
+		entity::component::saturated_pool<float>, ComponentPool
+	> world_type;
+
+	world_type world;
+	for(int i = 0; i < kNumEntities; ++i)
+	{
+		auto e = world.create();
+		*world.template pool<0>().get(e) = 1.f;
+		if(i % every == 0)
+			world.template pool<1>().create(e, 1.f);
+	}
+
+	int visited = 0;
+	perf_counters_scope counters(st, kNumEntities);
+	while(st.KeepRunning())
+	{
+		world.template view<entity::component::saturated_pool<float>, ComponentPool const>().for_each(
+			[&visited](float& position, float const& velocity)
+			{
+				position += velocity;
+				++visited;
+			}
+		);
+	}
+
+	benchmark::DoNotOptimize(visited);
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * kNumEntities);
+}
+
+static void ChurnArgs(benchmark::internal::Benchmark* b)
+{
+	for(int pools : kPoolCounts)
+		for(int rate : kChurnRates)
+			b->Args({ pools, rate });
+}
+
+// Benchmark macros can't handle templates, so we'll use typdefs.
+typedef entity::component::saturated_pool<float> SaturatedPool;
+typedef entity::component::dense_pool<float> DensePool;
+typedef entity::component::sparse_pool<float> SparsePool;
+typedef entity::component::hashed_pool<float> HashedPool;
+typedef entity::component::adaptive_pool<float> AdaptivePool;
+
+// Add new handle types here.
+#define HANDLES(pool)						\
+	CHURN(pool, EntityHandles)				\
+	CHURN(pool, UniqueHandles)				\
+	CHURN(pool, SharedHandles)				\
+	CHURN(pool, QueuedHandles)				\
+	CHURN(pool, PooledHandles)				\
+
+#define CHURN(pool, handles) \
+	BENCHMARK_TEMPLATE2(Churn, pool, handles)->Apply(ChurnArgs);
+
+HANDLES(SaturatedPool)
+HANDLES(DensePool)
+HANDLES(SparsePool)
+HANDLES(HashedPool)
+HANDLES(AdaptivePool)
+
+#undef CHURN
+#undef HANDLES
+
+static void ChurnRates(benchmark::internal::Benchmark* b)
+{
+	for(int rate : kChurnRates)
+		b->Arg(rate);
+}
+
+BENCHMARK_TEMPLATE(ChurnWorld, SaturatedPool)->Apply(ChurnRates);
+BENCHMARK_TEMPLATE(ChurnWorld, DensePool)->Apply(ChurnRates);
+BENCHMARK_TEMPLATE(ChurnWorld, SparsePool)->Apply(ChurnRates);
+BENCHMARK_TEMPLATE(ChurnWorld, HashedPool)->Apply(ChurnRates);
+BENCHMARK_TEMPLATE(ChurnWorld, AdaptivePool)->Apply(ChurnRates);
+
+static void ViewDensities(benchmark::internal::Benchmark* b)
+{
+	b->Arg(10)->Arg(100)->Arg(1000);
+}
+
+BENCHMARK_TEMPLATE(ViewWorld, SaturatedPool)->Arg(1000);
+BENCHMARK_TEMPLATE(ViewWorld, DensePool)->Apply(ViewDensities);
+BENCHMARK_TEMPLATE(ViewWorld, SparsePool)->Apply(ViewDensities);
+BENCHMARK_TEMPLATE(ViewWorld, HashedPool)->Apply(ViewDensities);
+BENCHMARK_TEMPLATE(ViewWorld, AdaptivePool)->Apply(ViewDensities);
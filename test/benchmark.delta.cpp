@@ -0,0 +1,179 @@
+// ****************************************************************************
+// test/benchmark.delta.cpp
+//
+// Benchmarks delta encoding and decoding of component pools.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "entity/serialization/delta.hpp"
+#include "entity/serialization/history.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <cstdint>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//
+struct transform
+{
+	float position[3];
+	float velocity[3];
+	std::int32_t flags;
+};
+
+// -----------------------------------------------------------------------------
+// One in ChangeStride entities moves every frame.
+static int const kChangeStride = 8;
+
+template<typename Pool>
+struct delta_world
+{
+	explicit delta_world(int num_entities)
+		: server(server_entities)
+		, client(client_entities)
+	{
+		for(int i = 0; i < num_entities; ++i)
+		{
+			auto e = server_entities.create();
+			client_entities.create();
+			transform t = { { float(i), 0.f, 0.f }, { 1.f, 0.f, 0.f }, i };
+			*server.create(e, t) = t;
+			*client.create(e, t) = t;
+		}
+
+		baseline.capture(server);
+	}
+
+	void step()
+	{
+		entity::entity_index_t idx = 0;
+		for(auto i = server.optional_begin(), e = server.optional_end(); i != e; ++i, ++idx)
+		{
+			if(idx % kChangeStride == 0)
+				(*i)->position[0] += (*i)->velocity[0] * 0.016f;
+		}
+	}
+
+	entity::entity_pool server_entities;
+	entity::entity_pool client_entities;
+	Pool server;
+	Pool client;
+	entity::serialization::delta_baseline<transform> baseline;
+	std::vector<std::uint8_t> buffer;
+};
+
+// -----------------------------------------------------------------------------
+//
+static void report(benchmark::State& st, std::size_t bytes, int num_entities)
+{
+	st.SetBytesProcessed(std::int64_t(st.iterations()) * num_entities * sizeof(transform));
+	st.counters["delta_bytes_per_entity"] = double(bytes) / num_entities;
+}
+
+template<typename Pool>
+static void EncodeDelta(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	delta_world<Pool> world(num_entities);
+	world.step();
+
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		world.buffer.clear();
+		entity::serialization::encode_delta(world.server, world.baseline, world.buffer);
+		benchmark::DoNotOptimize(world.buffer.data());
+	}
+
+	report(st, world.buffer.size(), num_entities);
+}
+
+template<typename Pool>
+static void ApplyDelta(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	delta_world<Pool> world(num_entities);
+	world.step();
+	entity::serialization::encode_delta(world.server, world.baseline, world.buffer);
+
+	std::uint8_t const* first = world.buffer.data();
+	std::uint8_t const* last = first + world.buffer.size();
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		// Applying the same modification repeatedly keeps adding to the
+		// client, which is fine for timing purposes.
+		entity::serialization::apply_delta(world.client, first, last);
+	}
+
+	st.SetBytesProcessed(std::int64_t(st.iterations()) * world.buffer.size());
+	st.counters["delta_bytes_per_entity"] = double(world.buffer.size()) / num_entities;
+}
+
+// -----------------------------------------------------------------------------
+// Rolling back this many frames is the target budget for resimulation.
+static int const kRollbackFrames = 8;
+
+template<typename Pool>
+static void CommitHistory(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	delta_world<Pool> world(num_entities);
+	entity::serialization::pool_history<Pool> history(world.server, kRollbackFrames);
+
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		world.step();
+		history.commit();
+	}
+
+	st.SetBytesProcessed(std::int64_t(st.iterations()) * num_entities * sizeof(transform));
+	st.counters["history_bytes"] = double(history.memory_stats().live_bytes);
+}
+
+template<typename Pool>
+static void RollbackHistory(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	delta_world<Pool> world(num_entities);
+	entity::serialization::pool_history<Pool> history(world.server, kRollbackFrames);
+
+	while(st.KeepRunning())
+	{
+		st.PauseTiming();
+		for(int i = 0; i < kRollbackFrames; ++i)
+		{
+			world.step();
+			history.commit();
+		}
+		st.ResumeTiming();
+
+		history.rollback(kRollbackFrames);
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * kRollbackFrames);
+}
+
+#define DELTA_BENCHMARK(Test, Pool) \
+	BENCHMARK_TEMPLATE(Test, Pool)->Arg(1024)->Arg(1024 * 256)
+
+DELTA_BENCHMARK(EncodeDelta, entity::component::saturated_pool<transform>);
+DELTA_BENCHMARK(EncodeDelta, entity::component::dense_pool<transform>);
+DELTA_BENCHMARK(EncodeDelta, entity::component::sparse_pool<transform>);
+DELTA_BENCHMARK(ApplyDelta, entity::component::saturated_pool<transform>);
+DELTA_BENCHMARK(ApplyDelta, entity::component::dense_pool<transform>);
+DELTA_BENCHMARK(ApplyDelta, entity::component::sparse_pool<transform>);
+DELTA_BENCHMARK(CommitHistory, entity::component::saturated_pool<transform>);
+DELTA_BENCHMARK(CommitHistory, entity::component::dense_pool<transform>);
+DELTA_BENCHMARK(CommitHistory, entity::component::sparse_pool<transform>);
+DELTA_BENCHMARK(RollbackHistory, entity::component::saturated_pool<transform>);
+DELTA_BENCHMARK(RollbackHistory, entity::component::dense_pool<transform>);
+DELTA_BENCHMARK(RollbackHistory, entity::component::sparse_pool<transform>);
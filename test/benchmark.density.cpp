@@ -0,0 +1,361 @@
+// ****************************************************************************
+// test/benchmark.density.cpp
+//
+// Sweeps every pool type and iteration strategy over a range of component
+// densities and entity counts.  Use it to pick a pool for a component
+// given how many entities are expected to carry it.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <boost/iterator/zip_iterator.hpp>
+#include <boost/range/algorithm/for_each.hpp>
+#include <algorithm>
+#include <cstdint>
+
+#include "entity/component/detail/get_helper.hpp"
+#include "entity/iterator/zip_iterator.hpp"
+
+// -----------------------------------------------------------------------------
+//
+static const float kFrameTime = 0.016f;
+
+// Densities are in parts per thousand so they fit the integer arguments.
+static const int kDensities[] = { 1000, 900, 500, 100, 1 };
+
+#ifdef _DEBUG
+static const int kEntityCounts[] = { 1024 };
+#else
+static const int kEntityCounts[] = { 1024 * 16, 1024 * 1024 };
+#endif
+
+// -----------------------------------------------------------------------------
+//
+struct jerk
+{
+	template<typename T>
+	void operator()(T a)
+	{
+		using std::get;
+		using boost::get;
+		auto ac = get<0>(a);
+		if(ac)
+			*ac += (0.001f *  kFrameTime);
+	}
+};
+
+// -----------------------------------------------------------------------------
+//
+struct accelerate
+{
+	template<typename T>
+	void operator()(T av)
+	{
+		using std::get;
+		using boost::get;
+		auto a = get<0>(av);
+		auto v = get<1>(av);
+		if(a && v)
+			*v += *a * kFrameTime;
+	}
+};
+
+// -----------------------------------------------------------------------------
+//
+struct move
+{
+	template<typename T>
+	void operator()(T vp)
+	{
+		using std::get;
+		using boost::get;
+		auto v = get<0>(vp);
+		auto p = get<1>(vp);
+		if(v && p)
+			*p += *v * kFrameTime;
+	}
+};
+
+// -----------------------------------------------------------------------------
+// Entities are given components by hashing their index so the populated
+// entities are spread evenly and identically on every run.
+template<typename ComponentPool>
+struct density_world
+{
+	density_world(int num_entities, int density)
+		: accel_pool(entities)
+		, velocity_pool(entities)
+		, position_pool(entities)
+		, live(0)
+	{
+		for(int i = 0; i < num_entities; ++i)
+		{
+			entities.create();
+		}
+
+		for(auto&& e : entities)
+		{
+			if((e.index() * 2654435761u) % 1000 < std::uint32_t(density))
+			{
+				*position_pool.create(e, 0.f) = 0.f;
+				*velocity_pool.create(e, 0.f) = 0.f;
+				*accel_pool.create(e, 0.f) = 9.8f;
+			}
+		}
+
+		live = position_pool.size();
+	}
+
+	entity::entity_pool entities;
+	ComponentPool accel_pool;
+	ComponentPool velocity_pool;
+	ComponentPool position_pool;
+	std::size_t live;
+};
+
+// -----------------------------------------------------------------------------
+// Iteration strategies.
+
+// Plain arrays indexed by entity; the baseline the others are measured
+// against.  Only saturated pools store every component contiguously in
+// entity order, so it is only registered for them.
+struct IterateRaw
+{
+	template<typename World>
+	void operator()(World& w) const
+	{
+		float* a = &*w.accel_pool.get(entity::make_entity(0));
+		for(entity::entity_index_t i = 0, s = w.entities.size(); i < s; ++i)
+			a[i] += 0.001f * kFrameTime;
+
+		float* v = &*w.velocity_pool.get(entity::make_entity(0));
+		for(entity::entity_index_t i = 0, s = w.entities.size(); i < s; ++i)
+			v[i] += a[i] * kFrameTime;
+
+		float* p = &*w.position_pool.get(entity::make_entity(0));
+		for(entity::entity_index_t i = 0, s = w.entities.size(); i < s; ++i)
+			p[i] += v[i] * kFrameTime;
+	}
+};
+
+struct IterateIndexed
+{
+	template<typename World>
+	void operator()(World& w) const
+	{
+		for(entity::entity_index_t i = 0, s = w.entities.size(); i < s; ++i)
+		{
+			auto accel = w.accel_pool.get(entity::make_entity(i));
+			if(accel)
+				*accel += 0.001f * kFrameTime;
+		}
+
+		for(entity::entity_index_t i = 0, s = w.entities.size(); i < s; ++i)
+		{
+			auto accel = w.accel_pool.get(entity::make_entity(i));
+			auto velocity = w.velocity_pool.get(entity::make_entity(i));
+			if(accel && velocity)
+				*velocity += *accel * kFrameTime;
+		}
+
+		for(entity::entity_index_t i = 0, s = w.entities.size(); i < s; ++i)
+		{
+			auto velocity = w.velocity_pool.get(entity::make_entity(i));
+			auto position = w.position_pool.get(entity::make_entity(i));
+			if(velocity && position)
+				*position += *velocity * kFrameTime;
+		}
+	}
+};
+
+struct IterateGetHelper
+{
+	template<typename World>
+	void operator()(World& w) const
+	{
+		auto a_getter = entity::component::detail::make_get_helper(w.accel_pool);
+		auto v_getter = entity::component::detail::make_get_helper(w.velocity_pool);
+		auto p_getter = entity::component::detail::make_get_helper(w.position_pool);
+
+		for(entity::entity_index_t i = 0, s = w.entities.size(); i < s; ++i)
+		{
+			auto accel = a_getter.get(entity::make_entity(i));
+			if(accel)
+				*accel += 0.001f * kFrameTime;
+		}
+
+		for(entity::entity_index_t i = 0, s = w.entities.size(); i < s; ++i)
+		{
+			auto accel = a_getter.get(entity::make_entity(i));
+			auto velocity = v_getter.get(entity::make_entity(i));
+			if(accel && velocity)
+				*velocity += *accel * kFrameTime;
+		}
+
+		for(entity::entity_index_t i = 0, s = w.entities.size(); i < s; ++i)
+		{
+			auto velocity = v_getter.get(entity::make_entity(i));
+			auto position = p_getter.get(entity::make_entity(i));
+			if(velocity && position)
+				*position += *velocity * kFrameTime;
+		}
+	}
+};
+
+struct IterateZip
+{
+	template<typename World>
+	void operator()(World& w) const
+	{
+		std::for_each(
+			entity::iterator::make_zip_iterator(w.entities.begin(), w.accel_pool),
+			entity::iterator::make_zip_iterator(w.entities.end(), w.accel_pool),
+			jerk()
+		);
+
+		std::for_each(
+			entity::iterator::make_zip_iterator(w.entities.begin(), w.accel_pool, w.velocity_pool),
+			entity::iterator::make_zip_iterator(w.entities.end(), w.accel_pool, w.velocity_pool),
+			accelerate()
+		);
+
+		std::for_each(
+			entity::iterator::make_zip_iterator(w.entities.begin(), w.velocity_pool, w.position_pool),
+			entity::iterator::make_zip_iterator(w.entities.end(), w.velocity_pool, w.position_pool),
+			move()
+		);
+	}
+};
+
+struct IterateRange
+{
+	template<typename World>
+	void operator()(World& w) const
+	{
+		auto ar = entity::range::combine(w.entities, w.accel_pool);
+		std::for_each(ar.begin(), ar.end(), jerk());
+
+		auto avr = entity::range::combine(w.entities, w.accel_pool, w.velocity_pool);
+		std::for_each(avr.begin(), avr.end(), accelerate());
+
+		auto vpr = entity::range::combine(w.entities, w.velocity_pool, w.position_pool);
+		std::for_each(vpr.begin(), vpr.end(), move());
+	}
+};
+
+struct IterateOptional
+{
+	template<typename World>
+	void operator()(World& w) const
+	{
+		std::for_each(
+			boost::make_zip_iterator(boost::make_tuple(w.accel_pool.optional_begin())),
+			boost::make_zip_iterator(boost::make_tuple(w.accel_pool.optional_end())),
+			jerk()
+		);
+
+		std::for_each(
+			boost::make_zip_iterator(boost::make_tuple(
+				w.accel_pool.optional_begin(), w.velocity_pool.optional_begin())),
+			boost::make_zip_iterator(boost::make_tuple(
+				w.accel_pool.optional_end(), w.velocity_pool.optional_end())),
+			accelerate()
+		);
+
+		std::for_each(
+			boost::make_zip_iterator(boost::make_tuple(
+				w.velocity_pool.optional_begin(), w.position_pool.optional_begin())),
+			boost::make_zip_iterator(boost::make_tuple(
+				w.velocity_pool.optional_end(), w.position_pool.optional_end())),
+			move()
+		);
+	}
+};
+
+struct IterateOptionalRange
+{
+	template<typename World>
+	void operator()(World& w) const
+	{
+		boost::range::for_each(
+			entity::range::combine_optional(w.accel_pool), jerk());
+		boost::range::for_each(
+			entity::range::combine_optional(w.accel_pool, w.velocity_pool), accelerate());
+		boost::range::for_each(
+			entity::range::combine_optional(w.velocity_pool, w.position_pool), move());
+	}
+};
+
+// -----------------------------------------------------------------------------
+// Args are density and entity count.  Items are entities swept per frame;
+// bytes are the live component data of the three pools.
+template<typename ComponentPool, typename Strategy>
+static void DensitySweep(benchmark::State& st)
+{
+	int const density = static_cast<int>(st.range(0));
+	int const num_entities = static_cast<int>(st.range(1));
+	density_world<ComponentPool> world(num_entities, density);
+	Strategy strategy;
+
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		strategy(world);
+	}
+
+	benchmark::DoNotOptimize(world.position_pool.size());
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_entities);
+	st.SetBytesProcessed(std::int64_t(st.iterations()) * world.live * 3 * sizeof(float));
+	st.counters["live"] = double(world.live);
+}
+
+static void AllDensities(benchmark::internal::Benchmark* b)
+{
+	for(int count : kEntityCounts)
+		for(int density : kDensities)
+			b->Args({ density, count });
+}
+
+// Saturated pools hold a component for every entity, so density is moot.
+static void FullDensity(benchmark::internal::Benchmark* b)
+{
+	for(int count : kEntityCounts)
+		b->Args({ 1000, count });
+}
+
+// Benchmark macros can't handle templates, so we'll use typdefs.
+typedef entity::component::saturated_pool<float> SaturatedPool;
+typedef entity::component::dense_pool<float> DensePool;
+typedef entity::component::sparse_pool<float> SparsePool;
+typedef entity::component::hashed_pool<float> HashedPool;
+typedef entity::component::adaptive_pool<float> AdaptivePool;
+
+// Add new strategies here.
+#define STRATEGIES(pool, args)							\
+	SWEEP(pool, IterateIndexed, args)					\
+	SWEEP(pool, IterateGetHelper, args)					\
+	SWEEP(pool, IterateZip, args)						\
+	SWEEP(pool, IterateRange, args)						\
+	SWEEP(pool, IterateOptional, args)					\
+	SWEEP(pool, IterateOptionalRange, args)				\
+
+#define SWEEP(pool, strategy, args) \
+	BENCHMARK_TEMPLATE2(DensitySweep, pool, strategy)->Apply(args);
+
+STRATEGIES(SaturatedPool, FullDensity)
+SWEEP(SaturatedPool, IterateRaw, FullDensity)
+STRATEGIES(DensePool, AllDensities)
+STRATEGIES(SparsePool, AllDensities)
+STRATEGIES(HashedPool, AllDensities)
+STRATEGIES(AdaptivePool, AllDensities)
+
+#undef SWEEP
+#undef STRATEGIES
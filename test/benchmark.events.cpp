@@ -0,0 +1,154 @@
+// ****************************************************************************
+// test/benchmark.events.cpp
+//
+// Benchmarks keeping a mirror of which entities hold a component up to
+// date by polling the pool every frame, against component_events with
+// immediate and with batched dispatch.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//
+#ifdef _DEBUG
+static const int kEntityCounts[] = { 1024 };
+#else
+static const int kEntityCounts[] = { 1024 * 16, 1024 * 256 };
+#endif
+
+typedef entity::component::sparse_pool<float> pool_type;
+typedef entity::component::component_events<pool_type> events_type;
+
+struct events_world
+{
+	explicit events_world(int num_entities)
+		: pool(entities)
+		, mirror(num_entities, 0)
+		, rng(49)
+	{
+		for(int i = 0; i < num_entities; ++i)
+			entities.create();
+	}
+
+	// Adds or removes the component on changed random entities.
+	template<typename Target>
+	void toggle(Target& target, int changed)
+	{
+		for(int i = 0; i < changed; ++i)
+		{
+			auto e = entity::make_entity(rng() % entities.size());
+			if(pool.get(e))
+				target.destroy(e);
+			else
+				target.create(e, 1.f);
+		}
+	}
+
+	void connect(events_type& events)
+	{
+		added = events.signals().on_component_added.connect(
+			[this](events_type::entity_range r)
+			{
+				for(auto e : r)
+					mirror[e.index()] = 1;
+			}
+		);
+
+		removed = events.signals().on_component_removed.connect(
+			[this](events_type::entity_range r)
+			{
+				for(auto e : r)
+					mirror[e.index()] = 0;
+			}
+		);
+	}
+
+	entity::entity_pool entities;
+	pool_type pool;
+	std::vector<char> mirror;
+	std::mt19937 rng;
+	boost::signals2::scoped_connection added;
+	boost::signals2::scoped_connection removed;
+};
+
+// -----------------------------------------------------------------------------
+//
+static void Poll(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	int const changed = num_entities * static_cast<int>(st.range(1)) / 100;
+	events_world w(num_entities);
+
+	perf_counters_scope counters(st, changed);
+	while(st.KeepRunning())
+	{
+		w.toggle(w.pool, changed);
+		for(auto e : w.entities)
+			w.mirror[e.index()] = w.pool.get(e) ? 1 : 0;
+		benchmark::ClobberMemory();
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * changed);
+}
+
+static void Immediate(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	int const changed = num_entities * static_cast<int>(st.range(1)) / 100;
+	events_world w(num_entities);
+	events_type events(w.entities, w.pool, entity::component::event_dispatch::immediate);
+	w.connect(events);
+
+	perf_counters_scope counters(st, changed);
+	while(st.KeepRunning())
+	{
+		w.toggle(events, changed);
+		benchmark::ClobberMemory();
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * changed);
+}
+
+static void Batched(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	int const changed = num_entities * static_cast<int>(st.range(1)) / 100;
+	events_world w(num_entities);
+	events_type events(w.entities, w.pool);
+	w.connect(events);
+
+	perf_counters_scope counters(st, changed);
+	while(st.KeepRunning())
+	{
+		w.toggle(events, changed);
+		events.flush();
+		benchmark::ClobberMemory();
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * changed);
+}
+
+static void EntityCountsChanged(benchmark::internal::Benchmark* b)
+{
+	for(int count : kEntityCounts)
+	{
+		b->Args({ count, 1 });
+		b->Args({ count, 10 });
+	}
+}
+
+BENCHMARK(Poll)->Apply(EntityCountsChanged);
+BENCHMARK(Immediate)->Apply(EntityCountsChanged);
+BENCHMARK(Batched)->Apply(EntityCountsChanged);
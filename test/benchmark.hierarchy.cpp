@@ -0,0 +1,200 @@
+// ****************************************************************************
+// test/benchmark.hierarchy.cpp
+//
+// Benchmarks transform propagation through a scene graph, storing parent
+// links in a sparse_pool against a hierarchy_pool that keeps the
+// nodes in depth first order, plus the cost of reparenting subtrees.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//
+#ifdef _DEBUG
+static const int kNodeCounts[] = { 1024 };
+#else
+static const int kNodeCounts[] = { 1024 * 16, 1024 * 1024 };
+#endif
+
+// A translation only transform keeps the arithmetic out of the way of the
+// memory access pattern being measured.
+struct transform
+{
+	float local[3];
+	float world[3];
+};
+
+static void compose(transform& child, transform const& parent)
+{
+	for(int i = 0; i < 3; ++i)
+		child.world[i] = parent.world[i] + child.local[i];
+}
+
+static void make_root(transform& t)
+{
+	for(int i = 0; i < 3; ++i)
+		t.world[i] = t.local[i];
+}
+
+// -----------------------------------------------------------------------------
+// Each node picks a random earlier node as parent, or is a root one time in
+// sixteen, so parents always have lower entity indices than their children.
+static std::vector<int> make_parents(int num_nodes)
+{
+	std::mt19937 rng(3);
+	std::vector<int> parents(num_nodes, -1);
+	for(int i = 1; i < num_nodes; ++i)
+	{
+		if(rng() % 16)
+			parents[i] = static_cast<int>(rng() % i);
+	}
+
+	return parents;
+}
+
+// Adds the nodes in depth first order, so every create_child appends to the
+// pool rather than opening a gap in the middle of it.
+static void build(entity::component::hierarchy_pool<transform>& nodes, entity::entity_pool& entities, std::vector<int> const& links)
+{
+	std::vector<std::vector<int>> children(links.size());
+	std::vector<int> stack;
+	for(int i = static_cast<int>(links.size()) - 1; i >= 0; --i)
+	{
+		entities.create();
+		if(links[i] >= 0)
+			children[links[i]].push_back(i);
+		else
+			stack.push_back(i);
+	}
+
+	while(!stack.empty())
+	{
+		int const i = stack.back();
+		stack.pop_back();
+		transform t = { { 1.f, 0.f, 0.f }, { 0.f, 0.f, 0.f } };
+		if(links[i] >= 0)
+			nodes.create_child(entity::make_entity(i), entity::make_entity(links[i]), t);
+		else
+			nodes.create(entity::make_entity(i), t);
+
+		stack.insert(stack.end(), children[i].begin(), children[i].end());
+	}
+}
+
+// -----------------------------------------------------------------------------
+// Parent indices in a sparse pool, transforms in a saturated pool, walked in
+// entity order, which visits parents first but chases them around memory.
+static void PropagateParentPool(benchmark::State& st)
+{
+	int const num_nodes = static_cast<int>(st.range(0));
+	std::vector<int> const links = make_parents(num_nodes);
+
+	entity::entity_pool entities;
+	entity::component::saturated_pool<transform> transforms(entities);
+	entity::component::sparse_pool<entity::entity_index_t> parents(entities);
+	for(int i = 0; i < num_nodes; ++i)
+	{
+		auto e = entities.create();
+		transform t = { { 1.f, 0.f, 0.f }, { 0.f, 0.f, 0.f } };
+		*transforms.create(e, t) = t;
+		if(links[i] >= 0)
+			parents.create(e, static_cast<entity::entity_index_t>(links[i]));
+	}
+
+	perf_counters_scope counters(st, num_nodes);
+	while(st.KeepRunning())
+	{
+		for(auto&& e : entities)
+		{
+			transform& t = *transforms.get(e);
+			auto p = parents.get(e);
+			if(p)
+				compose(t, *transforms.get(entity::make_entity(*p)));
+			else
+				make_root(t);
+		}
+	}
+
+	benchmark::DoNotOptimize(transforms.get(entity::make_entity(num_nodes - 1))->world[0]);
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_nodes);
+}
+
+// Transforms in a hierarchy_pool, propagated in one forward pass.
+static void PropagateHierarchyPool(benchmark::State& st)
+{
+	int const num_nodes = static_cast<int>(st.range(0));
+	std::vector<int> const links = make_parents(num_nodes);
+
+	entity::entity_pool entities;
+	entity::component::hierarchy_pool<transform> nodes(entities);
+	build(nodes, entities, links);
+
+	perf_counters_scope counters(st, num_nodes);
+	while(st.KeepRunning())
+	{
+		auto const& parents = nodes.parent_positions();
+		auto t = nodes.begin();
+		for(std::size_t i = 0, s = nodes.size(); i < s; ++i)
+		{
+			if(parents[i] == nodes.no_parent())
+				make_root(t[i]);
+			else
+				compose(t[i], t[parents[i]]);
+		}
+	}
+
+	benchmark::DoNotOptimize(nodes.begin()->world[0]);
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_nodes);
+}
+
+// Moves a random subtree under a random node outside of it each iteration.
+static void ReparentHierarchyPool(benchmark::State& st)
+{
+	int const num_nodes = static_cast<int>(st.range(0));
+	std::vector<int> const links = make_parents(num_nodes);
+
+	entity::entity_pool entities;
+	entity::component::hierarchy_pool<transform> nodes(entities);
+	build(nodes, entities, links);
+
+	std::mt19937 rng(5);
+	std::int64_t moved = 0;
+	while(st.KeepRunning())
+	{
+		auto e = entity::make_entity(rng() % num_nodes);
+		auto p = entity::make_entity(rng() % num_nodes);
+		std::size_t const pos = nodes.position(e);
+		std::size_t const size = nodes.subtree_sizes()[pos];
+		std::size_t const target = nodes.position(p);
+		if(target >= pos && target < pos + size)
+			continue;
+
+		nodes.set_parent(e, p);
+		moved += size;
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()));
+	st.counters["nodes_moved"] = benchmark::Counter(double(moved), benchmark::Counter::kAvgIterations);
+}
+
+static void NodeCounts(benchmark::internal::Benchmark* b)
+{
+	for(int count : kNodeCounts)
+		b->Arg(count);
+}
+
+BENCHMARK(PropagateParentPool)->Apply(NodeCounts);
+BENCHMARK(PropagateHierarchyPool)->Apply(NodeCounts);
+BENCHMARK(ReparentHierarchyPool)->Apply(NodeCounts);
@@ -12,5 +12,26 @@
 // ****************************************************************************
 
 #include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <cstring>
 
-BENCHMARK_MAIN()
\ No newline at end of file
+int main(int argc, char** argv)
+{
+	// Strip our own flags before benchmark sees them.
+	int remaining = 1;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--entity_perf_counters") == 0)
+			perf_counters_enabled() = true;
+		else
+			argv[remaining++] = argv[i];
+	}
+
+	argc = remaining;
+	benchmark::Initialize(&argc, argv);
+	if(benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
@@ -0,0 +1,105 @@
+// ****************************************************************************
+// test/benchmark.numa.cpp
+//
+// Benchmarks a bandwidth bound pass over a saturated_pool, on one thread
+// against numa_workers with the pool striped across nodes by a
+// numa_allocator.  On a single node machine this measures the cost of
+// dispatching to the workers.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "entity/support/numa.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// -----------------------------------------------------------------------------
+//
+#ifdef _DEBUG
+static const int kEntityCounts[] = { 1024 * 64 };
+#else
+static const int kEntityCounts[] = { 1024 * 1024, 1024 * 1024 * 16 };
+#endif
+
+struct particle
+{
+	float position[3];
+	float velocity[3];
+};
+
+typedef entity::support::numa_allocator<particle> particle_allocator;
+typedef entity::component::saturated_pool<particle, particle_allocator> particle_pool;
+
+static void integrate(particle* first, particle* last)
+{
+	for(; first != last; ++first)
+	{
+		for(int axis = 0; axis < 3; ++axis)
+			first->position[axis] += first->velocity[axis] * 0.016f;
+	}
+}
+
+// -----------------------------------------------------------------------------
+//
+static void IterateOneThread(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	entity::entity_pool entities;
+	particle_pool pool(std::allocator_arg, particle_allocator(), entities, particle());
+	for(int i = 0; i < num_entities; ++i)
+		entities.create();
+
+	particle* data = &*pool.begin();
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		integrate(data, data + num_entities);
+		benchmark::ClobberMemory();
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_entities);
+}
+
+static void IterateNumaWorkers(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	particle_allocator alloc;
+	entity::entity_pool entities;
+	particle_pool pool(std::allocator_arg, alloc, entities, particle());
+	for(int i = 0; i < num_entities; ++i)
+		entities.create();
+
+	entity::support::numa_workers workers;
+	particle* data = &*pool.begin();
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		workers.for_each_range(alloc, pool.size(),
+			[data](std::size_t first, std::size_t last)
+			{
+				integrate(data + first, data + last);
+			}
+		);
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_entities);
+	st.counters["nodes"] = double(workers.node_count());
+}
+
+static void EntityCounts(benchmark::internal::Benchmark* b)
+{
+	for(int count : kEntityCounts)
+		b->Arg(count);
+}
+
+BENCHMARK(IterateOneThread)->Apply(EntityCounts);
+BENCHMARK(IterateNumaWorkers)->Apply(EntityCounts)->UseRealTime();
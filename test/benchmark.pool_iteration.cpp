@@ -13,6 +13,7 @@
 
 #include "entity/all.hpp"
 #include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
 #include <boost/iterator/zip_iterator.hpp>
 
 #include "entity/component/detail/get_helper.hpp"
@@ -308,6 +309,20 @@ public:
 		}
 	}
 
+	void IterateFused(benchmark::State& st)
+	{
+		auto pipeline = entity::range::fuse(
+			entity::range::stage(jerk(), accel_pool),
+			entity::range::stage(accelerate(), accel_pool, velocity_pool),
+			entity::range::stage(move(), velocity_pool, position_pool)
+		);
+
+		while (st.KeepRunning())
+		{
+			pipeline.for_each(entities);
+		}
+	}
+
 private:
 
 	entity::entity_pool entities;
@@ -337,6 +352,7 @@ typedef ComponentFixture<entity::component::sparse_pool<float>> SparseFixture;
 	TEST(IterateZip, pool)					\
 	TEST(IterateRange, pool)				\
 	TEST(IterateOptional, pool)				\
+	TEST(IterateFused, pool)				\
 
 // -----------------------------------------------------------------------------
 // Auto instantiate tests here.
@@ -350,6 +366,8 @@ typedef ComponentFixture<entity::component::sparse_pool<float>> SparseFixture;
 #define TEST(t, p) \
 	BENCHMARK_DEFINE_F(p, t)(benchmark::State& st)	\
 	{												\
+		perf_counters_scope counters(				\
+			st, double(st.range(0)));				\
 		t(st);										\
 	}												\
 	BM_REGISTER(p, t);								\
@@ -0,0 +1,148 @@
+// ****************************************************************************
+// test/benchmark.registry.cpp
+//
+// Benchmarks runtime component access as tools and scripts do it, through
+// a name keyed map of accessors against component_registry ids, and a
+// two component query by id mask against the typed view.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+// -----------------------------------------------------------------------------
+//
+#ifdef _DEBUG
+static const int kEntityCounts[] = { 1024 };
+#else
+static const int kEntityCounts[] = { 1024 * 16, 1024 * 256 };
+#endif
+
+typedef entity::component::dense_pool<float> speed_pool;
+typedef entity::component::sparse_pool<double> mass_pool;
+
+struct registry_world
+{
+	explicit registry_world(int num_entities)
+		: speeds(entities)
+		, masses(entities)
+		, registry(entities)
+	{
+		registry.add_pool(speeds, "speed");
+		registry.add_pool(masses, "mass");
+		for(int i = 0; i < num_entities; ++i)
+		{
+			auto e = entities.create();
+			speeds.create(e, float(i));
+			if(i % 4 == 0)
+				masses.create(e, double(i));
+		}
+	}
+
+	entity::entity_pool entities;
+	speed_pool speeds;
+	mass_pool masses;
+	entity::component_registry registry;
+};
+
+// -----------------------------------------------------------------------------
+//
+static void GetByNameMap(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	registry_world w(num_entities);
+
+	// The shape of a string keyed scripting shim.
+	std::map<std::string, std::function<void*(entity::entity)>> accessors;
+	accessors["speed"] = [&w](entity::entity e) -> void*
+	{
+		auto c = w.speeds.get(e);
+		return c ? &*c : nullptr;
+	};
+
+	std::string const name = "speed";
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		float sum = 0.f;
+		for(auto e : w.entities)
+			sum += *static_cast<float*>(accessors.find(name)->second(e));
+		benchmark::DoNotOptimize(sum);
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_entities);
+}
+
+static void GetById(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	registry_world w(num_entities);
+
+	entity::component_id const speed = w.registry.find("speed");
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		float sum = 0.f;
+		for(auto e : w.entities)
+			sum += *static_cast<float*>(w.registry.get(speed, e));
+		benchmark::DoNotOptimize(sum);
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_entities);
+}
+
+static void QueryMask(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	registry_world w(num_entities);
+
+	entity::component_mask const mask = w.registry.mask<speed_pool, mass_pool>();
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		std::size_t found = 0;
+		w.registry.for_each(mask, [&found](entity::entity) { ++found; });
+		benchmark::DoNotOptimize(found);
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_entities);
+}
+
+static void QueryTypedView(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	registry_world w(num_entities);
+
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		std::size_t found = 0;
+		w.registry.view<speed_pool const, mass_pool const>().for_each(
+			[&found](float const&, double const&) { ++found; });
+		benchmark::DoNotOptimize(found);
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_entities);
+}
+
+static void EntityCounts(benchmark::internal::Benchmark* b)
+{
+	for(int count : kEntityCounts)
+		b->Arg(count);
+}
+
+BENCHMARK(GetByNameMap)->Apply(EntityCounts);
+BENCHMARK(GetById)->Apply(EntityCounts);
+BENCHMARK(QueryMask)->Apply(EntityCounts);
+BENCHMARK(QueryTypedView)->Apply(EntityCounts);
@@ -0,0 +1,162 @@
+// ****************************************************************************
+// test/benchmark.sharded.cpp
+//
+// Benchmarks updating a sharded_world with a thread per shard against a
+// single pool updated on one thread, plus the cost of syncing a batch of
+// migrations between shards.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//
+#ifdef _DEBUG
+static const int kEntityCounts[] = { 1024 };
+#else
+static const int kEntityCounts[] = { 1024 * 64, 1024 * 1024 };
+#endif
+
+struct body
+{
+	float position[3];
+	float velocity[3];
+};
+
+typedef entity::component::dense_pool<body> body_pool;
+typedef entity::sharded_world<body_pool> world_type;
+
+static void integrate(body_pool& pool)
+{
+	for(auto&& b : pool)
+	{
+		for(int axis = 0; axis < 3; ++axis)
+			b.position[axis] += b.velocity[axis] * 0.016f;
+	}
+}
+
+static void populate(world_type& world, int num_entities)
+{
+	for(int i = 0; i < num_entities; ++i)
+	{
+		std::size_t const s = std::size_t(i) % world.shard_count();
+		auto g = world.create(s);
+		auto& shard = world.get_shard(s);
+		body b = { { float(i), 0.f, 0.f }, { 1.f, 0.f, 0.f } };
+		shard.pool<body_pool>().create(world.locate(g).local, b);
+	}
+}
+
+// -----------------------------------------------------------------------------
+//
+static void UpdateSingle(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	world_type world(1);
+	populate(world, num_entities);
+
+	body_pool& pool = world.get_shard(0).pool<body_pool>();
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		integrate(pool);
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_entities);
+}
+
+static void UpdateSharded(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	int const num_shards = static_cast<int>(st.range(1));
+	world_type world(num_shards);
+	populate(world, num_entities);
+
+	std::vector<std::thread> threads;
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		world.for_each_shard(
+			[&threads](world_type::shard& s)
+			{
+				threads.emplace_back([&s] { integrate(s.pool<body_pool>()); });
+			}
+		);
+
+		for(auto&& t : threads)
+			t.join();
+		threads.clear();
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_entities);
+}
+
+// Moves a percentage of the entities to a random shard each iteration.
+static void SyncMigrations(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	int const migrated_percent = static_cast<int>(st.range(1));
+	int const num_shards = 4;
+	world_type world(num_shards);
+	populate(world, num_entities);
+
+	std::mt19937 rng(5);
+	int const num_migrated = num_entities * migrated_percent / 100;
+	perf_counters_scope counters(st, num_migrated);
+	while(st.KeepRunning())
+	{
+		for(int i = 0; i < num_migrated; ++i)
+		{
+			world.migrate(
+				entity::make_global_entity(rng() % num_entities),
+				rng() % num_shards
+			);
+		}
+
+		benchmark::DoNotOptimize(world.sync());
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_migrated);
+}
+
+static void EntityCounts(benchmark::internal::Benchmark* b)
+{
+	for(int count : kEntityCounts)
+		b->Arg(count);
+}
+
+static void EntityCountsShards(benchmark::internal::Benchmark* b)
+{
+	unsigned const cores = std::max(2u, std::thread::hardware_concurrency());
+	for(int count : kEntityCounts)
+	{
+		for(unsigned shards = 2; shards <= cores; shards *= 2)
+			b->Args({ count, int(shards) });
+	}
+}
+
+static void EntityCountsMigrated(benchmark::internal::Benchmark* b)
+{
+	for(int count : kEntityCounts)
+	{
+		b->Args({ count, 1 });
+		b->Args({ count, 10 });
+	}
+}
+
+BENCHMARK(UpdateSingle)->Apply(EntityCounts);
+BENCHMARK(UpdateSharded)->Apply(EntityCountsShards)->UseRealTime();
+BENCHMARK(SyncMigrations)->Apply(EntityCountsMigrated);
@@ -0,0 +1,116 @@
+// ****************************************************************************
+// test/benchmark.snapshot.cpp
+//
+// Benchmarks handing a frame of component state to reader threads, deep
+// copying a dense_pool against taking a cow_pool snapshot, with a
+// fraction of the components written between frames.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//
+#ifdef _DEBUG
+static const int kEntityCounts[] = { 1024 };
+#else
+static const int kEntityCounts[] = { 1024 * 64, 1024 * 1024 };
+#endif
+
+struct transform
+{
+	float position[3];
+	float rotation[4];
+};
+
+template<typename Pool>
+static void populate(entity::entity_pool& entities, Pool& pool, int num_entities)
+{
+	for(int i = 0; i < num_entities; ++i)
+	{
+		transform t = { { float(i), 0.f, 0.f }, { 0.f, 0.f, 0.f, 1.f } };
+		pool.create(entities.create(), t);
+	}
+}
+
+// Writes to written_percent of the entities, picked at random.
+template<typename Pool>
+static void simulate(Pool& pool, int num_entities, int written_percent, std::mt19937& rng)
+{
+	int const writes = num_entities * written_percent / 100;
+	for(int i = 0; i < writes; ++i)
+	{
+		auto t = pool.get(entity::make_entity(rng() % num_entities));
+		t->position[1] += 0.016f;
+	}
+}
+
+// -----------------------------------------------------------------------------
+//
+static void DeepCopyFrame(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	int const written_percent = static_cast<int>(st.range(1));
+	entity::entity_pool entities;
+	entity::component::dense_pool<transform> pool(entities);
+	populate(entities, pool, num_entities);
+
+	std::mt19937 rng(3);
+	std::vector<transform> copy;
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		simulate(pool, num_entities, written_percent, rng);
+		copy.assign(pool.begin(), pool.end());
+		benchmark::DoNotOptimize(copy.data());
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()));
+}
+
+static void SnapshotFrame(benchmark::State& st)
+{
+	int const num_entities = static_cast<int>(st.range(0));
+	int const written_percent = static_cast<int>(st.range(1));
+	entity::entity_pool entities;
+	entity::component::cow_pool<transform> pool(entities);
+	populate(entities, pool, num_entities);
+
+	// A reader always holds the previous frame, so writes copy pages.
+	std::mt19937 rng(3);
+	auto reader = pool.snapshot();
+	perf_counters_scope counters(st, num_entities);
+	while(st.KeepRunning())
+	{
+		simulate(pool, num_entities, written_percent, rng);
+		auto next = pool.snapshot();
+		reader = next;
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()));
+}
+
+static void EntityCountsWritten(benchmark::internal::Benchmark* b)
+{
+	for(int count : kEntityCounts)
+	{
+		b->Args({ count, 0 });
+		b->Args({ count, 1 });
+		b->Args({ count, 10 });
+	}
+}
+
+BENCHMARK(DeepCopyFrame)->Apply(EntityCountsWritten);
+BENCHMARK(SnapshotFrame)->Apply(EntityCountsWritten);
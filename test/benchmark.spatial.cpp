@@ -0,0 +1,196 @@
+// ****************************************************************************
+// test/benchmark.spatial.cpp
+//
+// Benchmarks neighbour queries over a crowd of agents, scanning the
+// position pool against querying a spatial_grid, plus the per frame cost
+// of keeping the grid up to date as agents move.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+
+#include "entity/all.hpp"
+#include "benchmark/benchmark.h"
+#include "perf_counters.hpp"
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//
+#ifdef _DEBUG
+static const int kAgentCounts[] = { 1024 };
+#else
+static const int kAgentCounts[] = { 1024 * 64, 1024 * 512 };
+#endif
+
+// Agents are spread so each sees around a dozen neighbours.
+static const float kNeighbourRadius = 2.f;
+static const int kQueriesPerIteration = 64;
+
+typedef std::array<float, 3> vec3;
+typedef entity::component::saturated_pool<vec3> position_pool;
+
+static float world_extent(int num_agents)
+{
+	return std::cbrt(float(num_agents) * 3.f);
+}
+
+static void spawn(entity::entity_pool& entities, position_pool& positions, int num_agents)
+{
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> coord(0.f, world_extent(num_agents));
+	for(int i = 0; i < num_agents; ++i)
+	{
+		auto e = entities.create();
+		vec3& p = *positions.get(e);
+		p[0] = coord(rng);
+		p[1] = coord(rng);
+		p[2] = coord(rng);
+	}
+}
+
+// -----------------------------------------------------------------------------
+//
+static void RadiusQueryScan(benchmark::State& st)
+{
+	int const num_agents = static_cast<int>(st.range(0));
+	entity::entity_pool entities;
+	position_pool positions(entities);
+	spawn(entities, positions, num_agents);
+
+	std::mt19937 rng(9);
+	std::vector<entity::entity> out;
+	perf_counters_scope counters(st, kQueriesPerIteration);
+	while(st.KeepRunning())
+	{
+		for(int q = 0; q < kQueriesPerIteration; ++q)
+		{
+			vec3 const c = *positions.get(entity::make_entity(rng() % num_agents));
+			out.clear();
+			for(auto e : entities)
+			{
+				vec3 const& p = *positions.get(e);
+				float dist_sq = 0.f;
+				for(int axis = 0; axis < 3; ++axis)
+					dist_sq += (p[axis] - c[axis]) * (p[axis] - c[axis]);
+				if(dist_sq <= kNeighbourRadius * kNeighbourRadius)
+					out.push_back(e);
+			}
+
+			benchmark::DoNotOptimize(out.data());
+		}
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * kQueriesPerIteration);
+}
+
+static void RadiusQueryGrid(benchmark::State& st)
+{
+	int const num_agents = static_cast<int>(st.range(0));
+	entity::entity_pool entities;
+	position_pool positions(entities);
+	spawn(entities, positions, num_agents);
+	entity::component::spatial_grid<position_pool> grid(
+		entities, positions, kNeighbourRadius, num_agents / 4);
+	grid.refresh();
+
+	std::mt19937 rng(9);
+	std::vector<entity::entity> out;
+	std::int64_t found = 0;
+	perf_counters_scope counters(st, kQueriesPerIteration);
+	while(st.KeepRunning())
+	{
+		for(int q = 0; q < kQueriesPerIteration; ++q)
+		{
+			vec3 const c = *positions.get(entity::make_entity(rng() % num_agents));
+			out.clear();
+			found += grid.query_radius(c, kNeighbourRadius, out).size();
+			benchmark::DoNotOptimize(out.data());
+		}
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * kQueriesPerIteration);
+	st.counters["neighbours"] = benchmark::Counter(
+		double(found) / kQueriesPerIteration, benchmark::Counter::kAvgIterations);
+}
+
+// Moves a percentage of the agents each iteration and marks them.
+static void UpdateMovedGrid(benchmark::State& st)
+{
+	int const num_agents = static_cast<int>(st.range(0));
+	int const moved_percent = static_cast<int>(st.range(1));
+	entity::entity_pool entities;
+	position_pool positions(entities);
+	spawn(entities, positions, num_agents);
+	entity::component::spatial_grid<position_pool> grid(
+		entities, positions, kNeighbourRadius, num_agents / 4);
+
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+	int const num_moved = num_agents * moved_percent / 100;
+	perf_counters_scope counters(st, num_moved);
+	while(st.KeepRunning())
+	{
+		for(int i = 0; i < num_moved; ++i)
+		{
+			auto e = entity::make_entity(rng() % num_agents);
+			vec3& p = *positions.get(e);
+			p[0] += step(rng);
+			p[2] += step(rng);
+			grid.mark_moved(e);
+		}
+
+		grid.update();
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_moved);
+}
+
+// Moves every agent and re-reads every position.
+static void RefreshGrid(benchmark::State& st)
+{
+	int const num_agents = static_cast<int>(st.range(0));
+	entity::entity_pool entities;
+	position_pool positions(entities);
+	spawn(entities, positions, num_agents);
+	entity::component::spatial_grid<position_pool> grid(
+		entities, positions, kNeighbourRadius, num_agents / 4);
+
+	perf_counters_scope counters(st, num_agents);
+	float step = 0.01f;
+	while(st.KeepRunning())
+	{
+		for(auto&& p : positions)
+			p[0] += step;
+		step = -step;
+		grid.refresh();
+	}
+
+	st.SetItemsProcessed(std::int64_t(st.iterations()) * num_agents);
+}
+
+static void AgentCounts(benchmark::internal::Benchmark* b)
+{
+	for(int count : kAgentCounts)
+		b->Arg(count);
+}
+
+static void AgentCountsMoved(benchmark::internal::Benchmark* b)
+{
+	for(int count : kAgentCounts)
+	{
+		b->Args({ count, 1 });
+		b->Args({ count, 10 });
+	}
+}
+
+BENCHMARK(RadiusQueryScan)->Apply(AgentCounts);
+BENCHMARK(RadiusQueryGrid)->Apply(AgentCounts);
+BENCHMARK(UpdateMovedGrid)->Apply(AgentCountsMoved);
+BENCHMARK(RefreshGrid)->Apply(AgentCounts);
@@ -10,9 +10,26 @@
 // http://www.boost.org/LICENSE_1_0.txt
 //
 // ****************************************************************************
+#include "entity/component/creation_queue.hpp"
+#include "entity/component/dense_pool.hpp"
+#include "entity/component/destruction_queue.hpp"
+#include "entity/component/hashed_pool.hpp"
+#include "entity/component/hierarchy_pool.hpp"
 #include "entity/component/saturated_pool.hpp"
+#include "entity/component/sparse_pool.hpp"
+#include "entity/component/tag_pool.hpp"
 #include "entity/entity_pool.hpp"
 #include "entity/entity.hpp"
+#include "entity/range/combine.hpp"
+#include "entity/sharded_world.hpp"
+#include "entity/world.hpp"
+#include <boost/range/distance.hpp>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
 
 #define BOOST_TEST_MODULE Lifetimes
 #include <boost/test/unit_test.hpp>
@@ -63,4 +80,789 @@ BOOST_AUTO_TEST_CASE( shared_ownership )
 	BOOST_CHECK_EQUAL(entities.size(), 1);
 	e2.clear();
 	BOOST_CHECK(entities.empty());
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE( queued_components_follow_entities )
+{
+	entity::entity_pool entities;
+	entity::component::sparse_pool<int> values(entities);
+	std::vector<entity::shared_entity> handles;
+	for(int i = 0; i < 8; ++i)
+	{
+		handles.push_back(entities.create_shared());
+	}
+
+	{
+		entity::component::creation_queue<decltype(values)> creator(values);
+		for(int i = 0; i < 8; i += 2)
+		{
+			creator.push(handles[i], i);
+		}
+	}
+
+	BOOST_CHECK_EQUAL(values.size(), 4);
+
+	// Releasing a handle swaps the last entity into its place.
+	handles[0].clear();
+	handles[3].clear();
+	BOOST_CHECK_EQUAL(values.size(), 3);
+	for(int i = 2; i < 8; i += 2)
+	{
+		BOOST_CHECK_EQUAL(*values.get(handles[i].get()), i);
+	}
+
+	{
+		entity::component::destruction_queue<decltype(values)> destroyer(values);
+		destroyer.push(handles[4]);
+	}
+
+	BOOST_CHECK_EQUAL(values.size(), 2);
+	BOOST_CHECK(!values.get(handles[4].get()));
+	BOOST_CHECK_EQUAL(*values.get(handles[6].get()), 6);
+}
+
+BOOST_AUTO_TEST_CASE( sparse_destroy_repoints_moved_component )
+{
+	entity::entity_pool entities;
+	entity::component::sparse_pool<int> values(entities);
+	std::vector<entity::entity> list;
+	for(int i = 0; i < 4; ++i)
+	{
+		list.push_back(entities.create());
+		values.create(list.back(), i);
+	}
+
+	// Destroying the first component moves the last one into its slot.
+	values.destroy(list[0]);
+	BOOST_CHECK(!values.get(list[0]));
+	BOOST_CHECK_EQUAL(*values.get(list[3]), 3);
+
+	values.destroy(list[3]);
+	BOOST_CHECK_EQUAL(values.size(), 2);
+	BOOST_CHECK_EQUAL(*values.get(list[1]), 1);
+	BOOST_CHECK_EQUAL(*values.get(list[2]), 2);
+}
+
+BOOST_AUTO_TEST_CASE( sparse_table_follows_entity_count )
+{
+	entity::entity_pool entities;
+	entity::component::sparse_pool<int> values(entities);
+	for(int i = 0; i < 16; ++i)
+	{
+		auto e = entities.create();
+		if(i % 2)
+			values.create(e, i);
+	}
+
+	while(entities.size() > 4)
+	{
+		entities.destroy(entity::make_entity(0));
+	}
+
+	BOOST_CHECK_EQUAL(values.memory_stats().slot_count, entities.size());
+	for(auto e : entities)
+	{
+		if(values.get(e))
+			BOOST_CHECK(*values.get(e) % 2);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( sparse_swap_with_missing_component )
+{
+	entity::entity_pool entities;
+	entity::component::sparse_pool<int> values(entities);
+	auto bare = entities.create();
+	auto held = entities.create();
+	values.create(held, 7);
+
+	// Destroying the first entity swaps the second into its place,
+	// and only one of them has a component.
+	entities.destroy(bare);
+	BOOST_CHECK_EQUAL(values.size(), 1);
+	BOOST_CHECK_EQUAL(*values.get(entity::make_entity(0)), 7);
+
+	auto fresh = entities.create();
+	BOOST_CHECK(!values.get(fresh));
+	entities.destroy(entity::make_entity(0));
+	BOOST_CHECK_EQUAL(values.size(), 0);
+	BOOST_CHECK(!values.get(entity::make_entity(0)));
+}
+
+BOOST_AUTO_TEST_CASE( sparse_queued_creation_appends )
+{
+	entity::entity_pool entities;
+	entity::component::sparse_pool<int> values(entities);
+	std::vector<entity::shared_entity> handles;
+	for(int i = 0; i < 8; ++i)
+	{
+		handles.push_back(entities.create_shared());
+	}
+
+	values.create(handles[0].get(), 0);
+
+	// The queue appends to a pool that already holds a component.
+	{
+		entity::component::creation_queue<decltype(values)> creator(values);
+		for(int i = 1; i < 8; ++i)
+		{
+			creator.push(handles[i], i);
+		}
+	}
+
+	BOOST_CHECK_EQUAL(values.size(), 8);
+
+	// Destroying from the front moves each last component forward, which
+	// only lands on the right entity if every one was recorded.
+	for(int i = 0; i < 4; ++i)
+	{
+		values.destroy(handles[i].get());
+	}
+
+	BOOST_CHECK_EQUAL(values.size(), 4);
+	for(int i = 4; i < 8; ++i)
+	{
+		BOOST_CHECK_EQUAL(*values.get(handles[i].get()), i);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( hashed_components_follow_entities )
+{
+	entity::entity_pool entities;
+	entity::component::hashed_pool<int> hashed(entities);
+	entity::component::sparse_pool<int> reference(entities);
+	std::vector<entity::shared_entity> handles;
+
+	// Randomly churn entities and components, checking the hashed pool
+	// against a sparse pool holding the same values.
+	std::mt19937 rng(7);
+	for(int step = 0; step < 4000; ++step)
+	{
+		int const action = rng() % 4;
+		if(action == 0 || handles.empty())
+		{
+			handles.push_back(entities.create_shared());
+		}
+		else if(action == 1)
+		{
+			std::size_t const victim = rng() % handles.size();
+			std::swap(handles[victim], handles.back());
+			handles.pop_back();
+		}
+		else
+		{
+			entity::entity const e = handles[rng() % handles.size()].get();
+			if(hashed.get(e))
+			{
+				hashed.destroy(e);
+				reference.destroy(e);
+			}
+			else
+			{
+				hashed.create(e, step);
+				reference.create(e, step);
+			}
+		}
+	}
+
+	BOOST_CHECK_EQUAL(hashed.size(), reference.size());
+	for(auto&& h : handles)
+	{
+		auto expected = reference.get(h.get());
+		auto actual = hashed.get(h.get());
+		BOOST_CHECK_EQUAL(!!actual, !!expected);
+		if(expected && actual)
+			BOOST_CHECK_EQUAL(*actual, *expected);
+	}
+
+	auto const& owners = hashed.entities();
+	auto value = hashed.begin();
+	for(std::size_t i = 0; i < owners.size(); ++i, ++value)
+	{
+		BOOST_CHECK_EQUAL(*value, *reference.get(entity::make_entity(owners[i])));
+	}
+}
+
+BOOST_AUTO_TEST_CASE( tags_follow_entities )
+{
+	struct marked {};
+	entity::entity_pool entities;
+	entity::component::tag_pool<marked> tags(entities);
+	std::vector<entity::shared_entity> handles;
+	for(int i = 0; i < 130; ++i)
+	{
+		handles.push_back(entities.create_shared());
+		if(i % 3 == 0)
+			tags.create(handles.back().get());
+	}
+
+	{
+		entity::component::destruction_queue<decltype(tags)> destroyer(tags);
+		destroyer.push(handles[3]);
+	}
+
+	// Releasing handles swaps the last entities into their places.
+	std::vector<int> alive;
+	for(int i = 0; i < 130; ++i)
+	{
+		if(i % 5 == 0)
+			handles[i].clear();
+		else
+			alive.push_back(i);
+	}
+
+	BOOST_CHECK_EQUAL(entities.size(), alive.size());
+	std::size_t expected = 0;
+	for(int i : alive)
+	{
+		bool const tagged = i % 3 == 0 && i != 3;
+		expected += tagged;
+		BOOST_CHECK_EQUAL(!!tags.get(handles[i].get()), tagged);
+	}
+
+	BOOST_CHECK_EQUAL(tags.size(), expected);
+	for(auto e : tags)
+	{
+		BOOST_CHECK(e.index() < entities.size());
+	}
+}
+
+BOOST_AUTO_TEST_CASE( hierarchy_follows_entities )
+{
+	entity::entity_pool entities;
+	entity::component::hierarchy_pool<int> nodes(entities);
+	std::vector<entity::shared_entity> handles;
+	for(int i = 0; i < 6; ++i)
+	{
+		handles.push_back(entities.create_shared());
+	}
+
+	// 0 -> 1 -> { 2, 5 }, 3 -> 4
+	nodes.create(handles[0].get(), 0);
+	nodes.create_child(handles[1].get(), handles[0].get(), 1);
+	nodes.create_child(handles[2].get(), handles[1].get(), 2);
+	nodes.create(handles[3].get(), 3);
+	nodes.create_child(handles[4].get(), handles[3].get(), 4);
+	nodes.create_child(handles[5].get(), handles[1].get(), 5);
+
+	std::vector<int> order(nodes.begin(), nodes.end());
+	BOOST_CHECK((order == std::vector<int>{ 0, 1, 2, 5, 3, 4 }));
+
+	// Releasing 1 swaps 5, a child of 1, into its place; 1's children
+	// are given to 0.
+	handles[1].clear();
+	BOOST_CHECK_EQUAL(nodes.size(), 5);
+	BOOST_CHECK_EQUAL(nodes.parent(handles[5].get())->index(), handles[0].get().index());
+	BOOST_CHECK_EQUAL(nodes.parent(handles[2].get())->index(), handles[0].get().index());
+
+	// More releases shuffle the remaining entities; parent links follow
+	// them.
+	handles[4].clear();
+	nodes.set_parent(handles[3].get(), handles[2].get());
+	handles[0].clear();
+	BOOST_CHECK(!nodes.parent(handles[2].get()));
+	BOOST_CHECK(!nodes.parent(handles[5].get()));
+	BOOST_CHECK_EQUAL(nodes.parent(handles[3].get())->index(), handles[2].get().index());
+	BOOST_CHECK_EQUAL(*nodes.get(handles[3].get()), 3);
+
+	order.assign(nodes.begin(), nodes.end());
+	BOOST_CHECK((order == std::vector<int>{ 2, 3, 5 }));
+}
+
+BOOST_AUTO_TEST_CASE( sharded_entities_migrate )
+{
+	typedef entity::component::saturated_pool<int> id_pool;
+	typedef entity::component::sparse_pool<float> speed_pool;
+	typedef entity::sharded_world<id_pool, speed_pool> world_type;
+
+	world_type world(4);
+	std::map<entity::global_entity, std::pair<int, float>> reference;
+	std::vector<entity::global_entity> alive;
+	std::mt19937 rng(29);
+
+	auto spawn = [&](int i)
+	{
+		auto g = world.create(rng() % world.shard_count());
+		*world.get<id_pool>(g) = i;
+		float speed = -1.f;
+		if(i % 2)
+		{
+			speed = float(i) * 0.5f;
+			auto where = world.locate(g);
+			world.get_shard(where.shard).pool<speed_pool>().create(where.local, speed);
+		}
+
+		reference[g] = std::make_pair(i, speed);
+		alive.push_back(g);
+	};
+
+	for(int i = 0; i < 200; ++i)
+		spawn(i);
+
+	for(int round = 0; round < 10; ++round)
+	{
+		// Shards queue migrations of their own entities, the world
+		// queues some more.
+		world.for_each_shard([&](world_type::shard& s)
+		{
+			for(auto e : s.entities())
+			{
+				if(rng() % 4 == 0)
+					s.migrate(e, rng() % world.shard_count());
+			}
+		});
+
+		for(int i = 0; i < 10; ++i)
+			world.migrate(alive[rng() % alive.size()], rng() % world.shard_count());
+
+		// Destroyed entities drop their queued migrations.
+		for(int i = 0; i < 5; ++i)
+		{
+			std::size_t const victim = rng() % alive.size();
+			world.destroy(alive[victim]);
+			BOOST_CHECK(!world.contains(alive[victim]));
+			reference.erase(alive[victim]);
+			alive.erase(alive.begin() + victim);
+		}
+
+		world.sync();
+		for(int i = 0; i < 5; ++i)
+			spawn(1000 + round * 10 + i);
+
+		BOOST_CHECK_EQUAL(world.size(), reference.size());
+		std::size_t total = 0;
+		world.for_each_shard([&](world_type::shard& s)
+		{
+			total += s.entities().size();
+			for(auto e : s.entities())
+			{
+				auto g = s.global(e);
+				auto where = world.locate(g);
+				BOOST_CHECK_EQUAL(where.shard, s.index());
+				BOOST_CHECK_EQUAL(where.local.index(), e.index());
+			}
+		});
+
+		BOOST_CHECK_EQUAL(total, reference.size());
+		for(auto&& r : reference)
+		{
+			BOOST_CHECK_EQUAL(*world.get<id_pool>(r.first), r.second.first);
+			auto speed = world.get<speed_pool>(r.first);
+			BOOST_CHECK_EQUAL(!!speed, r.second.second >= 0.f);
+			if(speed)
+				BOOST_CHECK_EQUAL(*speed, r.second.second);
+		}
+	}
+
+	// Global systems see every component once.
+	std::size_t seen = 0;
+	world.for_each<speed_pool>([&](entity::global_entity g, float speed)
+	{
+		BOOST_CHECK_EQUAL(speed, reference[g].second);
+		++seen;
+	});
+
+	std::size_t expected = 0;
+	for(auto&& r : reference)
+		expected += r.second.second >= 0.f;
+	BOOST_CHECK_EQUAL(seen, expected);
+
+	BOOST_CHECK_THROW(world.get_shard(4), std::out_of_range);
+	BOOST_CHECK_THROW(world.migrate(alive.front(), 7), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE( sharded_reused_ids_drop_stale_migrations )
+{
+	typedef entity::component::saturated_pool<int> id_pool;
+	typedef entity::sharded_world<id_pool> world_type;
+
+	world_type world(2);
+
+	// The id of a destroyed entity is reused before the sync that would
+	// have moved it.
+	auto a = world.create(0);
+	world.migrate(a, 1);
+	world.destroy(a);
+	auto b = world.create(0);
+	BOOST_CHECK_EQUAL(b.index(), a.index());
+	BOOST_CHECK(a != b);
+	BOOST_CHECK(!world.contains(a));
+	BOOST_CHECK(world.contains(b));
+	BOOST_CHECK_THROW(world.locate(a), std::out_of_range);
+
+	BOOST_CHECK_EQUAL(world.sync(), 0);
+	BOOST_CHECK_EQUAL(world.locate(b).shard, 0);
+
+	// Entities made directly on a shard have no global id, and destroying
+	// a global entity through its shard releases the id.
+	world_type::shard& s0 = world.get_shard(0);
+	auto local = s0.entities().create();
+	auto c = world.create(0);
+	BOOST_CHECK_THROW(s0.global(local), std::invalid_argument);
+	BOOST_CHECK_THROW(s0.migrate(local, 1), std::invalid_argument);
+
+	s0.entities().destroy(world.locate(b).local);
+	BOOST_CHECK(!world.contains(b));
+	BOOST_CHECK_EQUAL(world.size(), 1);
+	BOOST_CHECK_EQUAL(s0.entities().size(), 2);
+	BOOST_CHECK(s0.global(world.locate(c).local) == c);
+
+	s0.entities().destroy(local);
+	BOOST_CHECK(s0.global(world.locate(c).local) == c);
+	world.migrate(c, 1);
+	BOOST_CHECK_EQUAL(world.sync(), 1);
+	BOOST_CHECK_EQUAL(world.locate(c).shard, 1);
+	BOOST_CHECK_EQUAL(world.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( sharded_migrate_while_world_grows )
+{
+	typedef entity::component::saturated_pool<int> id_pool;
+	typedef entity::sharded_world<id_pool> world_type;
+
+	world_type world(2);
+	std::vector<entity::global_entity> movers;
+	for(int i = 0; i < 100; ++i)
+		movers.push_back(world.create(0));
+
+	// Shard 0's thread names and queues its entities while the world
+	// grows its tables for new entities on shard 1.
+	world_type::shard& s0 = world.get_shard(0);
+	std::vector<entity::global_entity> named;
+	std::thread worker(
+		[&]
+		{
+			for(auto e : s0.entities())
+			{
+				named.push_back(s0.global(e));
+				s0.migrate(e, 1);
+			}
+		}
+	);
+
+	for(int i = 0; i < 1000; ++i)
+		world.create(1);
+
+	worker.join();
+	BOOST_CHECK(std::is_permutation(named.begin(), named.end(), movers.begin(), movers.end()));
+	BOOST_CHECK_EQUAL(world.sync(), movers.size());
+	for(auto g : movers)
+		BOOST_CHECK_EQUAL(world.locate(g).shard, 1);
+}
+
+BOOST_AUTO_TEST_CASE( world_matches_signalled_pools )
+{
+	typedef entity::component::saturated_pool<int> id_pool;
+	typedef entity::component::dense_pool<float> speed_pool;
+	typedef entity::component::sparse_pool<double> mass_pool;
+	typedef entity::component::hashed_pool<char> tag_pool;
+
+	entity::world<id_pool, speed_pool, mass_pool, tag_pool> world;
+
+	entity::entity_pool entities;
+	id_pool ids(entities);
+	speed_pool speeds(entities);
+	mass_pool masses(entities);
+	tag_pool tags(entities);
+
+	std::mt19937 rng(31);
+	int next_id = 0;
+	auto spawn = [&]
+	{
+		auto a = world.create();
+		auto b = entities.create();
+		BOOST_CHECK(a == b);
+		*world.get<int>(a) = *ids.get(b) = next_id;
+		if(next_id % 2)
+		{
+			world.add<float>(a, float(next_id));
+			speeds.create(b, float(next_id));
+		}
+
+		if(next_id % 3)
+		{
+			world.add<mass_pool>(a, next_id * 2.0);
+			masses.create(b, next_id * 2.0);
+		}
+
+		if(next_id % 5 == 0)
+		{
+			world.add<char>(a, 'x');
+			tags.create(b, 'x');
+		}
+
+		++next_id;
+	};
+
+	for(int i = 0; i < 100; ++i)
+		spawn();
+
+	for(int round = 0; round < 20; ++round)
+	{
+		for(int i = 0; i < 10; ++i)
+		{
+			auto e = entity::make_entity(rng() % world.size());
+			world.destroy(e);
+			entities.destroy(e);
+		}
+
+		for(int i = 0; i < 3; ++i)
+		{
+			auto e = entity::make_entity(rng() % world.size());
+			if(world.get<float>(e))
+			{
+				world.remove<float>(e);
+				speeds.destroy(e);
+			}
+		}
+
+		for(int i = 0; i < 8; ++i)
+			spawn();
+
+		BOOST_CHECK_EQUAL(world.size(), entities.size());
+		for(auto e : entities)
+		{
+			BOOST_CHECK_EQUAL(*world.get<int>(e), *ids.get(e));
+			BOOST_CHECK_EQUAL(!!world.get<float>(e), !!speeds.get(e));
+			BOOST_CHECK_EQUAL(!!world.get<double>(e), !!masses.get(e));
+			BOOST_CHECK_EQUAL(!!world.get<char>(e), !!tags.get(e));
+			if(speeds.get(e))
+				BOOST_CHECK_EQUAL(*world.get<float>(e), *speeds.get(e));
+			if(masses.get(e))
+				BOOST_CHECK_EQUAL(*world.get<double>(e), *masses.get(e));
+		}
+	}
+
+	// The view holds exactly the entities with every component.
+	std::size_t expected = 0;
+	for(auto e : entities)
+	{
+		if(speeds.get(e) && masses.get(e))
+			++expected;
+	}
+
+	std::size_t seen = 0;
+	auto v = world.view<int, float, double const>();
+	for(auto i = v.begin(); i != v.end(); ++i)
+	{
+		auto e = i.get_entity();
+		BOOST_CHECK_EQUAL(std::get<0>(*i), *ids.get(e));
+		BOOST_CHECK_EQUAL(std::get<1>(*i), *speeds.get(e));
+		BOOST_CHECK_EQUAL(std::get<2>(*i), *masses.get(e));
+		++seen;
+	}
+
+	BOOST_CHECK_EQUAL(seen, expected);
+
+	// The hashed pool is the smallest, so it leads the walk.
+	std::size_t tagged = 0;
+	auto t = world.view<char const, int const>();
+	for(auto i = t.begin(); i != t.end(); ++i)
+	{
+		auto e = i.get_entity();
+		BOOST_CHECK(tags.get(e));
+		BOOST_CHECK_EQUAL(std::get<1>(*i), *ids.get(e));
+		++tagged;
+	}
+
+	BOOST_CHECK_EQUAL(t.driver(), 0u);
+	BOOST_CHECK_EQUAL(tagged, tags.size());
+
+	world.view<float, int const>().for_each([](float& speed, int const& id)
+	{
+		speed = float(id) * 10.f;
+	});
+
+	for(auto e : world)
+	{
+		if(world.get<float>(e))
+			BOOST_CHECK_EQUAL(*world.get<float>(e), float(*world.get<int>(e)) * 10.f);
+	}
+
+	std::size_t all = 0;
+	world.view<id_pool>().for_each([&all](int&) { ++all; });
+	BOOST_CHECK_EQUAL(all, world.size());
+}
+
+BOOST_AUTO_TEST_CASE( disabled_entities_are_skipped )
+{
+	typedef entity::component::saturated_pool<int> id_pool;
+
+	entity::entity_pool entities;
+	id_pool ids(entities);
+	std::set<int> disabled;
+	std::mt19937 rng(41);
+	int next_id = 0;
+
+	auto spawn = [&]
+	{
+		*ids.get(entities.create()) = next_id++;
+	};
+
+	for(int i = 0; i < 300; ++i)
+		spawn();
+
+	for(int round = 0; round < 20; ++round)
+	{
+		// Park some, wake some, and destroy some so the swaps move
+		// disabled entities around.
+		for(int i = 0; i < 40; ++i)
+		{
+			auto e = entity::make_entity(rng() % entities.size());
+			if(rng() % 3)
+			{
+				entities.disable(e);
+				disabled.insert(*ids.get(e));
+			}
+			else
+			{
+				entities.enable(e);
+				disabled.erase(*ids.get(e));
+			}
+		}
+
+		for(int i = 0; i < 10; ++i)
+		{
+			auto e = entity::make_entity(rng() % entities.size());
+			disabled.erase(*ids.get(e));
+			entities.destroy(e);
+		}
+
+		for(int i = 0; i < 10; ++i)
+			spawn();
+
+		std::vector<int> expected;
+		for(auto e : entities)
+		{
+			bool const off = disabled.count(*ids.get(e)) != 0;
+			BOOST_CHECK_EQUAL(entities.is_enabled(e), !off);
+			if(!off)
+				expected.push_back(*ids.get(e));
+		}
+
+		std::vector<int> seen;
+		auto enabled = entities.enabled();
+		for(auto&& i : entity::range::combine(enabled, ids))
+			seen.push_back(*std::get<0>(i));
+
+		BOOST_CHECK(seen == expected);
+		BOOST_CHECK_EQUAL(entities.enabled_count(), expected.size());
+	}
+
+	// Whole words of disabled entities.
+	for(auto e : entities)
+		entities.disable(e);
+	BOOST_CHECK(entities.enabled().empty());
+	BOOST_CHECK_EQUAL(entities.enabled_count(), 0u);
+
+	auto last = entity::make_entity(entities.size() - 1);
+	entities.enable(last);
+	BOOST_CHECK_EQUAL(boost::distance(entities.enabled()), 1);
+	BOOST_CHECK(*entities.enabled_begin() == last);
+}
+
+BOOST_AUTO_TEST_CASE( disabled_entities_leave_views )
+{
+	typedef entity::component::saturated_pool<int> id_pool;
+	typedef entity::component::sparse_pool<float> speed_pool;
+
+	entity::world<id_pool, speed_pool> world;
+	std::set<int> disabled;
+	std::mt19937 rng(43);
+	int next_id = 0;
+
+	auto spawn = [&]
+	{
+		auto e = world.create();
+		*world.get<int>(e) = next_id;
+		if(next_id % 2)
+			world.add<float>(e, float(next_id));
+		++next_id;
+	};
+
+	for(int i = 0; i < 200; ++i)
+		spawn();
+
+	for(int round = 0; round < 20; ++round)
+	{
+		for(int i = 0; i < 30; ++i)
+		{
+			auto e = entity::make_entity(rng() % world.size());
+			if(rng() % 3)
+			{
+				world.disable(e);
+				disabled.insert(*world.get<int>(e));
+			}
+			else
+			{
+				world.enable(e);
+				disabled.erase(*world.get<int>(e));
+			}
+		}
+
+		for(int i = 0; i < 10; ++i)
+		{
+			auto e = entity::make_entity(rng() % world.size());
+			disabled.erase(*world.get<int>(e));
+			world.destroy(e);
+		}
+
+		for(int i = 0; i < 10; ++i)
+			spawn();
+
+		std::vector<int> ids;
+		std::set<int> moving;
+		for(auto e : world)
+		{
+			int const id = *world.get<int>(e);
+			BOOST_CHECK_EQUAL(world.is_enabled(e), disabled.count(id) == 0);
+			if(!world.is_enabled(e))
+				continue;
+
+			ids.push_back(id);
+			if(world.get<float>(e))
+				moving.insert(id);
+		}
+
+		BOOST_CHECK_EQUAL(world.enabled_count(), ids.size());
+
+		// Walked by the saturated pool.
+		std::vector<int> walked;
+		for(auto&& c : world.view<int>())
+			walked.push_back(std::get<0>(c));
+		BOOST_CHECK(walked == ids);
+
+		walked.clear();
+		world.view<int>().for_each([&](int id) { walked.push_back(id); });
+		BOOST_CHECK(walked == ids);
+
+		// Driven by the sparse pool.
+		std::set<int> driven;
+		for(auto&& c : world.view<int, float>())
+			driven.insert(std::get<0>(c));
+		BOOST_CHECK(driven == moving);
+
+		driven.clear();
+		world.view<int, float>().for_each([&](int id, float) { driven.insert(id); });
+		BOOST_CHECK(driven == moving);
+	}
+
+	// Sharded worlds skip entities disabled in their shard.
+	typedef entity::sharded_world<id_pool, speed_pool> sharded_type;
+	sharded_type sharded(2);
+	std::set<entity::global_entity> expected;
+	for(int i = 0; i < 100; ++i)
+	{
+		auto g = sharded.create(i % 2);
+		auto where = sharded.locate(g);
+		sharded_type::shard& s = sharded.get_shard(where.shard);
+		s.pool<speed_pool>().create(where.local, float(i));
+		if(i % 3)
+			s.entities().disable(where.local);
+		else
+			expected.insert(g);
+	}
+
+	std::set<entity::global_entity> seen;
+	sharded.for_each<speed_pool>([&](entity::global_entity g, float) { seen.insert(g); });
+	BOOST_CHECK(seen == expected);
+}
@@ -1,6 +1,12 @@
+#include "entity/component/adaptive_pool.hpp"
+#include "entity/component/cow_pool.hpp"
 #include "entity/component/dense_pool.hpp"
+#include "entity/component/hashed_pool.hpp"
+#include "entity/component/hierarchy_pool.hpp"
 #include "entity/component/sparse_pool.hpp"
 #include "entity/component/saturated_pool.hpp"
+#include "entity/component/shared_value_pool.hpp"
+#include "entity/component/tag_pool.hpp"
 #include "entity/entity_pool.hpp"
 #include "entity/entity.hpp"
 
@@ -10,12 +16,22 @@ int main()
 	entity::component::saturated_pool<float> sat_pool(entities);
 	entity::component::dense_pool<float> dense_pool(entities);
 	entity::component::sparse_pool<float> sparse_pool(entities);
+	entity::component::hashed_pool<float> hashed_pool(entities);
+	entity::component::adaptive_pool<float> adaptive_pool(entities);
+	entity::component::hierarchy_pool<float> hierarchy_pool(entities);
+	entity::component::tag_pool<float> tag_pool(entities);
+	entity::component::shared_value_pool<float> shared_value_pool(entities);
+	entity::component::cow_pool<float> cow_pool(entities);
 
 	entities.create();
 
 	entity::component::saturated_pool<std::unique_ptr<float>> mo_sat_pool(entities);
 	entity::component::dense_pool<std::unique_ptr<float>> mo_dense_pool(entities);
 	entity::component::sparse_pool<std::unique_ptr<float>> mo_sparse_pool(entities);
+	entity::component::hashed_pool<std::unique_ptr<float>> mo_hashed_pool(entities);
+	entity::component::adaptive_pool<std::unique_ptr<float>> mo_adaptive_pool(entities);
+	entity::component::hierarchy_pool<std::unique_ptr<float>> mo_hierarchy_pool(entities);
+	entity::component::shared_value_pool<std::unique_ptr<float>> mo_shared_value_pool(entities);
 
 	return 0;
 }
\ No newline at end of file
@@ -10,15 +10,33 @@
 // http://www.boost.org/LICENSE_1_0.txt
 //
 // ****************************************************************************
+#include "entity/component/adaptive_pool.hpp"
 #include "entity/component/saturated_pool.hpp"
+#include "entity/component/cow_pool.hpp"
 #include "entity/component/dense_pool.hpp"
 #include "entity/component/sparse_pool.hpp"
+#include "entity/component/hashed_pool.hpp"
+#include "entity/component/hierarchy_pool.hpp"
+#include "entity/component/shared_value_pool.hpp"
+#include "entity/component/spatial_grid.hpp"
+#include "entity/component/tag_pool.hpp"
 #include "entity/range/combine.hpp"
+#include "entity/range/fuse.hpp"
 #include "entity/entity_pool.hpp"
 #include "entity/entity.hpp"
+#include "entity/registry.hpp"
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <numeric>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 
 #define BOOST_TEST_MODULE Iteration
@@ -256,6 +274,21 @@ BOOST_AUTO_TEST_CASE( sparse_iteration )
 	SimpleIteratePool<entity::component::sparse_pool<float>>();
 }
 
+BOOST_AUTO_TEST_CASE( hashed_iteration )
+{
+	SimpleIteratePool<entity::component::hashed_pool<float>>();
+}
+
+BOOST_AUTO_TEST_CASE( adaptive_iteration )
+{
+	SimpleIteratePool<entity::component::adaptive_pool<float>>();
+}
+
+BOOST_AUTO_TEST_CASE( cow_iteration )
+{
+	SimpleIteratePool<entity::component::cow_pool<float>>();
+}
+
 BOOST_AUTO_TEST_CASE( optional_saturated_iteration )
 {
 	OptionalSimpleIteratePool<entity::component::saturated_pool<float>>();
@@ -271,6 +304,21 @@ BOOST_AUTO_TEST_CASE( optional_sparse_iteration )
 	OptionalSimpleIteratePool<entity::component::sparse_pool<float>>();
 }
 
+BOOST_AUTO_TEST_CASE( optional_hashed_iteration )
+{
+	OptionalSimpleIteratePool<entity::component::hashed_pool<float>>();
+}
+
+BOOST_AUTO_TEST_CASE( optional_adaptive_iteration )
+{
+	OptionalSimpleIteratePool<entity::component::adaptive_pool<float>>();
+}
+
+BOOST_AUTO_TEST_CASE( optional_cow_iteration )
+{
+	OptionalSimpleIteratePool<entity::component::cow_pool<float>>();
+}
+
 BOOST_AUTO_TEST_CASE( saturated_accumulation )
 {
 	AccumulatePool<entity::component::saturated_pool<int>>();
@@ -286,6 +334,21 @@ BOOST_AUTO_TEST_CASE( sparse_accumulation )
 	AccumulatePool<entity::component::sparse_pool<int>>();
 }
 
+BOOST_AUTO_TEST_CASE( hashed_accumulation )
+{
+	AccumulatePool<entity::component::hashed_pool<int>>();
+}
+
+BOOST_AUTO_TEST_CASE( adaptive_accumulation )
+{
+	AccumulatePool<entity::component::adaptive_pool<int>>();
+}
+
+BOOST_AUTO_TEST_CASE( cow_accumulation )
+{
+	AccumulatePool<entity::component::cow_pool<int>>();
+}
+
 BOOST_AUTO_TEST_CASE( optional_saturated_accumulation )
 {
 	entity::entity_pool entities;
@@ -365,6 +428,524 @@ BOOST_AUTO_TEST_CASE( optional_sparse_accumulation )
 	BOOST_TEST_CHECK(sum == expected_sum);
 }
 
+BOOST_AUTO_TEST_CASE( dense_iteration_skips_free_slots )
+{
+	entity::entity_pool entities;
+	entity::component::dense_pool<int> pool(entities);
+	std::vector<int> expected;
+	for(int i = 0; i < 20; ++i)
+	{
+		auto e = entities.create();
+		if(i % 3 == 0)
+		{
+			pool.create(e, i);
+			expected.push_back(i);
+		}
+	}
+
+	// Runs of free slots between occupied ones, and after the last.
+	std::vector<int> visited(pool.begin(), pool.end());
+	BOOST_TEST_CHECK(visited == expected);
+	BOOST_TEST_CHECK(std::distance(pool.begin(), pool.end()) == static_cast<std::ptrdiff_t>(pool.size()));
+}
+
+BOOST_AUTO_TEST_CASE( shared_value_grouped_iteration )
+{
+	entity::entity_pool entities;
+	entity::component::shared_value_pool<int> materials(entities);
+	entity::component::dense_pool<int> counts(entities);
+	for(int i = 0; i < 100; ++i)
+	{
+		auto e = entities.create();
+		counts.create(e, 1);
+		if(i % 10)
+			materials.create(e, i % 3);
+	}
+
+	BOOST_TEST_CHECK(materials.size() == 90);
+	BOOST_TEST_CHECK(materials.unique_size() == 3);
+	BOOST_TEST_CHECK(std::accumulate(materials.begin(), materials.end(), 0) == 0 + 1 + 2);
+
+	// Each value is visited once with every entity holding it.
+	std::size_t visited = 0;
+	materials.for_each_group(
+		[&](int const& value, entity::entity const* first, entity::entity const* last)
+		{
+			for(; first != last; ++first)
+			{
+				BOOST_TEST_CHECK(static_cast<int>(first->index() % 3) == value);
+				BOOST_TEST_CHECK(first->index() % 10 != 0);
+				++visited;
+			}
+		}
+	);
+
+	BOOST_TEST_CHECK(visited == 90);
+
+	int total = 0;
+	auto range = entity::range::combine(entities, materials, counts);
+	std::for_each(
+		range.begin(),
+		range.end(),
+		[&total](std::tuple<entity::component::optional<int const>, entity::component::optional<int>> t)
+		{
+			if(std::get<0>(t))
+				total += *std::get<0>(t) * *std::get<1>(t);
+		}
+	);
+
+	BOOST_TEST_CHECK(total == 30 * (0 + 1 + 2));
+}
+
+BOOST_AUTO_TEST_CASE( tag_iteration )
+{
+	struct frozen {};
+	entity::entity_pool entities;
+	entity::component::tag_pool<frozen> tags(entities);
+	entity::component::dense_pool<int> values(entities);
+
+	// Leave whole words untagged so iteration has to skip them.
+	std::vector<entity::entity> expected;
+	for(int i = 0; i < 300; ++i)
+	{
+		auto e = entities.create();
+		if(i % 7 == 0 && (i < 64 || i >= 192))
+		{
+			tags.create(e);
+			expected.push_back(e);
+		}
+
+		if(i % 2 == 0)
+			values.create(e, i);
+	}
+
+	BOOST_TEST_CHECK(tags.size() == expected.size());
+	BOOST_TEST_CHECK(std::equal(tags.begin(), tags.end(), expected.begin(), expected.end()));
+
+	int sum = 0;
+	int expected_sum = 0;
+	for(auto&& e : expected)
+	{
+		if(e.index() % 2 == 0)
+			expected_sum += static_cast<int>(e.index());
+	}
+
+	auto range = entity::range::combine(entities, tags, values);
+	std::for_each(
+		range.begin(),
+		range.end(),
+		[&sum](std::tuple<entity::component::optional<frozen>, entity::component::optional<int>> t)
+		{
+			if(std::get<0>(t) && std::get<1>(t))
+				sum += *std::get<1>(t);
+		}
+	);
+
+	BOOST_TEST_CHECK(sum == expected_sum);
+}
+
+BOOST_AUTO_TEST_CASE( tag_set_operations )
+{
+	struct even {};
+	struct triple {};
+	entity::entity_pool entities;
+	entity::component::tag_pool<even> evens(entities);
+	entity::component::tag_pool<triple> triples(entities);
+	for(int i = 0; i < 1000; ++i)
+	{
+		auto e = entities.create();
+		if(i % 2 == 0)
+			evens.create(e);
+		if(i % 3 == 0)
+			triples.create(e);
+	}
+
+	BOOST_TEST_CHECK(evens.intersects(triples));
+	BOOST_TEST_CHECK(evens.intersection_size(triples) == 167);
+
+	evens |= triples;
+	BOOST_TEST_CHECK(evens.size() == 500 + 334 - 167);
+
+	evens -= triples;
+	BOOST_TEST_CHECK(evens.size() == 500 - 167);
+	BOOST_TEST_CHECK(!evens.intersects(triples));
+
+	evens ^= triples;
+	evens &= triples;
+	BOOST_TEST_CHECK(evens.size() == triples.size());
+	for(auto e : evens)
+	{
+		BOOST_TEST_CHECK(e.index() % 3 == 0);
+	}
+}
+
+// ----------------------------------------------------------------------------
+//
+template<typename Pool>
+void CheckHierarchy(Pool& pool)
+{
+	auto const& parents = pool.parent_positions();
+	auto const& sizes = pool.subtree_sizes();
+	auto const& owners = pool.entities();
+	std::vector<std::size_t> child_total(pool.size(), 0);
+	for(std::size_t i = 0; i < pool.size(); ++i)
+	{
+		BOOST_TEST_CHECK(pool.position(entity::make_entity(owners[i])) == i);
+		auto const p = parents[i];
+		if(p == Pool::no_parent())
+		{
+			BOOST_TEST_CHECK(!pool.parent(entity::make_entity(owners[i])));
+			continue;
+		}
+
+		// Parents come first and their subtree spans their children.
+		BOOST_TEST_CHECK(p < i);
+		BOOST_TEST_CHECK(i + sizes[i] <= p + sizes[p]);
+		BOOST_TEST_CHECK(pool.parent(entity::make_entity(owners[i]))->index() == owners[p]);
+		child_total[p] += sizes[i];
+	}
+
+	for(std::size_t i = 0; i < pool.size(); ++i)
+	{
+		BOOST_TEST_CHECK(sizes[i] == child_total[i] + 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( hierarchy_depth_first_order )
+{
+	entity::entity_pool entities;
+	entity::component::hierarchy_pool<int> pool(entities);
+	std::vector<entity::entity> nodes;
+	std::mt19937 rng(11);
+	for(int i = 0; i < 300; ++i)
+	{
+		auto e = entities.create();
+		if(nodes.empty() || rng() % 5 == 0)
+			pool.create(e, i);
+		else
+			pool.create_child(e, nodes[rng() % nodes.size()], i);
+		nodes.push_back(e);
+	}
+
+	CheckHierarchy(pool);
+
+	for(int i = 0; i < 200; ++i)
+	{
+		auto e = nodes[rng() % nodes.size()];
+		auto p = nodes[rng() % nodes.size()];
+		auto span = pool.subtree(e);
+		bool const cycle = std::any_of(
+			span.begin(), span.end(), [&](int v) { return v == *pool.get(p); }
+		);
+
+		if(rng() % 10 == 0)
+		{
+			pool.clear_parent(e);
+		}
+		else if(cycle)
+		{
+			BOOST_CHECK_THROW(pool.set_parent(e, p), std::invalid_argument);
+		}
+		else
+		{
+			pool.set_parent(e, p);
+			BOOST_TEST_CHECK(pool.parent(e)->index() == p.index());
+		}
+
+		if(i % 50 == 0)
+			CheckHierarchy(pool);
+	}
+
+	for(int i = 0; i < 50; ++i)
+	{
+		std::size_t const victim = rng() % nodes.size();
+		pool.destroy(nodes[victim]);
+		nodes.erase(nodes.begin() + victim);
+	}
+
+	CheckHierarchy(pool);
+
+	// Depths in one forward pass match walking up the parent links.
+	std::vector<int> depth(pool.size());
+	auto const& parents = pool.parent_positions();
+	for(std::size_t i = 0; i < pool.size(); ++i)
+	{
+		depth[i] = parents[i] == pool.no_parent() ? 0 : depth[parents[i]] + 1;
+	}
+
+	for(auto e : nodes)
+	{
+		int expected = 0;
+		for(auto p = pool.parent(e); p; p = pool.parent(*p))
+			++expected;
+		BOOST_TEST_CHECK(depth[pool.position(e)] == expected);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( spatial_grid_queries )
+{
+	typedef std::array<float, 3> vec3;
+	typedef entity::component::sparse_pool<vec3> position_pool;
+
+	entity::entity_pool entities;
+	position_pool positions(entities);
+
+	// Few buckets, so distinct cells share them.
+	entity::component::spatial_grid<position_pool> grid(entities, positions, 4.f, 64);
+
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> coord(-50.f, 50.f);
+	auto random_point = [&]()
+	{
+		vec3 p = {{ coord(rng), coord(rng), coord(rng) }};
+		return p;
+	};
+
+	auto brute_force = [&](vec3 const& lo, vec3 const& hi, vec3 const& c, float radius)
+	{
+		std::vector<entity::entity_index_t> hits;
+		for(auto e : entities)
+		{
+			auto p = positions.get(e);
+			if(!p)
+				continue;
+
+			float dist_sq = 0.f;
+			bool inside = true;
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				inside = inside && (*p)[axis] >= lo[axis] && (*p)[axis] <= hi[axis];
+				dist_sq += ((*p)[axis] - c[axis]) * ((*p)[axis] - c[axis]);
+			}
+
+			if(radius < 0.f ? inside : dist_sq <= radius * radius)
+				hits.push_back(e.index());
+		}
+
+		return hits;
+	};
+
+	auto indices = [](entity::component::spatial_grid<position_pool>::result_range r)
+	{
+		std::vector<entity::entity_index_t> hits;
+		for(auto e : r)
+			hits.push_back(e.index());
+		std::sort(hits.begin(), hits.end());
+		return hits;
+	};
+
+	for(int i = 0; i < 400; ++i)
+	{
+		auto e = entities.create();
+		if(rng() % 4)
+			positions.create(e, random_point());
+	}
+
+	for(int round = 0; round < 20; ++round)
+	{
+		for(int i = 0; i < 60; ++i)
+		{
+			auto e = entity::make_entity(rng() % entities.size());
+			auto p = positions.get(e);
+			if(p)
+				*p = random_point();
+			else
+				positions.create(e, random_point());
+			grid.mark_moved(e);
+		}
+
+		for(int i = 0; i < 10; ++i)
+		{
+			auto e = entity::make_entity(rng() % entities.size());
+			if(positions.get(e))
+			{
+				positions.destroy(e);
+				grid.mark_moved(e);
+			}
+
+			entities.destroy(entity::make_entity(rng() % entities.size()));
+			auto n = entities.create();
+			positions.create(n, random_point());
+		}
+
+		if(round % 5 == 4)
+			grid.refresh();
+		else
+			grid.update();
+
+		BOOST_TEST_CHECK(grid.size() == positions.size());
+
+		for(int q = 0; q < 10; ++q)
+		{
+			vec3 const c = random_point();
+			float const radius = (rng() % 3 == 0) ? 60.f : 6.f;
+			vec3 lo;
+			vec3 hi;
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				lo[axis] = c[axis] - radius;
+				hi[axis] = c[axis] + radius * 0.5f;
+			}
+
+			std::vector<entity::entity> out;
+			BOOST_TEST_CHECK(indices(grid.query_radius(c, radius, out)) == brute_force(lo, hi, c, radius));
+			BOOST_TEST_CHECK(indices(grid.query_box(lo, hi, out)) == brute_force(lo, hi, c, -1.f));
+		}
+	}
+
+	// Query results zip with the component pools.
+	std::vector<entity::entity> out;
+	vec3 const c = {{ 0.f, 0.f, 0.f }};
+	auto hits = grid.query_radius(c, 20.f, out);
+	BOOST_TEST_CHECK(!hits.empty());
+	for(auto&& i : entity::range::combine(hits, positions))
+	{
+		vec3 const& p = *std::get<0>(i);
+		BOOST_TEST_CHECK(p[0] * p[0] + p[1] * p[1] + p[2] * p[2] <= 400.f);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( registry_queries_by_id )
+{
+	typedef entity::component::saturated_pool<int> id_pool;
+	typedef entity::component::dense_pool<float> speed_pool;
+	typedef entity::component::sparse_pool<std::string> name_pool;
+	typedef entity::component::hashed_pool<double> mass_pool;
+
+	entity::entity_pool entities;
+	id_pool ids(entities);
+	speed_pool speeds(entities);
+	name_pool names(entities);
+	mass_pool masses(entities);
+
+	entity::component_registry registry(entities);
+	BOOST_TEST_CHECK(registry.add_pool(ids, "id") == 0u);
+	BOOST_TEST_CHECK(registry.add_pool(speeds, "speed") == 1u);
+	BOOST_TEST_CHECK(registry.add_pool(names, "name") == 2u);
+	BOOST_TEST_CHECK(registry.add_pool(masses, "mass") == 3u);
+	BOOST_CHECK_THROW(registry.add_pool(ids, "other"), std::invalid_argument);
+	BOOST_CHECK_THROW(registry.add_pool(ids, "speed"), std::invalid_argument);
+
+	entity::component_id const speed = registry.find("speed");
+	entity::component_id const name = registry.find("name");
+	entity::component_id const mass = registry.id_of<mass_pool>();
+	BOOST_TEST_CHECK(speed == registry.id_of<speed_pool>());
+	BOOST_TEST_CHECK(registry.find("missing") == entity::invalid_component_id);
+	BOOST_TEST_CHECK(registry.id_of<entity::component::dense_pool<int>>() == entity::invalid_component_id);
+	BOOST_TEST_CHECK(registry.info(speed).size == sizeof(float));
+	BOOST_TEST_CHECK(registry.info(speed).serializable);
+	BOOST_TEST_CHECK(!registry.info(name).serializable);
+	BOOST_CHECK_THROW(registry.info(7), std::out_of_range);
+
+	// Half the components go in through the typed pools, half by id.
+	std::mt19937 rng(37);
+	for(int i = 0; i < 200; ++i)
+	{
+		auto e = entities.create();
+		*ids.get(e) = i;
+		if(rng() % 2)
+		{
+			float const v = float(i);
+			if(i % 2)
+				speeds.create(e, v);
+			else
+				registry.create_copy(speed, e, &v);
+		}
+
+		if(rng() % 3 == 0)
+			*static_cast<double*>(registry.create(mass, e)) = i * 2.0;
+	}
+
+	BOOST_CHECK_THROW(registry.get(speed, entity::make_entity(500)), std::out_of_range);
+
+	auto brute_force = [&](bool need_speed, bool need_mass)
+	{
+		std::vector<entity::entity_index_t> result;
+		for(auto e : entities)
+		{
+			if((!need_speed || speeds.get(e)) && (!need_mass || masses.get(e)))
+				result.push_back(e.index());
+		}
+
+		return result;
+	};
+
+	auto query = [&](entity::component_mask const& mask)
+	{
+		std::vector<entity::entity_index_t> result;
+		registry.for_each(mask, [&result](entity::entity e) { result.push_back(e.index()); });
+		return result;
+	};
+
+	entity::component_mask both;
+	both.set(speed);
+	both.set(mass);
+	BOOST_TEST_CHECK(query(both) == brute_force(true, true));
+	BOOST_TEST_CHECK(query(registry.mask<speed_pool>()) == brute_force(true, false));
+	BOOST_TEST_CHECK(query(registry.mask<id_pool>()).size() == entities.size());
+	BOOST_TEST_CHECK(registry.count(both) == brute_force(true, true).size());
+
+	// Copy, move and destroy by id.
+	auto a = entity::make_entity(brute_force(true, false).front());
+	auto b = entity::make_entity(brute_force(true, false).back());
+	auto c = entity::make_entity(0);
+	BOOST_TEST_CHECK(registry.mask_of(a).test(speed));
+	registry.destroy(speed, a);
+	BOOST_TEST_CHECK(!speeds.get(a));
+	BOOST_TEST_CHECK(!registry.copy(speed, a, c));
+	BOOST_TEST_CHECK(registry.copy(speed, b, a));
+	BOOST_TEST_CHECK(*speeds.get(a) == *speeds.get(b));
+
+	std::string moved = "moved";
+	registry.create_move(name, c, &moved);
+	BOOST_TEST_CHECK(*names.get(c) == "moved");
+	BOOST_TEST_CHECK(*static_cast<std::string*>(registry.get(name, c)) == "moved");
+
+	// Serialization round trips through raw bytes.
+	std::vector<std::uint8_t> bytes;
+	BOOST_TEST_CHECK(registry.save(speed, b, bytes));
+	BOOST_TEST_CHECK(bytes.size() == sizeof(float));
+	std::uint8_t const* first = bytes.data();
+	registry.load(speed, c, first, bytes.data() + bytes.size());
+	BOOST_TEST_CHECK(first == bytes.data() + bytes.size());
+	BOOST_TEST_CHECK(*speeds.get(c) == *speeds.get(b));
+	BOOST_CHECK_THROW(registry.save(name, c, bytes), std::runtime_error);
+
+	// Typed access keeps the pools' own iterators.
+	std::vector<std::pair<int, float>> viewed;
+	registry.view<id_pool, speed_pool const>().for_each(
+		[&](int& id, float const& v)
+		{
+			viewed.emplace_back(id, v);
+		}
+	);
+
+	std::vector<std::pair<int, float>> expected;
+	for(auto e : entities)
+	{
+		if(speeds.get(e))
+			expected.emplace_back(*ids.get(e), *speeds.get(e));
+	}
+
+	BOOST_TEST_CHECK(viewed == expected);
+	BOOST_TEST_CHECK(viewed.size() == registry.count(registry.mask<speed_pool>()));
+	BOOST_TEST_CHECK(&registry.pool<name_pool>() == &names);
+
+	// Views leave out disabled entities.
+	entities.disable(b);
+	viewed.clear();
+	registry.view<id_pool, speed_pool const>().for_each(
+		[&](int& id, float const& v)
+		{
+			viewed.emplace_back(id, v);
+		}
+	);
+
+	expected.erase(std::find(expected.begin(), expected.end(),
+		std::make_pair(*ids.get(b), *speeds.get(b))));
+	BOOST_TEST_CHECK(viewed == expected);
+}
+
 BOOST_AUTO_TEST_CASE( tied_iteration )
 {
 	auto entities = CreateFilledPool();
@@ -442,4 +1023,76 @@ BOOST_AUTO_TEST_CASE( partial_list_iteration )
 //	IterateTied(*entities, ids);
 //}
 
+BOOST_AUTO_TEST_CASE( fused_stages_match_separate_passes )
+{
+	entity::entity_pool entities;
+	entity::component::dense_pool<float> accel(entities);
+	entity::component::dense_pool<float> velocity(entities);
+	entity::component::sparse_pool<double> position(entities);
 
+	for(int i = 0; i < 1000; ++i)
+	{
+		auto e = entities.create();
+		accel.create(e, float(i % 7));
+		if(i % 3)
+			velocity.create(e, float(i));
+		if(i % 5)
+			position.create(e, double(i));
+	}
+
+	auto jerk = [](entity::component::optional<float> a)
+	{
+		if(a)
+			*a += 1.f;
+	};
+
+	auto accelerate = [](std::tuple<
+		entity::component::optional<float>,
+		entity::component::optional<float>> av)
+	{
+		auto a = std::get<0>(av);
+		auto v = std::get<1>(av);
+		if(a && v)
+			*v += *a * 0.5f;
+	};
+
+	auto move = [](std::tuple<
+		entity::component::optional<float>,
+		entity::component::optional<double>> vp)
+	{
+		auto v = std::get<0>(vp);
+		auto p = std::get<1>(vp);
+		if(v && p)
+			*p += *v * 0.25;
+	};
+
+	// The separate passes first, on copies of the state.
+	std::vector<float> expected_v;
+	std::vector<double> expected_p;
+	for(auto e : entities)
+	{
+		float const a = *accel.get(e) + 1.f;
+		float const v = velocity.get(e) ? *velocity.get(e) + a * 0.5f : 0.f;
+		expected_v.push_back(v);
+		expected_p.push_back(
+			position.get(e) ? *position.get(e) + (velocity.get(e) ? v * 0.25 : 0.) : 0.
+		);
+	}
+
+	auto pipeline = entity::range::fuse(
+		entity::range::stage(jerk, accel),
+		entity::range::stage(accelerate, accel, velocity),
+		entity::range::stage(move, velocity, position)
+	);
+
+	pipeline.for_each(entities);
+
+	for(auto e : entities)
+	{
+		BOOST_CHECK_EQUAL(*accel.get(e), float(e.index() % 7) + 1.f);
+		if(velocity.get(e))
+			BOOST_CHECK_EQUAL(*velocity.get(e), expected_v[e.index()]);
+		if(position.get(e))
+			BOOST_CHECK_EQUAL(*position.get(e), expected_p[e.index()]);
+	}
+}
@@ -0,0 +1,663 @@
+// ****************************************************************************
+// test/memory.cpp
+//
+// Part of the test harness for entity.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#include "entity/component/adaptive_pool.hpp"
+#include "entity/component/cow_pool.hpp"
+#include "entity/component/dense_pool.hpp"
+#include "entity/component/hashed_pool.hpp"
+#include "entity/component/sparse_pool.hpp"
+#include "entity/component/saturated_pool.hpp"
+#include "entity/component/shared_value_pool.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/entity.hpp"
+#include "entity/memory_usage.hpp"
+#include "entity/shrink_policy.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE Memory
+#include <boost/test/unit_test.hpp>
+
+static int const kNumEntities = 100;
+
+BOOST_AUTO_TEST_CASE( entity_pool_memory_stats )
+{
+	entity::entity_pool entities;
+	BOOST_CHECK_EQUAL(entities.memory_stats().live_count, 0);
+
+	for(int i = 0; i < kNumEntities; ++i)
+	{
+		entities.create_shared();
+	}
+
+	// Shared handles were dropped so the pool is empty again, but it
+	// still holds onto its index storage.
+	auto usage = entities.memory_stats();
+	BOOST_CHECK_EQUAL(usage.live_count, 0);
+	BOOST_CHECK(usage.reserved_bytes > 0);
+
+	for(int i = 0; i < kNumEntities; ++i)
+	{
+		entities.create();
+	}
+
+	usage = entities.memory_stats();
+	BOOST_CHECK_EQUAL(usage.live_count, kNumEntities);
+	BOOST_CHECK(usage.live_bytes <= usage.reserved_bytes);
+	BOOST_CHECK(usage.index_bytes >= kNumEntities * sizeof(entity::entity_index_t*));
+}
+
+BOOST_AUTO_TEST_CASE( component_pool_memory_stats )
+{
+	entity::entity_pool entities;
+	entity::component::saturated_pool<float> sat_pool(entities);
+	entity::component::dense_pool<float> dense_pool(entities);
+	entity::component::sparse_pool<float> sparse_pool(entities);
+
+	for(int i = 0; i < kNumEntities; ++i)
+	{
+		auto e = entities.create();
+		if(i % 4 == 0)
+		{
+			dense_pool.create(e, 0.f);
+			sparse_pool.create(e, 0.f);
+		}
+	}
+
+	auto sat_usage = sat_pool.memory_stats();
+	BOOST_CHECK_EQUAL(sat_usage.live_bytes, kNumEntities * sizeof(float));
+	BOOST_CHECK(sat_usage.reserved_bytes >= sat_usage.live_bytes);
+	BOOST_CHECK_EQUAL(sat_usage.index_bytes, 0);
+
+	auto dense_usage = dense_pool.memory_stats();
+	BOOST_CHECK_EQUAL(dense_usage.live_count, kNumEntities / 4);
+	BOOST_CHECK_EQUAL(dense_usage.slot_count, kNumEntities);
+	BOOST_CHECK_CLOSE(dense_usage.occupancy(), 0.25, 0.001);
+	BOOST_CHECK(dense_usage.fragmentation() >= 0.75);
+	BOOST_CHECK(dense_usage.index_bytes >= kNumEntities);
+
+	auto sparse_usage = sparse_pool.memory_stats();
+	BOOST_CHECK_EQUAL(sparse_usage.live_bytes, (kNumEntities / 4) * sizeof(float));
+	BOOST_CHECK_EQUAL(sparse_usage.slot_count, kNumEntities);
+	BOOST_CHECK_CLOSE(sparse_usage.occupancy(), 0.25, 0.001);
+	BOOST_CHECK(sparse_usage.index_bytes >= kNumEntities * sizeof(entity::entity_index_t));
+
+	auto total = entity::total_memory_usage(entities, sat_pool, dense_pool, sparse_pool);
+	BOOST_CHECK_EQUAL(
+		total.total_bytes(),
+		entities.memory_stats().total_bytes() +
+		sat_usage.total_bytes() + 
+		dense_usage.total_bytes() + 
+		sparse_usage.total_bytes()
+	);
+}
+
+// ----------------------------------------------------------------------------
+//
+static int const kPeakEntities = 10000;
+static int const kSurvivors = 10;
+
+BOOST_AUTO_TEST_CASE( shrink_after_mass_destruction )
+{
+	entity::entity_pool entities;
+	entity::component::saturated_pool<float> sat_pool(entities);
+	entity::component::dense_pool<float> dense_pool(entities);
+	entity::component::sparse_pool<float> sparse_pool(entities);
+
+	for(int i = 0; i < kPeakEntities; ++i)
+	{
+		auto e = entities.create();
+		dense_pool.create(e, 0.f);
+		sparse_pool.create(e, 0.f);
+	}
+
+	auto peak = entity::total_memory_usage(entities, sat_pool, dense_pool, sparse_pool);
+
+	while(entities.size() > kSurvivors)
+	{
+		entities.destroy(entity::make_entity(entities.size() - 1));
+	}
+
+	BOOST_CHECK_EQUAL(
+		entity::total_memory_usage(entities, sat_pool, dense_pool, sparse_pool).total_bytes(),
+		peak.total_bytes()
+	);
+
+	entities.compact();
+	sat_pool.compact();
+	dense_pool.compact();
+	sparse_pool.compact();
+
+	auto shrunk = entity::total_memory_usage(entities, sat_pool, dense_pool, sparse_pool);
+	BOOST_CHECK(shrunk.total_bytes() * 10 < peak.total_bytes());
+	BOOST_CHECK_EQUAL(shrunk.live_count, kSurvivors * 4);
+	BOOST_CHECK_EQUAL(sparse_pool.size(), kSurvivors);
+
+	// Pools must still be usable afterwards.
+	for(int i = 0; i < kSurvivors; ++i)
+	{
+		auto e = entities.create();
+		sparse_pool.create(e, 1.f);
+	}
+
+	BOOST_CHECK_EQUAL(sparse_pool.size(), kSurvivors * 2);
+	BOOST_CHECK_EQUAL(*sparse_pool.get(entity::make_entity(kSurvivors)), 1.f);
+}
+
+BOOST_AUTO_TEST_CASE( entity_pool_compact_keeps_handles )
+{
+	entity::entity_pool entities;
+	std::vector<entity::shared_entity> handles;
+	for(int i = 0; i < kPeakEntities; ++i)
+	{
+		handles.push_back(entities.create_shared());
+	}
+
+	auto const peak = entities.memory_stats();
+
+	// Keep a handful spread across the index blocks.
+	std::vector<entity::shared_entity> survivors;
+	for(int i = 0; i < kPeakEntities; i += kPeakEntities / kSurvivors)
+	{
+		survivors.push_back(handles[i]);
+	}
+
+	handles.clear();
+	entities.compact();
+
+	BOOST_CHECK(entities.memory_stats().reserved_bytes < peak.reserved_bytes);
+	BOOST_CHECK_EQUAL(entities.size(), survivors.size());
+	for(auto&& h : survivors)
+	{
+		BOOST_CHECK(h.get().index() < entities.size());
+	}
+
+	for(int i = 0; i < kPeakEntities; ++i)
+	{
+		handles.push_back(entities.create_shared());
+	}
+
+	BOOST_CHECK_EQUAL(entities.size(), kPeakEntities + survivors.size());
+}
+
+BOOST_AUTO_TEST_CASE( sparse_compact_restores_order )
+{
+	entity::entity_pool entities;
+	entity::component::sparse_pool<int> pool(entities);
+
+	std::vector<entity::entity> list;
+	for(int i = 0; i < 100; ++i)
+	{
+		list.push_back(entities.create());
+	}
+
+	// Create in reverse order so storage order is the opposite of
+	// entity order, then punch some holes.
+	for(auto i = list.rbegin(); i != list.rend(); ++i)
+	{
+		pool.create(*i, static_cast<int>(i->index()));
+	}
+
+	for(int i = 0; i < 100; i += 3)
+	{
+		pool.destroy(list[i]);
+	}
+
+	for(int i = 0; i < 100; ++i)
+	{
+		auto c = pool.get(list[i]);
+		BOOST_CHECK_EQUAL(!!c, (i % 3) != 0);
+		if(c)
+			BOOST_CHECK_EQUAL(*c, i);
+	}
+
+	pool.compact();
+
+	int last = -1;
+	for(int v : pool)
+	{
+		BOOST_CHECK(v > last);
+		last = v;
+	}
+
+	for(int i = 0; i < 100; ++i)
+	{
+		auto c = pool.get(list[i]);
+		BOOST_CHECK_EQUAL(!!c, (i % 3) != 0);
+		if(c)
+			BOOST_CHECK_EQUAL(*c, i);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( hashed_pool_memory_follows_components )
+{
+	entity::entity_pool entities;
+	entity::component::hashed_pool<int> pool(entities);
+
+	std::vector<entity::entity> list;
+	for(int i = 0; i < kNumEntities * 100; ++i)
+	{
+		list.push_back(entities.create());
+	}
+
+	// A handful of components in a large world, created out of order.
+	for(int i = kNumEntities * 100 - 1; i >= 0; i -= 1000)
+	{
+		pool.create(list[i], i);
+	}
+
+	auto usage = pool.memory_stats();
+	BOOST_CHECK_EQUAL(usage.live_count, 10);
+	BOOST_CHECK(usage.index_bytes < kNumEntities * sizeof(entity::entity_index_t));
+
+	pool.destroy(list[999]);
+	pool.compact();
+	BOOST_CHECK_EQUAL(pool.size(), 9);
+	BOOST_CHECK(!pool.get(list[999]));
+
+	int last = -1;
+	for(int v : pool)
+	{
+		BOOST_CHECK(v > last);
+		BOOST_CHECK_EQUAL(*pool.get(list[v]), v);
+		last = v;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( shared_value_pool_deduplicates )
+{
+	typedef std::vector<float> blob;
+	entity::entity_pool entities;
+	entity::component::shared_value_pool<blob> pool(entities);
+
+	std::vector<entity::entity> list;
+	for(int i = 0; i < kNumEntities * 10; ++i)
+	{
+		list.push_back(entities.create());
+		pool.create(list.back(), 64, float(i % 4));
+	}
+
+	BOOST_CHECK_EQUAL(pool.size(), kNumEntities * 10);
+	BOOST_CHECK_EQUAL(pool.unique_size(), 4);
+	BOOST_CHECK_EQUAL(pool.use_count(list[1]), kNumEntities * 10 / 4);
+	BOOST_CHECK_EQUAL(pool.memory_stats().live_bytes, 4 * sizeof(blob));
+
+	// Release two of the values entirely, then compact them away.
+	for(auto&& e : list)
+	{
+		if(pool.get(e)->front() < 2.f)
+			pool.create(e, 64, 3.f);
+	}
+
+	BOOST_CHECK_EQUAL(pool.unique_size(), 2);
+	pool.compact();
+	BOOST_CHECK_EQUAL(pool.memory_stats().slot_count, 2);
+	BOOST_CHECK_EQUAL(pool.use_count(list[0]), kNumEntities * 10 * 3 / 4);
+	for(int i = 0; i < kNumEntities * 10; ++i)
+	{
+		BOOST_CHECK_EQUAL(pool.get(list[i])->front(), i % 4 == 2 ? 2.f : 3.f);
+	}
+
+	pool.destroy(list[2]);
+	BOOST_CHECK_EQUAL(pool.size(), kNumEntities * 10 - 1);
+	BOOST_CHECK(!pool.get(list[2]));
+
+	// Destroying an entity moves the last one, and its value, into place.
+	entities.destroy(list[2]);
+	BOOST_CHECK_EQUAL(pool.size(), kNumEntities * 10 - 1);
+	BOOST_CHECK_EQUAL(pool.get(list[2])->front(), 3.f);
+	entities.destroy(list[3]);
+	BOOST_CHECK_EQUAL(pool.size(), kNumEntities * 10 - 2);
+}
+
+BOOST_AUTO_TEST_CASE( adaptive_pool_switches_layout )
+{
+	entity::entity_pool entities;
+	entity::component::adaptive_pool<int> pool(entities);
+	pool.set_policy(entity::component::adaptive_policy(0.5, 0.1, 0));
+
+	// Handles and the value each one's component should hold, or -1.
+	std::vector<std::pair<entity::shared_entity, int>> list;
+	for(int i = 0; i < kNumEntities * 10; ++i)
+	{
+		list.emplace_back(entities.create_shared(), -1);
+	}
+
+	auto check_values = [&]
+	{
+		int sum = 0;
+		for(int v : pool)
+			sum += v;
+
+		int expected = 0;
+		std::size_t count = 0;
+		for(auto&& h : list)
+		{
+			auto c = pool.get(h.first.get());
+			BOOST_CHECK_EQUAL(!!c, h.second >= 0);
+			if(c)
+			{
+				BOOST_CHECK_EQUAL(*c, h.second);
+				expected += *c;
+				++count;
+			}
+		}
+
+		BOOST_CHECK_EQUAL(sum, expected);
+		BOOST_CHECK_EQUAL(count, pool.size());
+	};
+
+	auto create = [&](std::size_t i)
+	{
+		list[i].second = static_cast<int>(i);
+		pool.create(list[i].first.get(), list[i].second);
+	};
+
+	auto destroy = [&](std::size_t i)
+	{
+		list[i].second = -1;
+		pool.destroy(list[i].first.get());
+	};
+
+	// Low occupancy stays sparse.
+	for(int i = 0; i < kNumEntities; i += 2)
+	{
+		create(i);
+	}
+
+	BOOST_CHECK(pool.layout() == entity::component::adaptive_layout::sparse);
+
+	// Crossing the dense threshold starts a migration that proceeds a
+	// budget at a time, with every component reachable throughout.
+	for(int i = 1; i < kNumEntities * 10; i += 2)
+	{
+		create(i);
+	}
+
+	BOOST_CHECK(pool.layout() == entity::component::adaptive_layout::migrating_to_dense);
+	while(pool.layout() == entity::component::adaptive_layout::migrating_to_dense)
+	{
+		BOOST_CHECK_EQUAL(pool.adapt_step(4 * sizeof(int)), 4 * sizeof(int));
+		check_values();
+	}
+
+	BOOST_CHECK(pool.layout() == entity::component::adaptive_layout::dense);
+
+	// Releasing entities swaps the last ones, with components, into place.
+	for(int i = kNumEntities * 10 - 1; i >= 0; --i)
+	{
+		if(i % 3 == 0)
+			list.erase(list.begin() + i);
+	}
+
+	check_values();
+
+	// Hysteresis keeps occupancy between the thresholds from flipping
+	// the layout; dropping below the sparse threshold migrates back.
+	std::size_t next = 0;
+	while(pool.size() * 10 > entities.size() * 3)
+	{
+		if(list[next].second >= 0)
+			destroy(next);
+		++next;
+	}
+
+	BOOST_CHECK(pool.layout() == entity::component::adaptive_layout::dense);
+	while(pool.size() * 10 > entities.size())
+	{
+		if(list[next].second >= 0)
+			destroy(next);
+		++next;
+	}
+
+	BOOST_CHECK(pool.layout() == entity::component::adaptive_layout::migrating_to_sparse);
+	check_values();
+	pool.adapt_step(sizeof(int));
+	list.pop_back();
+	list.erase(list.begin());
+	check_values();
+
+	pool.compact();
+	BOOST_CHECK(pool.layout() == entity::component::adaptive_layout::sparse);
+	check_values();
+	BOOST_CHECK(pool.memory_stats().reserved_bytes < kNumEntities * 10 * sizeof(int) / 4);
+
+	// By default migrations also advance as components are created.
+	pool.set_policy(entity::component::adaptive_policy());
+	for(std::size_t i = 0; i < list.size(); ++i)
+	{
+		if(list[i].second < 0)
+			create(i);
+	}
+
+	BOOST_CHECK(pool.layout() == entity::component::adaptive_layout::dense);
+	check_values();
+}
+
+BOOST_AUTO_TEST_CASE( cow_pool_snapshots_share_pages )
+{
+	typedef entity::component::cow_pool<int> pool_type;
+	entity::entity_pool entities;
+	pool_type pool(entities);
+
+	std::size_t const num_entities = pool_type::page_size * 4;
+	for(std::size_t i = 0; i < num_entities; ++i)
+	{
+		auto e = entities.create();
+		if(i % 3)
+			pool.create(e, int(i));
+	}
+
+	// Without snapshots writes happen in place.
+	*pool.get(entity::make_entity(1)) = 1;
+	BOOST_CHECK_EQUAL(pool.retired_page_count(), 0);
+
+	auto first = pool.snapshot();
+	BOOST_CHECK_EQUAL(first->size(), pool.size());
+	BOOST_CHECK_EQUAL(first->entity_count(), num_entities);
+
+	// Touching one page copies only that page.
+	*pool.get(entity::make_entity(1)) = -1;
+	*pool.get(entity::make_entity(2)) = -2;
+	pool.destroy(entity::make_entity(4));
+	BOOST_CHECK_EQUAL(pool.retired_page_count(), 1);
+	BOOST_CHECK_EQUAL(*first->get(entity::make_entity(1)), 1);
+	BOOST_CHECK_EQUAL(*first->get(entity::make_entity(4)), 4);
+	BOOST_CHECK_EQUAL(*pool.get(entity::make_entity(1)), -1);
+	BOOST_CHECK(!pool.get(entity::make_entity(4)));
+
+	// New entities and destruction don't show in the snapshot.
+	auto e = entities.create();
+	pool.create(e, 1000);
+	entities.destroy(entity::make_entity(0));
+
+	auto second = pool.snapshot();
+	*pool.get(entity::make_entity(2)) = -3;
+	*pool.get(entity::make_entity(num_entities - 2)) = -4;
+
+	int sum = 0;
+	int count = 0;
+	for(int v : *first)
+	{
+		sum += v;
+		++count;
+	}
+
+	BOOST_CHECK_EQUAL(count, first->size());
+	for(std::size_t i = 0; i < num_entities; ++i)
+	{
+		if(i % 3)
+			sum -= int(i);
+	}
+
+	BOOST_CHECK_EQUAL(sum, 0);
+	BOOST_CHECK_EQUAL(first->entity_count(), num_entities);
+	BOOST_CHECK_EQUAL(second->entity_count(), num_entities);
+	BOOST_CHECK_EQUAL(*second->get(entity::make_entity(0)), 1000);
+	BOOST_CHECK_EQUAL(*second->get(entity::make_entity(2)), -2);
+	BOOST_CHECK_EQUAL(*second->get(entity::make_entity(num_entities - 2)), int(num_entities - 2));
+
+	// The first page twice, the page dropped with the destroyed entity
+	// and the last page.
+	BOOST_CHECK_EQUAL(pool.retired_page_count(), 4);
+
+	// Pages replaced after the second snapshot wait for it, even once
+	// the first is gone.
+	first.reset();
+	pool.reclaim();
+	BOOST_CHECK_EQUAL(pool.retired_page_count(), 2);
+	second.reset();
+	pool.reclaim();
+	BOOST_CHECK_EQUAL(pool.retired_page_count(), 0);
+
+	// Snapshots outlive their pool.
+	std::shared_ptr<pool_type::snapshot_type const> orphan;
+	{
+		entity::entity_pool other_entities;
+		pool_type other(other_entities);
+		other.create(other_entities.create(), 7);
+		orphan = other.snapshot();
+	}
+
+	BOOST_CHECK_EQUAL(*orphan->get(entity::make_entity(0)), 7);
+}
+
+BOOST_AUTO_TEST_CASE( cow_pool_concurrent_snapshots )
+{
+	entity::entity_pool entities;
+	entity::component::cow_pool<int> pool(entities);
+	for(int i = 0; i < kNumEntities * 10; ++i)
+	{
+		pool.create(entities.create(), 0);
+	}
+
+	// Readers check each snapshot is a single frame: every component
+	// holds the same value.
+	typedef entity::component::cow_pool<int>::snapshot_type snapshot_type;
+	std::shared_ptr<snapshot_type const> latest = pool.snapshot();
+	std::mutex latest_mutex;
+	std::atomic<bool> done(false);
+	std::atomic<int> torn(0);
+
+	auto reader = [&]()
+	{
+		while(!done)
+		{
+			std::shared_ptr<snapshot_type const> s;
+			{
+				std::lock_guard<std::mutex> lock(latest_mutex);
+				s = latest;
+			}
+
+			int const frame = *s->begin();
+			for(int v : *s)
+			{
+				if(v != frame)
+					++torn;
+			}
+		}
+	};
+
+	std::thread render(reader);
+	std::thread stats(reader);
+	for(int frame = 1; frame <= 200; ++frame)
+	{
+		for(auto&& v : pool)
+			v = frame;
+
+		auto s = pool.snapshot();
+		std::lock_guard<std::mutex> lock(latest_mutex);
+		latest = s;
+	}
+
+	done = true;
+	render.join();
+	stats.join();
+	BOOST_CHECK_EQUAL(torn, 0);
+
+	latest.reset();
+	pool.reclaim();
+	BOOST_CHECK_EQUAL(pool.retired_page_count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( incremental_shrink )
+{
+	entity::entity_pool entities;
+	entity::component::saturated_pool<float> sat_pool(entities);
+	entity::component::sparse_pool<float> sparse_pool(entities);
+
+	for(int i = 0; i < kPeakEntities; ++i)
+	{
+		sparse_pool.create(entities.create(), 0.f);
+	}
+
+	while(entities.size() > kSurvivors)
+	{
+		entities.destroy(entity::make_entity(entities.size() - 1));
+	}
+
+	auto const before = entity::total_memory_usage(sat_pool, sparse_pool);
+	auto const entities_before = entities.memory_stats();
+
+	std::size_t const kBudget = 256;
+	entity::shrink_scheduler scheduler(entity::shrink_policy(0.75, 0.25, kBudget, 1024));
+	scheduler.add(entities);
+	scheduler.add(sat_pool);
+	scheduler.add(sparse_pool);
+
+	int steps = 0;
+	while(std::size_t spent = scheduler.update())
+	{
+		BOOST_CHECK(spent <= kBudget);
+		++steps;
+	}
+
+	// Several tables so it must have taken several frames.
+	BOOST_CHECK(steps > 1);
+
+	// The index nodes cost more to walk than the budget allows, so
+	// only the tables can be reclaimed this way.
+	auto const after = entity::total_memory_usage(sat_pool, sparse_pool);
+	BOOST_CHECK(after.total_bytes() * 10 < before.total_bytes());
+	BOOST_CHECK_EQUAL(after.live_count, before.live_count);
+	BOOST_CHECK(entities.memory_stats().index_bytes < entities_before.index_bytes);
+}
+
+BOOST_AUTO_TEST_CASE( shrink_step_leaves_tables_over_budget )
+{
+	entity::entity_pool entities;
+	entity::component::saturated_pool<float> pool(entities);
+	for(int i = 0; i < kPeakEntities; ++i)
+	{
+		entities.create();
+	}
+
+	while(entities.size() > kPeakEntities / 8)
+	{
+		entities.destroy(entity::make_entity(entities.size() - 1));
+	}
+
+	// The survivors alone cost more to copy than a step may spend, so
+	// steps never touch the table; only shrink_to_fit() reclaims it.
+	std::size_t const kBudget = 256;
+	entity::shrink_policy const policy(0.75, 0.25, kBudget, 1024);
+	auto const before = pool.memory_stats();
+	BOOST_CHECK(policy.should_shrink(entities.size(), before.reserved_bytes / sizeof(float), sizeof(float)));
+	BOOST_CHECK_EQUAL(pool.shrink_step(policy, kBudget), 0);
+	BOOST_CHECK_EQUAL(pool.memory_stats().reserved_bytes, before.reserved_bytes);
+
+	pool.shrink_to_fit();
+	BOOST_CHECK(pool.memory_stats().reserved_bytes < before.reserved_bytes);
+}
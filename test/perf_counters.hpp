@@ -0,0 +1,151 @@
+// ****************************************************************************
+// test/perf_counters.hpp
+//
+// Optional hardware performance counters for the benchmarks.
+//
+// When enabled with --entity_perf_counters, a perf_counters_scope opened
+// around a benchmark loop reads cache, TLB and branch counters through
+// perf_event_open and reports them per item next to the timings.
+// Counters the CPU, kernel or permissions don't provide are skipped, and
+// on platforms without perf_event_open nothing is reported at all.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#pragma once
+
+#include "benchmark/benchmark.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__linux__)
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  define ENTITY_HAS_PERF_EVENTS 1
+#else
+#  define ENTITY_HAS_PERF_EVENTS 0
+#endif
+
+// -----------------------------------------------------------------------------
+//
+inline bool& perf_counters_enabled()
+{
+	static bool enabled = false;
+	return enabled;
+}
+
+// -----------------------------------------------------------------------------
+//
+class perf_counters_scope
+{
+public:
+
+	// items is the number of entities, or other units of work, processed
+	// per benchmark iteration.
+	perf_counters_scope(benchmark::State& st, double items)
+		: st_(st)
+		, items_(items)
+	{
+		if(!perf_counters_enabled())
+			return;
+
+#if ENTITY_HAS_PERF_EVENTS
+		open("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		open("branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+		open("L1d_misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D));
+		open("LLC_misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL));
+		open("dTLB_misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB));
+
+		for(auto&& c : counters_)
+		{
+			ioctl(c.fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(c.fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	~perf_counters_scope()
+	{
+#if ENTITY_HAS_PERF_EVENTS
+		for(auto&& c : counters_)
+		{
+			ioctl(c.fd, PERF_EVENT_IOC_DISABLE, 0);
+		}
+
+		double const total_items = items_ * double(st_.iterations());
+		for(auto&& c : counters_)
+		{
+			// value, time enabled, time running; scale up if the kernel
+			// had to multiplex the counters.
+			std::uint64_t values[3] = {};
+			if(read(c.fd, values, sizeof(values)) == sizeof(values) &&
+				values[2] > 0 && total_items > 0)
+			{
+				double const count =
+					double(values[0]) * double(values[1]) / double(values[2]);
+				st_.counters[c.name] = count / total_items;
+			}
+
+			close(c.fd);
+		}
+#endif
+	}
+
+private:
+
+	// No copying.
+	perf_counters_scope(perf_counters_scope const&);
+	perf_counters_scope operator=(perf_counters_scope);
+
+#if ENTITY_HAS_PERF_EVENTS
+	struct counter
+	{
+		char const* name;
+		int fd;
+	};
+
+	static std::uint64_t cache_miss(std::uint64_t cache)
+	{
+		return cache
+			| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+		;
+	}
+
+	void open(char const* name, std::uint32_t type, std::uint64_t config)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format =
+			PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		int const fd = static_cast<int>(
+			syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)
+		);
+
+		if(fd >= 0)
+		{
+			counter c = { name, fd };
+			counters_.push_back(c);
+		}
+	}
+
+	std::vector<counter> counters_;
+#endif
+
+	benchmark::State& st_;
+	double items_;
+};
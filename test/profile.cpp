@@ -0,0 +1,124 @@
+// ****************************************************************************
+// test/profile.cpp
+//
+// Part of the test harness for entity.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#include "entity/component/creation_queue.hpp"
+#include "entity/component/dense_pool.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/entity.hpp"
+#include "entity/profile.hpp"
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE Profile
+#include <boost/test/unit_test.hpp>
+
+// Set for the whole target by test/CMakeLists.txt.
+#if !ENTITY_ENABLE_PROFILING
+#  error test.profile must be built with ENTITY_ENABLE_PROFILING=1.
+#endif
+
+static std::string export_trace()
+{
+	std::stringstream out;
+	entity::profile::profiler::instance().write_chrome_trace(out);
+	return out.str();
+}
+
+// ----------------------------------------------------------------------------
+//
+BOOST_AUTO_TEST_CASE( library_zones )
+{
+	entity::profile::profiler::instance().clear();
+
+	{
+		entity::entity_pool entities;
+		entity::component::dense_pool<float> values(entities);
+		std::vector<entity::shared_entity> handles;
+		for(int i = 0; i < 16; ++i)
+		{
+			handles.push_back(entities.create_shared());
+		}
+
+		entity::component::creation_queue<decltype(values)> creator(values);
+		for(auto&& h : handles)
+		{
+			creator.push(h, 1.f);
+		}
+
+		creator.flush();
+	}
+
+	std::string const trace = export_trace();
+	BOOST_CHECK(trace.find("{\"traceEvents\":[") == 0);
+	BOOST_CHECK(trace.find("\"name\":\"entity_pool::create_unique\"") != std::string::npos);
+	BOOST_CHECK(trace.find("\"name\":\"entity_pool::destroy\"") != std::string::npos);
+	BOOST_CHECK(trace.find("\"name\":\"creation_queue::flush\"") != std::string::npos);
+	BOOST_CHECK(trace.find("\"ph\":\"X\"") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE( user_zones_nest )
+{
+	entity::profile::profiler::instance().clear();
+	{
+		ENTITY_PROFILE_ZONE("frame");
+		{
+			ENTITY_PROFILE_ZONE("update \"physics\"");
+		}
+	}
+
+	BOOST_CHECK_EQUAL(entity::profile::profiler::instance().size(), 2);
+	std::string const trace = export_trace();
+
+	// Inner zones close first.
+	std::size_t const inner = trace.find("update \\\"physics\\\"");
+	std::size_t const outer = trace.find("\"frame\"");
+	BOOST_CHECK(inner != std::string::npos);
+	BOOST_CHECK(outer != std::string::npos);
+	BOOST_CHECK(inner < outer);
+}
+
+BOOST_AUTO_TEST_CASE( thread_ring_buffers )
+{
+	entity::profile::profiler& p = entity::profile::profiler::instance();
+	p.clear();
+	p.set_capacity(4);
+
+	// Boost.Test assertions are not thread safe; check after the join.
+	std::size_t worker_size = 0;
+	std::uint64_t worker_dropped = 0;
+	std::thread worker(
+		[&]
+		{
+			for(int i = 0; i < 10; ++i)
+			{
+				ENTITY_PROFILE_ZONE("worker");
+			}
+
+			worker_size = entity::profile::profiler::local().size();
+			worker_dropped = entity::profile::profiler::local().dropped();
+		}
+	);
+
+	worker.join();
+	BOOST_CHECK_EQUAL(worker_size, 4);
+	BOOST_CHECK_EQUAL(worker_dropped, 6);
+	p.set_capacity(entity::profile::profiler::default_capacity);
+
+	// The worker's buffer outlives it.
+	BOOST_CHECK_EQUAL(p.size(), 4);
+	std::string const trace = export_trace();
+	BOOST_CHECK(trace.find("\"tid\":1") == std::string::npos);
+	BOOST_CHECK(trace.find("\"name\":\"worker\"") != std::string::npos);
+}
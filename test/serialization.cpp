@@ -0,0 +1,472 @@
+// ****************************************************************************
+// test/serialization.cpp
+//
+// Part of the test harness for entity.
+//
+// Copyright Chris Glover 2014-2016
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt
+//
+// ****************************************************************************
+#include "entity/component/dense_pool.hpp"
+#include "entity/component/sparse_pool.hpp"
+#include "entity/component/saturated_pool.hpp"
+#include "entity/serialization/delta.hpp"
+#include "entity/serialization/history.hpp"
+#include "entity/serialization/snapshot.hpp"
+#include "entity/entity_pool.hpp"
+#include "entity/entity.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#define BOOST_TEST_MODULE Serialization
+#include <boost/test/unit_test.hpp>
+
+static int const kNumEntities = 1000;
+static char const* const kSnapshotPath = "test.serialization.snapshot";
+
+struct vec3
+{
+	float x, y, z;
+};
+
+// ----------------------------------------------------------------------------
+//
+BOOST_AUTO_TEST_CASE( snapshot_round_trip )
+{
+	{
+		entity::entity_pool entities;
+		entity::component::saturated_pool<vec3> positions(entities);
+		entity::component::dense_pool<float> health(entities);
+		entity::component::sparse_pool<int> targets(entities);
+
+		for(int i = 0; i < kNumEntities; ++i)
+		{
+			auto e = entities.create();
+			vec3 p = { float(i), float(i * 2), float(i * 3) };
+			*positions.get(e) = p;
+			if(i % 2)
+				health.create(e, float(i));
+			if(i % 10 == 0)
+				targets.create(e, i);
+		}
+
+		entity::serialization::save_snapshot(
+			kSnapshotPath, entities, positions, health, targets);
+	}
+
+	entity::entity_pool entities;
+	entity::component::saturated_pool<vec3> positions(entities);
+	entity::component::dense_pool<float> health(entities);
+	entity::component::sparse_pool<int> targets(entities);
+
+	entity::serialization::load_snapshot(
+		kSnapshotPath, entities, positions, health, targets);
+
+	BOOST_CHECK_EQUAL(entities.size(), kNumEntities);
+	BOOST_CHECK_EQUAL(positions.size(), kNumEntities);
+	BOOST_CHECK_EQUAL(health.size(), kNumEntities / 2);
+	BOOST_CHECK_EQUAL(targets.size(), kNumEntities / 10);
+
+	for(auto e : entities)
+	{
+		int const i = static_cast<int>(e.index());
+		BOOST_CHECK_EQUAL(positions.get(e)->z, float(i * 3));
+		BOOST_CHECK_EQUAL(!!health.get(e), (i % 2) != 0);
+		BOOST_CHECK_EQUAL(!!targets.get(e), (i % 10) == 0);
+		if(i % 10 == 0)
+			BOOST_CHECK_EQUAL(*targets.get(e), i);
+	}
+
+	// The restored world is live; churn it a little.
+	entities.destroy(entity::make_entity(0));
+	auto e = entities.create();
+	targets.create(e, -1);
+	BOOST_CHECK_EQUAL(entities.size(), kNumEntities);
+	BOOST_CHECK_EQUAL(*targets.get(e), -1);
+	BOOST_CHECK(!health.get(e));
+
+	std::remove(kSnapshotPath);
+}
+
+BOOST_AUTO_TEST_CASE( snapshot_mismatch )
+{
+	{
+		entity::entity_pool entities;
+		entity::component::saturated_pool<float> values(entities);
+		entities.create();
+		entity::serialization::save_snapshot(kSnapshotPath, entities, values);
+	}
+
+	{
+		entity::entity_pool entities;
+		entity::component::saturated_pool<double> values(entities);
+		BOOST_CHECK_THROW(
+			entity::serialization::load_snapshot(kSnapshotPath, entities, values),
+			std::runtime_error
+		);
+	}
+
+	{
+		entity::entity_pool entities;
+		entities.create();
+		BOOST_CHECK_THROW(
+			entity::serialization::load_snapshot(kSnapshotPath, entities),
+			std::logic_error
+		);
+	}
+
+	std::remove(kSnapshotPath);
+
+	entity::entity_pool entities;
+	BOOST_CHECK_THROW(
+		entity::serialization::load_snapshot(kSnapshotPath, entities),
+		std::runtime_error
+	);
+}
+
+BOOST_AUTO_TEST_CASE( snapshot_corrupt )
+{
+	namespace detail = entity::serialization::detail;
+
+	// Pool tables saved against a different entity pool.
+	{
+		entity::entity_pool entities;
+		entity::entity_pool others;
+		entity::component::sparse_pool<int> values(others);
+		entities.create();
+		for(int i = 0; i < 10; ++i)
+			values.create(others.create(), i);
+
+		entity::serialization::save_snapshot(kSnapshotPath, entities, values);
+	}
+
+	{
+		entity::entity_pool entities;
+		entity::component::sparse_pool<int> values(entities);
+		BOOST_CHECK_THROW(
+			entity::serialization::load_snapshot(kSnapshotPath, entities, values),
+			std::runtime_error
+		);
+	}
+
+	// A section count picked so offset + count * size wraps around.
+	{
+		entity::entity_pool entities;
+		entity::component::sparse_pool<int> values(entities);
+		values.create(entities.create(), 1);
+		entity::serialization::save_snapshot(kSnapshotPath, entities, values);
+	}
+
+	std::FILE* f = std::fopen(kSnapshotPath, "r+b");
+	BOOST_REQUIRE(f);
+	detail::section_header s;
+	std::fseek(f, sizeof(detail::file_header), SEEK_SET);
+	BOOST_REQUIRE_EQUAL(std::fread(&s, sizeof(s), 1, f), 1);
+	s.count = (~std::uint64_t(0) / s.element_size) + 1;
+	std::fseek(f, sizeof(detail::file_header), SEEK_SET);
+	BOOST_REQUIRE_EQUAL(std::fwrite(&s, sizeof(s), 1, f), 1);
+	std::fclose(f);
+
+	{
+		entity::entity_pool entities;
+		entity::component::sparse_pool<int> values(entities);
+		BOOST_CHECK_THROW(
+			entity::serialization::load_snapshot(kSnapshotPath, entities, values),
+			std::runtime_error
+		);
+	}
+
+	std::remove(kSnapshotPath);
+}
+
+// ----------------------------------------------------------------------------
+//
+template<typename Pool>
+void check_delta_round_trip()
+{
+	entity::entity_pool server_entities;
+	entity::entity_pool client_entities;
+	Pool server(server_entities);
+	Pool client(client_entities);
+
+	for(int i = 0; i < kNumEntities; ++i)
+	{
+		auto e = server_entities.create();
+		client_entities.create();
+		if(i % 3 == 0)
+		{
+			vec3 p = { float(i), 0.f, -float(i) };
+			server.create(e, p);
+		}
+	}
+
+	entity::serialization::delta_baseline<vec3> baseline;
+	std::vector<std::uint8_t> buffer;
+
+	// Full state against an empty baseline.
+	entity::serialization::encode_delta(server, baseline, buffer);
+	entity::serialization::apply_delta(client, buffer.data(), buffer.data() + buffer.size());
+	baseline.capture(server);
+
+	// Touch a few fields, add and remove a few components.
+	int changed = 0;
+	for(auto e : server_entities)
+	{
+		int const i = static_cast<int>(e.index());
+		if(i % 30 == 0)
+		{
+			server.get(e)->y += 1.f;
+			++changed;
+		}
+		else if(i % 3 == 1 && i % 7 == 0)
+		{
+			vec3 p = { 1.f, 2.f, 3.f };
+			server.create(e, p);
+			++changed;
+		}
+	}
+
+	server.destroy(entity::make_entity(3));
+	++changed;
+
+	buffer.clear();
+	std::size_t const written =
+		entity::serialization::encode_delta(server, baseline, buffer);
+	BOOST_CHECK_EQUAL(written, changed);
+
+	std::uint8_t const* end = entity::serialization::apply_delta(
+		client, buffer.data(), buffer.data() + buffer.size());
+	BOOST_CHECK(end == buffer.data() + buffer.size());
+
+	BOOST_CHECK_EQUAL(client.size(), server.size());
+	for(auto e : server_entities)
+	{
+		auto s = server.get(e);
+		auto c = client.get(e);
+		BOOST_CHECK_EQUAL(!!s, !!c);
+		if(s && c)
+		{
+			BOOST_CHECK_EQUAL(s->x, c->x);
+			BOOST_CHECK_EQUAL(s->y, c->y);
+			BOOST_CHECK_EQUAL(s->z, c->z);
+		}
+	}
+
+	// Nothing changed since the last capture.
+	baseline.capture(server);
+	buffer.clear();
+	BOOST_CHECK_EQUAL(entity::serialization::encode_delta(server, baseline, buffer), 0);
+	BOOST_CHECK_EQUAL(buffer.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( delta_round_trip )
+{
+	check_delta_round_trip<entity::component::dense_pool<vec3>>();
+	check_delta_round_trip<entity::component::sparse_pool<vec3>>();
+}
+
+BOOST_AUTO_TEST_CASE( delta_saturated )
+{
+	entity::entity_pool entities;
+	entity::component::saturated_pool<vec3> server(entities);
+	entity::component::saturated_pool<vec3> client(entities);
+
+	for(int i = 0; i < kNumEntities; ++i)
+		entities.create();
+
+	entity::serialization::delta_baseline<vec3> baseline(server);
+	for(auto e : entities)
+		server.get(e)->x = float(e.index());
+
+	std::vector<std::uint8_t> buffer;
+	BOOST_CHECK_EQUAL(
+		entity::serialization::encode_delta(server, baseline, buffer),
+		kNumEntities - 1
+	);
+
+	entity::serialization::apply_delta(client, buffer.data(), buffer.data() + buffer.size());
+	for(auto e : entities)
+		BOOST_CHECK_EQUAL(client.get(e)->x, float(e.index()));
+
+	buffer.pop_back();
+	BOOST_CHECK_THROW(
+		entity::serialization::apply_delta(client, buffer.data(), buffer.data() + buffer.size()),
+		std::runtime_error
+	);
+}
+
+BOOST_AUTO_TEST_CASE( delta_mismatch )
+{
+	entity::entity_pool server_entities;
+	entity::component::sparse_pool<vec3> server(server_entities);
+	for(int i = 0; i < kNumEntities; ++i)
+	{
+		vec3 p = { float(i), 0.f, 0.f };
+		server.create(server_entities.create(), p);
+	}
+
+	entity::serialization::delta_baseline<vec3> baseline;
+	std::vector<std::uint8_t> buffer;
+	entity::serialization::encode_delta(server, baseline, buffer);
+
+	// Fewer entities than the delta names.
+	{
+		entity::entity_pool entities;
+		entity::component::sparse_pool<vec3> client(entities);
+		for(int i = 0; i < kNumEntities / 2; ++i)
+			entities.create();
+
+		BOOST_CHECK_THROW(
+			entity::serialization::apply_delta(client, buffer.data(), buffer.data() + buffer.size()),
+			std::runtime_error
+		);
+
+		BOOST_CHECK_EQUAL(client.size(), kNumEntities / 2);
+	}
+
+	entity::entity_pool entities;
+	entity::component::sparse_pool<vec3> client(entities);
+	for(int i = 0; i < kNumEntities; ++i)
+		entities.create();
+
+	// Cut off part way through.
+	BOOST_CHECK_THROW(
+		entity::serialization::apply_delta(client, buffer.data(), buffer.data() + buffer.size() / 2),
+		std::runtime_error
+	);
+
+	// Added over components the client already holds.
+	BOOST_CHECK_THROW(
+		entity::serialization::apply_delta(client, buffer.data(), buffer.data() + buffer.size()),
+		std::runtime_error
+	);
+}
+
+// ----------------------------------------------------------------------------
+//
+template<typename Pool>
+std::vector<std::pair<bool, vec3>> history_state(entity::entity_pool& entities, Pool& pool)
+{
+	std::vector<std::pair<bool, vec3>> state;
+	for(auto e : entities)
+	{
+		auto c = pool.get(e);
+		vec3 const none = { 0.f, 0.f, 0.f };
+		state.push_back(std::make_pair(!!c, c ? *c : none));
+	}
+
+	return state;
+}
+
+template<typename Pool>
+bool history_matches(
+	std::vector<std::pair<bool, vec3>> const& a,
+	std::vector<std::pair<bool, vec3>> const& b)
+{
+	if(a.size() != b.size())
+		return false;
+
+	for(std::size_t i = 0; i < a.size(); ++i)
+	{
+		if(a[i].first != b[i].first)
+			return false;
+
+		if(a[i].first &&
+			(a[i].second.x != b[i].second.x ||
+			 a[i].second.y != b[i].second.y ||
+			 a[i].second.z != b[i].second.z))
+			return false;
+	}
+
+	return true;
+}
+
+template<typename Pool>
+void check_history()
+{
+	entity::entity_pool entities;
+	Pool pool(entities);
+	for(int i = 0; i < kNumEntities; ++i)
+	{
+		auto e = entities.create();
+		vec3 p = { float(i), 0.f, 0.f };
+		*pool.create(e, p) = p;
+	}
+
+	entity::serialization::pool_history<Pool> history(pool, 8);
+	std::vector<std::vector<std::pair<bool, vec3>>> states;
+	states.push_back(history_state(entities, pool));
+
+	std::mt19937 rng(23);
+	auto mutate = [&]()
+	{
+		for(int i = 0; i < 40; ++i)
+		{
+			auto e = entity::make_entity(rng() % kNumEntities);
+			auto c = pool.get(e);
+			if(!c)
+			{
+				vec3 p = { 1.f, 2.f, float(i) };
+				*pool.create(e, p) = p;
+			}
+			else if(rng() % 8 == 0)
+				pool.destroy(e);
+			else
+				c->y += 0.5f;
+		}
+	};
+
+	auto push = [&](std::vector<std::pair<bool, vec3>> const& state)
+	{
+		states.push_back(state);
+		if(states.size() > history.capacity() + 1)
+			states.erase(states.begin());
+		BOOST_CHECK_EQUAL(history.frames(), states.size() - 1);
+	};
+
+	for(int frame = 0; frame < 60; ++frame)
+	{
+		mutate();
+		if(frame % 7 == 3)
+		{
+			// Uncommitted changes are thrown away.
+			history.discard();
+			BOOST_CHECK((history_matches<Pool>(history_state(entities, pool), states.back())));
+			mutate();
+		}
+
+		history.commit();
+		push(history_state(entities, pool));
+
+		if(frame % 10 == 9)
+		{
+			std::size_t const back = rng() % (history.frames() + 1);
+			mutate();
+			history.rollback(back);
+			states.resize(states.size() - back);
+			BOOST_CHECK_EQUAL(history.frames(), states.size() - 1);
+			BOOST_CHECK((history_matches<Pool>(history_state(entities, pool), states.back())));
+
+			// The baseline follows the rollback.
+			BOOST_CHECK_EQUAL(history.commit(), 0);
+			push(states.back());
+		}
+	}
+
+	BOOST_CHECK_THROW(history.rollback(history.frames() + 1), std::out_of_range);
+	history.rollback(history.frames());
+	BOOST_CHECK((history_matches<Pool>(history_state(entities, pool), states.front())));
+}
+
+BOOST_AUTO_TEST_CASE( history_rollback )
+{
+	check_history<entity::component::saturated_pool<vec3>>();
+	check_history<entity::component::dense_pool<vec3>>();
+	check_history<entity::component::sparse_pool<vec3>>();
+}
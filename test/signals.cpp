@@ -10,12 +10,15 @@
 // http://www.boost.org/LICENSE_1_0.txt
 //
 // ****************************************************************************
+#include "entity/component/component_events.hpp"
 #include "entity/component/dense_pool.hpp"
 #include "entity/component/sparse_pool.hpp"
 #include "entity/component/saturated_pool.hpp"
 #include "entity/entity_pool.hpp"
 #include "entity/entity.hpp"
 #include <algorithm>
+#include <random>
+#include <vector>
 
 #define BOOST_TEST_MODULE Signals
 #include <boost/test/unit_test.hpp>
@@ -98,4 +101,138 @@ BOOST_AUTO_TEST_CASE( component_destruction )
 	BOOST_CHECK_EQUAL(sat_pool.size(), 0);
 	BOOST_CHECK_EQUAL(dense_pool.size(), 0);
 	BOOST_CHECK_EQUAL(sparse_pool.size(), 0);
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE( component_events_batch_net_changes )
+{
+	typedef entity::component::sparse_pool<float> pool_type;
+	typedef entity::component::component_events<pool_type> events_type;
+
+	entity::entity_pool entities;
+	pool_type pool(entities);
+	events_type events(entities, pool);
+
+	// A mirror kept up to date only from the batches and the entity
+	// pool's own signals.
+	std::vector<char> mirror;
+	int batches = 0;
+	auto added = events.signals().on_component_added.connect(
+		[&](events_type::entity_range r)
+		{
+			++batches;
+			BOOST_CHECK(std::is_sorted(r.begin(), r.end()));
+			for(auto e : r)
+				mirror[e.index()] = 1;
+		}
+	);
+
+	auto removed = events.signals().on_component_removed.connect(
+		[&](events_type::entity_range r)
+		{
+			for(auto e : r)
+				mirror[e.index()] = 0;
+		}
+	);
+
+	auto created = entities.signals().on_entity_create.connect(
+		[&](entity::entity) { mirror.push_back(0); }
+	);
+
+	auto destroyed = entities.signals().on_entity_destroy.connect(
+		[&](entity::entity) { mirror.pop_back(); }
+	);
+
+	auto swapped = entities.signals().on_entity_swap.connect(
+		[&](entity::entity a, entity::entity b)
+		{
+			std::swap(mirror[a.index()], mirror[b.index()]);
+		}
+	);
+
+	// Created and destroyed inside one batch: nothing to report.
+	auto e = entities.create();
+	events.create(e, 1.f);
+	events.destroy(e);
+	BOOST_CHECK_EQUAL(events.pending(), 1);
+	events.flush();
+	BOOST_CHECK_EQUAL(batches, 0);
+	BOOST_CHECK_EQUAL(events.pending(), 0);
+
+	std::mt19937 rng(49);
+	for(int i = 0; i < 300; ++i)
+		entities.create();
+
+	for(int round = 0; round < 30; ++round)
+	{
+		for(int i = 0; i < 100; ++i)
+		{
+			auto e = entity::make_entity(rng() % entities.size());
+			switch(rng() % 4)
+			{
+			case 0:
+			case 1:
+				if(!pool.get(e))
+					events.create(e, float(i));
+				break;
+			case 2:
+				if(pool.get(e))
+					events.destroy(e);
+				break;
+			default:
+				entities.destroy(e);
+				entities.create();
+				break;
+			}
+		}
+
+		events.flush();
+		BOOST_REQUIRE_EQUAL(mirror.size(), entities.size());
+		for(auto e : entities)
+		{
+			BOOST_CHECK_EQUAL(mirror[e.index()] != 0, static_cast<bool>(pool.get(e)));
+		}
+	}
+
+	BOOST_CHECK_EQUAL(batches, 30);
+
+	// Immediate dispatch reports each change as it's made.
+	entity::entity_pool other;
+	entity::component::dense_pool<int> dense(other);
+	entity::component::component_events<entity::component::dense_pool<int>> now(
+		other, dense, entity::component::event_dispatch::immediate
+	);
+
+	std::vector<std::size_t> seen;
+	auto now_added = now.signals().on_component_added.connect(
+		[&](entity::component::component_events<
+			entity::component::dense_pool<int>>::entity_range r)
+		{
+			for(auto e : r)
+				seen.push_back(e.index());
+		}
+	);
+
+	auto a = other.create();
+	auto b = other.create();
+	now.create(b, 2);
+	BOOST_CHECK_EQUAL(seen.size(), 1);
+	now.create(a, 1);
+	BOOST_CHECK_EQUAL(seen.size(), 2);
+	BOOST_CHECK_EQUAL(seen[0], b.index());
+	BOOST_CHECK_EQUAL(now.pending(), 0);
+
+	// Anything not flushed is dropped with the events, not reported.
+	int late = 0;
+	{
+		events_type unflushed(entities, pool);
+		auto late_added = unflushed.signals().on_component_added.connect(
+			[&](events_type::entity_range) { ++late; }
+		);
+
+		auto last = entities.create();
+		unflushed.create(last, 1.f);
+		BOOST_CHECK_EQUAL(unflushed.pending(), 1);
+	}
+
+	BOOST_CHECK_EQUAL(late, 0);
+}